@@ -0,0 +1,207 @@
+//
+// Aspia Project
+// Copyright (C) 2020 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+
+#include "base/codec/chunk_compressor.h"
+
+#include "base/logging.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace base {
+
+namespace {
+
+// The sample consists of several blocks evenly distributed over the chunk.
+const size_t kSampleBlockCount = 16;
+const size_t kSampleBlockSize = 256;
+
+// Samples of compressed data have an entropy close to 8 bits per byte (about 7.95 for a sample
+// of 4 kB). Text, executables and uncompressed images have a much lower entropy.
+const double kMaxEntropy = 7.5;
+
+// A chunk must shrink at least by 1/16 of its size to be sent compressed.
+const size_t kMinGainDivisor = 16;
+
+// The maximum number of chunks skipped after an incompressible chunk.
+const int kMaxSkipInterval = 32;
+
+} // namespace
+
+ChunkCompressor::ChunkCompressor(int compression_level)
+    : compression_level_(compression_level),
+      cctx_(ZSTD_createCStream())
+{
+    DCHECK(cctx_);
+}
+
+ChunkCompressor::~ChunkCompressor() = default;
+
+bool ChunkCompressor::compress(std::string_view input, std::string* output)
+{
+    DCHECK(output);
+
+    input_bytes_ += input.size();
+
+    if (input.size() < kMinChunkSize)
+    {
+        output_bytes_ += input.size();
+        return false;
+    }
+
+    if (skip_count_ > 0)
+    {
+        --skip_count_;
+        output_bytes_ += input.size();
+        return false;
+    }
+
+    if (sampleEntropy(input) > kMaxEntropy)
+    {
+        onIncompressibleChunk();
+        output_bytes_ += input.size();
+        return false;
+    }
+
+    output->resize(ZSTD_compressBound(input.size()));
+
+    const size_t ret = ZSTD_compressCCtx(cctx_.get(), output->data(), output->size(),
+                                         input.data(), input.size(), compression_level_);
+    if (ZSTD_isError(ret))
+    {
+        LOG(LS_ERROR) << "ZSTD_compressCCtx failed: " << ZSTD_getErrorName(ret);
+        output_bytes_ += input.size();
+        return false;
+    }
+
+    if (ret > input.size() - input.size() / kMinGainDivisor)
+    {
+        onIncompressibleChunk();
+        output_bytes_ += input.size();
+        return false;
+    }
+
+    output->resize(ret);
+    output_bytes_ += ret;
+    skip_interval_ = 0;
+    return true;
+}
+
+void ChunkCompressor::reset()
+{
+    skip_count_ = 0;
+    skip_interval_ = 0;
+}
+
+// static
+double ChunkCompressor::sampleEntropy(std::string_view input)
+{
+    if (input.empty())
+        return 0;
+
+    uint32_t histogram[256] = { 0 };
+    size_t sample_size = 0;
+
+    auto add_block = [&](size_t offset, size_t size)
+    {
+        const uint8_t* block = reinterpret_cast<const uint8_t*>(input.data()) + offset;
+
+        for (size_t i = 0; i < size; ++i)
+            ++histogram[block[i]];
+
+        sample_size += size;
+    };
+
+    if (input.size() <= kSampleBlockCount * kSampleBlockSize)
+    {
+        add_block(0, input.size());
+    }
+    else
+    {
+        const size_t step = (input.size() - kSampleBlockSize) / (kSampleBlockCount - 1);
+
+        for (size_t i = 0; i < kSampleBlockCount; ++i)
+            add_block(i * step, kSampleBlockSize);
+    }
+
+    double entropy = 0;
+
+    for (uint32_t count : histogram)
+    {
+        if (!count)
+            continue;
+
+        const double probability = static_cast<double>(count) / static_cast<double>(sample_size);
+        entropy -= probability * std::log2(probability);
+    }
+
+    return entropy;
+}
+
+void ChunkCompressor::onIncompressibleChunk()
+{
+    skip_interval_ = std::min(std::max(skip_interval_ * 2, 1), kMaxSkipInterval);
+    skip_count_ = skip_interval_;
+}
+
+ChunkDecompressor::ChunkDecompressor()
+    : dctx_(ZSTD_createDStream())
+{
+    DCHECK(dctx_);
+}
+
+ChunkDecompressor::~ChunkDecompressor() = default;
+
+bool ChunkDecompressor::decompress(std::string_view input, size_t max_size, std::string* output)
+{
+    DCHECK(output);
+
+    const unsigned long long output_size = ZSTD_getFrameContentSize(input.data(), input.size());
+    if (output_size == ZSTD_CONTENTSIZE_ERROR || output_size == ZSTD_CONTENTSIZE_UNKNOWN)
+    {
+        LOG(LS_ERROR) << "Invalid compressed chunk";
+        return false;
+    }
+
+    if (output_size > max_size)
+    {
+        LOG(LS_ERROR) << "Too large compressed chunk: " << output_size;
+        return false;
+    }
+
+    output->resize(static_cast<size_t>(output_size));
+
+    const size_t ret = ZSTD_decompressDCtx(
+        dctx_.get(), output->data(), output->size(), input.data(), input.size());
+    if (ZSTD_isError(ret))
+    {
+        LOG(LS_ERROR) << "ZSTD_decompressDCtx failed: " << ZSTD_getErrorName(ret);
+        return false;
+    }
+
+    if (ret != output->size())
+    {
+        LOG(LS_ERROR) << "Wrong size of decompressed chunk: " << ret;
+        return false;
+    }
+
+    return true;
+}
+
+} // namespace base
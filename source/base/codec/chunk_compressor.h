@@ -0,0 +1,95 @@
+//
+// Aspia Project
+// Copyright (C) 2020 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+
+#ifndef BASE__CODEC__CHUNK_COMPRESSOR_H
+#define BASE__CODEC__CHUNK_COMPRESSOR_H
+
+#include "base/macros_magic.h"
+#include "base/codec/scoped_zstd_stream.h"
+
+#include <string>
+#include <string_view>
+
+namespace base {
+
+// Compresses independent chunks of a data stream (for example, packets of a file) with Zstd.
+// Data that is already compressed (archives, images, video) is detected by the entropy of a small
+// sample of the chunk and is not compressed. After such a chunk the following chunks are skipped
+// without sampling, the number of skipped chunks grows while the data remains incompressible.
+class ChunkCompressor
+{
+public:
+    // The fastest level gives the best throughput for links up to several Gbit/s.
+    static const int kDefaultCompressionLevel = 1;
+
+    // Chunks smaller than this are not compressed.
+    static const size_t kMinChunkSize = 512;
+
+    explicit ChunkCompressor(int compression_level = kDefaultCompressionLevel);
+    ~ChunkCompressor();
+
+    // Compresses |input| into |output|. Returns false if the chunk should be sent without
+    // compression. In this case the contents of |output| are undefined.
+    bool compress(std::string_view input, std::string* output);
+
+    // Resets the state of the skipping of incompressible chunks. Called when a new stream begins.
+    void reset();
+
+    // Returns the entropy of a sample of |input| in bits per byte (from 0 to 8).
+    static double sampleEntropy(std::string_view input);
+
+    // Total sizes of the chunks passed to compress() and of the data produced, including the
+    // chunks left uncompressed.
+    uint64_t inputBytes() const { return input_bytes_; }
+    uint64_t outputBytes() const { return output_bytes_; }
+
+private:
+    void onIncompressibleChunk();
+
+    const int compression_level_;
+    ScopedZstdCStream cctx_;
+
+    int skip_count_ = 0;
+    int skip_interval_ = 0;
+
+    uint64_t input_bytes_ = 0;
+    uint64_t output_bytes_ = 0;
+
+    DISALLOW_COPY_AND_ASSIGN(ChunkCompressor);
+};
+
+class ChunkDecompressor
+{
+public:
+    ChunkDecompressor();
+    ~ChunkDecompressor();
+
+    // Decompresses the chunk produced by ChunkCompressor into |output|. Returns false if the data
+    // is corrupted or the size of the decompressed chunk exceeds |max_size|.
+    bool decompress(std::string_view input, size_t max_size, std::string* output);
+
+private:
+    ScopedZstdDStream dctx_;
+
+    DISALLOW_COPY_AND_ASSIGN(ChunkDecompressor);
+};
+
+} // namespace base
+
+#endif // BASE__CODEC__CHUNK_COMPRESSOR_H
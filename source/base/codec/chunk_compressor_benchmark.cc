@@ -0,0 +1,186 @@
+//
+// Aspia Project
+// Copyright (C) 2020 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+// Measures the compression ratio and the throughput of ChunkCompressor for text, binary,
+// compressed and sparse data, and the throughput of Zstd for the same chunks without the
+// entropy heuristic.
+//
+// Usage: aspia_chunk_compressor_benchmark
+
+#include "base/codec/chunk_compressor.h"
+
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+const size_t kItemSize = 16 * 1024 * 1024;
+const size_t kChunkSize = 64 * 1024;
+
+std::string randomData(size_t size, uint32_t seed)
+{
+    std::mt19937 engine(seed);
+    std::string data(size, 0);
+
+    for (size_t i = 0; i < size; ++i)
+        data[i] = static_cast<char>(engine() & 0xFF);
+
+    return data;
+}
+
+std::string textData(size_t size, uint32_t seed)
+{
+    static const char* kWords[] =
+    {
+        "connection", "session", "established", "closed", "error", "file", "directory",
+        "transfer", "packet", "received", "sent", "bytes", "user", "host", "router", "the", "of"
+    };
+
+    std::mt19937 engine(seed);
+    std::string data;
+
+    while (data.size() < size)
+    {
+        data += "2020-05-14 12:";
+        data += std::to_string(engine() % 60);
+        data += ' ';
+
+        for (uint32_t i = engine() % 12 + 3; i != 0; --i)
+        {
+            data += kWords[engine() % std::size(kWords)];
+            data += ' ';
+        }
+
+        data += std::to_string(engine() % 100000);
+        data += '\n';
+    }
+
+    data.resize(size);
+    return data;
+}
+
+std::string binaryData(size_t size, uint32_t seed)
+{
+    std::mt19937 engine(seed);
+    std::string data(size, 0);
+
+    // Records of a table with small integers and a few random fields.
+    for (size_t i = 0; i + 16 <= size; i += 16)
+    {
+        data[i] = static_cast<char>(i / 16);
+        data[i + 4] = static_cast<char>(engine() % 8);
+        data[i + 8] = static_cast<char>(engine() & 0xFF);
+        data[i + 12] = 1;
+    }
+
+    return data;
+}
+
+struct CorpusItem
+{
+    const char* name;
+    std::string data;
+};
+
+std::vector<CorpusItem> mixedCorpus(size_t item_size)
+{
+    std::vector<CorpusItem> corpus;
+
+    corpus.push_back({ "text (logs, sources)", textData(item_size, 1) });
+    corpus.push_back({ "binary (tables, executables)", binaryData(item_size, 2) });
+    corpus.push_back({ "compressed (zip, jpg, mp4)", randomData(item_size, 3) });
+    corpus.push_back({ "sparse (disk images)", std::string(item_size, 0) });
+
+    return corpus;
+}
+
+} // namespace
+
+int main(int /* argc */, const char* const* /* argv */)
+{
+    base::ChunkCompressor compressor;
+    base::ChunkDecompressor decompressor;
+    base::ScopedZstdCStream cctx(ZSTD_createCStream());
+
+    std::string compressed;
+    std::string decompressed;
+    std::string forced;
+
+    for (const auto& item : mixedCorpus(kItemSize))
+    {
+        compressor.reset();
+
+        const uint64_t input_bytes = compressor.inputBytes();
+        const uint64_t output_bytes = compressor.outputBytes();
+
+        std::chrono::duration<double> compress_time(0);
+        std::chrono::duration<double> decompress_time(0);
+        std::chrono::duration<double> forced_time(0);
+
+        for (size_t offset = 0; offset < item.data.size(); offset += kChunkSize)
+        {
+            const std::string_view chunk =
+                std::string_view(item.data).substr(offset, kChunkSize);
+
+            Clock::time_point start_time = Clock::now();
+            const bool is_compressed = compressor.compress(chunk, &compressed);
+            compress_time += Clock::now() - start_time;
+
+            if (is_compressed)
+            {
+                start_time = Clock::now();
+                const bool is_decompressed =
+                    decompressor.decompress(compressed, kChunkSize, &decompressed);
+                decompress_time += Clock::now() - start_time;
+
+                if (!is_decompressed || decompressed != chunk)
+                {
+                    fprintf(stderr, "%s: the round trip failed\n", item.name);
+                    return 1;
+                }
+            }
+
+            // The same chunk compressed without the heuristic.
+            forced.resize(ZSTD_compressBound(chunk.size()));
+
+            start_time = Clock::now();
+            ZSTD_compressCCtx(cctx.get(), forced.data(), forced.size(), chunk.data(), chunk.size(),
+                              base::ChunkCompressor::kDefaultCompressionLevel);
+            forced_time += Clock::now() - start_time;
+        }
+
+        const double size_mb =
+            static_cast<double>(compressor.inputBytes() - input_bytes) / (1024 * 1024);
+
+        printf("%-30s ratio: %5.1f%%, compress: %7.0f MB/s (without heuristic: %7.0f MB/s), "
+               "decompress: %7.0f MB/s\n",
+               item.name,
+               static_cast<double>(compressor.outputBytes() - output_bytes) * 100.0 /
+                   static_cast<double>(compressor.inputBytes() - input_bytes),
+               size_mb / compress_time.count(),
+               size_mb / forced_time.count(),
+               decompress_time.count() > 0 ? size_mb / decompress_time.count() : 0.0);
+    }
+
+    return 0;
+}
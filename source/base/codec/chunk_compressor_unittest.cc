@@ -0,0 +1,210 @@
+//
+// Aspia Project
+// Copyright (C) 2020 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+
+#include "base/codec/chunk_compressor.h"
+
+#include <gtest/gtest.h>
+
+#include <random>
+
+namespace base {
+
+namespace {
+
+const size_t kChunkSize = 64 * 1024;
+
+std::string randomData(size_t size, uint32_t seed)
+{
+    std::mt19937 engine(seed);
+    std::string data(size, 0);
+
+    for (size_t i = 0; i < size; ++i)
+        data[i] = static_cast<char>(engine() & 0xFF);
+
+    return data;
+}
+
+std::string textData(size_t size, uint32_t seed)
+{
+    static const char* kWords[] =
+    {
+        "connection", "session", "established", "closed", "error", "file", "directory",
+        "transfer", "packet", "received", "sent", "bytes", "user", "host", "router", "the", "of"
+    };
+
+    std::mt19937 engine(seed);
+    std::string data;
+
+    while (data.size() < size)
+    {
+        data += "2020-05-14 12:";
+        data += std::to_string(engine() % 60);
+        data += ' ';
+
+        for (uint32_t i = engine() % 12 + 3; i != 0; --i)
+        {
+            data += kWords[engine() % std::size(kWords)];
+            data += ' ';
+        }
+
+        data += std::to_string(engine() % 100000);
+        data += '\n';
+    }
+
+    data.resize(size);
+    return data;
+}
+
+std::string binaryData(size_t size, uint32_t seed)
+{
+    std::mt19937 engine(seed);
+    std::string data(size, 0);
+
+    // Records of a table with small integers and a few random fields.
+    for (size_t i = 0; i + 16 <= size; i += 16)
+    {
+        data[i] = static_cast<char>(i / 16);
+        data[i + 4] = static_cast<char>(engine() % 8);
+        data[i + 8] = static_cast<char>(engine() & 0xFF);
+        data[i + 12] = 1;
+    }
+
+    return data;
+}
+
+struct CorpusItem
+{
+    const char* name;
+    std::string data;
+};
+
+std::vector<CorpusItem> mixedCorpus(size_t item_size)
+{
+    std::vector<CorpusItem> corpus;
+
+    corpus.push_back({ "text (logs, sources)", textData(item_size, 1) });
+    corpus.push_back({ "binary (tables, executables)", binaryData(item_size, 2) });
+    corpus.push_back({ "compressed (zip, jpg, mp4)", randomData(item_size, 3) });
+    corpus.push_back({ "sparse (disk images)", std::string(item_size, 0) });
+
+    return corpus;
+}
+
+} // namespace
+
+TEST(ChunkCompressorTest, SampleEntropy)
+{
+    EXPECT_EQ(ChunkCompressor::sampleEntropy(std::string()), 0);
+    EXPECT_EQ(ChunkCompressor::sampleEntropy(std::string(kChunkSize, 'a')), 0);
+    EXPECT_GT(ChunkCompressor::sampleEntropy(randomData(kChunkSize, 1)), 7.8);
+    EXPECT_LT(ChunkCompressor::sampleEntropy(textData(kChunkSize, 1)), 6.0);
+}
+
+TEST(ChunkCompressorTest, RoundTrip)
+{
+    ChunkCompressor compressor;
+    ChunkDecompressor decompressor;
+
+    const std::string input = textData(kChunkSize, 1);
+
+    std::string compressed;
+    ASSERT_TRUE(compressor.compress(input, &compressed));
+    EXPECT_LT(compressed.size(), input.size() / 2);
+
+    std::string output;
+    ASSERT_TRUE(decompressor.decompress(compressed, input.size(), &output));
+    EXPECT_EQ(output, input);
+
+    // The size of the decompressed chunk is limited.
+    EXPECT_FALSE(decompressor.decompress(compressed, input.size() - 1, &output));
+
+    // Corrupted data.
+    EXPECT_FALSE(decompressor.decompress(input, input.size(), &output));
+    EXPECT_FALSE(decompressor.decompress(compressed.substr(0, compressed.size() / 2),
+                                         input.size(), &output));
+}
+
+TEST(ChunkCompressorTest, SmallChunk)
+{
+    ChunkCompressor compressor;
+    std::string output;
+
+    EXPECT_FALSE(compressor.compress(std::string(ChunkCompressor::kMinChunkSize - 1, 0), &output));
+    EXPECT_TRUE(compressor.compress(std::string(ChunkCompressor::kMinChunkSize, 0), &output));
+}
+
+TEST(ChunkCompressorTest, SkipIncompressible)
+{
+    ChunkCompressor compressor;
+    std::string output;
+
+    const std::string random = randomData(kChunkSize, 1);
+    const std::string text = textData(kChunkSize, 1);
+
+    EXPECT_FALSE(compressor.compress(random, &output));
+
+    // One chunk is skipped after the first incompressible chunk.
+    EXPECT_FALSE(compressor.compress(text, &output));
+    EXPECT_TRUE(compressor.compress(text, &output));
+
+    // The interval grows while the data remains incompressible.
+    EXPECT_FALSE(compressor.compress(random, &output));
+    EXPECT_FALSE(compressor.compress(random, &output));
+    EXPECT_FALSE(compressor.compress(random, &output));
+    EXPECT_FALSE(compressor.compress(text, &output));
+    EXPECT_FALSE(compressor.compress(text, &output));
+    EXPECT_TRUE(compressor.compress(text, &output));
+
+    // A new stream starts without skipping.
+    EXPECT_FALSE(compressor.compress(random, &output));
+    compressor.reset();
+    EXPECT_TRUE(compressor.compress(text, &output));
+
+    EXPECT_EQ(compressor.inputBytes(), 11 * kChunkSize);
+    EXPECT_LT(compressor.outputBytes(), compressor.inputBytes());
+}
+
+TEST(ChunkCompressorTest, MixedCorpus)
+{
+    ChunkCompressor compressor;
+    ChunkDecompressor decompressor;
+
+    std::string compressed;
+    std::string decompressed;
+
+    for (const auto& item : mixedCorpus(16 * kChunkSize))
+    {
+        compressor.reset();
+
+        for (size_t offset = 0; offset < item.data.size(); offset += kChunkSize)
+        {
+            const std::string_view chunk =
+                std::string_view(item.data).substr(offset, kChunkSize);
+
+            if (!compressor.compress(chunk, &compressed))
+                continue;
+
+            EXPECT_LT(compressed.size(), chunk.size()) << item.name;
+            ASSERT_TRUE(decompressor.decompress(compressed, kChunkSize, &decompressed));
+            ASSERT_EQ(decompressed, chunk) << item.name;
+        }
+    }
+}
+
+} // namespace base
@@ -20,11 +20,45 @@
 
 #include "base/logging.h"
 #include "base/desktop/frame_simple.h"
+#include "base/threading/parallel_for.h"
 
 #include <libyuv/scale_argb.h>
 
+#include <algorithm>
+
 namespace base {
 
+namespace {
+
+// The rectangles of the target frame are aligned to blocks of this size. libyuv gives the same
+// pixels for a part of the frame as for the whole frame only when the width of the part is a
+// multiple of 4.
+const int kBlockSize = 4;
+
+// The updated region is scaled in bands of rows on several threads when it is larger than this
+// (in pixels of the target frame).
+const int64_t kMinAreaForParallelScaling = 256 * 256;
+
+// Each band has at least this number of rows.
+const int kMinRowsPerBand = 64;
+
+int alignDown(int value)
+{
+    return value & ~(kBlockSize - 1);
+}
+
+int alignUp(int value)
+{
+    return alignDown(value + kBlockSize - 1);
+}
+
+libyuv::FilterMode filterMode(ScaleReducer::Filter filter)
+{
+    return filter == ScaleReducer::Filter::BILINEAR ? libyuv::kFilterBilinear : libyuv::kFilterBox;
+}
+
+} // namespace
+
 ScaleReducer::ScaleReducer() = default;
 
 ScaleReducer::~ScaleReducer() = default;
@@ -32,7 +66,14 @@ ScaleReducer::~ScaleReducer() = default;
 const Frame* ScaleReducer::scaleFrame(const Frame* source_frame, const Size& target_size)
 {
     DCHECK(source_frame);
-    DCHECK(!source_frame->constUpdatedRegion().isEmpty());
+    return scaleFrame(source_frame, source_frame->constUpdatedRegion(), target_size);
+}
+
+const Frame* ScaleReducer::scaleFrame(
+    const Frame* source_frame, const Region& updated_region, const Size& target_size)
+{
+    DCHECK(source_frame);
+    DCHECK(!updated_region.isEmpty());
     DCHECK(source_frame->format() == PixelFormat::ARGB());
 
     const Size& source_size = source_frame->size();
@@ -49,15 +90,28 @@ const Frame* ScaleReducer::scaleFrame(const Frame* source_frame, const Size& tar
         target_size_ = target_size;
         target_frame_.reset();
 
+        // The bilinear filter samples only 2x2 source pixels for each target pixel. Below half of
+        // the size it skips source pixels and the box filter is used.
+        if (target_size.width() * 2 >= source_size.width() &&
+            target_size.height() * 2 >= source_size.height())
+        {
+            filter_ = Filter::BILINEAR;
+        }
+        else
+        {
+            filter_ = Filter::BOX;
+        }
+
         LOG(LS_INFO) << "Scale mode changed (dpi:" << source_frame->dpi()
                      << " source:" << source_size << " target:" << target_size
-                     << " scale_x:" << scale_x_ << " scale_y:" << scale_y_ << ")";
+                     << " scale_x:" << scale_x_ << " scale_y:" << scale_y_
+                     << " filter:" << (filter_ == Filter::BILINEAR ? "bilinear" : "box") << ")";
     }
 
     if (source_size == target_size)
         return source_frame;
 
-    Rect target_frame_rect = Rect::makeSize(target_size);
+    const Rect target_frame_rect = Rect::makeSize(target_size);
 
     if (!target_frame_)
     {
@@ -65,62 +119,99 @@ const Frame* ScaleReducer::scaleFrame(const Frame* source_frame, const Size& tar
         if (!target_frame_)
             return nullptr;
 
-        target_frame_->updatedRegion()->addRect(target_frame_rect);
-
-        libyuv::ARGBScale(source_frame->frameData(),
-                          source_frame->stride(),
-                          source_size.width(),
-                          source_size.height(),
-                          target_frame_->frameData(),
-                          target_frame_->stride(),
-                          target_size.width(),
-                          target_size.height(),
-                          libyuv::kFilterBox);
+        target_frame_->updatedRegion()->setRect(target_frame_rect);
     }
     else
     {
-        Region* updated_region = target_frame_->updatedRegion();
-        updated_region->clear();
+        // The neighboring rectangles of the source frame overlap after scaling. They are merged
+        // in the region, so no area is scaled twice.
+        Region* target_region = target_frame_->updatedRegion();
+        target_region->clear();
+
+        for (Region::Iterator it(updated_region); !it.isAtEnd(); it.advance())
+            target_region->addRect(scaledRect(it.rect()));
+    }
+
+    target_rects_.clear();
+    int64_t updated_area = 0;
 
-        for (Region::Iterator it(source_frame->constUpdatedRegion());
-             !it.isAtEnd(); it.advance())
+    for (Region::Iterator it(target_frame_->constUpdatedRegion()); !it.isAtEnd(); it.advance())
+    {
+        const Rect& rect = it.rect();
+
+        updated_area += static_cast<int64_t>(rect.width()) * rect.height();
+        target_rects_.push_back(rect);
+    }
+
+    if (!parallel_scaling_ || updated_area < kMinAreaForParallelScaling)
+    {
+        scaleRects(source_frame, target_frame_rect);
+    }
+    else
+    {
+        // Each band scales the parts of the rectangles that are within its rows.
+        ParallelFor::run(target_size.height(), kMinRowsPerBand, kBlockSize,
+                         [&](int top, int bottom)
         {
-            Rect target_rect = scaledRect(it.rect());
-            target_rect.intersectWith(target_frame_rect);
-
-            libyuv::ARGBScaleClip(source_frame->frameData(),
-                                  source_frame->stride(),
-                                  source_size.width(),
-                                  source_size.height(),
-                                  target_frame_->frameData(),
-                                  target_frame_->stride(),
-                                  target_size.width(),
-                                  target_size.height(),
-                                  target_rect.x(),
-                                  target_rect.y(),
-                                  target_rect.width(),
-                                  target_rect.height(),
-                                  libyuv::kFilterBox);
-
-            updated_region->addRect(target_rect);
-        }
+            scaleRects(source_frame, Rect::makeLTRB(0, top, target_size.width(), bottom));
+        });
     }
 
     return target_frame_.get();
 }
 
-Rect ScaleReducer::scaledRect(const Rect& source_rect)
+Rect ScaleReducer::scaledRect(const Rect& source_rect) const
 {
-    int left = static_cast<int>(
-        static_cast<double>(source_rect.left() * scale_x_) / 100.0);
-    int top = static_cast<int>(
-        static_cast<double>(source_rect.top() * scale_y_) / 100.0);
+    // The target pixels whose source areas intersect the rectangle. The coordinates are rounded
+    // outwards.
+    const int64_t source_width = source_size_.width();
+    const int64_t source_height = source_size_.height();
+    const int64_t target_width = target_size_.width();
+    const int64_t target_height = target_size_.height();
+
+    int left = static_cast<int>(source_rect.left() * target_width / source_width);
+    int top = static_cast<int>(source_rect.top() * target_height / source_height);
     int right = static_cast<int>(
-        static_cast<double>(source_rect.right() * scale_x_) / 100.0);
+        (source_rect.right() * target_width + source_width - 1) / source_width);
     int bottom = static_cast<int>(
-        static_cast<double>(source_rect.bottom() * scale_y_) / 100.0);
+        (source_rect.bottom() * target_height + source_height - 1) / source_height);
+
+    // libyuv steps through the source in 16.16 fixed point and the bilinear filter also reads the
+    // neighbors of the sample point. One more pixel on each side covers both.
+    left = alignDown(std::max(left - 1, 0));
+    top = alignDown(std::max(top - 1, 0));
+    right = std::min(alignUp(right + 1), target_size_.width());
+    bottom = std::min(alignUp(bottom + 1), target_size_.height());
+
+    return Rect::makeLTRB(left, top, right, bottom);
+}
+
+void ScaleReducer::scaleRects(const Frame* source_frame, const Rect& band_rect)
+{
+    const libyuv::FilterMode filter_mode = filterMode(filter_);
 
-    return Rect::makeLTRB(left - 1, top - 1, right + 2, bottom + 2);
+    for (const auto& rect : target_rects_)
+    {
+        Rect part = rect;
+        part.intersectWith(band_rect);
+
+        if (part.isEmpty())
+            continue;
+
+        libyuv::ARGBScaleClip(source_frame->frameData(),
+                              source_frame->stride(),
+                              source_size_.width(),
+                              source_size_.height(),
+                              target_frame_->frameData(),
+                              target_frame_->stride(),
+                              target_size_.width(),
+                              target_size_.height(),
+                              part.x(),
+                              part.y(),
+                              part.width(),
+                              part.height(),
+                              filter_mode);
+    }
 }
 
 } // namespace base
@@ -23,10 +23,12 @@
 #include "base/desktop/geometry.h"
 
 #include <memory>
+#include <vector>
 
 namespace base {
 
 class Frame;
+class Region;
 
 class ScaleReducer
 {
@@ -34,19 +36,41 @@ public:
     ScaleReducer();
     ~ScaleReducer();
 
+    enum class Filter { BILINEAR, BOX };
+
+    // Returns the frame scaled to |target_size|. Only the areas of the target frame that are
+    // affected by |updated_region| of the source frame are scaled again. If the sizes are equal,
+    // the source frame is returned.
+    const Frame* scaleFrame(const Frame* source_frame, const Region& updated_region,
+                            const Size& target_size);
+
+    // Same as above for the updated region of the source frame.
     const Frame* scaleFrame(const Frame* source_frame, const Size& target_size);
 
     double scaleFactorX() const { return scale_x_; }
     double scaleFactorY() const { return scale_y_; }
 
+    // The filter for the current sizes. Below half of the size the bilinear filter would skip
+    // source pixels and the box filter is used.
+    Filter filter() const { return filter_; }
+
+    // Large regions are scaled in bands of rows on several threads. Enabled by default.
+    void setParallelScaling(bool enable) { parallel_scaling_ = enable; }
+
 private:
-    Rect scaledRect(const Rect& source_rect);
+    Rect scaledRect(const Rect& source_rect) const;
+    void scaleRects(const Frame* source_frame, const Rect& band_rect);
 
     std::unique_ptr<Frame> target_frame_;
     Size source_size_;
     Size target_size_;
     double scale_x_ = 0;
     double scale_y_ = 0;
+    Filter filter_ = Filter::BOX;
+    bool parallel_scaling_ = true;
+
+    // The target rectangles that are scaled for the current frame. Kept to reuse the memory.
+    std::vector<Rect> target_rects_;
 
     DISALLOW_COPY_AND_ASSIGN(ScaleReducer);
 };
@@ -0,0 +1,264 @@
+//
+// Aspia Project
+// Copyright (C) 2020 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+// Compares the time to scale the updated regions of a frame with the previous implementation (each
+// updated rectangle scaled separately with the box filter), with ScaleReducer in one thread and
+// with ScaleReducer in bands, and counts the pixels of the previous implementation that differ
+// from the whole frame scaled at once.
+//
+// Usage: aspia_scale_reducer_benchmark
+
+#include "base/codec/scale_reducer.h"
+
+#include "base/desktop/frame_simple.h"
+
+#include <libyuv/scale_argb.h>
+
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <random>
+#include <vector>
+
+namespace {
+
+void fillRect(base::Frame* frame, const base::Rect& rect, std::mt19937* random)
+{
+    for (int y = rect.top(); y < rect.bottom(); ++y)
+    {
+        uint32_t* row = reinterpret_cast<uint32_t*>(frame->frameDataAtPos(rect.left(), y));
+
+        for (int x = 0; x < rect.width(); ++x)
+            row[x] = (*random)();
+    }
+}
+
+libyuv::FilterMode filterMode(base::ScaleReducer::Filter filter)
+{
+    return filter == base::ScaleReducer::Filter::BILINEAR ?
+        libyuv::kFilterBilinear : libyuv::kFilterBox;
+}
+
+// The whole frame scaled at once.
+std::unique_ptr<base::Frame> scaleWhole(const base::Frame& source, const base::Size& target_size,
+                                        base::ScaleReducer::Filter filter)
+{
+    std::unique_ptr<base::Frame> target =
+        base::FrameSimple::create(target_size, base::PixelFormat::ARGB());
+
+    libyuv::ARGBScale(source.frameData(), source.stride(),
+                      source.size().width(), source.size().height(),
+                      target->frameData(), target->stride(),
+                      target_size.width(), target_size.height(),
+                      filterMode(filter));
+    return target;
+}
+
+int countDifferentPixels(const base::Frame& frame1, const base::Frame& frame2)
+{
+    int count = 0;
+
+    for (int y = 0; y < frame1.size().height(); ++y)
+    {
+        const uint32_t* row1 = reinterpret_cast<const uint32_t*>(frame1.frameDataAtPos(0, y));
+        const uint32_t* row2 = reinterpret_cast<const uint32_t*>(frame2.frameDataAtPos(0, y));
+
+        for (int x = 0; x < frame1.size().width(); ++x)
+        {
+            if (row1[x] != row2[x])
+                ++count;
+        }
+    }
+
+    return count;
+}
+
+// The previous implementation: each updated rectangle is scaled separately with the box filter
+// and padded by 1-2 pixels.
+class OldScaleReducer
+{
+public:
+    const base::Frame* scaleFrame(const base::Frame* source_frame, const base::Size& target_size)
+    {
+        const base::Size& source_size = source_frame->size();
+        const double scale_x = static_cast<double>(target_size.width() * 100.0) /
+            static_cast<double>(source_size.width());
+        const double scale_y = static_cast<double>(target_size.height() * 100.0) /
+            static_cast<double>(source_size.height());
+
+        if (!target_frame_)
+            target_frame_ = base::FrameSimple::create(target_size, base::PixelFormat::ARGB());
+
+        const base::Rect target_frame_rect = base::Rect::makeSize(target_size);
+
+        for (base::Region::Iterator it(source_frame->constUpdatedRegion());
+             !it.isAtEnd(); it.advance())
+        {
+            const base::Rect& rect = it.rect();
+
+            base::Rect target_rect = base::Rect::makeLTRB(
+                static_cast<int>(static_cast<double>(rect.left() * scale_x) / 100.0) - 1,
+                static_cast<int>(static_cast<double>(rect.top() * scale_y) / 100.0) - 1,
+                static_cast<int>(static_cast<double>(rect.right() * scale_x) / 100.0) + 2,
+                static_cast<int>(static_cast<double>(rect.bottom() * scale_y) / 100.0) + 2);
+            target_rect.intersectWith(target_frame_rect);
+
+            libyuv::ARGBScaleClip(source_frame->frameData(), source_frame->stride(),
+                                  source_size.width(), source_size.height(),
+                                  target_frame_->frameData(), target_frame_->stride(),
+                                  target_size.width(), target_size.height(),
+                                  target_rect.x(), target_rect.y(),
+                                  target_rect.width(), target_rect.height(),
+                                  libyuv::kFilterBox);
+        }
+
+        return target_frame_.get();
+    }
+
+private:
+    std::unique_ptr<base::Frame> target_frame_;
+};
+
+} // namespace
+
+int main(int /* argc */, const char* const* /* argv */)
+{
+    static const base::Size kSourceSize(2560, 1440);
+    static const base::Size kTargetSizes[] =
+        { base::Size(1920, 1080), base::Size(1280, 720), base::Size(854, 480) };
+    static const int kFrames = 100;
+
+    // The differ reports the changes in blocks of 16x16 pixels.
+    static const int kDifferBlockSize = 16;
+
+    struct Scenario
+    {
+        const char* name;
+        int rect_count;
+        int max_blocks_x;
+        int max_blocks_y;
+    };
+
+    // Typing changes short runs of blocks in several lines; moving windows and video change few
+    // large areas.
+    static const Scenario kScenarios[] =
+    {
+        { "typing", 8, 20, 2 },
+        { "windows", 6, 25, 25 },
+        { "full screen", 0, 0, 0 }
+    };
+
+    std::mt19937 random(1);
+
+    std::unique_ptr<base::Frame> source =
+        base::FrameSimple::create(kSourceSize, base::PixelFormat::ARGB());
+    fillRect(source.get(), base::Rect::makeSize(kSourceSize), &random);
+
+    for (const auto& target_size : kTargetSizes)
+    {
+        for (const auto& scenario : kScenarios)
+        {
+            std::vector<base::Region> updates(kFrames);
+            for (auto& update : updates)
+            {
+                if (!scenario.rect_count)
+                {
+                    update.addRect(base::Rect::makeSize(kSourceSize));
+                    continue;
+                }
+
+                for (int i = 0; i < scenario.rect_count; ++i)
+                {
+                    const int columns = kSourceSize.width() / kDifferBlockSize;
+                    const int rows = kSourceSize.height() / kDifferBlockSize;
+                    const int x = static_cast<int>(random() % static_cast<uint32_t>(columns));
+                    const int y = static_cast<int>(random() % static_cast<uint32_t>(rows));
+                    const int width = 1 + static_cast<int>(
+                        random() % static_cast<uint32_t>(scenario.max_blocks_x));
+                    const int height = 1 + static_cast<int>(
+                        random() % static_cast<uint32_t>(scenario.max_blocks_y));
+
+                    base::Rect rect = base::Rect::makeXYWH(
+                        x * kDifferBlockSize, y * kDifferBlockSize,
+                        width * kDifferBlockSize, height * kDifferBlockSize);
+                    rect.intersectWith(base::Rect::makeSize(kSourceSize));
+                    update.addRect(rect);
+                }
+            }
+
+            OldScaleReducer old_scale_reducer;
+            base::ScaleReducer serial_scale_reducer;
+            base::ScaleReducer parallel_scale_reducer;
+            serial_scale_reducer.setParallelScaling(false);
+
+            // The first frame is scaled completely.
+            source->updatedRegion()->setRect(base::Rect::makeSize(kSourceSize));
+            old_scale_reducer.scaleFrame(source.get(), target_size);
+            serial_scale_reducer.scaleFrame(source.get(), target_size);
+            parallel_scale_reducer.scaleFrame(source.get(), target_size);
+
+            auto measure = [&](auto& scale_reducer)
+            {
+                auto start = std::chrono::steady_clock::now();
+
+                for (const auto& update : updates)
+                {
+                    *source->updatedRegion() = update;
+                    scale_reducer.scaleFrame(source.get(), target_size);
+                }
+
+                std::chrono::duration<double, std::milli> time =
+                    std::chrono::steady_clock::now() - start;
+                return time.count() / kFrames;
+            };
+
+            const double old_time = measure(old_scale_reducer);
+            const double serial_time = measure(serial_scale_reducer);
+            const double parallel_time = measure(parallel_scale_reducer);
+
+            // The same updates with changing pixels. The pixels of the old path that differ from
+            // the whole frame scaled at once are counted.
+            OldScaleReducer checked_scale_reducer;
+            source->updatedRegion()->setRect(base::Rect::makeSize(kSourceSize));
+            checked_scale_reducer.scaleFrame(source.get(), target_size);
+
+            for (const auto& update : updates)
+            {
+                for (base::Region::Iterator it(update); !it.isAtEnd(); it.advance())
+                    fillRect(source.get(), it.rect(), &random);
+
+                *source->updatedRegion() = update;
+                checked_scale_reducer.scaleFrame(source.get(), target_size);
+            }
+
+            const base::ScaleReducer::Filter filter = serial_scale_reducer.filter();
+            const int old_errors = countDifferentPixels(
+                *checked_scale_reducer.scaleFrame(source.get(), target_size),
+                *scaleWhole(*source, target_size, base::ScaleReducer::Filter::BOX));
+
+            printf("%dx%d -> %dx%d, %s: %.3f ms old, %.3f ms new, %.3f ms new in bands "
+                   "(%s filter), %d wrong pixels in the old path\n",
+                   kSourceSize.width(), kSourceSize.height(),
+                   target_size.width(), target_size.height(), scenario.name,
+                   old_time, serial_time, parallel_time,
+                   filter == base::ScaleReducer::Filter::BILINEAR ? "bilinear" : "box", old_errors);
+        }
+    }
+
+    return 0;
+}
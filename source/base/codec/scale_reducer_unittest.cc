@@ -0,0 +1,215 @@
+//
+// Aspia Project
+// Copyright (C) 2020 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+
+#include "base/codec/scale_reducer.h"
+
+#include "base/desktop/frame_simple.h"
+
+#include <gtest/gtest.h>
+#include <libyuv/scale_argb.h>
+
+#include <cstring>
+#include <random>
+
+namespace base {
+
+namespace {
+
+const Size kSourceSizes[] = { Size(1920, 1080), Size(2560, 1440), Size(1366, 768) };
+const Size kTargetSizes[] = { Size(1600, 900), Size(1280, 720), Size(1279, 719), Size(640, 360) };
+
+void fillRect(Frame* frame, const Rect& rect, std::mt19937* random)
+{
+    for (int y = rect.top(); y < rect.bottom(); ++y)
+    {
+        uint32_t* row = reinterpret_cast<uint32_t*>(frame->frameDataAtPos(rect.left(), y));
+
+        for (int x = 0; x < rect.width(); ++x)
+            row[x] = (*random)();
+    }
+}
+
+Rect randomRect(const Size& size, int max_size, std::mt19937* random)
+{
+    const int x = static_cast<int>((*random)() % static_cast<uint32_t>(size.width()));
+    const int y = static_cast<int>((*random)() % static_cast<uint32_t>(size.height()));
+    const int width = 1 + static_cast<int>((*random)() % static_cast<uint32_t>(max_size));
+    const int height = 1 + static_cast<int>((*random)() % static_cast<uint32_t>(max_size));
+
+    Rect rect = Rect::makeXYWH(x, y, width, height);
+    rect.intersectWith(Rect::makeSize(size));
+    return rect;
+}
+
+libyuv::FilterMode filterMode(ScaleReducer::Filter filter)
+{
+    return filter == ScaleReducer::Filter::BILINEAR ? libyuv::kFilterBilinear : libyuv::kFilterBox;
+}
+
+// The whole frame scaled at once.
+std::unique_ptr<Frame> scaleWhole(const Frame& source, const Size& target_size,
+                                  ScaleReducer::Filter filter)
+{
+    std::unique_ptr<Frame> target = FrameSimple::create(target_size, PixelFormat::ARGB());
+
+    libyuv::ARGBScale(source.frameData(), source.stride(),
+                      source.size().width(), source.size().height(),
+                      target->frameData(), target->stride(),
+                      target_size.width(), target_size.height(),
+                      filterMode(filter));
+    return target;
+}
+
+bool isEqual(const Frame& frame1, const Frame& frame2)
+{
+    for (int y = 0; y < frame1.size().height(); ++y)
+    {
+        if (memcmp(frame1.frameDataAtPos(0, y), frame2.frameDataAtPos(0, y),
+                   static_cast<size_t>(frame1.size().width() * 4)) != 0)
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+} // namespace
+
+TEST(ScaleReducerTest, SameSize)
+{
+    std::unique_ptr<Frame> source = FrameSimple::create(Size(640, 480), PixelFormat::ARGB());
+    source->updatedRegion()->addRect(Rect::makeXYWH(10, 10, 20, 20));
+
+    ScaleReducer scale_reducer;
+    EXPECT_EQ(scale_reducer.scaleFrame(source.get(), Size(640, 480)), source.get());
+}
+
+TEST(ScaleReducerTest, SeparateRegion)
+{
+    std::unique_ptr<Frame> source = FrameSimple::create(Size(1920, 1080), PixelFormat::ARGB());
+    source->updatedRegion()->addRect(Rect::makeSize(source->size()));
+
+    ScaleReducer scale_reducer;
+    ASSERT_TRUE(scale_reducer.scaleFrame(source.get(), Size(960, 540)));
+
+    // The source frame is shared, its updated region stays as it is.
+    const Rect frame_rect = Rect::makeXYWH(1000, 500, 20, 20);
+    const Rect changed_rect = Rect::makeXYWH(100, 100, 20, 20);
+    *source->updatedRegion() = Region(frame_rect);
+
+    const Frame* target =
+        scale_reducer.scaleFrame(source.get(), Region(changed_rect), Size(960, 540));
+    ASSERT_TRUE(target);
+
+    EXPECT_TRUE(source->constUpdatedRegion().equals(Region(frame_rect)));
+    EXPECT_TRUE(target->constUpdatedRegion().equals(Region(Rect::makeLTRB(48, 48, 64, 64))));
+}
+
+TEST(ScaleReducerTest, FilterByRatio)
+{
+    std::unique_ptr<Frame> source = FrameSimple::create(Size(1920, 1080), PixelFormat::ARGB());
+
+    ScaleReducer scale_reducer;
+
+    source->updatedRegion()->addRect(Rect::makeXYWH(0, 0, 16, 16));
+    scale_reducer.scaleFrame(source.get(), Size(1280, 720));
+    EXPECT_EQ(scale_reducer.filter(), ScaleReducer::Filter::BILINEAR);
+
+    source->updatedRegion()->addRect(Rect::makeXYWH(0, 0, 16, 16));
+    scale_reducer.scaleFrame(source.get(), Size(960, 540));
+    EXPECT_EQ(scale_reducer.filter(), ScaleReducer::Filter::BILINEAR);
+
+    source->updatedRegion()->addRect(Rect::makeXYWH(0, 0, 16, 16));
+    scale_reducer.scaleFrame(source.get(), Size(640, 360));
+    EXPECT_EQ(scale_reducer.filter(), ScaleReducer::Filter::BOX);
+}
+
+// After any sequence of updates the target frame is the same as the whole source frame scaled
+// at once, and the updated region of the target frame contains all changed pixels.
+TEST(ScaleReducerTest, UpdatesMatchWholeFrame)
+{
+    std::mt19937 random(1);
+
+    for (const auto& source_size : kSourceSizes)
+    {
+        for (const auto& target_size : kTargetSizes)
+        {
+            for (bool parallel : { false, true })
+            {
+                std::unique_ptr<Frame> source =
+                    FrameSimple::create(source_size, PixelFormat::ARGB());
+                fillRect(source.get(), Rect::makeSize(source_size), &random);
+                source->updatedRegion()->addRect(Rect::makeSize(source_size));
+
+                ScaleReducer scale_reducer;
+                scale_reducer.setParallelScaling(parallel);
+
+                std::unique_ptr<Frame> previous = FrameSimple::create(
+                    target_size, PixelFormat::ARGB());
+
+                const Frame* target = scale_reducer.scaleFrame(source.get(), target_size);
+                ASSERT_TRUE(target);
+                previous->copyPixelsFrom(*target, Point(0, 0), Rect::makeSize(target_size));
+
+                for (int i = 0; i < 10; ++i)
+                {
+                    source->updatedRegion()->clear();
+
+                    // Many small rectangles, as when typing, and sometimes a large one.
+                    const int count = 1 + static_cast<int>(random() % 30);
+                    for (int j = 0; j < count; ++j)
+                    {
+                        const Rect rect = randomRect(source_size, i % 3 ? 40 : 800, &random);
+                        fillRect(source.get(), rect, &random);
+                        source->updatedRegion()->addRect(rect);
+                    }
+
+                    target = scale_reducer.scaleFrame(source.get(), target_size);
+                    ASSERT_TRUE(target);
+
+                    std::unique_ptr<Frame> expected =
+                        scaleWhole(*source, target_size, scale_reducer.filter());
+                    ASSERT_TRUE(isEqual(*target, *expected))
+                        << source_size << " -> " << target_size << " parallel " << parallel;
+
+                    // The pixels outside of the updated region did not change.
+                    Region unchanged(Rect::makeSize(target_size));
+                    unchanged.subtract(target->constUpdatedRegion());
+
+                    for (Region::Iterator it(unchanged); !it.isAtEnd(); it.advance())
+                    {
+                        const Rect& rect = it.rect();
+
+                        for (int y = rect.top(); y < rect.bottom(); ++y)
+                        {
+                            ASSERT_EQ(memcmp(target->frameDataAtPos(rect.left(), y),
+                                             previous->frameDataAtPos(rect.left(), y),
+                                             static_cast<size_t>(rect.width() * 4)), 0);
+                        }
+                    }
+
+                    previous->copyPixelsFrom(*target, Point(0, 0), Rect::makeSize(target_size));
+                }
+            }
+        }
+    }
+}
+
+} // namespace base
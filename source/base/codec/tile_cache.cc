@@ -0,0 +1,242 @@
+//
+// Aspia Project
+// Copyright (C) 2020 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+
+#include "base/codec/tile_cache.h"
+
+#include "base/logging.h"
+#include "base/codec/video_util.h"
+#include "base/desktop/frame.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace base {
+
+namespace {
+
+// Returns the tiles of the grid that intersect |region|.
+Region alignedTiles(const Region& region, const Size& frame_size)
+{
+    Region tiles;
+
+    for (Region::Iterator it(region); !it.isAtEnd(); it.advance())
+    {
+        const Rect& rect = it.rect();
+
+        tiles.addRect(Rect::makeLTRB(
+            rect.left() / kTileCacheTileSize * kTileCacheTileSize,
+            rect.top() / kTileCacheTileSize * kTileCacheTileSize,
+            (rect.right() + kTileCacheTileSize - 1) / kTileCacheTileSize * kTileCacheTileSize,
+            (rect.bottom() + kTileCacheTileSize - 1) / kTileCacheTileSize * kTileCacheTileSize));
+    }
+
+    tiles.intersectWith(Rect::makeSize(frame_size));
+    return tiles;
+}
+
+// Calls |callback| for each tile of the region returned by alignedTiles(). The edges of its
+// rectangles are on the grid or on the edges of the frame.
+template <typename Callback>
+void forEachTile(const Region& tiles, Callback callback)
+{
+    for (Region::Iterator it(tiles); !it.isAtEnd(); it.advance())
+    {
+        const Rect& rect = it.rect();
+
+        for (int y = rect.top(); y < rect.bottom(); y += kTileCacheTileSize)
+        {
+            const int bottom = std::min(y + kTileCacheTileSize, rect.bottom());
+
+            for (int x = rect.left(); x < rect.right(); x += kTileCacheTileSize)
+            {
+                callback(Rect::makeLTRB(
+                    x, y, std::min(x + kTileCacheTileSize, rect.right()), bottom));
+            }
+        }
+    }
+}
+
+// A fast hash for the lookup. The pixels are always compared, so the collisions are harmless.
+uint64_t hashTile(const Frame* frame, const Rect& rect)
+{
+    static const uint64_t kMultiplier = 0x9E3779B97F4A7C15;
+
+    const size_t row_size = static_cast<size_t>(rect.width()) * frame->format().bytesPerPixel();
+    uint64_t hash =
+        (static_cast<uint64_t>(rect.width()) << 32) | static_cast<uint32_t>(rect.height());
+
+    for (int y = rect.top(); y < rect.bottom(); ++y)
+    {
+        const uint8_t* row = frame->frameDataAtPos(rect.left(), y);
+        size_t i = 0;
+
+        for (; i + sizeof(uint64_t) <= row_size; i += sizeof(uint64_t))
+        {
+            uint64_t word;
+            memcpy(&word, row + i, sizeof(word));
+
+            hash = (hash ^ word) * kMultiplier;
+            hash ^= hash >> 32;
+        }
+
+        for (; i < row_size; ++i)
+            hash = (hash ^ row[i]) * kMultiplier;
+    }
+
+    return hash;
+}
+
+} // namespace
+
+TileCache::TileCache(size_t capacity)
+    : capacity_(std::clamp(capacity, size_t(1), kMaxTileCacheSize))
+{
+    // Nothing
+}
+
+TileCache::~TileCache() = default;
+
+Region TileCache::encode(
+    const Frame* frame, const Region& changed_region, proto::VideoPacket* packet)
+{
+    const Region changed_tiles = alignedTiles(changed_region, frame->size());
+    Region cached_region;
+
+    forEachTile(changed_tiles, [&](const Rect& rect)
+    {
+        const Tile* tile = find(frame, rect, hashTile(frame, rect));
+        if (!tile)
+            return;
+
+        touch(*tile);
+
+        proto::VideoTile* cached_tile = packet->add_cached_tile();
+        cached_tile->set_index(tile->index);
+        serializeRect(rect, cached_tile->mutable_rect());
+
+        cached_region.addRect(rect);
+    });
+
+    // The client has the final pixels of the tiles that did not change since the previous frame.
+    // The tiles that change in every frame, for example of a video, are never stored.
+    Region stable_tiles(previous_tiles_);
+    stable_tiles.subtract(changed_tiles);
+
+    forEachTile(stable_tiles, [&](const Rect& rect)
+    {
+        const uint64_t hash = hashTile(frame, rect);
+
+        // The same content can already be in the cache.
+        const Tile* tile = find(frame, rect, hash);
+        if (tile)
+        {
+            touch(*tile);
+            return;
+        }
+
+        proto::VideoTile* stored_tile = packet->add_stored_tile();
+        stored_tile->set_index(add(frame, rect, hash));
+        serializeRect(rect, stored_tile->mutable_rect());
+    });
+
+    previous_tiles_ = changed_tiles;
+    previous_tiles_.subtract(cached_region);
+
+    return cached_region;
+}
+
+void TileCache::clear()
+{
+    tiles_.clear();
+    lru_.clear();
+    previous_tiles_.clear();
+}
+
+TileCache::Tile* TileCache::find(const Frame* frame, const Rect& rect, uint64_t hash)
+{
+    auto it = tiles_.find(hash);
+    if (it == tiles_.end())
+        return nullptr;
+
+    Tile& tile = it->second;
+    if (tile.size != rect.size())
+        return nullptr;
+
+    const size_t row_size = static_cast<size_t>(rect.width()) * frame->format().bytesPerPixel();
+    const uint8_t* pixels = tile.pixels.data();
+
+    for (int y = rect.top(); y < rect.bottom(); ++y)
+    {
+        if (memcmp(frame->frameDataAtPos(rect.left(), y), pixels, row_size) != 0)
+            return nullptr;
+
+        pixels += row_size;
+    }
+
+    return &tile;
+}
+
+uint32_t TileCache::add(const Frame* frame, const Rect& rect, uint64_t hash)
+{
+    auto it = tiles_.find(hash);
+    if (it == tiles_.end())
+    {
+        uint32_t index = static_cast<uint32_t>(tiles_.size());
+
+        if (tiles_.size() >= capacity_)
+        {
+            // The index of the least recently used tile is reused.
+            auto oldest = tiles_.find(lru_.back());
+            DCHECK(oldest != tiles_.end());
+
+            index = oldest->second.index;
+            tiles_.erase(oldest);
+            lru_.pop_back();
+        }
+
+        lru_.push_front(hash);
+        it = tiles_.emplace(hash, Tile{ index, Size(), ByteArray(), lru_.begin() }).first;
+    }
+
+    // Other pixels with the same hash are replaced.
+    Tile& tile = it->second;
+    touch(tile);
+
+    const size_t row_size = static_cast<size_t>(rect.width()) * frame->format().bytesPerPixel();
+
+    tile.size = rect.size();
+    tile.pixels.resize(row_size * static_cast<size_t>(rect.height()));
+
+    uint8_t* pixels = tile.pixels.data();
+
+    for (int y = rect.top(); y < rect.bottom(); ++y)
+    {
+        memcpy(pixels, frame->frameDataAtPos(rect.left(), y), row_size);
+        pixels += row_size;
+    }
+
+    return tile.index;
+}
+
+void TileCache::touch(const Tile& tile)
+{
+    lru_.splice(lru_.begin(), lru_, tile.lru);
+}
+
+} // namespace base
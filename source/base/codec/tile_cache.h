@@ -0,0 +1,97 @@
+//
+// Aspia Project
+// Copyright (C) 2020 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+
+#ifndef BASE__CODEC__TILE_CACHE_H
+#define BASE__CODEC__TILE_CACHE_H
+
+#include "base/macros_magic.h"
+#include "base/desktop/region.h"
+#include "base/memory/byte_array.h"
+#include "proto/desktop.pb.h"
+
+#include <list>
+#include <unordered_map>
+
+namespace base {
+
+class Frame;
+
+// The size of the tiles. The tiles are aligned to the grid of the frame.
+static const int kTileCacheTileSize = 64;
+
+// The largest number of tiles that the host keeps for a client.
+static const size_t kMaxTileCacheSize = 4096;
+
+// The host side of the tile cache of the client (see VideoPacket::cached_tile). When the same
+// content returns to the screen, for example after switching between windows, the host sends the
+// index of the tile in the cache of the client instead of its pixels. The host keeps the pixels of
+// the tiles to compare them with the frame, and the client keeps the pixels it has decoded. When
+// the cache is full, the least recently used tile is replaced.
+class TileCache
+{
+public:
+    explicit TileCache(size_t capacity);
+    ~TileCache();
+
+    // Adds the references to the tiles in |changed_region| which the client has in its cache to
+    // |packet|. Returns the region of these tiles, the encoder does not need to send it. The tiles
+    // that changed in the previous frame and are stable now are added to the cache and to the
+    // tiles that the client stores.
+    Region encode(const Frame* frame, const Region& changed_region, proto::VideoPacket* packet);
+
+    // Forgets all tiles. Must be called when the client gets a new frame.
+    void clear();
+
+    size_t capacity() const { return capacity_; }
+    size_t size() const { return tiles_.size(); }
+
+private:
+    struct Tile
+    {
+        uint32_t index;
+        Size size;
+        ByteArray pixels;
+        std::list<uint64_t>::iterator lru;
+    };
+
+    // Returns the tile with the same pixels as |rect| of the frame or nullptr.
+    Tile* find(const Frame* frame, const Rect& rect, uint64_t hash);
+
+    // Adds the pixels of |rect| to the cache. Returns the index of the tile.
+    uint32_t add(const Frame* frame, const Rect& rect, uint64_t hash);
+
+    // Moves the tile to the front of the LRU list.
+    void touch(const Tile& tile);
+
+    const size_t capacity_;
+
+    std::unordered_map<uint64_t, Tile> tiles_;
+
+    // The hashes from the most to the least recently used.
+    std::list<uint64_t> lru_;
+
+    // The tiles that changed in the previous frame and are not in the cache.
+    Region previous_tiles_;
+
+    DISALLOW_COPY_AND_ASSIGN(TileCache);
+};
+
+} // namespace base
+
+#endif // BASE__CODEC__TILE_CACHE_H
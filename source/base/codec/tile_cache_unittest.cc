@@ -0,0 +1,227 @@
+//
+// Aspia Project
+// Copyright (C) 2020 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+
+#include "base/codec/tile_cache.h"
+
+#include "base/codec/video_decoder_zstd.h"
+#include "base/codec/video_encoder_zstd.h"
+#include "base/codec/video_util.h"
+#include "base/desktop/frame_simple.h"
+
+#include <gtest/gtest.h>
+
+#include <set>
+
+namespace base {
+
+namespace {
+
+// The frame is not a multiple of the tile size, so the tiles at the edges are smaller.
+const Size kFrameSize(200, 150);
+const int kTileCount = 4 * 3;
+
+void fillFrame(Frame* frame, const Rect& rect, uint32_t seed)
+{
+    for (int y = rect.top(); y < rect.bottom(); ++y)
+    {
+        uint32_t* row = reinterpret_cast<uint32_t*>(frame->frameDataAtPos(rect.left(), y));
+
+        for (int x = 0; x < rect.width(); ++x)
+        {
+            row[x] = 0xFF000000 |
+                ((seed * 2654435761U) ^ ((rect.left() + x) * 7919) ^ (y * 104729));
+        }
+    }
+}
+
+// The alpha channel is not sent.
+bool isEqual(const Frame& frame1, const Frame& frame2)
+{
+    for (int y = 0; y < frame1.size().height(); ++y)
+    {
+        const uint32_t* row1 = reinterpret_cast<const uint32_t*>(frame1.frameDataAtPos(0, y));
+        const uint32_t* row2 = reinterpret_cast<const uint32_t*>(frame2.frameDataAtPos(0, y));
+
+        for (int x = 0; x < frame1.size().width(); ++x)
+        {
+            if ((row1[x] & 0x00FFFFFF) != (row2[x] & 0x00FFFFFF))
+                return false;
+        }
+    }
+
+    return true;
+}
+
+Region tileRegion(const google::protobuf::RepeatedPtrField<proto::VideoTile>& tiles)
+{
+    Region region;
+
+    for (const auto& tile : tiles)
+        region.addRect(parseRect(tile.rect()));
+
+    return region;
+}
+
+} // namespace
+
+TEST(TileCacheTest, StableTilesAreFound)
+{
+    std::unique_ptr<Frame> frame = FrameSimple::create(kFrameSize, PixelFormat::ARGB());
+    const Rect frame_rect = Rect::makeSize(kFrameSize);
+    TileCache cache(64);
+
+    // The first content.
+    fillFrame(frame.get(), frame_rect, 1);
+
+    proto::VideoPacket packet;
+    EXPECT_TRUE(cache.encode(frame.get(), Region(frame_rect), &packet).isEmpty());
+    EXPECT_EQ(packet.cached_tile_size(), 0);
+    EXPECT_EQ(packet.stored_tile_size(), 0);
+
+    // The content did not change, so the client has its final pixels.
+    packet.Clear();
+    EXPECT_TRUE(cache.encode(frame.get(), Region(), &packet).isEmpty());
+    EXPECT_EQ(packet.stored_tile_size(), kTileCount);
+    EXPECT_TRUE(tileRegion(packet.stored_tile()).equals(Region(frame_rect)));
+
+    std::set<uint32_t> first_indexes;
+    for (const auto& tile : packet.stored_tile())
+        first_indexes.insert(tile.index());
+    EXPECT_EQ(first_indexes.size(), static_cast<size_t>(kTileCount));
+
+    // The second content.
+    fillFrame(frame.get(), frame_rect, 2);
+
+    packet.Clear();
+    EXPECT_TRUE(cache.encode(frame.get(), Region(frame_rect), &packet).isEmpty());
+
+    packet.Clear();
+    cache.encode(frame.get(), Region(), &packet);
+    EXPECT_EQ(packet.stored_tile_size(), kTileCount);
+    EXPECT_EQ(cache.size(), static_cast<size_t>(kTileCount * 2));
+
+    // The first content returns.
+    fillFrame(frame.get(), frame_rect, 1);
+
+    packet.Clear();
+    EXPECT_TRUE(cache.encode(frame.get(), Region(frame_rect), &packet).equals(Region(frame_rect)));
+    EXPECT_EQ(packet.cached_tile_size(), kTileCount);
+    EXPECT_EQ(packet.stored_tile_size(), 0);
+
+    for (const auto& tile : packet.cached_tile())
+        EXPECT_EQ(first_indexes.count(tile.index()), 1u);
+}
+
+TEST(TileCacheTest, ChangingTilesAreNotStored)
+{
+    std::unique_ptr<Frame> frame = FrameSimple::create(kFrameSize, PixelFormat::ARGB());
+    const Rect video_rect = Rect::makeXYWH(64, 0, 64, 64);
+    TileCache cache(64);
+
+    fillFrame(frame.get(), Rect::makeSize(kFrameSize), 1);
+
+    proto::VideoPacket packet;
+    cache.encode(frame.get(), Region(Rect::makeSize(kFrameSize)), &packet);
+
+    for (uint32_t i = 0; i < 10; ++i)
+    {
+        fillFrame(frame.get(), video_rect, 100 + i);
+
+        packet.Clear();
+        EXPECT_TRUE(cache.encode(frame.get(), Region(video_rect), &packet).isEmpty());
+
+        // Only the other tiles are stored after the first frame.
+        EXPECT_EQ(packet.stored_tile_size(), i == 0 ? kTileCount - 1 : 0);
+        EXPECT_FALSE(tileRegion(packet.stored_tile()).equals(Region(video_rect)));
+    }
+}
+
+TEST(TileCacheTest, LeastRecentlyUsedIsReplaced)
+{
+    std::unique_ptr<Frame> frame = FrameSimple::create(Size(64, 64), PixelFormat::ARGB());
+    const Rect frame_rect = Rect::makeSize(frame->size());
+    TileCache cache(2);
+
+    proto::VideoPacket packet;
+
+    // Store the contents 1, 2 and 3. The content 1 is replaced by 3.
+    for (uint32_t seed = 1; seed <= 3; ++seed)
+    {
+        fillFrame(frame.get(), frame_rect, seed);
+
+        packet.Clear();
+        cache.encode(frame.get(), Region(frame_rect), &packet);
+
+        packet.Clear();
+        cache.encode(frame.get(), Region(), &packet);
+        ASSERT_EQ(packet.stored_tile_size(), 1);
+    }
+
+    EXPECT_EQ(cache.size(), 2u);
+
+    fillFrame(frame.get(), frame_rect, 1);
+    packet.Clear();
+    EXPECT_TRUE(cache.encode(frame.get(), Region(frame_rect), &packet).isEmpty());
+
+    fillFrame(frame.get(), frame_rect, 2);
+    packet.Clear();
+    EXPECT_FALSE(cache.encode(frame.get(), Region(frame_rect), &packet).isEmpty());
+}
+
+TEST(TileCacheTest, ClientGetsSameFrame)
+{
+    std::unique_ptr<Frame> source_frame = FrameSimple::create(kFrameSize, PixelFormat::ARGB());
+    std::unique_ptr<Frame> client_frame = FrameSimple::create(kFrameSize, PixelFormat::ARGB());
+    const Rect frame_rect = Rect::makeSize(kFrameSize);
+    const Rect window_rect = Rect::makeXYWH(10, 20, 150, 100);
+
+    std::unique_ptr<VideoEncoderZstd> encoder = VideoEncoderZstd::create(PixelFormat::ARGB(), 1);
+    std::unique_ptr<VideoDecoderZstd> decoder = VideoDecoderZstd::create();
+    encoder->setTileCacheSize(64);
+
+    auto send = [&](const Rect& rect)
+    {
+        *source_frame->updatedRegion() = Region(rect);
+
+        proto::VideoPacket packet;
+        encoder->encode(source_frame.get(), &packet);
+        EXPECT_TRUE(decoder->decode(packet, client_frame.get()));
+        EXPECT_TRUE(isEqual(*source_frame, *client_frame));
+
+        return packet;
+    };
+
+    // Switch between two windows.
+    fillFrame(source_frame.get(), frame_rect, 1);
+    send(frame_rect);
+    send(Rect());
+
+    fillFrame(source_frame.get(), window_rect, 2);
+    const proto::VideoPacket first_packet = send(window_rect);
+    send(Rect());
+
+    fillFrame(source_frame.get(), window_rect, 1);
+    const proto::VideoPacket second_packet = send(window_rect);
+
+    EXPECT_EQ(first_packet.cached_tile_size(), 0);
+    EXPECT_GT(second_packet.cached_tile_size(), 0);
+    EXPECT_LT(second_packet.data().size(), first_packet.data().size());
+}
+
+} // namespace base
@@ -0,0 +1,1095 @@
+//
+// Aspia Project
+// Copyright (C) 2020 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+
+// Compares the video encoders and decoders without a screen and without a network. A desktop
+// trace is replayed through the same pipeline as in the host and in the client: Differ ->
+// ScaleReducer -> encoder -> decoder. For each codec the benchmark reports the time to scale,
+// encode and decode a frame, the size of the packets, the quality of the decoded frames (PSNR and
+// SSIM against the frames given to the encoder) and the peak memory of the process.
+//
+// The traces are either synthetic (typing, scrolling, video playback) or read from a file. A trace
+// file starts with a header and contains the changed rectangles of each frame with their pixels.
+// All numbers are little-endian:
+//
+//   header: "ASPIATRC", uint32 version (1), uint32 width, uint32 height
+//   frame:  uint32 rect count, then for each rect: int32 x, y, width, height and
+//           width * height * 4 bytes of ARGB pixels (rows from top to bottom)
+//
+// The first frame must cover the whole screen. --save-trace writes the synthetic traces in this
+// format.
+//
+// The encode and decode times and the packet size are per packet, including the refinements of
+// the progressive encoders (only with --fps). The scale time is per frame with changes.
+//
+// Usage: aspia_video_codec_benchmark [--scenario=typing|scrolling|video|all] [--trace=<file>]
+//            [--codec=<name>|all] [--frames=<n>] [--width=<pixels>] [--height=<pixels>]
+//            [--scale=<percent>] [--fps=<n>] [--tile-cache=<tiles>] [--save-trace=<dir>]
+
+#include "base/command_line.h"
+#include "base/logging.h"
+#include "base/codec/scale_reducer.h"
+#include "base/codec/video_decoder.h"
+#include "base/codec/video_encoder.h"
+#include "base/codec/video_encoder_hybrid.h"
+#include "base/codec/video_encoder_vpx.h"
+#include "base/codec/video_encoder_zstd.h"
+#include "base/desktop/differ.h"
+#include "base/desktop/frame_simple.h"
+#include "base/strings/string_number_conversions.h"
+#include "base/strings/unicode.h"
+#include "build/build_config.h"
+#include "proto/desktop.pb.h"
+
+#if defined(OS_WIN)
+#include <Windows.h>
+#include <psapi.h>
+#endif // defined(OS_WIN)
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <random>
+#include <thread>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+const char kTraceMagic[] = { 'A', 'S', 'P', 'I', 'A', 'T', 'R', 'C' };
+const uint32_t kTraceVersion = 1;
+
+// The refinement of the progressive encoders is sent with the same delay as in the host.
+const std::chrono::milliseconds kRefinementDelay(1000);
+
+// The compression ratio used by the client by default.
+const int kCompressRatio = 8;
+
+const char* kScenarios[] = { "typing", "scrolling", "video" };
+
+struct Options
+{
+    std::string scenario = "all";
+    std::filesystem::path trace;
+    std::filesystem::path save_trace;
+    std::string codec = "all";
+    int frames = 300;
+    base::Size size = base::Size(1920, 1080);
+    int scale = 100;
+    int fps = 0; // 0 means as fast as possible.
+    int tile_cache = 0;
+};
+
+struct Codec
+{
+    const char* name;
+    proto::VideoEncoding encoding;
+    std::function<std::unique_ptr<base::VideoEncoder>()> create;
+};
+
+const Codec kCodecs[] =
+{
+    { "zstd", proto::VIDEO_ENCODING_ZSTD, []()
+    {
+        return std::unique_ptr<base::VideoEncoder>(
+            base::VideoEncoderZstd::create(base::PixelFormat::ARGB(), kCompressRatio));
+    } },
+    { "zstd-rgb565", proto::VIDEO_ENCODING_ZSTD, []()
+    {
+        return std::unique_ptr<base::VideoEncoder>(
+            base::VideoEncoderZstd::create(base::PixelFormat::RGB565(), kCompressRatio));
+    } },
+    { "zstd-progressive", proto::VIDEO_ENCODING_ZSTD, []()
+    {
+        return std::unique_ptr<base::VideoEncoder>(base::VideoEncoderZstd::createProgressive(
+            base::PixelFormat::RGB565(), kCompressRatio));
+    } },
+    { "vp8", proto::VIDEO_ENCODING_VP8, []()
+    {
+        return std::unique_ptr<base::VideoEncoder>(base::VideoEncoderVPX::createVP8());
+    } },
+    { "vp9", proto::VIDEO_ENCODING_VP9, []()
+    {
+        return std::unique_ptr<base::VideoEncoder>(base::VideoEncoderVPX::createVP9());
+    } },
+    { "vp9-444", proto::VIDEO_ENCODING_VP9, []()
+    {
+        return std::unique_ptr<base::VideoEncoder>(base::VideoEncoderVPX::createVP9I444());
+    } },
+    { "hybrid", proto::VIDEO_ENCODING_HYBRID, []()
+    {
+        return std::unique_ptr<base::VideoEncoder>(
+            base::VideoEncoderHybrid::create(base::PixelFormat::ARGB(), kCompressRatio));
+    } }
+};
+
+struct Result
+{
+    bool succeeded = true;
+    int frames = 0;
+    int encoded_frames = 0;
+    int refinements = 0;
+    double scale_ms = 0;
+    double encode_ms = 0;
+    double decode_ms = 0;
+    int64_t bytes = 0;
+
+    // Sums over all color samples and all SSIM windows of the encoded frames.
+    double squared_error = 0;
+    int64_t samples = 0;
+    double ssim = 0;
+    int64_t ssim_windows = 0;
+
+    double peak_megabytes = 0;
+};
+
+//--------------------------------------------------------------------------------------------------
+// Memory
+//--------------------------------------------------------------------------------------------------
+
+// Linux can reset the peak to the current resident size. Windows can not, there the peak of the
+// process is reported; run one codec at a time to get the peak of each codec.
+void resetPeakMemory()
+{
+#if defined(OS_LINUX)
+    std::ofstream clear_refs("/proc/self/clear_refs");
+    clear_refs << "5";
+#endif // defined(OS_LINUX)
+}
+
+double peakMemoryMegabytes()
+{
+#if defined(OS_WIN)
+    PROCESS_MEMORY_COUNTERS counters;
+    if (!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+        return 0;
+
+    return static_cast<double>(counters.PeakWorkingSetSize) / (1024 * 1024);
+#elif defined(OS_LINUX)
+    std::ifstream status("/proc/self/status");
+    std::string line;
+
+    while (std::getline(status, line))
+    {
+        if (line.compare(0, 6, "VmHWM:") == 0)
+            return std::strtod(line.c_str() + 6, nullptr) / 1024; // The value is in kB.
+    }
+
+    return 0;
+#else
+    return 0;
+#endif
+}
+
+//--------------------------------------------------------------------------------------------------
+// Traces
+//--------------------------------------------------------------------------------------------------
+
+class TraceSource
+{
+public:
+    virtual ~TraceSource() = default;
+
+    virtual base::Size size() const = 0;
+
+    // Changes the pixels of |frame| to the next frame of the trace and adds the changed area to
+    // |changed|. Returns false at the end of the trace.
+    virtual bool nextFrame(base::Frame* frame, base::Region* changed) = 0;
+};
+
+uint32_t hash32(uint32_t value)
+{
+    value ^= value >> 16;
+    value *= 0x7FEB352D;
+    value ^= value >> 15;
+    value *= 0x846CA68B;
+    value ^= value >> 16;
+    return value;
+}
+
+void fillRect(base::Frame* frame, const base::Rect& rect, uint32_t color)
+{
+    for (int y = rect.top(); y < rect.bottom(); ++y)
+    {
+        uint32_t* row = reinterpret_cast<uint32_t*>(frame->frameDataAtPos(rect.left(), y));
+        std::fill(row, row + rect.width(), color);
+    }
+}
+
+// A character cell of 8x16 pixels with a pseudo glyph and anti-aliased edges, as rendered text
+// looks to the encoders.
+const int kGlyphWidth = 8;
+const int kGlyphHeight = 16;
+
+void drawGlyph(base::Frame* frame, int x, int y, uint32_t code)
+{
+    const base::Rect cell = base::Rect::makeXYWH(x, y, kGlyphWidth, kGlyphHeight);
+    if (!base::Rect::makeSize(frame->size()).containsRect(cell))
+        return;
+
+    fillRect(frame, cell, 0xFFFFFFFF);
+
+    if (code == ' ')
+        return;
+
+    // A 5x9 bitmap in the middle of the cell.
+    const uint32_t bits = hash32(code) | 0x21;
+
+    for (int row = 0; row < 9; ++row)
+    {
+        uint32_t* pixels = reinterpret_cast<uint32_t*>(frame->frameDataAtPos(x + 1, y + 4 + row));
+        const uint32_t row_bits = hash32(bits + static_cast<uint32_t>(row)) & 0x1F;
+
+        for (int column = 0; column < 5; ++column)
+        {
+            if (row_bits & (1U << column))
+            {
+                pixels[column] = 0xFF202020;
+
+                if (pixels[column + 1] == 0xFFFFFFFF)
+                    pixels[column + 1] = 0xFF9090A0;
+            }
+        }
+    }
+}
+
+class SyntheticTrace : public TraceSource
+{
+public:
+    SyntheticTrace(const std::string& scenario, const base::Size& size, int frames)
+        : scenario_(scenario),
+          size_(size),
+          frames_(frames),
+          content_rect_(base::Rect::makeLTRB(0, 40, size.width(), size.height() - 30))
+    {
+        // Nothing
+    }
+
+    base::Size size() const override { return size_; }
+
+    bool nextFrame(base::Frame* frame, base::Region* changed) override
+    {
+        if (frame_index_ >= frames_)
+            return false;
+
+        if (!frame_index_)
+        {
+            drawDesktop(frame);
+            changed->addRect(base::Rect::makeSize(size_));
+        }
+        else if (scenario_ == "typing")
+        {
+            type(frame, changed);
+        }
+        else if (scenario_ == "scrolling")
+        {
+            scroll(frame, changed);
+        }
+        else
+        {
+            playVideo(frame, changed);
+        }
+
+        ++frame_index_;
+        return true;
+    }
+
+private:
+    uint32_t textAt(int line, int column) const
+    {
+        // The lines have different lengths and some are empty.
+        const uint32_t line_hash = hash32(static_cast<uint32_t>(line) * 7919 + 1);
+        const int length = static_cast<int>(line_hash % 160);
+        if (column >= length || (line_hash & 0x700) == 0)
+            return ' ';
+
+        const uint32_t value = hash32(line_hash + static_cast<uint32_t>(column));
+
+        // Words of 2-9 letters.
+        if (value % 6 == 0)
+            return ' ';
+
+        return 'a' + value % 26;
+    }
+
+    void drawLine(base::Frame* frame, int y, int line)
+    {
+        for (int x = content_rect_.left(); x + kGlyphWidth <= content_rect_.right();
+             x += kGlyphWidth)
+        {
+            drawGlyph(frame, x, y, textAt(line, (x - content_rect_.left()) / kGlyphWidth));
+        }
+    }
+
+    void drawDesktop(base::Frame* frame)
+    {
+        // The title and tool bars, the text area and the status bar of a window.
+        fillRect(frame, base::Rect::makeLTRB(0, 0, size_.width(), content_rect_.top()),
+                 0xFFE0E4EA);
+        fillRect(frame, base::Rect::makeLTRB(0, content_rect_.bottom(), size_.width(),
+                                             size_.height()), 0xFF2B579A);
+
+        for (int x = 8; x + 24 <= size_.width() && x < 400; x += 32)
+            fillRect(frame, base::Rect::makeXYWH(x, 8, 24, 24), 0xFF000000 | hash32(x));
+
+        const int lines = content_rect_.height() / kGlyphHeight;
+
+        for (int line = 0; line < lines; ++line)
+        {
+            drawLine(frame, content_rect_.top() + line * kGlyphHeight,
+                     scenario_ == "typing" ? line + 100000 : line);
+        }
+
+        fillRect(frame, base::Rect::makeLTRB(0, content_rect_.top() + lines * kGlyphHeight,
+                                             size_.width(), content_rect_.bottom()),
+                 0xFFFFFFFF);
+
+        if (scenario_ == "video")
+        {
+            // A player window in the middle of the screen.
+            const int width = size_.width() * 4 / 9;
+            const int height = width * 9 / 16;
+
+            video_rect_ = base::Rect::makeXYWH((size_.width() - width) / 2,
+                                               (size_.height() - height) / 2,
+                                               width, height);
+
+            base::Rect border = video_rect_;
+            border.extend(4, 30, 4, 40);
+            fillRect(frame, border, 0xFF1E1E1E);
+        }
+    }
+
+    // One character per frame at the cursor and a blinking caret after it.
+    void type(base::Frame* frame, base::Region* changed)
+    {
+        const int columns = std::min(100, content_rect_.width() / kGlyphWidth - 1);
+        const int x = content_rect_.left() + cursor_column_ * kGlyphWidth;
+        const int y = content_rect_.top() + cursor_line_ * kGlyphHeight;
+
+        drawGlyph(frame, x, y, textAt(cursor_line_, cursor_column_));
+        changed->addRect(base::Rect::makeXYWH(x, y, kGlyphWidth, kGlyphHeight));
+
+        if (++cursor_column_ >= columns)
+        {
+            cursor_column_ = 0;
+            if ((++cursor_line_ + 1) * kGlyphHeight > content_rect_.height())
+                cursor_line_ = 0;
+        }
+
+        const base::Rect caret = base::Rect::makeXYWH(
+            content_rect_.left() + cursor_column_ * kGlyphWidth,
+            content_rect_.top() + cursor_line_ * kGlyphHeight, 2, kGlyphHeight);
+
+        fillRect(frame, caret, (frame_index_ / 15) % 2 ? 0xFFFFFFFF : 0xFF000000);
+        changed->addRect(caret);
+    }
+
+    // The text area moves up by two lines per frame, as with the mouse wheel.
+    void scroll(base::Frame* frame, base::Region* changed)
+    {
+        static const int kLinesPerFrame = 2;
+        const int lines = content_rect_.height() / kGlyphHeight;
+        const int step = kLinesPerFrame * kGlyphHeight;
+        const int row_bytes = content_rect_.width() * 4;
+
+        for (int y = content_rect_.top(); y + step < content_rect_.top() + lines * kGlyphHeight;
+             ++y)
+        {
+            memmove(frame->frameDataAtPos(content_rect_.left(), y),
+                    frame->frameDataAtPos(content_rect_.left(), y + step),
+                    static_cast<size_t>(row_bytes));
+        }
+
+        first_line_ += kLinesPerFrame;
+
+        for (int i = lines - kLinesPerFrame; i < lines; ++i)
+            drawLine(frame, content_rect_.top() + i * kGlyphHeight, first_line_ + i);
+
+        changed->addRect(base::Rect::makeXYWH(
+            content_rect_.left(), content_rect_.top(), content_rect_.width(),
+            lines * kGlyphHeight));
+    }
+
+    // Smooth moving colors with a bright object and some noise, like camera footage.
+    void playVideo(base::Frame* frame, base::Region* changed)
+    {
+        const double time = frame_index_ / 30.0;
+        std::mt19937 random(static_cast<uint32_t>(frame_index_));
+
+        const int object_x = static_cast<int>(
+            (0.5 + 0.4 * std::sin(time * 1.3)) * video_rect_.width());
+        const int object_y = static_cast<int>(
+            (0.5 + 0.4 * std::cos(time * 0.9)) * video_rect_.height());
+        const int object_radius = video_rect_.height() / 8;
+
+        for (int y = 0; y < video_rect_.height(); ++y)
+        {
+            uint32_t* row = reinterpret_cast<uint32_t*>(
+                frame->frameDataAtPos(video_rect_.left(), video_rect_.top() + y));
+            const double vertical = std::sin(y * 0.011 + time * 0.7);
+
+            for (int x = 0; x < video_rect_.width(); ++x)
+            {
+                const double horizontal = std::sin(x * 0.007 + time);
+                const int noise = static_cast<int>(random() % 9) - 4;
+
+                int r = static_cast<int>(110 + 70 * horizontal + 30 * vertical) + noise;
+                int g = static_cast<int>(120 + 50 * vertical) + noise;
+                int b = static_cast<int>(140 - 60 * horizontal * vertical) + noise;
+
+                const int dx = x - object_x;
+                const int dy = y - object_y;
+                if (dx * dx + dy * dy < object_radius * object_radius)
+                {
+                    r = 240 + noise;
+                    g = 200 + noise;
+                    b = 60 + noise;
+                }
+
+                row[x] = 0xFF000000 |
+                    (static_cast<uint32_t>(std::clamp(r, 0, 255)) << 16) |
+                    (static_cast<uint32_t>(std::clamp(g, 0, 255)) << 8) |
+                    static_cast<uint32_t>(std::clamp(b, 0, 255));
+            }
+        }
+
+        changed->addRect(video_rect_);
+    }
+
+    const std::string scenario_;
+    const base::Size size_;
+    const int frames_;
+    const base::Rect content_rect_;
+    base::Rect video_rect_;
+
+    int frame_index_ = 0;
+    int cursor_line_ = 0;
+    int cursor_column_ = 0;
+    int first_line_ = 0;
+
+    DISALLOW_COPY_AND_ASSIGN(SyntheticTrace);
+};
+
+bool readUint32(std::istream& stream, uint32_t* value)
+{
+    uint8_t bytes[4];
+    if (!stream.read(reinterpret_cast<char*>(bytes), sizeof(bytes)))
+        return false;
+
+    *value = static_cast<uint32_t>(bytes[0]) | (static_cast<uint32_t>(bytes[1]) << 8) |
+        (static_cast<uint32_t>(bytes[2]) << 16) | (static_cast<uint32_t>(bytes[3]) << 24);
+    return true;
+}
+
+void writeUint32(std::ostream& stream, uint32_t value)
+{
+    const uint8_t bytes[4] =
+    {
+        static_cast<uint8_t>(value),
+        static_cast<uint8_t>(value >> 8),
+        static_cast<uint8_t>(value >> 16),
+        static_cast<uint8_t>(value >> 24)
+    };
+
+    stream.write(reinterpret_cast<const char*>(bytes), sizeof(bytes));
+}
+
+class TraceReader : public TraceSource
+{
+public:
+    ~TraceReader() override = default;
+
+    static std::unique_ptr<TraceReader> open(const std::filesystem::path& path)
+    {
+        std::unique_ptr<TraceReader> reader(new TraceReader());
+
+        reader->file_.open(path, std::ios::binary);
+        if (!reader->file_)
+        {
+            fprintf(stderr, "Unable to open %s\n", path.u8string().c_str());
+            return nullptr;
+        }
+
+        char magic[sizeof(kTraceMagic)];
+        uint32_t version, width, height;
+
+        if (!reader->file_.read(magic, sizeof(magic)) ||
+            memcmp(magic, kTraceMagic, sizeof(magic)) != 0 ||
+            !readUint32(reader->file_, &version) || version != kTraceVersion ||
+            !readUint32(reader->file_, &width) || !readUint32(reader->file_, &height) ||
+            !width || width > 16384 || !height || height > 16384)
+        {
+            fprintf(stderr, "%s is not a trace file\n", path.u8string().c_str());
+            return nullptr;
+        }
+
+        reader->size_ = base::Size(static_cast<int>(width), static_cast<int>(height));
+        return reader;
+    }
+
+    base::Size size() const override { return size_; }
+
+    bool nextFrame(base::Frame* frame, base::Region* changed) override
+    {
+        uint32_t count;
+        if (!readUint32(file_, &count))
+            return false;
+
+        const base::Rect frame_rect = base::Rect::makeSize(size_);
+
+        for (uint32_t i = 0; i < count; ++i)
+        {
+            uint32_t values[4];
+            for (uint32_t& value : values)
+            {
+                if (!readUint32(file_, &value))
+                    return false;
+            }
+
+            const base::Rect rect = base::Rect::makeXYWH(
+                static_cast<int32_t>(values[0]), static_cast<int32_t>(values[1]),
+                static_cast<int32_t>(values[2]), static_cast<int32_t>(values[3]));
+
+            if (rect.isEmpty() || !frame_rect.containsRect(rect))
+            {
+                fprintf(stderr, "Wrong rectangle in the trace\n");
+                return false;
+            }
+
+            for (int y = rect.top(); y < rect.bottom(); ++y)
+            {
+                if (!file_.read(reinterpret_cast<char*>(frame->frameDataAtPos(rect.left(), y)),
+                                rect.width() * 4))
+                {
+                    return false;
+                }
+            }
+
+            changed->addRect(rect);
+        }
+
+        return true;
+    }
+
+private:
+    TraceReader() = default;
+
+    std::ifstream file_;
+    base::Size size_;
+
+    DISALLOW_COPY_AND_ASSIGN(TraceReader);
+};
+
+bool writeTrace(TraceSource* source, const std::filesystem::path& path)
+{
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    if (!file)
+        return false;
+
+    const base::Size size = source->size();
+
+    file.write(kTraceMagic, sizeof(kTraceMagic));
+    writeUint32(file, kTraceVersion);
+    writeUint32(file, static_cast<uint32_t>(size.width()));
+    writeUint32(file, static_cast<uint32_t>(size.height()));
+
+    std::unique_ptr<base::Frame> frame = base::FrameSimple::create(size, base::PixelFormat::ARGB());
+    base::Region changed;
+
+    while (source->nextFrame(frame.get(), &changed))
+    {
+        uint32_t count = 0;
+        for (base::Region::Iterator it(changed); !it.isAtEnd(); it.advance())
+            ++count;
+
+        writeUint32(file, count);
+
+        for (base::Region::Iterator it(changed); !it.isAtEnd(); it.advance())
+        {
+            const base::Rect& rect = it.rect();
+
+            writeUint32(file, static_cast<uint32_t>(rect.x()));
+            writeUint32(file, static_cast<uint32_t>(rect.y()));
+            writeUint32(file, static_cast<uint32_t>(rect.width()));
+            writeUint32(file, static_cast<uint32_t>(rect.height()));
+
+            for (int y = rect.top(); y < rect.bottom(); ++y)
+            {
+                file.write(reinterpret_cast<const char*>(frame->frameDataAtPos(rect.left(), y)),
+                           rect.width() * 4);
+            }
+        }
+
+        changed.clear();
+    }
+
+    return static_cast<bool>(file);
+}
+
+//--------------------------------------------------------------------------------------------------
+// Quality
+//--------------------------------------------------------------------------------------------------
+
+double luma(uint32_t pixel)
+{
+    return 0.299 * ((pixel >> 16) & 0xFF) + 0.587 * ((pixel >> 8) & 0xFF) + 0.114 * (pixel & 0xFF);
+}
+
+// Adds the squared errors of the color samples (the alpha channel is not sent) and the SSIM of the
+// luma in windows of 8x8 pixels.
+void measureQuality(const base::Frame& source, const base::Frame& decoded, Result* result)
+{
+    static const int kWindowSize = 8;
+    static const double kC1 = (0.01 * 255) * (0.01 * 255);
+    static const double kC2 = (0.03 * 255) * (0.03 * 255);
+
+    const base::Size& size = source.size();
+
+    for (int y = 0; y < size.height(); ++y)
+    {
+        const uint8_t* row1 = source.frameDataAtPos(0, y);
+        const uint8_t* row2 = decoded.frameDataAtPos(0, y);
+
+        for (int x = 0; x < size.width() * 4; x += 4)
+        {
+            for (int channel = 0; channel < 3; ++channel)
+            {
+                const double error = static_cast<double>(row1[x + channel]) - row2[x + channel];
+                result->squared_error += error * error;
+            }
+        }
+    }
+
+    result->samples += static_cast<int64_t>(size.width()) * size.height() * 3;
+
+    for (int top = 0; top + kWindowSize <= size.height(); top += kWindowSize)
+    {
+        for (int left = 0; left + kWindowSize <= size.width(); left += kWindowSize)
+        {
+            double sum1 = 0, sum2 = 0, sum11 = 0, sum22 = 0, sum12 = 0;
+
+            for (int y = top; y < top + kWindowSize; ++y)
+            {
+                const uint32_t* row1 =
+                    reinterpret_cast<const uint32_t*>(source.frameDataAtPos(left, y));
+                const uint32_t* row2 =
+                    reinterpret_cast<const uint32_t*>(decoded.frameDataAtPos(left, y));
+
+                for (int x = 0; x < kWindowSize; ++x)
+                {
+                    const double value1 = luma(row1[x]);
+                    const double value2 = luma(row2[x]);
+
+                    sum1 += value1;
+                    sum2 += value2;
+                    sum11 += value1 * value1;
+                    sum22 += value2 * value2;
+                    sum12 += value1 * value2;
+                }
+            }
+
+            const double count = kWindowSize * kWindowSize;
+            const double mean1 = sum1 / count;
+            const double mean2 = sum2 / count;
+            const double variance1 = sum11 / count - mean1 * mean1;
+            const double variance2 = sum22 / count - mean2 * mean2;
+            const double covariance = sum12 / count - mean1 * mean2;
+
+            result->ssim += ((2 * mean1 * mean2 + kC1) * (2 * covariance + kC2)) /
+                ((mean1 * mean1 + mean2 * mean2 + kC1) * (variance1 + variance2 + kC2));
+            ++result->ssim_windows;
+        }
+    }
+}
+
+//--------------------------------------------------------------------------------------------------
+// Pipeline
+//--------------------------------------------------------------------------------------------------
+
+double elapsedMs(Clock::time_point start)
+{
+    return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+class Pipeline
+{
+public:
+    Pipeline(const Codec& codec, const Options& options)
+        : codec_(codec),
+          options_(options),
+          encoder_(codec.create()),
+          decoder_(base::VideoDecoder::create(codec.encoding))
+    {
+        if (encoder_)
+            encoder_->setTileCacheSize(static_cast<size_t>(options.tile_cache));
+    }
+
+    Result run(TraceSource* source)
+    {
+        if (!encoder_ || !decoder_)
+        {
+            result_.succeeded = false;
+            return result_;
+        }
+
+        const base::Size size = source->size();
+        const base::Size target_size(std::max(size.width() * options_.scale / 100, 1),
+                                     std::max(size.height() * options_.scale / 100, 1));
+
+        std::unique_ptr<base::Frame> frame =
+            base::FrameSimple::create(size, base::PixelFormat::ARGB());
+        std::unique_ptr<base::Frame> previous =
+            base::FrameSimple::create(size, base::PixelFormat::ARGB());
+        base::Differ differ(size);
+        base::ScaleReducer scale_reducer;
+        base::Region changed;
+
+        const Clock::time_point start_time = Clock::now();
+        Clock::time_point refinement_time = start_time;
+
+        while (source->nextFrame(frame.get(), &changed))
+        {
+            if (options_.fps)
+            {
+                std::this_thread::sleep_until(
+                    start_time + std::chrono::microseconds(1000000LL * result_.frames /
+                                                           options_.fps));
+            }
+
+            ++result_.frames;
+
+            // The area changed in the trace is only a hint; the differ finds the changed blocks
+            // as the screen capturers do.
+            base::Region* updated_region = frame->updatedRegion();
+            updated_region->clear();
+
+            if (result_.frames == 1)
+            {
+                updated_region->addRect(base::Rect::makeSize(size));
+            }
+            else
+            {
+                differ.calcDirtyRegion(previous->frameData(), frame->frameData(), updated_region);
+            }
+
+            for (base::Region::Iterator it(changed); !it.isAtEnd(); it.advance())
+                previous->copyPixelsFrom(*frame, it.rect().topLeft(), it.rect());
+            changed.clear();
+
+            if (!updated_region->isEmpty())
+            {
+                Clock::time_point scale_start = Clock::now();
+                const base::Frame* scaled_frame =
+                    scale_reducer.scaleFrame(frame.get(), target_size);
+                result_.scale_ms += elapsedMs(scale_start);
+
+                if (!scaled_frame || !encodeAndDecode(scaled_frame))
+                {
+                    result_.succeeded = false;
+                    break;
+                }
+
+                ++result_.encoded_frames;
+                measureQuality(*scaled_frame, *client_frame_, &result_);
+            }
+
+            // The host refines the frame by a timer while the refinement is pending.
+            if (options_.fps && encoder_->hasPendingRefinement() &&
+                Clock::now() - refinement_time >= kRefinementDelay)
+            {
+                refinement_time = Clock::now();
+
+                if (!encodeAndDecode(nullptr))
+                {
+                    result_.succeeded = false;
+                    break;
+                }
+
+                ++result_.refinements;
+            }
+        }
+
+        result_.peak_megabytes = peakMemoryMegabytes();
+        return result_;
+    }
+
+private:
+    // Encodes |frame| or the refinement if |frame| is null and decodes the packet.
+    bool encodeAndDecode(const base::Frame* frame)
+    {
+        packet_.Clear();
+
+        Clock::time_point encode_start = Clock::now();
+        if (frame)
+            encoder_->encode(frame, &packet_);
+        else
+            encoder_->encodeRefinement(&packet_);
+        result_.encode_ms += elapsedMs(encode_start);
+
+        result_.bytes += static_cast<int64_t>(packet_.ByteSizeLong());
+
+        if (packet_.has_format())
+        {
+            const proto::Rect& video_rect = packet_.format().video_rect();
+            client_frame_ = base::FrameSimple::create(
+                base::Size(video_rect.width(), video_rect.height()), base::PixelFormat::ARGB());
+        }
+
+        if (!client_frame_)
+            return false;
+
+        Clock::time_point decode_start = Clock::now();
+        const bool decoded = decoder_->decode(packet_, client_frame_.get());
+        result_.decode_ms += elapsedMs(decode_start);
+
+        if (!decoded)
+            fprintf(stderr, "%s: the packet could not be decoded\n", codec_.name);
+
+        return decoded;
+    }
+
+    const Codec& codec_;
+    const Options& options_;
+    std::unique_ptr<base::VideoEncoder> encoder_;
+    std::unique_ptr<base::VideoDecoder> decoder_;
+    std::unique_ptr<base::Frame> client_frame_;
+    proto::VideoPacket packet_;
+    Result result_;
+
+    DISALLOW_COPY_AND_ASSIGN(Pipeline);
+};
+
+std::unique_ptr<TraceSource> createSource(const std::string& scenario, const Options& options)
+{
+    if (!options.trace.empty())
+        return TraceReader::open(options.trace);
+
+    return std::make_unique<SyntheticTrace>(scenario, options.size, options.frames);
+}
+
+void printResult(const char* codec, const Result& result)
+{
+    if (!result.succeeded)
+    {
+        printf("%-17s FAILED\n", codec);
+        return;
+    }
+
+    const double frames = std::max(result.encoded_frames + result.refinements, 1);
+    const double mean_squared_error =
+        result.samples ? result.squared_error / static_cast<double>(result.samples) : 0;
+
+    char psnr[16];
+    if (mean_squared_error > 0)
+        snprintf(psnr, sizeof(psnr), "%.2f", 10 * std::log10(255.0 * 255.0 / mean_squared_error));
+    else
+        snprintf(psnr, sizeof(psnr), "lossless");
+
+    printf("%-17s %7d %8d %9.3f %9.3f %9.3f %10.1f %9s %7.4f %8.1f\n",
+           codec,
+           result.encoded_frames,
+           result.refinements,
+           result.scale_ms / std::max(result.encoded_frames, 1),
+           result.encode_ms / frames,
+           result.decode_ms / frames,
+           static_cast<double>(result.bytes) / frames / 1024,
+           psnr,
+           result.ssim_windows ? result.ssim / static_cast<double>(result.ssim_windows) : 1.0,
+           result.peak_megabytes);
+}
+
+bool parseSize(const base::CommandLine& command_line, std::u16string_view name, int* value)
+{
+    if (!command_line.hasSwitch(name))
+        return true;
+
+    return base::stringToInt(command_line.switchValue(name), value) && *value > 0;
+}
+
+bool parseOptions(const base::CommandLine& command_line, Options* options)
+{
+    if (command_line.hasSwitch(u"scenario"))
+        options->scenario = base::utf8FromUtf16(command_line.switchValue(u"scenario"));
+
+    if (command_line.hasSwitch(u"trace"))
+        options->trace = command_line.switchValuePath(u"trace");
+
+    if (command_line.hasSwitch(u"save-trace"))
+        options->save_trace = command_line.switchValuePath(u"save-trace");
+
+    if (command_line.hasSwitch(u"codec"))
+        options->codec = base::utf8FromUtf16(command_line.switchValue(u"codec"));
+
+    int width = options->size.width();
+    int height = options->size.height();
+
+    if (!parseSize(command_line, u"frames", &options->frames) ||
+        !parseSize(command_line, u"width", &width) ||
+        !parseSize(command_line, u"height", &height) ||
+        !parseSize(command_line, u"scale", &options->scale) || options->scale > 100)
+    {
+        return false;
+    }
+
+    options->size = base::Size(width, height);
+
+    if (command_line.hasSwitch(u"fps"))
+    {
+        if (!base::stringToInt(command_line.switchValue(u"fps"), &options->fps) ||
+            options->fps < 0 || options->fps > 1000)
+        {
+            return false;
+        }
+    }
+
+    if (command_line.hasSwitch(u"tile-cache"))
+    {
+        if (!base::stringToInt(command_line.switchValue(u"tile-cache"), &options->tile_cache) ||
+            options->tile_cache < 0)
+        {
+            return false;
+        }
+    }
+
+    // The glyphs and the bars of the synthetic desktop need some space.
+    if (width < 320 || height < 240)
+        return false;
+
+    bool known_scenario = options->scenario == "all";
+    for (const char* scenario : kScenarios)
+        known_scenario = known_scenario || options->scenario == scenario;
+
+    bool known_codec = options->codec == "all";
+    for (const auto& codec : kCodecs)
+        known_codec = known_codec || options->codec == codec.name;
+
+    return known_scenario && known_codec;
+}
+
+} // namespace
+
+int main(int argc, const char* const* argv)
+{
+    base::CommandLine::init(argc, argv);
+
+    Options options;
+    if (!parseOptions(*base::CommandLine::forCurrentProcess(), &options))
+    {
+        std::string codecs;
+        for (const auto& codec : kCodecs)
+            codecs += std::string(codec.name) + "|";
+
+        fprintf(stderr, "Usage: aspia_video_codec_benchmark "
+                        "[--scenario=typing|scrolling|video|all] [--trace=<file>] "
+                        "[--codec=%sall] [--frames=<n>] [--width=<pixels>] [--height=<pixels>] "
+                        "[--scale=<percent>] [--fps=<n>] [--tile-cache=<tiles>] "
+                        "[--save-trace=<dir>]\n", codecs.c_str());
+        return 1;
+    }
+
+    std::vector<std::string> scenarios;
+
+    if (!options.trace.empty())
+    {
+        scenarios.emplace_back(options.trace.filename().u8string());
+    }
+    else
+    {
+        for (const char* scenario : kScenarios)
+        {
+            if (options.scenario == "all" || options.scenario == scenario)
+                scenarios.emplace_back(scenario);
+        }
+    }
+
+    if (!options.save_trace.empty())
+    {
+        std::error_code ignored_error;
+        std::filesystem::create_directories(options.save_trace, ignored_error);
+
+        for (const auto& scenario : scenarios)
+        {
+            std::filesystem::path path = options.save_trace;
+            path.append(scenario + ".trace");
+
+            SyntheticTrace source(scenario, options.size, options.frames);
+            if (!writeTrace(&source, path))
+            {
+                fprintf(stderr, "Unable to write %s\n", path.u8string().c_str());
+                return 1;
+            }
+
+            printf("Saved %s\n", path.u8string().c_str());
+        }
+
+        return 0;
+    }
+
+    bool succeeded = true;
+
+    for (const auto& scenario : scenarios)
+    {
+        std::unique_ptr<TraceSource> source = createSource(scenario, options);
+        if (!source)
+            return 1;
+
+        const base::Size size = source->size();
+
+        printf("\n%s: %dx%d, scale %d%%, %s\n", scenario.c_str(), size.width(), size.height(),
+               options.scale,
+               options.fps ? (std::to_string(options.fps) + " fps").c_str() : "no frame pacing");
+        printf("%-17s %7s %8s %9s %9s %9s %10s %9s %7s %8s\n",
+               "codec", "frames", "refines", "scale ms", "enc ms", "dec ms", "KB/frame",
+               "PSNR dB", "SSIM", "peak MB");
+
+        for (const auto& codec : kCodecs)
+        {
+            if (options.codec != "all" && options.codec != codec.name)
+                continue;
+
+            // The trace is replayed from the start for each codec.
+            if (!source)
+            {
+                source = createSource(scenario, options);
+                if (!source)
+                    return 1;
+            }
+
+            resetPeakMemory();
+
+            Result result;
+            {
+                Pipeline pipeline(codec, options);
+                result = pipeline.run(source.get());
+            }
+
+            source.reset();
+
+            printResult(codec.name, result);
+            succeeded = succeeded && result.succeeded;
+        }
+    }
+
+    return succeeded ? 0 : 1;
+}
@@ -18,6 +18,7 @@
 
 #include "base/codec/video_decoder.h"
 
+#include "base/codec/video_decoder_hybrid.h"
 #include "base/codec/video_decoder_vpx.h"
 #include "base/codec/video_decoder_zstd.h"
 
@@ -37,6 +38,9 @@ std::unique_ptr<VideoDecoder> VideoDecoder::create(proto::VideoEncoding encoding
         case proto::VIDEO_ENCODING_VP9:
             return VideoDecoderVPX::createVP9();
 
+        case proto::VIDEO_ENCODING_HYBRID:
+            return VideoDecoderHybrid::create();
+
         default:
             return nullptr;
     }
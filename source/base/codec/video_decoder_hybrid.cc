@@ -0,0 +1,75 @@
+//
+// Aspia Project
+// Copyright (C) 2020 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+
+#include "base/codec/video_decoder_hybrid.h"
+
+#include "base/logging.h"
+
+namespace base {
+
+VideoDecoderHybrid::VideoDecoderHybrid() = default;
+
+VideoDecoderHybrid::~VideoDecoderHybrid() = default;
+
+// static
+std::unique_ptr<VideoDecoderHybrid> VideoDecoderHybrid::create()
+{
+    return std::unique_ptr<VideoDecoderHybrid>(new VideoDecoderHybrid());
+}
+
+bool VideoDecoderHybrid::decode(const proto::VideoPacket& packet, Frame* frame)
+{
+    // The host creates new encoders for the parts when the size of the screen changes.
+    if (packet.has_format())
+    {
+        lossless_decoder_.reset();
+        motion_decoder_.reset();
+    }
+
+    for (const auto& part : packet.part())
+    {
+        std::unique_ptr<VideoDecoder>* decoder;
+
+        switch (part.encoding())
+        {
+            case proto::VIDEO_ENCODING_ZSTD:
+                decoder = &lossless_decoder_;
+                break;
+
+            case proto::VIDEO_ENCODING_VP8:
+            case proto::VIDEO_ENCODING_VP9:
+                decoder = &motion_decoder_;
+                break;
+
+            default:
+                LOG(LS_WARNING) << "Unsupported encoding of the part: " << part.encoding();
+                return false;
+        }
+
+        if (!*decoder)
+            *decoder = VideoDecoder::create(part.encoding());
+
+        if (!(*decoder)->decode(part, frame))
+            return false;
+    }
+
+    return true;
+}
+
+} // namespace base
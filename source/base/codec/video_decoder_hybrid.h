@@ -0,0 +1,50 @@
+//
+// Aspia Project
+// Copyright (C) 2020 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+
+#ifndef BASE__CODEC__VIDEO_DECODER_HYBRID_H
+#define BASE__CODEC__VIDEO_DECODER_HYBRID_H
+
+#include "base/macros_magic.h"
+#include "base/codec/video_decoder.h"
+
+namespace base {
+
+// Decodes the packets of VideoEncoderHybrid. Each part of a packet is decoded by the decoder of
+// its encoding.
+class VideoDecoderHybrid : public VideoDecoder
+{
+public:
+    ~VideoDecoderHybrid();
+
+    static std::unique_ptr<VideoDecoderHybrid> create();
+
+    bool decode(const proto::VideoPacket& packet, Frame* frame) override;
+
+private:
+    VideoDecoderHybrid();
+
+    std::unique_ptr<VideoDecoder> lossless_decoder_;
+    std::unique_ptr<VideoDecoder> motion_decoder_;
+
+    DISALLOW_COPY_AND_ASSIGN(VideoDecoderHybrid);
+};
+
+} // namespace base
+
+#endif // BASE__CODEC__VIDEO_DECODER_HYBRID_H
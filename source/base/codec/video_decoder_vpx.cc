@@ -35,7 +35,8 @@ namespace {
 
 bool convertImage(const proto::VideoPacket& packet, vpx_image_t* image, Frame* frame)
 {
-    if (image->fmt != VPX_IMG_FMT_I420)
+    // The host sends I444 images if the client enabled the full color resolution (VP9 profile 1).
+    if (image->fmt != VPX_IMG_FMT_I420 && image->fmt != VPX_IMG_FMT_I444)
         return false;
 
     Rect frame_rect = Rect::makeSize(frame->size());
@@ -58,6 +59,21 @@ bool convertImage(const proto::VideoPacket& packet, vpx_image_t* image, Frame* f
         }
 
         int y_offset = y_stride * rect.y() + rect.x();
+
+        if (image->fmt == VPX_IMG_FMT_I444)
+        {
+            int uv_offset = uv_stride * rect.y() + rect.x();
+
+            libyuv::I444ToARGB(y_data + y_offset, y_stride,
+                               u_data + uv_offset, uv_stride,
+                               v_data + uv_offset, uv_stride,
+                               frame->frameDataAtPos(rect.topLeft()),
+                               frame->stride(),
+                               rect.width(),
+                               rect.height());
+            continue;
+        }
+
         int uv_offset = uv_stride * rect.y() / 2 + rect.x() / 2;
 
         libyuv::I420ToARGB(y_data + y_offset, y_stride,
@@ -20,8 +20,10 @@
 
 #include "base/logging.h"
 #include "base/codec/pixel_translator.h"
+#include "base/codec/tile_cache.h"
 #include "base/codec/video_util.h"
 #include "base/desktop/frame_aligned.h"
+#include "base/desktop/frame_simple.h"
 
 namespace base {
 
@@ -52,18 +54,43 @@ bool VideoDecoderZstd::decode(const proto::VideoPacket& packet, Frame* target_fr
         translator_ = PixelTranslator::create(source_frame_->format(), target_frame->format());
     }
 
-    DCHECK(source_frame_->size() == target_frame->size());
-
     if (!source_frame_ || !translator_)
     {
         LOG(LS_WARNING) << "A packet with image information was not received";
         return false;
     }
 
+    DCHECK(source_frame_->size() == target_frame->size());
+
+    Frame* source_frame = source_frame_.get();
+    PixelTranslator* translator = translator_.get();
+
+    // The refinement of the progressive mode has its own pixel format.
+    if (packet.has_pixel_format())
+    {
+        const PixelFormat format = parsePixelFormat(packet.pixel_format());
+
+        if (!refinement_frame_ || !(refinement_frame_->format() == format) ||
+            refinement_frame_->size() != source_frame_->size())
+        {
+            refinement_frame_ = FrameAligned::create(source_frame_->size(), format, 32);
+            refinement_translator_ = PixelTranslator::create(format, target_frame->format());
+        }
+
+        if (!refinement_translator_)
+        {
+            LOG(LS_WARNING) << "Unsupported pixel format";
+            return false;
+        }
+
+        source_frame = refinement_frame_.get();
+        translator = refinement_translator_.get();
+    }
+
     size_t ret = ZSTD_initDStream(stream_.get());
     DCHECK(!ZSTD_isError(ret)) << ZSTD_getErrorName(ret);
 
-    Rect frame_rect = Rect::makeSize(source_frame_->size());
+    Rect frame_rect = Rect::makeSize(source_frame->size());
     ZSTD_inBuffer input = { packet.data().data(), packet.data().size(), 0 };
 
     for (int i = 0; i < packet.dirty_rect_size(); ++i)
@@ -76,8 +103,8 @@ bool VideoDecoderZstd::decode(const proto::VideoPacket& packet, Frame* target_fr
             return false;
         }
 
-        uint8_t* output_data = source_frame_->frameDataAtPos(rect.x(), rect.y());
-        const size_t output_size = rect.width() * source_frame_->format().bytesPerPixel();
+        uint8_t* output_data = source_frame->frameDataAtPos(rect.x(), rect.y());
+        const size_t output_size = rect.width() * source_frame->format().bytesPerPixel();
 
         ZSTD_outBuffer output = { output_data, output_size, 0 };
         int row_y = 0;
@@ -95,18 +122,62 @@ bool VideoDecoderZstd::decode(const proto::VideoPacket& packet, Frame* target_fr
             if (output.pos == output.size)
             {
                 ++row_y;
-                output_data += source_frame_->stride();
+                output_data += source_frame->stride();
                 output.dst = output_data;
                 output.pos = 0;
             }
         }
 
-        translator_->translate(source_frame_->frameDataAtPos(rect.topLeft()),
-                               source_frame_->stride(),
-                               target_frame->frameDataAtPos(rect.topLeft()),
-                               target_frame->stride(),
-                               rect.width(),
-                               rect.height());
+        translator->translate(source_frame->frameDataAtPos(rect.topLeft()),
+                              source_frame->stride(),
+                              target_frame->frameDataAtPos(rect.topLeft()),
+                              target_frame->stride(),
+                              rect.width(),
+                              rect.height());
+    }
+
+    return decodeTiles(packet, target_frame);
+}
+
+bool VideoDecoderZstd::decodeTiles(const proto::VideoPacket& packet, Frame* target_frame)
+{
+    const Rect frame_rect = Rect::makeSize(target_frame->size());
+
+    for (const auto& cached_tile : packet.cached_tile())
+    {
+        const Rect rect = parseRect(cached_tile.rect());
+        const size_t index = cached_tile.index();
+
+        if (index >= tiles_.size() || !tiles_[index] || tiles_[index]->size() != rect.size() ||
+            !frame_rect.containsRect(rect))
+        {
+            LOG(LS_WARNING) << "Invalid cached tile: " << index;
+            return false;
+        }
+
+        target_frame->copyPixelsFrom(*tiles_[index], Point(0, 0), rect);
+    }
+
+    for (const auto& stored_tile : packet.stored_tile())
+    {
+        const Rect rect = parseRect(stored_tile.rect());
+        const size_t index = stored_tile.index();
+
+        if (index >= kMaxTileCacheSize || rect.isEmpty() || !frame_rect.containsRect(rect) ||
+            rect.width() > kTileCacheTileSize || rect.height() > kTileCacheTileSize)
+        {
+            LOG(LS_WARNING) << "Invalid stored tile: " << index;
+            return false;
+        }
+
+        if (index >= tiles_.size())
+            tiles_.resize(index + 1);
+
+        std::unique_ptr<Frame>& tile = tiles_[index];
+        if (!tile || tile->size() != rect.size())
+            tile = FrameSimple::create(rect.size(), target_frame->format());
+
+        tile->copyPixelsFrom(*target_frame, rect.topLeft(), Rect::makeSize(rect.size()));
     }
 
     return true;
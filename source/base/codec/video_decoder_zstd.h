@@ -23,6 +23,8 @@
 #include "base/codec/scoped_zstd_stream.h"
 #include "base/codec/video_decoder.h"
 
+#include <vector>
+
 namespace base {
 
 class PixelTranslator;
@@ -39,11 +41,20 @@ public:
 private:
     VideoDecoderZstd();
 
+    bool decodeTiles(const proto::VideoPacket& packet, Frame* target_frame);
+
     ScopedZstdDStream stream_;
 
     std::unique_ptr<PixelTranslator> translator_;
     std::unique_ptr<Frame> source_frame_;
 
+    // For the packets in another pixel format (see VideoPacket::pixel_format).
+    std::unique_ptr<PixelTranslator> refinement_translator_;
+    std::unique_ptr<Frame> refinement_frame_;
+
+    // The tile cache for the host (see VideoPacket::cached_tile).
+    std::vector<std::unique_ptr<Frame>> tiles_;
+
     DISALLOW_COPY_AND_ASSIGN(VideoDecoderZstd);
 };
 
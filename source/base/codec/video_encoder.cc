@@ -28,6 +28,11 @@ VideoEncoder::VideoEncoder(proto::VideoEncoding encoding)
     // Nothing
 }
 
+void VideoEncoder::encode(const Frame* frame, proto::VideoPacket* packet)
+{
+    encode(frame, frame->constUpdatedRegion(), packet);
+}
+
 void VideoEncoder::fillPacketInfo(const Frame* frame, proto::VideoPacket* packet)
 {
     packet->set_encoding(encoding_);
@@ -25,6 +25,7 @@
 namespace base {
 
 class Frame;
+class Region;
 
 class VideoEncoder
 {
@@ -32,7 +33,27 @@ public:
     explicit VideoEncoder(proto::VideoEncoding encoding);
     virtual ~VideoEncoder() = default;
 
-    virtual void encode(const Frame* frame, proto::VideoPacket* packet) = 0;
+    // Encodes |updated_region| of the frame. The frame can be shared by several clients, so its
+    // own updated region is not changed.
+    virtual void encode(const Frame* frame, const Region& updated_region,
+                        proto::VideoPacket* packet) = 0;
+
+    // Encodes the updated region of the frame.
+    void encode(const Frame* frame, proto::VideoPacket* packet);
+
+    // Sets the estimated bandwidth of the link. Encoders with a target bitrate adapt it to the
+    // estimate.
+    virtual void setBandwidthEstimateKbps(int /* bandwidth_kbps */) {}
+
+    // Sets the number of tiles that the client keeps in its cache (see TileCache). Encoders that
+    // support the cache send references to these tiles instead of their pixels.
+    virtual void setTileCacheSize(size_t /* size */) {}
+
+    // Encoders that first send some areas with a lower quality improve them when they stop
+    // changing. Returns true if there are such areas. Then the caller invokes encodeRefinement()
+    // periodically, which improves the areas that did not change for a while.
+    virtual bool hasPendingRefinement() const { return false; }
+    virtual void encodeRefinement(proto::VideoPacket* /* packet */) {}
 
     proto::VideoEncoding encoding() const { return encoding_; }
 
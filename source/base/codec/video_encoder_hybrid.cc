@@ -0,0 +1,329 @@
+//
+// Aspia Project
+// Copyright (C) 2020 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+
+#include "base/codec/video_encoder_hybrid.h"
+
+#include "base/logging.h"
+#include "base/codec/video_encoder_vpx.h"
+#include "base/codec/video_encoder_zstd.h"
+#include "base/codec/video_util.h"
+#include "base/desktop/frame_simple.h"
+
+#include <algorithm>
+#include <bitset>
+
+namespace base {
+
+namespace {
+
+// The screen is classified in blocks of this size.
+const int kBlockSize = 64;
+
+// A block is sent as video if it changed in at least this number of the last 16 frames...
+const uint32_t kHistoryMask = 0xFFFF;
+const size_t kMinChangesForMotion = 6;
+
+// ...and has more colors than this. Text and user interface elements have few colors even with
+// antialiasing.
+const int kMaxStaticColors = 256;
+
+// A video block that does not change for this time is sent losslessly again.
+const std::chrono::milliseconds kMotionIdleTime { 1000 };
+
+// Counts the colors of the rectangle. Stops counting when there are more than |limit| colors.
+int countColors(const Frame* frame, const Rect& rect, int limit)
+{
+    DCHECK_EQ(frame->format().bytesPerPixel(), 4);
+
+    // Open addressing hash set which is at least four times larger than the limit.
+    static const int kTableBits = 10;
+    static const int kTableSize = 1 << kTableBits;
+    DCHECK_LE(limit * 4, kTableSize);
+
+    uint32_t table[kTableSize];
+    bool used[kTableSize] = { false };
+    int count = 0;
+
+    for (int y = rect.top(); y < rect.bottom(); ++y)
+    {
+        const uint32_t* row =
+            reinterpret_cast<const uint32_t*>(frame->frameDataAtPos(rect.left(), y));
+
+        for (int x = 0; x < rect.width(); ++x)
+        {
+            // The alpha channel is not used.
+            const uint32_t color = row[x] & 0x00FFFFFF;
+            uint32_t index = (color * 2654435761U) >> (32 - kTableBits);
+
+            while (used[index] && table[index] != color)
+                index = (index + 1) & (kTableSize - 1);
+
+            if (used[index])
+                continue;
+
+            used[index] = true;
+            table[index] = color;
+
+            if (++count > limit)
+                return count;
+        }
+    }
+
+    return count;
+}
+
+Rect blockRect(const Frame* frame, int column, int row)
+{
+    Rect rect = Rect::makeXYWH(column * kBlockSize, row * kBlockSize, kBlockSize, kBlockSize);
+    rect.intersectWith(Rect::makeSize(frame->size()));
+    return rect;
+}
+
+// The dirty rectangles of the packet are the union of the rectangles of its parts.
+void addDirtyRectsOfParts(proto::VideoPacket* packet)
+{
+    Region dirty_region;
+
+    for (const auto& part : packet->part())
+    {
+        for (const auto& rect : part.dirty_rect())
+            dirty_region.addRect(parseRect(rect));
+    }
+
+    for (Region::Iterator it(dirty_region); !it.isAtEnd(); it.advance())
+        serializeRect(it.rect(), packet->add_dirty_rect());
+}
+
+} // namespace
+
+VideoEncoderHybrid::VideoEncoderHybrid(const PixelFormat& lossless_format, int compression_ratio)
+    : VideoEncoder(proto::VIDEO_ENCODING_HYBRID),
+      lossless_format_(lossless_format),
+      compression_ratio_(compression_ratio)
+{
+    // Nothing
+}
+
+VideoEncoderHybrid::~VideoEncoderHybrid() = default;
+
+// static
+std::unique_ptr<VideoEncoderHybrid> VideoEncoderHybrid::create(
+    const PixelFormat& lossless_format, int compression_ratio)
+{
+    return std::unique_ptr<VideoEncoderHybrid>(
+        new VideoEncoderHybrid(lossless_format, compression_ratio));
+}
+
+void VideoEncoderHybrid::encode(
+    const Frame* frame, const Region& updated_region, proto::VideoPacket* packet)
+{
+    fillPacketInfo(frame, packet);
+
+    if (packet->has_format())
+    {
+        reset(frame);
+
+        // All blocks are sent losslessly at first.
+        classifyBlocks(frame, Region(Rect::makeSize(frame->size())), Clock::now());
+    }
+    else
+    {
+        classifyBlocks(frame, updated_region, Clock::now());
+    }
+
+    if (!lossless_region_.isEmpty())
+        encodeLossless(frame, packet->add_part());
+
+    if (!motion_region_.isEmpty())
+        encodeMotion(frame, packet->add_part());
+
+    addDirtyRectsOfParts(packet);
+}
+
+void VideoEncoderHybrid::setBandwidthEstimateKbps(int bandwidth_kbps)
+{
+    if (motion_encoder_)
+        motion_encoder_->setBandwidthEstimateKbps(bandwidth_kbps);
+}
+
+bool VideoEncoderHybrid::hasPendingRefinement() const
+{
+    return !motion_blocks_.isEmpty();
+}
+
+void VideoEncoderHybrid::encodeRefinement(proto::VideoPacket* packet)
+{
+    if (motion_blocks_.isEmpty())
+        return;
+
+    const TimePoint now = Clock::now();
+    lossless_region_.clear();
+
+    // The video blocks that still change are improved later.
+    for (int row = 0; row < rows_; ++row)
+    {
+        for (int column = 0; column < columns_; ++column)
+        {
+            Block& block = blocks_[static_cast<size_t>(row * columns_ + column)];
+
+            if (!block.is_motion || now - block.last_change < kMotionIdleTime)
+                continue;
+
+            block.is_motion = false;
+
+            const Rect rect = blockRect(motion_frame_.get(), column, row);
+            motion_blocks_.subtract(rect);
+            lossless_region_.addRect(rect);
+        }
+    }
+
+    if (lossless_region_.isEmpty())
+        return;
+
+    packet->set_encoding(encoding());
+
+    // The blocks did not change since the last frame, so their copy is current.
+    encodeLossless(motion_frame_.get(), packet->add_part());
+    addDirtyRectsOfParts(packet);
+}
+
+void VideoEncoderHybrid::reset(const Frame* frame)
+{
+    const Size& size = frame->size();
+
+    columns_ = (size.width() + kBlockSize - 1) / kBlockSize;
+    rows_ = (size.height() + kBlockSize - 1) / kBlockSize;
+
+    blocks_.assign(static_cast<size_t>(columns_ * rows_), Block());
+    changed_blocks_.assign(blocks_.size(), false);
+    motion_blocks_.clear();
+
+    lossless_encoder_ = VideoEncoderZstd::create(lossless_format_, compression_ratio_);
+    motion_encoder_ = VideoEncoderVPX::createVP9();
+    motion_frame_ = FrameSimple::create(size, frame->format());
+}
+
+void VideoEncoderHybrid::classifyBlocks(
+    const Frame* frame, const Region& updated_region, TimePoint now)
+{
+    lossless_region_.clear();
+    motion_region_.clear();
+
+    std::fill(changed_blocks_.begin(), changed_blocks_.end(), false);
+
+    for (Region::Iterator it(updated_region); !it.isAtEnd(); it.advance())
+    {
+        const Rect& rect = it.rect();
+
+        const int left = std::max(rect.left() / kBlockSize, 0);
+        const int top = std::max(rect.top() / kBlockSize, 0);
+        const int right = std::min((rect.right() - 1) / kBlockSize, columns_ - 1);
+        const int bottom = std::min((rect.bottom() - 1) / kBlockSize, rows_ - 1);
+
+        for (int row = top; row <= bottom; ++row)
+        {
+            for (int column = left; column <= right; ++column)
+                changed_blocks_[static_cast<size_t>(row * columns_ + column)] = true;
+        }
+    }
+
+    for (int row = 0; row < rows_; ++row)
+    {
+        for (int column = 0; column < columns_; ++column)
+        {
+            const size_t index = static_cast<size_t>(row * columns_ + column);
+            const bool changed = changed_blocks_[index];
+
+            Block& block = blocks_[index];
+            const bool was_motion = block.is_motion;
+
+            block.history = (block.history << 1) | (changed ? 1 : 0);
+
+            if (changed)
+            {
+                block.last_change = now;
+
+                if (was_motion ||
+                    std::bitset<32>(block.history & kHistoryMask).count() >= kMinChangesForMotion)
+                {
+                    block.is_motion = countColors(
+                        frame, blockRect(frame, column, row), kMaxStaticColors) > kMaxStaticColors;
+                }
+            }
+            else if (was_motion && now - block.last_change >= kMotionIdleTime)
+            {
+                block.is_motion = false;
+            }
+
+            if (block.is_motion == was_motion)
+                continue;
+
+            // The whole block is sent by its new encoder. VP9 needs the unchanged pixels of the
+            // block for the prediction and Zstd replaces the lossy pixels.
+            const Rect rect = blockRect(frame, column, row);
+
+            if (block.is_motion)
+            {
+                motion_blocks_.addRect(rect);
+                motion_region_.addRect(rect);
+            }
+            else
+            {
+                motion_blocks_.subtract(rect);
+                lossless_region_.addRect(rect);
+            }
+        }
+    }
+
+    Region motion_changes(updated_region);
+    motion_changes.intersectWith(motion_blocks_);
+    motion_region_.addRegion(motion_changes);
+
+    Region lossless_changes(updated_region);
+    lossless_changes.subtract(motion_blocks_);
+    lossless_region_.addRegion(lossless_changes);
+}
+
+void VideoEncoderHybrid::encodeLossless(const Frame* frame, proto::VideoPacket* packet)
+{
+    lossless_encoder_->encode(frame, lossless_region_, packet);
+}
+
+void VideoEncoderHybrid::encodeMotion(const Frame* frame, proto::VideoPacket* packet)
+{
+    for (Region::Iterator it(motion_region_); !it.isAtEnd(); it.advance())
+        motion_frame_->copyPixelsFrom(*frame, it.rect().topLeft(), it.rect());
+
+    motion_encoder_->encode(frame, motion_region_, packet);
+
+    // VP9 also sends the surroundings of the changes and improves the quality of the previous
+    // frames. The client must show only the video blocks from it.
+    Region dirty_region;
+
+    for (const auto& rect : packet->dirty_rect())
+        dirty_region.addRect(parseRect(rect));
+
+    dirty_region.intersectWith(motion_blocks_);
+    packet->clear_dirty_rect();
+
+    for (Region::Iterator it(dirty_region); !it.isAtEnd(); it.advance())
+        serializeRect(it.rect(), packet->add_dirty_rect());
+}
+
+} // namespace base
@@ -0,0 +1,102 @@
+//
+// Aspia Project
+// Copyright (C) 2020 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+
+#ifndef BASE__CODEC__VIDEO_ENCODER_HYBRID_H
+#define BASE__CODEC__VIDEO_ENCODER_HYBRID_H
+
+#include "base/macros_magic.h"
+#include "base/codec/video_encoder.h"
+#include "base/desktop/pixel_format.h"
+#include "base/desktop/region.h"
+
+#include <chrono>
+#include <memory>
+#include <vector>
+
+namespace base {
+
+class FrameSimple;
+class VideoEncoderVPX;
+class VideoEncoderZstd;
+
+// Encodes the text and the user interface losslessly with Zstd and the video and animations with
+// VP9. The screen is divided into blocks. A block that changes often and has many colors is sent
+// with VP9, other blocks with Zstd. Each packet contains the parts of both encoders (see
+// VideoPacket::part). When a video block stops changing, it is sent losslessly again.
+class VideoEncoderHybrid : public VideoEncoder
+{
+public:
+    ~VideoEncoderHybrid();
+
+    static std::unique_ptr<VideoEncoderHybrid> create(
+        const PixelFormat& lossless_format, int compression_ratio);
+
+    using VideoEncoder::encode;
+    void encode(const Frame* frame, const Region& updated_region,
+                proto::VideoPacket* packet) override;
+    void setBandwidthEstimateKbps(int bandwidth_kbps) override;
+    bool hasPendingRefinement() const override;
+    void encodeRefinement(proto::VideoPacket* packet) override;
+
+private:
+    using Clock = std::chrono::steady_clock;
+    using TimePoint = Clock::time_point;
+
+    struct Block
+    {
+        // Bit N is set if the block changed N frames ago.
+        uint32_t history = 0;
+        bool is_motion = false;
+        TimePoint last_change;
+    };
+
+    VideoEncoderHybrid(const PixelFormat& lossless_format, int compression_ratio);
+
+    void reset(const Frame* frame);
+    void classifyBlocks(const Frame* frame, const Region& updated_region, TimePoint now);
+    void encodeLossless(const Frame* frame, proto::VideoPacket* packet);
+    void encodeMotion(const Frame* frame, proto::VideoPacket* packet);
+
+    const PixelFormat lossless_format_;
+    const int compression_ratio_;
+
+    std::unique_ptr<VideoEncoderZstd> lossless_encoder_;
+    std::unique_ptr<VideoEncoderVPX> motion_encoder_;
+
+    int columns_ = 0;
+    int rows_ = 0;
+    std::vector<Block> blocks_;
+    std::vector<bool> changed_blocks_;
+
+    // All blocks that are sent with VP9.
+    Region motion_blocks_;
+
+    // The areas of the current frame for each encoder.
+    Region lossless_region_;
+    Region motion_region_;
+
+    // The last pixels of the video blocks. They are sent losslessly when the blocks stop changing.
+    std::unique_ptr<FrameSimple> motion_frame_;
+
+    DISALLOW_COPY_AND_ASSIGN(VideoEncoderHybrid);
+};
+
+} // namespace base
+
+#endif // BASE__CODEC__VIDEO_ENCODER_HYBRID_H
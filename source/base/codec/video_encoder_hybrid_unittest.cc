@@ -0,0 +1,274 @@
+//
+// Aspia Project
+// Copyright (C) 2020 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "base/codec/video_encoder_hybrid.h"
+
+#include "base/codec/video_decoder_hybrid.h"
+#include "base/codec/video_util.h"
+#include "base/desktop/frame_simple.h"
+
+#include <gtest/gtest.h>
+
+#include <thread>
+
+namespace base {
+
+namespace {
+
+// 4x3 blocks of the encoder.
+const Size kFrameSize(256, 192);
+
+// A block with a video and a block with a user interface that changes as often.
+const Rect kVideoBlock = Rect::makeXYWH(0, 0, 64, 64);
+const Rect kWindowBlock = Rect::makeXYWH(64, 0, 64, 64);
+
+// A block becomes a video block when it changed in 6 of the last 16 frames.
+const int kFramesForMotion = 6;
+
+// Longer than the time after which an idle video block is sent losslessly again.
+const std::chrono::milliseconds kIdleTime(1100);
+
+// Every pixel has its own color.
+void fillNoise(Frame* frame, const Rect& rect, uint32_t seed)
+{
+    for (int y = rect.top(); y < rect.bottom(); ++y)
+    {
+        uint32_t* row = reinterpret_cast<uint32_t*>(frame->frameDataAtPos(rect.left(), y));
+
+        for (int x = 0; x < rect.width(); ++x)
+        {
+            row[x] = 0xFF000000 |
+                ((seed * 2654435761U) ^ ((rect.left() + x) * 7919) ^ (y * 104729));
+        }
+    }
+}
+
+// Two colors, like text on a background.
+void fillText(Frame* frame, const Rect& rect, uint32_t seed)
+{
+    for (int y = rect.top(); y < rect.bottom(); ++y)
+    {
+        uint32_t* row = reinterpret_cast<uint32_t*>(frame->frameDataAtPos(rect.left(), y));
+
+        for (int x = 0; x < rect.width(); ++x)
+            row[x] = ((x + y + seed) % 3) ? 0xFFFFFFFF : 0xFF000000;
+    }
+}
+
+// The alpha channel is not sent.
+bool isEqual(const Frame& frame1, const Frame& frame2, const Region& region)
+{
+    for (Region::Iterator it(region); !it.isAtEnd(); it.advance())
+    {
+        const Rect& rect = it.rect();
+
+        for (int y = rect.top(); y < rect.bottom(); ++y)
+        {
+            const uint32_t* row1 =
+                reinterpret_cast<const uint32_t*>(frame1.frameDataAtPos(rect.left(), y));
+            const uint32_t* row2 =
+                reinterpret_cast<const uint32_t*>(frame2.frameDataAtPos(rect.left(), y));
+
+            for (int x = 0; x < rect.width(); ++x)
+            {
+                if ((row1[x] & 0x00FFFFFF) != (row2[x] & 0x00FFFFFF))
+                    return false;
+            }
+        }
+    }
+
+    return true;
+}
+
+Region dirtyRegion(const proto::VideoPacket& packet)
+{
+    Region region;
+
+    for (const auto& rect : packet.dirty_rect())
+        region.addRect(parseRect(rect));
+
+    return region;
+}
+
+// The dirty region of the part of the packet with |encoding|.
+Region partRegion(const proto::VideoPacket& packet, proto::VideoEncoding encoding)
+{
+    Region region;
+
+    for (const auto& part : packet.part())
+    {
+        if (part.encoding() == encoding)
+            region.addRegion(dirtyRegion(part));
+    }
+
+    return region;
+}
+
+class VideoEncoderHybridTest : public testing::Test
+{
+protected:
+    VideoEncoderHybridTest()
+        : encoder_(VideoEncoderHybrid::create(PixelFormat::ARGB(), 8)),
+          decoder_(VideoDecoderHybrid::create()),
+          source_frame_(FrameSimple::create(kFrameSize, PixelFormat::ARGB())),
+          client_frame_(FrameSimple::create(kFrameSize, PixelFormat::ARGB()))
+    {
+        // Nothing
+    }
+
+    // Sends |region| of the source frame to the client.
+    proto::VideoPacket send(const Region& region)
+    {
+        proto::VideoPacket packet;
+        encoder_->encode(source_frame_.get(), region, &packet);
+
+        EXPECT_TRUE(decoder_->decode(packet, client_frame_.get()));
+
+        // The dirty rectangles of the packet are the union of its parts.
+        Region parts_region = partRegion(packet, proto::VIDEO_ENCODING_ZSTD);
+        parts_region.addRegion(partRegion(packet, proto::VIDEO_ENCODING_VP9));
+        EXPECT_TRUE(dirtyRegion(packet).equals(parts_region));
+
+        return packet;
+    }
+
+    // Sends the whole frame and then changes the video and the window in each frame. Returns
+    // the last packet, in which the video block is sent with VP9 for the first time.
+    proto::VideoPacket sendUntilMotion()
+    {
+        const Rect frame_rect = Rect::makeSize(source_frame_->size());
+
+        fillText(source_frame_.get(), frame_rect, 0);
+        fillNoise(source_frame_.get(), kVideoBlock, 0);
+
+        // All blocks are sent losslessly at first.
+        proto::VideoPacket packet = send(Region(frame_rect));
+        EXPECT_TRUE(packet.has_format());
+        EXPECT_TRUE(partRegion(packet, proto::VIDEO_ENCODING_ZSTD).equals(Region(frame_rect)));
+        EXPECT_TRUE(isEqual(*source_frame_, *client_frame_, Region(frame_rect)));
+
+        // Only a part of the video changes.
+        const Rect video_rect = Rect::makeXYWH(8, 8, 16, 16);
+
+        for (int i = 1; i < kFramesForMotion; ++i)
+        {
+            fillNoise(source_frame_.get(), video_rect, static_cast<uint32_t>(i));
+            fillText(source_frame_.get(), kWindowBlock, static_cast<uint32_t>(i));
+
+            Region region(video_rect);
+            region.addRect(kWindowBlock);
+
+            packet = send(region);
+
+            if (i + 1 < kFramesForMotion)
+            {
+                EXPECT_TRUE(partRegion(packet, proto::VIDEO_ENCODING_VP9).isEmpty()) << i;
+                EXPECT_TRUE(isEqual(*source_frame_, *client_frame_, region)) << i;
+            }
+        }
+
+        return packet;
+    }
+
+    std::unique_ptr<VideoEncoderHybrid> encoder_;
+    std::unique_ptr<VideoDecoderHybrid> decoder_;
+    std::unique_ptr<Frame> source_frame_;
+    std::unique_ptr<Frame> client_frame_;
+};
+
+} // namespace
+
+TEST_F(VideoEncoderHybridTest, MotionBlock)
+{
+    const proto::VideoPacket packet = sendUntilMotion();
+
+    // The whole block is sent when it becomes a video block. VP9 encodes the whole first frame,
+    // but only the video block is shown.
+    EXPECT_TRUE(partRegion(packet, proto::VIDEO_ENCODING_VP9).equals(Region(kVideoBlock)));
+
+    // The window has few colors and stays lossless.
+    EXPECT_TRUE(partRegion(packet, proto::VIDEO_ENCODING_ZSTD).equals(Region(kWindowBlock)));
+    EXPECT_TRUE(isEqual(*source_frame_, *client_frame_, Region(kWindowBlock)));
+
+    EXPECT_TRUE(encoder_->hasPendingRefinement());
+}
+
+TEST_F(VideoEncoderHybridTest, ChangesOfVideoBlock)
+{
+    sendUntilMotion();
+
+    // Changes of a video block are sent with VP9 and only within the block.
+    const Rect video_rect = Rect::makeXYWH(40, 40, 16, 16);
+    fillNoise(source_frame_.get(), video_rect, 100);
+
+    const proto::VideoPacket packet = send(Region(video_rect));
+
+    Region motion_region = partRegion(packet, proto::VIDEO_ENCODING_VP9);
+    EXPECT_FALSE(motion_region.isEmpty());
+
+    motion_region.subtract(kVideoBlock);
+    EXPECT_TRUE(motion_region.isEmpty());
+    EXPECT_TRUE(partRegion(packet, proto::VIDEO_ENCODING_ZSTD).isEmpty());
+}
+
+TEST_F(VideoEncoderHybridTest, RefinementOfIdleBlock)
+{
+    sendUntilMotion();
+
+    // The video still changes.
+    proto::VideoPacket packet;
+    encoder_->encodeRefinement(&packet);
+    EXPECT_EQ(packet.part_size(), 0);
+
+    std::this_thread::sleep_for(kIdleTime);
+
+    // The video stopped. Its last pixels are sent losslessly.
+    packet.Clear();
+    encoder_->encodeRefinement(&packet);
+
+    ASSERT_EQ(packet.part_size(), 1);
+    EXPECT_EQ(packet.part(0).encoding(), proto::VIDEO_ENCODING_ZSTD);
+    EXPECT_TRUE(dirtyRegion(packet).equals(Region(kVideoBlock)));
+
+    ASSERT_TRUE(decoder_->decode(packet, client_frame_.get()));
+    EXPECT_TRUE(isEqual(*source_frame_, *client_frame_, Region(Rect::makeSize(kFrameSize))));
+
+    EXPECT_FALSE(encoder_->hasPendingRefinement());
+}
+
+TEST_F(VideoEncoderHybridTest, NewScreenSize)
+{
+    sendUntilMotion();
+
+    // The packet with the new format starts the encoders and the decoders of the parts again.
+    const Size new_size(320, 256);
+    source_frame_ = FrameSimple::create(new_size, PixelFormat::ARGB());
+    client_frame_ = FrameSimple::create(new_size, PixelFormat::ARGB());
+
+    const proto::VideoPacket packet = sendUntilMotion();
+
+    EXPECT_TRUE(partRegion(packet, proto::VIDEO_ENCODING_VP9).equals(Region(kVideoBlock)));
+    EXPECT_TRUE(isEqual(*source_frame_, *client_frame_, Region(kWindowBlock)));
+
+    // The rest of the frame did not change since the first packet of the new size.
+    Region still_region(Rect::makeSize(new_size));
+    still_region.subtract(kVideoBlock);
+    EXPECT_TRUE(isEqual(*source_frame_, *client_frame_, still_region));
+}
+
+} // namespace base
@@ -21,8 +21,10 @@
 #include "base/logging.h"
 #include "base/codec/video_util.h"
 #include "base/desktop/frame.h"
+#include "base/threading/parallel_for.h"
 
 #include <libyuv/convert.h>
+#include <libyuv/convert_from_argb.h>
 #include <libyuv/cpu_id.h>
 
 #include <thread>
@@ -55,8 +57,17 @@ const int kStatsWindow = 5;
 // Defines the dimension of a macro block. This is used to compute the active map for the encoder.
 const int kMacroBlockSize = 16;
 
-// Magic encoder profile numbers for I420 input formats.
+// The updated region is converted to YUV in bands of rows on several threads when it is larger
+// than this. Smaller regions are converted faster than the threads wake up.
+const int64_t kMinAreaForParallelConversion = 256 * 256;
+
+// Each band has at least this number of rows. The bands start at macroblock rows, so the rows of
+// the chroma planes are never shared by two bands.
+const int kMinRowsPerBand = 64;
+
+// Magic encoder profile numbers for I420 and I444 input formats.
 const int kVp9I420ProfileNumber = 0;
+const int kVp9I444ProfileNumber = 1;
 
 // Magic encoder constant for adaptive quantization strategy.
 const int kVp9AqModeCyclicRefresh = 3;
@@ -104,6 +115,7 @@ void setCommonCodecParameters(vpx_codec_enc_cfg_t* config, const Size& size)
 }
 
 void createImage(const Size& size,
+                 bool use_i444,
                  std::unique_ptr<vpx_image_t>* out_image,
                  ByteArray* out_image_buffer)
 {
@@ -114,9 +126,19 @@ void createImage(const Size& size,
     image->d_w = image->w = size.width();
     image->d_h = image->h = size.height();
 
-    image->fmt = VPX_IMG_FMT_YV12;
-    image->x_chroma_shift = 1;
-    image->y_chroma_shift = 1;
+    if (use_i444)
+    {
+        // The chroma planes have the full resolution.
+        image->fmt = VPX_IMG_FMT_I444;
+        image->x_chroma_shift = 0;
+        image->y_chroma_shift = 0;
+    }
+    else
+    {
+        image->fmt = VPX_IMG_FMT_YV12;
+        image->x_chroma_shift = 1;
+        image->y_chroma_shift = 1;
+    }
 
     // libyuv's fast-path requires 16-byte aligned pointers and strides, so pad the Y, U and V
     // planes' strides to multiples of 16 bytes.
@@ -167,22 +189,62 @@ Rect alignRect(const Rect& rect)
     return Rect::makeLTRB(x, y, right, bottom);
 }
 
+void convertRect(const Frame* frame, const Rect& rect, vpx_image_t* image)
+{
+    const int y_stride = image->stride[0];
+    const int uv_stride = image->stride[1];
+
+    const int y_offset = y_stride * rect.y() + rect.x();
+    const int uv_offset = uv_stride * (rect.y() >> image->y_chroma_shift) +
+        (rect.x() >> image->x_chroma_shift);
+
+    if (image->fmt == VPX_IMG_FMT_I444)
+    {
+        libyuv::ARGBToI444(frame->frameDataAtPos(rect.topLeft()),
+                           frame->stride(),
+                           image->planes[0] + y_offset, y_stride,
+                           image->planes[1] + uv_offset, uv_stride,
+                           image->planes[2] + uv_offset, uv_stride,
+                           rect.width(),
+                           rect.height());
+        return;
+    }
+
+    libyuv::ARGBToI420(frame->frameDataAtPos(rect.topLeft()),
+                       frame->stride(),
+                       image->planes[0] + y_offset, y_stride,
+                       image->planes[1] + uv_offset, uv_stride,
+                       image->planes[2] + uv_offset, uv_stride,
+                       rect.width(),
+                       rect.height());
+}
+
 } // namespace
 
 // static
 std::unique_ptr<VideoEncoderVPX> VideoEncoderVPX::createVP8()
 {
-    return std::unique_ptr<VideoEncoderVPX>(new VideoEncoderVPX(proto::VIDEO_ENCODING_VP8));
+    return std::unique_ptr<VideoEncoderVPX>(
+        new VideoEncoderVPX(proto::VIDEO_ENCODING_VP8, false));
 }
 
 // static
 std::unique_ptr<VideoEncoderVPX> VideoEncoderVPX::createVP9()
 {
-    return std::unique_ptr<VideoEncoderVPX>(new VideoEncoderVPX(proto::VIDEO_ENCODING_VP9));
+    return std::unique_ptr<VideoEncoderVPX>(
+        new VideoEncoderVPX(proto::VIDEO_ENCODING_VP9, false));
+}
+
+// static
+std::unique_ptr<VideoEncoderVPX> VideoEncoderVPX::createVP9I444()
+{
+    return std::unique_ptr<VideoEncoderVPX>(
+        new VideoEncoderVPX(proto::VIDEO_ENCODING_VP9, true));
 }
 
-VideoEncoderVPX::VideoEncoderVPX(proto::VideoEncoding encoding)
+VideoEncoderVPX::VideoEncoderVPX(proto::VideoEncoding encoding, bool use_i444)
     : VideoEncoder(encoding),
+      use_i444_(use_i444),
       bitrate_filter_(kVp8MinimumTargetBitrateKbpsPerMegapixel),
       updated_region_area_(kStatsWindow)
 {
@@ -190,7 +252,8 @@ VideoEncoderVPX::VideoEncoderVPX(proto::VideoEncoding encoding)
     memset(&active_map_, 0, sizeof(active_map_));
 }
 
-void VideoEncoderVPX::encode(const Frame* frame, proto::VideoPacket* packet)
+void VideoEncoderVPX::encode(
+    const Frame* frame, const Region& updated_region, proto::VideoPacket* packet)
 {
     fillPacketInfo(frame, packet);
 
@@ -202,7 +265,7 @@ void VideoEncoderVPX::encode(const Frame* frame, proto::VideoPacket* packet)
 
         bitrate_filter_.setFrameSize(frame_size.width(), frame_size.height());
 
-        createImage(frame_size, &image_, &image_buffer_);
+        createImage(frame_size, use_i444_, &image_, &image_buffer_);
         createActiveMap(frame_size);
 
         if (encoding() == proto::VIDEO_ENCODING_VP8)
@@ -220,7 +283,7 @@ void VideoEncoderVPX::encode(const Frame* frame, proto::VideoPacket* packet)
 
     // Convert the updated capture data ready for encode.
     // Update active map based on updated region.
-    int64_t updated_area = prepareImageAndActiveMap(is_key_frame, frame, packet);
+    int64_t updated_area = prepareImageAndActiveMap(is_key_frame, frame, updated_region, packet);
 
     updateConfig(updated_area);
 
@@ -294,8 +357,7 @@ void VideoEncoderVPX::createVp8Codec(const Size& size)
     config_.rc_min_quantizer = 20;
     config_.rc_max_quantizer = 30;
 
-    // In the absence of a good bandwidth estimator set the target bitrate to a
-    // conservative default.
+    // Start with a conservative default. The target bitrate follows the bandwidth estimate later.
     config_.rc_target_bitrate = kDefaultTargetBitrateKbps;
 
     ret = vpx_codec_enc_init(codec_.get(), algo, &config_, 0);
@@ -326,14 +388,13 @@ void VideoEncoderVPX::createVp9Codec(const Size& size)
 
     setCommonCodecParameters(&config_, size);
 
-    // Configure VP9 for I420 source frames.
-    config_.g_profile = kVp9I420ProfileNumber;
+    // Configure VP9 for I420 or I444 source frames.
+    config_.g_profile = use_i444_ ? kVp9I444ProfileNumber : kVp9I420ProfileNumber;
     config_.rc_min_quantizer = 20;
     config_.rc_max_quantizer = 30;
     config_.rc_end_usage = VPX_CBR;
 
-    // In the absence of a good bandwidth estimator set the target bitrate to a
-    // conservative default.
+    // Start with a conservative default. The target bitrate follows the bandwidth estimate later.
     config_.rc_target_bitrate = kDefaultTargetBitrateKbps;
 
     ret = vpx_codec_enc_init(codec_.get(), algo, &config_, 0);
@@ -358,7 +419,7 @@ void VideoEncoderVPX::createVp9Codec(const Size& size)
 }
 
 int64_t VideoEncoderVPX::prepareImageAndActiveMap(
-    bool is_key_frame, const Frame* frame, proto::VideoPacket* packet)
+    bool is_key_frame, const Frame* frame, const Region& frame_region, proto::VideoPacket* packet)
 {
     Rect image_rect = Rect::makeWH(image_->w, image_->h);
     Region updated_region;
@@ -367,7 +428,7 @@ int64_t VideoEncoderVPX::prepareImageAndActiveMap(
     {
         const int padding = ((encoding() == proto::VIDEO_ENCODING_VP9) ? 8 : 3);
 
-        for (Region::Iterator it(frame->constUpdatedRegion()); !it.isAtEnd(); it.advance())
+        for (Region::Iterator it(frame_region); !it.isAtEnd(); it.advance())
         {
             Rect rect = it.rect();
 
@@ -396,33 +457,49 @@ int64_t VideoEncoderVPX::prepareImageAndActiveMap(
     if (!top_off_is_active_)
         clearActiveMap();
 
-    const int y_stride = image_->stride[0];
-    const int uv_stride = image_->stride[1];
-    uint8_t* y_data = image_->planes[0];
-    uint8_t* u_data = image_->planes[1];
-    uint8_t* v_data = image_->planes[2];
-
     int64_t updated_area = 0;
+    updated_rects_.clear();
 
     for (Region::Iterator it(updated_region); !it.isAtEnd(); it.advance())
     {
-        Rect rect = it.rect();
+        const Rect& rect = it.rect();
 
-        const int y_offset = y_stride * rect.y() + rect.x();
-        const int uv_offset = uv_stride * rect.y() / 2 + rect.x() / 2;
-        const int width = rect.width();
-        const int height = rect.height();
+        updated_area += rect.width() * rect.height();
+        updated_rects_.push_back(rect);
+    }
 
-        libyuv::ARGBToI420(frame->frameDataAtPos(rect.topLeft()),
-                           frame->stride(),
-                           y_data + y_offset, y_stride,
-                           u_data + uv_offset, uv_stride,
-                           v_data + uv_offset, uv_stride,
-                           width,
-                           height);
-
-        updated_area += width * height;
-        addRectToActiveMap(rect);
+    if (updated_area < kMinAreaForParallelConversion)
+    {
+        for (const auto& rect : updated_rects_)
+        {
+            convertRect(frame, rect, image_.get());
+            addRectToActiveMap(rect);
+        }
+    }
+    else
+    {
+        // Each band converts the parts of the rectangles that are within its rows.
+        const int height = static_cast<int>(image_->h);
+
+        ParallelFor conversion(height, kMinRowsPerBand, kMacroBlockSize, [&](int top, int bottom)
+        {
+            const Rect band_rect = Rect::makeLTRB(0, top, image_rect.right(), bottom);
+
+            for (const auto& rect : updated_rects_)
+            {
+                Rect part = rect;
+                part.intersectWith(band_rect);
+
+                if (!part.isEmpty())
+                    convertRect(frame, part, image_.get());
+            }
+        });
+
+        // The active map is updated while the bands are converted.
+        for (const auto& rect : updated_rects_)
+            addRectToActiveMap(rect);
+
+        conversion.wait();
     }
 
     if (top_off_is_active_)
@@ -31,6 +31,8 @@
 #include <vpx/vpx_encoder.h>
 #include <vpx/vp8cx.h>
 
+#include <vector>
+
 namespace base {
 
 class VideoEncoderVPX : public VideoEncoder
@@ -41,23 +43,31 @@ public:
     static std::unique_ptr<VideoEncoderVPX> createVP8();
     static std::unique_ptr<VideoEncoderVPX> createVP9();
 
-    void encode(const Frame* frame, proto::VideoPacket* packet) override;
-    void setBandwidthEstimateKbps(int bandwidth_kbps);
+    // VP9 profile 1 with the full resolution of the chroma planes. Colored text and thin lines
+    // stay sharp without raising the bitrate.
+    static std::unique_ptr<VideoEncoderVPX> createVP9I444();
+
+    using VideoEncoder::encode;
+    void encode(const Frame* frame, const Region& updated_region,
+                proto::VideoPacket* packet) override;
+    void setBandwidthEstimateKbps(int bandwidth_kbps) override;
 
 private:
-    explicit VideoEncoderVPX(proto::VideoEncoding encoding);
+    VideoEncoderVPX(proto::VideoEncoding encoding, bool use_i444);
 
     void createActiveMap(const Size& size);
     void createVp8Codec(const Size& size);
     void createVp9Codec(const Size& size);
-    int64_t prepareImageAndActiveMap(
-        bool is_key_frame, const Frame* frame, proto::VideoPacket* packet);
+    int64_t prepareImageAndActiveMap(bool is_key_frame, const Frame* frame,
+                                     const Region& frame_region, proto::VideoPacket* packet);
     void regionFromActiveMap(Region* updated_region);
     void addRectToActiveMap(const Rect& rect);
     void clearActiveMap();
 
     void updateConfig(int64_t updated_area);
 
+    const bool use_i444_;
+
     vpx_codec_enc_cfg_t config_;
     ScopedVpxCodec codec_;
 
@@ -69,6 +79,10 @@ private:
     std::unique_ptr<vpx_image_t> image_;
     ByteArray image_buffer_;
 
+    // The rectangles of the updated region of the current frame. The vector is kept between frames
+    // so that its memory is reused.
+    std::vector<Rect> updated_rects_;
+
     EncoderBitrateFilter bitrate_filter_;
 
     // Accumulator for updated region area in the previously encoded frames.
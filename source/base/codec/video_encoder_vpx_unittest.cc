@@ -0,0 +1,108 @@
+//
+// Aspia Project
+// Copyright (C) 2020 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "base/codec/video_encoder_vpx.h"
+
+#include "base/codec/video_decoder_vpx.h"
+#include "base/desktop/frame_simple.h"
+
+#include <gtest/gtest.h>
+
+#include <cstdlib>
+
+namespace base {
+
+namespace {
+
+const Size kFrameSize(256, 128);
+const int kFrameCount = 5;
+
+// Red and blue lines one pixel wide, like the strokes of colored text.
+void fillColoredLines(Frame* frame)
+{
+    for (int y = 0; y < frame->size().height(); ++y)
+    {
+        uint32_t* row = reinterpret_cast<uint32_t*>(frame->frameDataAtPos(0, y));
+
+        for (int x = 0; x < frame->size().width(); ++x)
+            row[x] = (x % 2) ? 0xFFFF0000 : 0xFF0000FF;
+    }
+}
+
+// The average difference of the color channels.
+double colorError(const Frame& frame1, const Frame& frame2)
+{
+    int64_t error = 0;
+
+    for (int y = 0; y < frame1.size().height(); ++y)
+    {
+        const uint8_t* row1 = frame1.frameDataAtPos(0, y);
+        const uint8_t* row2 = frame2.frameDataAtPos(0, y);
+
+        for (int x = 0; x < frame1.size().width(); ++x)
+        {
+            // The alpha channel is not sent.
+            for (int i = 0; i < 3; ++i)
+                error += std::abs(row1[x * 4 + i] - row2[x * 4 + i]);
+        }
+    }
+
+    return static_cast<double>(error) / (frame1.size().width() * frame1.size().height() * 3);
+}
+
+// Sends the frame several times and returns the error of the last decoded frame.
+double roundTripError(VideoEncoderVPX* encoder, const Frame& source_frame)
+{
+    std::unique_ptr<VideoDecoderVPX> decoder = VideoDecoderVPX::createVP9();
+    std::unique_ptr<Frame> client_frame = FrameSimple::create(kFrameSize, PixelFormat::ARGB());
+
+    for (int i = 0; i < kFrameCount; ++i)
+    {
+        proto::VideoPacket packet;
+        encoder->encode(&source_frame, Region(Rect::makeSize(kFrameSize)), &packet);
+
+        if (i == 0)
+        {
+            EXPECT_TRUE(packet.has_format());
+        }
+
+        EXPECT_TRUE(decoder->decode(packet, client_frame.get()));
+    }
+
+    return colorError(source_frame, *client_frame);
+}
+
+} // namespace
+
+TEST(VideoEncoderVPXTest, I444KeepsColorResolution)
+{
+    std::unique_ptr<Frame> source_frame = FrameSimple::create(kFrameSize, PixelFormat::ARGB());
+    fillColoredLines(source_frame.get());
+
+    std::unique_ptr<VideoEncoderVPX> i420_encoder = VideoEncoderVPX::createVP9();
+    std::unique_ptr<VideoEncoderVPX> i444_encoder = VideoEncoderVPX::createVP9I444();
+
+    const double i420_error = roundTripError(i420_encoder.get(), *source_frame);
+    const double i444_error = roundTripError(i444_encoder.get(), *source_frame);
+
+    // With I420 the neighboring red and blue pixels share their chroma and turn purple.
+    EXPECT_GT(i420_error, 32);
+    EXPECT_LT(i444_error * 4, i420_error);
+}
+
+} // namespace base
@@ -20,13 +20,17 @@
 
 #include "base/logging.h"
 #include "base/codec/pixel_translator.h"
+#include "base/codec/tile_cache.h"
 #include "base/codec/video_util.h"
-#include "base/desktop/frame.h"
+#include "base/desktop/frame_simple.h"
 
 namespace base {
 
 namespace {
 
+// In the progressive mode the areas that did not change for this time are sent in ARGB.
+const std::chrono::milliseconds kRefinementIdleTime { 1000 };
+
 // Retrieves a pointer to the output buffer in |update| used for storing the
 // encoded rectangle data. Will resize the buffer to |size|.
 uint8_t* outputBuffer(proto::VideoPacket* packet, size_t size)
@@ -35,14 +39,27 @@ uint8_t* outputBuffer(proto::VideoPacket* packet, size_t size)
     return reinterpret_cast<uint8_t*>(packet->mutable_data()->data());
 }
 
+int clampCompressionRatio(int compression_ratio)
+{
+    if (compression_ratio > ZSTD_maxCLevel())
+        return ZSTD_maxCLevel();
+
+    if (compression_ratio < 1)
+        return 1;
+
+    return compression_ratio;
+}
+
 } // namespace
 
 VideoEncoderZstd::VideoEncoderZstd(const PixelFormat& target_format,
-                                   int compression_ratio)
+                                   int compression_ratio,
+                                   bool progressive)
     : VideoEncoder(proto::VIDEO_ENCODING_ZSTD),
       target_format_(target_format),
       compress_ratio_(compression_ratio),
-      stream_(ZSTD_createCStream())
+      stream_(ZSTD_createCStream()),
+      progressive_(progressive)
 {
     // Nothing
 }
@@ -53,13 +70,19 @@ VideoEncoderZstd::~VideoEncoderZstd() = default;
 std::unique_ptr<VideoEncoderZstd> VideoEncoderZstd::create(
     const PixelFormat& target_format, int compression_ratio)
 {
-    if (compression_ratio > ZSTD_maxCLevel())
-        compression_ratio = ZSTD_maxCLevel();
-    else if (compression_ratio < 1)
-        compression_ratio = 1;
-
     return std::unique_ptr<VideoEncoderZstd>(
-        new VideoEncoderZstd(target_format, compression_ratio));
+        new VideoEncoderZstd(target_format, clampCompressionRatio(compression_ratio), false));
+}
+
+// static
+std::unique_ptr<VideoEncoderZstd> VideoEncoderZstd::createProgressive(
+    const PixelFormat& target_format, int compression_ratio)
+{
+    // ARGB is already lossless.
+    const bool progressive = target_format.bytesPerPixel() < 4;
+
+    return std::unique_ptr<VideoEncoderZstd>(new VideoEncoderZstd(
+        target_format, clampCompressionRatio(compression_ratio), progressive));
 }
 
 void VideoEncoderZstd::compressPacket(const ByteArray& buffer, proto::VideoPacket* packet)
@@ -89,7 +112,8 @@ void VideoEncoderZstd::compressPacket(const ByteArray& buffer, proto::VideoPacke
     packet->mutable_data()->resize(output.pos);
 }
 
-void VideoEncoderZstd::encode(const Frame* frame, proto::VideoPacket* packet)
+void VideoEncoderZstd::encode(
+    const Frame* frame, const Region& updated_region, proto::VideoPacket* packet)
 {
     fillPacketInfo(frame, packet);
 
@@ -97,10 +121,20 @@ void VideoEncoderZstd::encode(const Frame* frame, proto::VideoPacket* packet)
     {
         serializePixelFormat(target_format_, packet->mutable_format()->mutable_pixel_format());
         updated_region_ = Region(Rect::makeSize(frame->size()));
+
+        if (tile_cache_)
+            tile_cache_->clear();
+
+        if (progressive_)
+        {
+            source_frame_ = FrameSimple::create(frame->size(), frame->format());
+            refinement_region_.clear();
+            recent_updates_.clear();
+        }
     }
     else
     {
-        updated_region_ = frame->constUpdatedRegion();
+        updated_region_ = updated_region;
     }
 
     if (!translator_)
@@ -113,13 +147,94 @@ void VideoEncoderZstd::encode(const Frame* frame, proto::VideoPacket* packet)
         }
     }
 
-    size_t data_size = 0;
+    if (tile_cache_)
+    {
+        // The tiles that the client has in its cache are not sent.
+        Region encoded_region(updated_region_);
+        encoded_region.subtract(tile_cache_->encode(frame, updated_region_, packet));
 
+        encodeRegion(frame, encoded_region, target_format_, translator_.get(), packet);
+    }
+    else
+    {
+        encodeRegion(frame, updated_region_, target_format_, translator_.get(), packet);
+    }
+
+    if (!progressive_ || updated_region_.isEmpty())
+        return;
+
+    // Keep the pixels for the refinement. The frame can be changed by the capturer before.
     for (Region::Iterator it(updated_region_); !it.isAtEnd(); it.advance())
+        source_frame_->copyPixelsFrom(*frame, it.rect().topLeft(), it.rect());
+
+    const TimePoint now = Clock::now();
+
+    refinement_region_.addRegion(updated_region_);
+    recent_updates_.push_back({ now, updated_region_ });
+    removeOldUpdates(now);
+}
+
+void VideoEncoderZstd::setTileCacheSize(size_t size)
+{
+    if (size)
+        tile_cache_ = std::make_unique<TileCache>(size);
+    else
+        tile_cache_.reset();
+}
+
+bool VideoEncoderZstd::hasPendingRefinement() const
+{
+    return !refinement_region_.isEmpty();
+}
+
+void VideoEncoderZstd::encodeRefinement(proto::VideoPacket* packet)
+{
+    if (refinement_region_.isEmpty())
+        return;
+
+    removeOldUpdates(Clock::now());
+
+    // The areas that still change are improved later.
+    Region region(refinement_region_);
+    for (const auto& update : recent_updates_)
+        region.subtract(update.region);
+
+    if (region.isEmpty())
+        return;
+
+    if (!refinement_translator_)
+    {
+        refinement_translator_ =
+            PixelTranslator::create(source_frame_->format(), PixelFormat::ARGB());
+        if (!refinement_translator_)
+        {
+            LOG(LS_WARNING) << "Unsupported pixel format";
+            return;
+        }
+    }
+
+    refinement_region_.subtract(region);
+
+    packet->set_encoding(encoding());
+    serializePixelFormat(PixelFormat::ARGB(), packet->mutable_pixel_format());
+
+    encodeRegion(source_frame_.get(), region, PixelFormat::ARGB(),
+                 refinement_translator_.get(), packet);
+}
+
+void VideoEncoderZstd::encodeRegion(const Frame* frame,
+                                    const Region& region,
+                                    const PixelFormat& format,
+                                    PixelTranslator* translator,
+                                    proto::VideoPacket* packet)
+{
+    size_t data_size = 0;
+
+    for (Region::Iterator it(region); !it.isAtEnd(); it.advance())
     {
         const Rect& rect = it.rect();
 
-        data_size += rect.width() * rect.height() * target_format_.bytesPerPixel();
+        data_size += rect.width() * rect.height() * format.bytesPerPixel();
         serializeRect(rect, packet->add_dirty_rect());
     }
 
@@ -130,17 +245,17 @@ void VideoEncoderZstd::encode(const Frame* frame, proto::VideoPacket* packet)
 
     uint8_t* translate_pos = translate_buffer_.data();
 
-    for (Region::Iterator it(updated_region_); !it.isAtEnd(); it.advance())
+    for (Region::Iterator it(region); !it.isAtEnd(); it.advance())
     {
         const Rect& rect = it.rect();
-        const int stride = rect.width() * target_format_.bytesPerPixel();
+        const int stride = rect.width() * format.bytesPerPixel();
 
-        translator_->translate(frame->frameDataAtPos(rect.topLeft()),
-                               frame->stride(),
-                               translate_pos,
-                               stride,
-                               rect.width(),
-                               rect.height());
+        translator->translate(frame->frameDataAtPos(rect.topLeft()),
+                              frame->stride(),
+                              translate_pos,
+                              stride,
+                              rect.width(),
+                              rect.height());
 
         translate_pos += rect.height() * stride;
     }
@@ -149,4 +264,10 @@ void VideoEncoderZstd::encode(const Frame* frame, proto::VideoPacket* packet)
     compressPacket(translate_buffer_, packet);
 }
 
+void VideoEncoderZstd::removeOldUpdates(TimePoint now)
+{
+    while (!recent_updates_.empty() && now - recent_updates_.front().time >= kRefinementIdleTime)
+        recent_updates_.pop_front();
+}
+
 } // namespace base
@@ -26,9 +26,14 @@
 #include "base/desktop/pixel_format.h"
 #include "base/memory/byte_array.h"
 
+#include <chrono>
+#include <deque>
+
 namespace base {
 
+class FrameSimple;
 class PixelTranslator;
+class TileCache;
 
 class VideoEncoderZstd : public VideoEncoder
 {
@@ -38,10 +43,35 @@ public:
     static std::unique_ptr<VideoEncoderZstd> create(
         const PixelFormat& target_format, int compression_ratio);
 
-    void encode(const Frame* frame, proto::VideoPacket* packet) override;
+    // The changed areas are sent in |target_format| first. When they stop changing, they are sent
+    // again in ARGB.
+    static std::unique_ptr<VideoEncoderZstd> createProgressive(
+        const PixelFormat& target_format, int compression_ratio);
+
+    using VideoEncoder::encode;
+    void encode(const Frame* frame, const Region& updated_region,
+                proto::VideoPacket* packet) override;
+    void setTileCacheSize(size_t size) override;
+    bool hasPendingRefinement() const override;
+    void encodeRefinement(proto::VideoPacket* packet) override;
 
 private:
-    VideoEncoderZstd(const PixelFormat& target_format, int compression_ratio);
+    using Clock = std::chrono::steady_clock;
+    using TimePoint = Clock::time_point;
+
+    struct Update
+    {
+        TimePoint time;
+        Region region;
+    };
+
+    VideoEncoderZstd(const PixelFormat& target_format, int compression_ratio, bool progressive);
+    void encodeRegion(const Frame* frame,
+                      const Region& region,
+                      const PixelFormat& format,
+                      PixelTranslator* translator,
+                      proto::VideoPacket* packet);
+    void removeOldUpdates(TimePoint now);
     void compressPacket(const ByteArray& buffer, proto::VideoPacket* packet);
 
     Region updated_region_;
@@ -50,6 +80,15 @@ private:
     ScopedZstdCStream stream_;
     std::unique_ptr<PixelTranslator> translator_;
     ByteArray translate_buffer_;
+    std::unique_ptr<TileCache> tile_cache_;
+
+    // Progressive mode. The copy of the screen, the areas that are not yet sent in ARGB and the
+    // changes of the last second.
+    const bool progressive_;
+    std::unique_ptr<FrameSimple> source_frame_;
+    std::unique_ptr<PixelTranslator> refinement_translator_;
+    Region refinement_region_;
+    std::deque<Update> recent_updates_;
 
     DISALLOW_COPY_AND_ASSIGN(VideoEncoderZstd);
 };
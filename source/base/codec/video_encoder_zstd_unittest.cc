@@ -0,0 +1,122 @@
+//
+// Aspia Project
+// Copyright (C) 2020 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "base/codec/video_encoder_zstd.h"
+
+#include "base/codec/video_decoder_zstd.h"
+#include "base/desktop/frame_simple.h"
+
+#include <gtest/gtest.h>
+
+#include <thread>
+
+namespace base {
+
+namespace {
+
+const Size kFrameSize(200, 150);
+
+// Longer than the time after which the encoder sends the areas that stopped changing in ARGB.
+const std::chrono::milliseconds kIdleTime(1100);
+
+void fillFrame(Frame* frame, const Rect& rect, uint32_t seed)
+{
+    for (int y = rect.top(); y < rect.bottom(); ++y)
+    {
+        uint32_t* row = reinterpret_cast<uint32_t*>(frame->frameDataAtPos(rect.left(), y));
+
+        for (int x = 0; x < rect.width(); ++x)
+        {
+            row[x] = 0xFF000000 |
+                ((seed * 2654435761U) ^ ((rect.left() + x) * 7919) ^ (y * 104729));
+        }
+    }
+}
+
+// The alpha channel is not sent.
+bool isEqual(const Frame& frame1, const Frame& frame2, const Rect& rect)
+{
+    for (int y = rect.top(); y < rect.bottom(); ++y)
+    {
+        const uint32_t* row1 =
+            reinterpret_cast<const uint32_t*>(frame1.frameDataAtPos(rect.left(), y));
+        const uint32_t* row2 =
+            reinterpret_cast<const uint32_t*>(frame2.frameDataAtPos(rect.left(), y));
+
+        for (int x = 0; x < rect.width(); ++x)
+        {
+            if ((row1[x] & 0x00FFFFFF) != (row2[x] & 0x00FFFFFF))
+                return false;
+        }
+    }
+
+    return true;
+}
+
+} // namespace
+
+TEST(VideoEncoderZstdTest, ProgressiveRefinement)
+{
+    std::unique_ptr<Frame> source_frame = FrameSimple::create(kFrameSize, PixelFormat::ARGB());
+    std::unique_ptr<Frame> client_frame = FrameSimple::create(kFrameSize, PixelFormat::ARGB());
+    const Rect frame_rect = Rect::makeSize(kFrameSize);
+    const Rect window_rect = Rect::makeXYWH(10, 20, 150, 100);
+
+    std::unique_ptr<VideoEncoderZstd> encoder =
+        VideoEncoderZstd::createProgressive(PixelFormat::RGB332(), 1);
+    std::unique_ptr<VideoDecoderZstd> decoder = VideoDecoderZstd::create();
+
+    // The frame is sent in RGB332 first.
+    fillFrame(source_frame.get(), frame_rect, 1);
+
+    proto::VideoPacket packet;
+    encoder->encode(source_frame.get(), Region(frame_rect), &packet);
+    ASSERT_TRUE(decoder->decode(packet, client_frame.get()));
+    EXPECT_FALSE(isEqual(*source_frame, *client_frame, frame_rect));
+    EXPECT_TRUE(encoder->hasPendingRefinement());
+
+    // The frame has just changed.
+    packet.Clear();
+    encoder->encodeRefinement(&packet);
+    EXPECT_EQ(packet.dirty_rect_size(), 0);
+
+    std::this_thread::sleep_for(kIdleTime);
+
+    fillFrame(source_frame.get(), window_rect, 2);
+
+    packet.Clear();
+    encoder->encode(source_frame.get(), Region(window_rect), &packet);
+    ASSERT_TRUE(decoder->decode(packet, client_frame.get()));
+
+    // The areas around the window did not change for a while. They are sent in ARGB.
+    packet.Clear();
+    encoder->encodeRefinement(&packet);
+    ASSERT_TRUE(packet.has_pixel_format());
+    ASSERT_TRUE(decoder->decode(packet, client_frame.get()));
+
+    Region refined_region(frame_rect);
+    refined_region.subtract(window_rect);
+
+    for (Region::Iterator it(refined_region); !it.isAtEnd(); it.advance())
+        EXPECT_TRUE(isEqual(*source_frame, *client_frame, it.rect()));
+
+    EXPECT_FALSE(isEqual(*source_frame, *client_frame, window_rect));
+    EXPECT_TRUE(encoder->hasPendingRefinement());
+}
+
+} // namespace base
@@ -81,4 +81,16 @@ bool CpuidUtil::hasAesNi()
     return BitSet<uint32_t>(CpuidUtil(1).ecx()).test(25);
 }
 
+// static
+bool CpuidUtil::hasPclmulqdq()
+{
+    // Check if function 1 is supported.
+    if (CpuidUtil(0).eax() < 1)
+        return false;
+
+    // Bit 1 of register ECX set to 1 indicates the support of carry-less multiplication
+    // (used by GHASH in AES GCM).
+    return BitSet<uint32_t>(CpuidUtil(1).ecx()).test(1);
+}
+
 } // namespace base
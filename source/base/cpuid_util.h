@@ -46,6 +46,7 @@ public:
     uint32_t edx() const { return static_cast<uint32_t>(cpu_info_[kEDX]); }
 
     static bool hasAesNi();
+    static bool hasPclmulqdq();
 
 private:
     static constexpr int kEAX = 0;
@@ -0,0 +1,137 @@
+//
+// Aspia Project
+// Copyright (C) 2020 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+// Measures the throughput of the message encryptors and decryptors for messages of different sizes,
+// sent in one record each and sealed into 64 kB records as NetworkChannel does with record
+// batching.
+//
+// Usage: aspia_cryptor_benchmark
+
+#include "base/crypto/message_decryptor_openssl.h"
+#include "base/crypto/message_encryptor_openssl.h"
+#include "base/crypto/scoped_crypto_initializer.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+
+namespace {
+
+using EncryptorFactory =
+    std::unique_ptr<base::MessageEncryptor>(*)(const base::ByteArray&, const base::ByteArray&);
+using DecryptorFactory =
+    std::unique_ptr<base::MessageDecryptor>(*)(const base::ByteArray&, const base::ByteArray&);
+
+struct Cipher
+{
+    const char* name;
+    EncryptorFactory encryptor;
+    DecryptorFactory decryptor;
+};
+
+const Cipher kCiphers[] =
+{
+    { "AES256-GCM",
+      &base::MessageEncryptorOpenssl::createForAes256Gcm,
+      &base::MessageDecryptorOpenssl::createForAes256Gcm },
+    { "ChaCha20-Poly1305",
+      &base::MessageEncryptorOpenssl::createForChaCha20Poly1305,
+      &base::MessageDecryptorOpenssl::createForChaCha20Poly1305 }
+};
+
+const size_t kMessageSizes[] = { 64, 256, 1024, 4096, 16384, 65536 };
+
+const size_t kTotalSize = 64 * 1024 * 1024;
+const size_t kBatchSize = 64 * 1024;
+
+// Encrypts and decrypts |total_size| bytes split into messages of |message_size| bytes. If
+// |batch_size| is greater than |message_size|, then the messages are sealed into records of
+// |batch_size| bytes. Returns MB/s or a negative value on error.
+double measureThroughput(EncryptorFactory encryptor_factory,
+                         DecryptorFactory decryptor_factory,
+                         size_t message_size,
+                         size_t batch_size,
+                         size_t total_size)
+{
+    const base::ByteArray key =
+        base::fromHex("5ce26794165a808ec425684e9384c27c22499512a513da8b455bd39746dc5014");
+    const base::ByteArray iv = base::fromHex("ee7eb0e6fb24d445597f3e6f");
+
+    std::unique_ptr<base::MessageEncryptor> encryptor = encryptor_factory(key, iv);
+    std::unique_ptr<base::MessageDecryptor> decryptor = decryptor_factory(key, iv);
+    if (!encryptor || !decryptor)
+        return -1;
+
+    const size_t record_size = std::max(message_size, batch_size - batch_size % message_size);
+
+    base::ByteArray record(record_size, 0x5A);
+    base::ByteArray encrypted(encryptor->encryptedDataSize(record_size));
+    base::ByteArray decrypted(record_size);
+
+    const auto start_time = std::chrono::steady_clock::now();
+
+    for (size_t processed = 0; processed < total_size; processed += record_size)
+    {
+        if (!encryptor->encrypt(record.data(), record.size(), encrypted.data()) ||
+            !decryptor->decrypt(encrypted.data(), encrypted.size(), decrypted.data()))
+        {
+            return -1;
+        }
+    }
+
+    const std::chrono::duration<double> duration = std::chrono::steady_clock::now() - start_time;
+
+    if (decrypted != record)
+        return -1;
+
+    if (duration.count() <= 0)
+        return 0;
+
+    return static_cast<double>(total_size) / (1024.0 * 1024.0) / duration.count();
+}
+
+} // namespace
+
+int main(int /* argc */, const char* const* /* argv */)
+{
+    base::ScopedCryptoInitializer crypto_initializer;
+    if (!crypto_initializer.isSucceeded())
+        return 1;
+
+    for (const auto& cipher : kCiphers)
+    {
+        for (size_t message_size : kMessageSizes)
+        {
+            const double single = measureThroughput(
+                cipher.encryptor, cipher.decryptor, message_size, 0, kTotalSize);
+            const double batched = measureThroughput(
+                cipher.encryptor, cipher.decryptor, message_size, kBatchSize, kTotalSize);
+
+            if (single < 0 || batched < 0)
+            {
+                fprintf(stderr, "%s: encryption failed\n", cipher.name);
+                return 1;
+            }
+
+            printf("%-18s message: %6zu bytes, single: %8.1f MB/s, batched: %8.1f MB/s\n",
+                   cipher.name, message_size, single, batched);
+        }
+    }
+
+    return 0;
+}
@@ -78,6 +78,28 @@ void testVector(MessageEncryptor* client_encryptor, MessageDecryptor* client_dec
     ASSERT_EQ(decrypted_msg_for_client, message_for_client);
 }
 
+using EncryptorFactory = std::unique_ptr<MessageEncryptor>(*)(const ByteArray&, const ByteArray&);
+using DecryptorFactory = std::unique_ptr<MessageDecryptor>(*)(const ByteArray&, const ByteArray&);
+
+struct Cipher
+{
+    const char* name;
+    EncryptorFactory encryptor;
+    DecryptorFactory decryptor;
+};
+
+const Cipher kCiphers[] =
+{
+    { "AES256-GCM",
+      &MessageEncryptorOpenssl::createForAes256Gcm,
+      &MessageDecryptorOpenssl::createForAes256Gcm },
+    { "ChaCha20-Poly1305",
+      &MessageEncryptorOpenssl::createForChaCha20Poly1305,
+      &MessageDecryptorOpenssl::createForChaCha20Poly1305 }
+};
+
+const size_t kMessageSizes[] = { 64, 256, 1024, 4096, 16384, 65536 };
+
 void wrongKey(MessageEncryptor* client_encryptor, MessageDecryptor* host_decryptor)
 {
     ByteArray message_for_host = fromHex(
@@ -218,4 +240,44 @@ TEST(CryptorChaCha20Poly1305Test, WrongKey)
     wrongKey(client_encryptor.get(), host_decryptor.get());
 }
 
+TEST(CryptorTest, EncryptWithPrefix)
+{
+    const ByteArray key =
+        fromHex("5ce26794165a808ec425684e9384c27c22499512a513da8b455bd39746dc5014");
+    const ByteArray iv = fromHex("ee7eb0e6fb24d445597f3e6f");
+    const ByteArray prefix = fromHex("8f07");
+
+    for (const auto& cipher : kCiphers)
+    {
+        std::unique_ptr<MessageEncryptor> encryptor = cipher.encryptor(key, iv);
+        std::unique_ptr<MessageEncryptor> reference_encryptor = cipher.encryptor(key, iv);
+        std::unique_ptr<MessageDecryptor> decryptor = cipher.decryptor(key, iv);
+        ASSERT_TRUE(encryptor && reference_encryptor && decryptor);
+
+        for (size_t message_size : kMessageSizes)
+        {
+            ByteArray message(message_size);
+            for (size_t i = 0; i < message.size(); ++i)
+                message[i] = static_cast<uint8_t>(i * 7);
+
+            ByteArray record = prefix;
+            record.insert(record.end(), message.begin(), message.end());
+
+            ByteArray encrypted(encryptor->encryptedDataSize(record.size()));
+            ASSERT_TRUE(encryptor->encrypt(prefix.data(), prefix.size(),
+                                           message.data(), message.size(),
+                                           encrypted.data()));
+
+            // The record is the same as if the prefix and the message were encrypted together.
+            ByteArray reference(reference_encryptor->encryptedDataSize(record.size()));
+            ASSERT_TRUE(reference_encryptor->encrypt(record.data(), record.size(), reference.data()));
+            EXPECT_EQ(encrypted, reference);
+
+            ByteArray decrypted(decryptor->decryptedDataSize(encrypted.size()));
+            ASSERT_TRUE(decryptor->decrypt(encrypted.data(), encrypted.size(), decrypted.data()));
+            EXPECT_EQ(decrypted, record);
+        }
+    }
+}
+
 } // namespace base
@@ -30,6 +30,12 @@ public:
 
     virtual size_t encryptedDataSize(size_t in_size) = 0;
     virtual bool encrypt(const void* in, size_t in_size, void* out) = 0;
+
+    // Encrypts |prefix| followed by |in| into one record. The result is the same as for encrypt()
+    // of the concatenated data, but the data is not copied together.
+    virtual bool encrypt(const void* prefix, size_t prefix_size,
+                         const void* in, size_t in_size,
+                         void* out) = 0;
 };
 
 } // namespace base
@@ -18,6 +18,7 @@
 
 #include "base/crypto/message_encryptor_fake.h"
 
+#include <cstdint>
 #include <cstring>
 
 namespace base {
@@ -37,4 +38,13 @@ bool MessageEncryptorFake::encrypt(const void* in, size_t in_size, void* out)
     return true;
 }
 
+bool MessageEncryptorFake::encrypt(const void* prefix, size_t prefix_size,
+                                   const void* in, size_t in_size,
+                                   void* out)
+{
+    memcpy(out, prefix, prefix_size);
+    memcpy(reinterpret_cast<uint8_t*>(out) + prefix_size, in, in_size);
+    return true;
+}
+
 } // namespace base
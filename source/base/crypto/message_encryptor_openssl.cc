@@ -79,6 +79,13 @@ size_t MessageEncryptorOpenssl::encryptedDataSize(size_t in_size)
 }
 
 bool MessageEncryptorOpenssl::encrypt(const void* in, size_t in_size, void* out)
+{
+    return encrypt(nullptr, 0, in, in_size, out);
+}
+
+bool MessageEncryptorOpenssl::encrypt(const void* prefix, size_t prefix_size,
+                                      const void* in, size_t in_size,
+                                      void* out)
 {
     if (EVP_EncryptInit_ex(ctx_.get(), nullptr, nullptr, nullptr, iv_.data()) != 1)
     {
@@ -86,19 +93,32 @@ bool MessageEncryptorOpenssl::encrypt(const void* in, size_t in_size, void* out)
         return false;
     }
 
+    uint8_t* out_data = reinterpret_cast<uint8_t*>(out) + kTagSize;
     int length;
 
-    if (EVP_EncryptUpdate(ctx_.get(),
-                          reinterpret_cast<uint8_t*>(out) + kTagSize, &length,
+    // Both ciphers are stream ciphers, so each update writes exactly its input size.
+    if (prefix_size)
+    {
+        if (EVP_EncryptUpdate(ctx_.get(), out_data, &length,
+                              reinterpret_cast<const uint8_t*>(prefix), prefix_size) != 1)
+        {
+            LOG(LS_WARNING) << "EVP_EncryptUpdate failed";
+            return false;
+        }
+
+        out_data += length;
+    }
+
+    if (EVP_EncryptUpdate(ctx_.get(), out_data, &length,
                           reinterpret_cast<const uint8_t*>(in), in_size) != 1)
     {
         LOG(LS_WARNING) << "EVP_EncryptUpdate failed";
         return false;
     }
 
-    if (EVP_EncryptFinal_ex(ctx_.get(),
-                            reinterpret_cast<uint8_t*>(out) + kTagSize + length,
-                            &length) != 1)
+    out_data += length;
+
+    if (EVP_EncryptFinal_ex(ctx_.get(), out_data, &length) != 1)
     {
         LOG(LS_WARNING) << "EVP_EncryptFinal_ex failed";
         return false;
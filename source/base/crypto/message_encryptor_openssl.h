@@ -40,6 +40,9 @@ public:
     // MessageEncryptor implementation.
     size_t encryptedDataSize(size_t in_size) override;
     bool encrypt(const void* in, size_t in_size, void* out) override;
+    bool encrypt(const void* prefix, size_t prefix_size,
+                 const void* in, size_t in_size,
+                 void* out) override;
 
 private:
     MessageEncryptorOpenssl(EVP_CIPHER_CTX_ptr ctx, const ByteArray& iv);
@@ -16,13 +16,15 @@
 // along with this program. If not, see <https://www.gnu.org/licenses/>.
 //
 
-#include "desktop/region.h"
+#include "base/desktop/region.h"
 
 #include <gtest/gtest.h>
 
 #include <algorithm>
+#include <iterator>
+#include <new>
 
-namespace desktop {
+namespace base {
 
 namespace {
 
@@ -983,6 +985,24 @@ TEST(desktop_region_test, subtract_rect_on_same_col)
     }
 }
 
+// Verify that a region can be moved into memory that was used before (as in containers).
+TEST(desktop_region_test, move_construct)
+{
+    alignas(Region) unsigned char memory[sizeof(Region)];
+    std::fill(std::begin(memory), std::end(memory), 0xCD);
+
+    Region source(Rect::makeXYWH(1, 2, 3, 4));
+    source.addRect(Rect::makeXYWH(10, 20, 30, 40));
+
+    Region* region = new (memory) Region(std::move(source));
+
+    const Rect expected[] = { Rect::makeXYWH(1, 2, 3, 4), Rect::makeXYWH(10, 20, 30, 40) };
+    compareRegion(*region, expected, 2);
+    EXPECT_TRUE(source.isEmpty());
+
+    region->~Region();
+}
+
 TEST(desktop_region_test, performance)
 {
     for (int c = 0; c < 1000; ++c)
@@ -1007,4 +1027,4 @@ TEST(desktop_region_test, performance)
     }
 }
 
-} // namespace desktop
+} // namespace base
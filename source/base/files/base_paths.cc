@@ -76,6 +76,25 @@ bool BasePaths::userAppData(std::filesystem::path* result)
     return true;
 }
 
+// static
+bool BasePaths::userLocalAppData(std::filesystem::path* result)
+{
+    DCHECK(result);
+
+    wchar_t buffer[MAX_PATH] = { 0 };
+
+    HRESULT hr = SHGetFolderPathW(nullptr, CSIDL_LOCAL_APPDATA,
+                                  nullptr, SHGFP_TYPE_CURRENT, buffer);
+    if (FAILED(hr))
+    {
+        LOG(LS_ERROR) << "SHGetFolderPathW failed: " << SystemError::toString(hr);
+        return false;
+    }
+
+    result->assign(buffer);
+    return true;
+}
+
 // static
 bool BasePaths::userDesktop(std::filesystem::path* result)
 {
@@ -37,6 +37,9 @@ public:
     // Application Data directory under the user profile.
     static bool userAppData(std::filesystem::path* result);
 
+    // Local (non-roaming) Application Data directory under the user profile.
+    static bool userLocalAppData(std::filesystem::path* result);
+
     // The current user's Desktop.
     static bool userDesktop(std::filesystem::path* result);
 
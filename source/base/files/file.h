@@ -0,0 +1,97 @@
+//
+// Aspia Project
+// Copyright (C) 2020 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#ifndef BASE__FILES__FILE_H
+#define BASE__FILES__FILE_H
+
+#include "base/macros_magic.h"
+#include "build/build_config.h"
+
+#include <cstdint>
+#include <filesystem>
+
+namespace base {
+
+// Wrapper over a native file handle. Reads and writes take an explicit offset, so there is no
+// file position to seek before every operation (pread/pwrite on POSIX, ReadFile/WriteFile with
+// an offset on Windows). Unlike std::fstream the class does not have its own buffer: callers
+// use buffers of the size that suits them.
+class File
+{
+public:
+    enum Flags : uint32_t
+    {
+        // Opens an existing file.
+        FLAG_OPEN = 1,
+
+        // Creates a new file or truncates an existing one.
+        FLAG_CREATE_ALWAYS = 2,
+
+        FLAG_READ = 4,
+        FLAG_WRITE = 8,
+
+        // The file is accessed sequentially. The system reads ahead more aggressively.
+        FLAG_SEQUENTIAL = 16
+    };
+
+#if defined(OS_WIN)
+    using PlatformFile = void*; // HANDLE
+#else
+    using PlatformFile = int;
+#endif
+
+    File();
+    File(const std::filesystem::path& path, uint32_t flags);
+    File(File&& other) noexcept;
+    File& operator=(File&& other) noexcept;
+    ~File();
+
+    bool isValid() const;
+    void close();
+
+    // Returns the size of the file or -1 on error.
+    int64_t length() const;
+
+    // Truncates or extends the file to |length| bytes. Returns false on error.
+    bool setLength(int64_t length);
+
+    // Reads up to |size| bytes at |offset|. Returns the number of bytes read, which is less than
+    // |size| only at the end of the file, or -1 on error.
+    int64_t read(int64_t offset, void* data, size_t size);
+
+    // Writes |size| bytes at |offset|. Returns false on error.
+    bool write(int64_t offset, const void* data, size_t size);
+
+    // Hints the system that the range will be read soon. The data is read in the background.
+    void prefetch(int64_t offset, int64_t size);
+
+    // Hints the system that the range will not be accessed again and may be dropped from the
+    // cache. Used for large files which are read or written once.
+    void evict(int64_t offset, int64_t size);
+
+private:
+    void initialize(const std::filesystem::path& path, uint32_t flags);
+
+    PlatformFile file_;
+
+    DISALLOW_COPY_AND_ASSIGN(File);
+};
+
+} // namespace base
+
+#endif // BASE__FILES__FILE_H
@@ -0,0 +1,220 @@
+//
+// Aspia Project
+// Copyright (C) 2020 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "base/files/file.h"
+
+#include "base/logging.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace base {
+
+namespace {
+
+const File::PlatformFile kInvalidFile = -1;
+
+} // namespace
+
+File::File()
+    : file_(kInvalidFile)
+{
+    // Nothing
+}
+
+File::File(const std::filesystem::path& path, uint32_t flags)
+    : file_(kInvalidFile)
+{
+    initialize(path, flags);
+}
+
+File::File(File&& other) noexcept
+    : file_(other.file_)
+{
+    other.file_ = kInvalidFile;
+}
+
+File& File::operator=(File&& other) noexcept
+{
+    if (this != &other)
+    {
+        close();
+
+        file_ = other.file_;
+        other.file_ = kInvalidFile;
+    }
+
+    return *this;
+}
+
+File::~File()
+{
+    close();
+}
+
+void File::initialize(const std::filesystem::path& path, uint32_t flags)
+{
+    int open_flags = O_CLOEXEC;
+
+    if (flags & FLAG_CREATE_ALWAYS)
+        open_flags |= O_CREAT | O_TRUNC;
+
+    if ((flags & FLAG_READ) && (flags & FLAG_WRITE))
+        open_flags |= O_RDWR;
+    else if (flags & FLAG_WRITE)
+        open_flags |= O_WRONLY;
+    else
+        open_flags |= O_RDONLY;
+
+    do
+    {
+        file_ = open(path.c_str(), open_flags, S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH);
+    }
+    while (file_ == kInvalidFile && errno == EINTR);
+
+    if (file_ == kInvalidFile)
+        return;
+
+#if defined(OS_LINUX)
+    if (flags & FLAG_SEQUENTIAL)
+        posix_fadvise(file_, 0, 0, POSIX_FADV_SEQUENTIAL);
+#endif // defined(OS_LINUX)
+}
+
+bool File::isValid() const
+{
+    return file_ != kInvalidFile;
+}
+
+void File::close()
+{
+    if (file_ == kInvalidFile)
+        return;
+
+    if (::close(file_) != 0)
+        PLOG(LS_WARNING) << "close failed";
+
+    file_ = kInvalidFile;
+}
+
+int64_t File::length() const
+{
+    DCHECK(isValid());
+
+    struct stat file_info;
+    if (fstat(file_, &file_info) != 0)
+        return -1;
+
+    return file_info.st_size;
+}
+
+bool File::setLength(int64_t length)
+{
+    DCHECK(isValid());
+
+    int result;
+
+    do
+    {
+        result = ftruncate(file_, static_cast<off_t>(length));
+    }
+    while (result != 0 && errno == EINTR);
+
+    return result == 0;
+}
+
+int64_t File::read(int64_t offset, void* data, size_t size)
+{
+    DCHECK(isValid());
+
+    uint8_t* buffer = reinterpret_cast<uint8_t*>(data);
+    size_t bytes_read = 0;
+
+    while (bytes_read < size)
+    {
+        const ssize_t result = pread(file_, buffer + bytes_read, size - bytes_read,
+                                     static_cast<off_t>(offset + bytes_read));
+        if (result < 0)
+        {
+            if (errno == EINTR)
+                continue;
+
+            return -1;
+        }
+
+        // End of file.
+        if (!result)
+            break;
+
+        bytes_read += static_cast<size_t>(result);
+    }
+
+    return static_cast<int64_t>(bytes_read);
+}
+
+bool File::write(int64_t offset, const void* data, size_t size)
+{
+    DCHECK(isValid());
+
+    const uint8_t* buffer = reinterpret_cast<const uint8_t*>(data);
+    size_t bytes_written = 0;
+
+    while (bytes_written < size)
+    {
+        const ssize_t result = pwrite(file_, buffer + bytes_written, size - bytes_written,
+                                      static_cast<off_t>(offset + bytes_written));
+        if (result < 0)
+        {
+            if (errno == EINTR)
+                continue;
+
+            return false;
+        }
+
+        bytes_written += static_cast<size_t>(result);
+    }
+
+    return true;
+}
+
+void File::prefetch(int64_t offset, int64_t size)
+{
+    DCHECK(isValid());
+
+#if defined(OS_LINUX)
+    posix_fadvise(file_, offset, size, POSIX_FADV_WILLNEED);
+#elif defined(OS_MACOSX)
+    struct radvisory advisory;
+    advisory.ra_offset = offset;
+    advisory.ra_count = static_cast<int>(size);
+    fcntl(file_, F_RDADVISE, &advisory);
+#endif // defined(OS_MACOSX)
+}
+
+void File::evict(int64_t offset, int64_t size)
+{
+    DCHECK(isValid());
+
+#if defined(OS_LINUX)
+    posix_fadvise(file_, offset, size, POSIX_FADV_DONTNEED);
+#endif // defined(OS_LINUX)
+}
+
+} // namespace base
@@ -0,0 +1,132 @@
+//
+// Aspia Project
+// Copyright (C) 2020 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "base/files/file.h"
+
+#include <gtest/gtest.h>
+
+#include <numeric>
+#include <vector>
+
+namespace base {
+
+namespace {
+
+std::filesystem::path testFilePath()
+{
+    return std::filesystem::temp_directory_path() / "aspia_file_unittest.bin";
+}
+
+} // namespace
+
+TEST(FileTest, WriteAndRead)
+{
+    const std::filesystem::path path = testFilePath();
+
+    std::vector<uint8_t> data(100000);
+    std::iota(data.begin(), data.end(), 0);
+
+    {
+        File file(path, File::FLAG_CREATE_ALWAYS | File::FLAG_WRITE);
+        ASSERT_TRUE(file.isValid());
+
+        // Write the second half first. The offsets are independent of each other.
+        ASSERT_TRUE(file.write(50000, data.data() + 50000, 50000));
+        ASSERT_TRUE(file.write(0, data.data(), 50000));
+        EXPECT_EQ(file.length(), 100000);
+    }
+
+    File file(path, File::FLAG_OPEN | File::FLAG_READ | File::FLAG_SEQUENTIAL);
+    ASSERT_TRUE(file.isValid());
+    EXPECT_EQ(file.length(), 100000);
+
+    file.prefetch(0, 100000);
+
+    std::vector<uint8_t> buffer(100000);
+    EXPECT_EQ(file.read(0, buffer.data(), buffer.size()), 100000);
+    EXPECT_EQ(buffer, data);
+
+    // Reading at the end of the file returns the rest of the data.
+    EXPECT_EQ(file.read(99990, buffer.data(), buffer.size()), 10);
+    EXPECT_EQ(buffer[0], data[99990]);
+    EXPECT_EQ(file.read(100000, buffer.data(), buffer.size()), 0);
+
+    file.evict(0, 100000);
+    file.close();
+    EXPECT_FALSE(file.isValid());
+
+    std::error_code ignored_code;
+    std::filesystem::remove(path, ignored_code);
+}
+
+TEST(FileTest, SetLength)
+{
+    const std::filesystem::path path = testFilePath();
+
+    std::vector<uint8_t> data(1000, 0xAA);
+
+    File file(path, File::FLAG_CREATE_ALWAYS | File::FLAG_READ | File::FLAG_WRITE);
+    ASSERT_TRUE(file.isValid());
+    ASSERT_TRUE(file.write(0, data.data(), data.size()));
+
+    ASSERT_TRUE(file.setLength(100));
+    EXPECT_EQ(file.length(), 100);
+
+    // The file is extended with zeros.
+    ASSERT_TRUE(file.setLength(200));
+    EXPECT_EQ(file.length(), 200);
+
+    std::vector<uint8_t> buffer(300);
+    ASSERT_EQ(file.read(0, buffer.data(), buffer.size()), 200);
+    EXPECT_EQ(buffer[99], 0xAA);
+    EXPECT_EQ(buffer[100], 0);
+
+    file.close();
+    std::error_code ignored_code;
+    std::filesystem::remove(path, ignored_code);
+}
+
+TEST(FileTest, OpenMissing)
+{
+    File file(std::filesystem::temp_directory_path() / "aspia_file_unittest_missing.bin",
+              File::FLAG_OPEN | File::FLAG_READ);
+    EXPECT_FALSE(file.isValid());
+}
+
+TEST(FileTest, Move)
+{
+    const std::filesystem::path path = testFilePath();
+
+    File file(path, File::FLAG_CREATE_ALWAYS | File::FLAG_WRITE);
+    ASSERT_TRUE(file.isValid());
+
+    File other(std::move(file));
+    EXPECT_FALSE(file.isValid());
+    EXPECT_TRUE(other.isValid());
+
+    file = std::move(other);
+    EXPECT_TRUE(file.isValid());
+    EXPECT_FALSE(other.isValid());
+
+    file.close();
+
+    std::error_code ignored_code;
+    std::filesystem::remove(path, ignored_code);
+}
+
+} // namespace base
@@ -0,0 +1,212 @@
+//
+// Aspia Project
+// Copyright (C) 2020 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "base/files/file.h"
+
+#include "base/logging.h"
+
+#include <algorithm>
+
+#include <Windows.h>
+
+namespace base {
+
+File::File()
+    : file_(INVALID_HANDLE_VALUE)
+{
+    // Nothing
+}
+
+File::File(const std::filesystem::path& path, uint32_t flags)
+    : file_(INVALID_HANDLE_VALUE)
+{
+    initialize(path, flags);
+}
+
+File::File(File&& other) noexcept
+    : file_(other.file_)
+{
+    other.file_ = INVALID_HANDLE_VALUE;
+}
+
+File& File::operator=(File&& other) noexcept
+{
+    if (this != &other)
+    {
+        close();
+
+        file_ = other.file_;
+        other.file_ = INVALID_HANDLE_VALUE;
+    }
+
+    return *this;
+}
+
+File::~File()
+{
+    close();
+}
+
+void File::initialize(const std::filesystem::path& path, uint32_t flags)
+{
+    DWORD access = 0;
+
+    if (flags & FLAG_READ)
+        access |= GENERIC_READ;
+
+    if (flags & FLAG_WRITE)
+        access |= GENERIC_WRITE;
+
+    DWORD disposition = OPEN_EXISTING;
+
+    if (flags & FLAG_CREATE_ALWAYS)
+        disposition = CREATE_ALWAYS;
+
+    DWORD attributes = FILE_ATTRIBUTE_NORMAL;
+
+    // The cache manager reads ahead twice as much data for sequential files.
+    if (flags & FLAG_SEQUENTIAL)
+        attributes |= FILE_FLAG_SEQUENTIAL_SCAN;
+
+    // Other processes may read, write, rename and delete the file while it is open, as with the
+    // standard file streams (_SH_DENYNO).
+    file_ = CreateFileW(path.c_str(),
+                        access,
+                        FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+                        nullptr,
+                        disposition,
+                        attributes,
+                        nullptr);
+}
+
+bool File::isValid() const
+{
+    return file_ != INVALID_HANDLE_VALUE;
+}
+
+void File::close()
+{
+    if (file_ == INVALID_HANDLE_VALUE)
+        return;
+
+    if (!CloseHandle(file_))
+        PLOG(LS_WARNING) << "CloseHandle failed";
+
+    file_ = INVALID_HANDLE_VALUE;
+}
+
+int64_t File::length() const
+{
+    DCHECK(isValid());
+
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(file_, &size))
+        return -1;
+
+    return size.QuadPart;
+}
+
+bool File::setLength(int64_t length)
+{
+    DCHECK(isValid());
+
+    FILE_END_OF_FILE_INFO info;
+    info.EndOfFile.QuadPart = length;
+
+    return !!SetFileInformationByHandle(file_, FileEndOfFileInfo, &info, sizeof(info));
+}
+
+int64_t File::read(int64_t offset, void* data, size_t size)
+{
+    DCHECK(isValid());
+
+    uint8_t* buffer = reinterpret_cast<uint8_t*>(data);
+    size_t bytes_read = 0;
+
+    while (bytes_read < size)
+    {
+        const uint64_t position = static_cast<uint64_t>(offset) + bytes_read;
+
+        OVERLAPPED overlapped;
+        memset(&overlapped, 0, sizeof(overlapped));
+        overlapped.Offset = static_cast<DWORD>(position & 0xFFFFFFFF);
+        overlapped.OffsetHigh = static_cast<DWORD>(position >> 32);
+
+        const DWORD bytes_to_read =
+            static_cast<DWORD>(std::min(size - bytes_read, size_t(0x7FFFFFFF)));
+        DWORD result = 0;
+
+        if (!ReadFile(file_, buffer + bytes_read, bytes_to_read, &result, &overlapped))
+        {
+            // The offset is at or beyond the end of the file.
+            if (GetLastError() == ERROR_HANDLE_EOF)
+                break;
+
+            return -1;
+        }
+
+        // End of file.
+        if (!result)
+            break;
+
+        bytes_read += result;
+    }
+
+    return static_cast<int64_t>(bytes_read);
+}
+
+bool File::write(int64_t offset, const void* data, size_t size)
+{
+    DCHECK(isValid());
+
+    const uint8_t* buffer = reinterpret_cast<const uint8_t*>(data);
+    size_t bytes_written = 0;
+
+    while (bytes_written < size)
+    {
+        const uint64_t position = static_cast<uint64_t>(offset) + bytes_written;
+
+        OVERLAPPED overlapped;
+        memset(&overlapped, 0, sizeof(overlapped));
+        overlapped.Offset = static_cast<DWORD>(position & 0xFFFFFFFF);
+        overlapped.OffsetHigh = static_cast<DWORD>(position >> 32);
+
+        const DWORD bytes_to_write =
+            static_cast<DWORD>(std::min(size - bytes_written, size_t(0x7FFFFFFF)));
+        DWORD result = 0;
+
+        if (!WriteFile(file_, buffer + bytes_written, bytes_to_write, &result, &overlapped))
+            return false;
+
+        bytes_written += result;
+    }
+
+    return true;
+}
+
+void File::prefetch(int64_t /* offset */, int64_t /* size */)
+{
+    // The cache manager reads ahead for files opened with FILE_FLAG_SEQUENTIAL_SCAN.
+}
+
+void File::evict(int64_t /* offset */, int64_t /* size */)
+{
+    // Not supported for cached files.
+}
+
+} // namespace base
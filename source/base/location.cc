@@ -104,4 +104,16 @@ NOINLINE Location Location::createFromHere(const char* function_name,
     return Location(function_name, file_name, line_number, RETURN_ADDRESS());
 }
 
+// static
+NOINLINE Location Location::current(const char* function_name,
+                                    const char* file_name,
+                                    int line_number)
+{
+#if defined(ENABLE_LOCATION_SOURCE)
+    return Location(function_name, file_name, line_number, RETURN_ADDRESS());
+#else
+    return Location(file_name, RETURN_ADDRESS());
+#endif
+}
+
 } // namespace base
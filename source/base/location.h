@@ -84,6 +84,12 @@ public:
                                    const char* file_name,
                                    int line_number);
 
+    // Returns the location of the caller when used as a default argument:
+    // void postTask(Callback callback, const Location& from_here = Location::current());
+    static Location current(const char* function_name = __builtin_FUNCTION(),
+                            const char* file_name = __builtin_FILE(),
+                            int line_number = __builtin_LINE());
+
 private:
     const char* function_name_ = nullptr;
     const char* file_name_ = nullptr;
@@ -35,8 +35,9 @@ void* alignedAlloc(size_t size, size_t alignment)
 #if defined(OS_WIN)
     void* ptr = _aligned_malloc(size, alignment);
 #elif defined(OS_ANDROID)
-    ptr = memalign(alignment, size);
+    void* ptr = memalign(alignment, size);
 #else
+    void* ptr = nullptr;
     if (posix_memalign(&ptr, alignment, size))
         ptr = nullptr;
 #endif
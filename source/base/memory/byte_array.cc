@@ -135,6 +135,15 @@ base::ByteArray serialize(const google::protobuf::MessageLite& message)
     return buffer;
 }
 
+void serialize(const google::protobuf::MessageLite& message, base::ByteArray* buffer)
+{
+    buffer->resize(message.ByteSizeLong());
+    if (buffer->empty())
+        return;
+
+    message.SerializeWithCachedSizesToArray(buffer->data());
+}
+
 int compare(const base::ByteArray& first, const base::ByteArray& second)
 {
     if (first.empty() && second.empty())
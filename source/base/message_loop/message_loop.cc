@@ -18,10 +18,12 @@
 
 #include "base/message_loop/message_loop.h"
 
+#include "base/message_loop/message_loop_profiler.h"
 #include "base/message_loop/message_loop_task_runner.h"
 #include "base/message_loop/message_pump_asio.h"
 #include "base/message_loop/message_pump_default.h"
 #include "base/logging.h"
+#include "base/threading/asio_thread_pool.h"
 
 #if defined(OS_WIN)
 #include "base/message_loop/message_pump_win.h"
@@ -54,6 +56,10 @@ MessageLoop::MessageLoop(Type type)
             pump_ = std::make_unique<MessagePumpForAsio>();
             break;
 
+        case Type::ASIO_POOL:
+            pump_ = std::make_unique<MessagePumpForAsio>(std::make_unique<AsioThreadPool>());
+            break;
+
 #if defined(OS_WIN)
         case Type::WIN:
             pump_ = std::make_unique<MessagePumpForWin>();
@@ -89,6 +95,8 @@ MessageLoop::~MessageLoop()
 
     DCHECK(!did_work);
 
+    setProfilingEnabled(false);
+
     proxy_->willDestroyCurrentMessageLoop();
     proxy_ = nullptr;
 
@@ -119,29 +127,30 @@ PendingTask::Callback MessageLoop::quitClosure()
     return std::bind(&MessageLoop::quit, this);
 }
 
-void MessageLoop::postTask(PendingTask::Callback callback)
+void MessageLoop::postTask(PendingTask::Callback callback, const Location& from_here)
 {
     DCHECK(callback != nullptr);
-    addToIncomingQueue(std::move(callback), Milliseconds::zero(), true);
+    addToIncomingQueue(std::move(callback), from_here, Milliseconds::zero(), true);
 }
 
-void MessageLoop::postDelayedTask(PendingTask::Callback callback, const Milliseconds& delay)
+void MessageLoop::postDelayedTask(
+    PendingTask::Callback callback, const Milliseconds& delay, const Location& from_here)
 {
     DCHECK(callback != nullptr);
-    addToIncomingQueue(std::move(callback), delay, true);
+    addToIncomingQueue(std::move(callback), from_here, delay, true);
 }
 
-void MessageLoop::postNonNestableTask(PendingTask::Callback callback)
+void MessageLoop::postNonNestableTask(PendingTask::Callback callback, const Location& from_here)
 {
     DCHECK(callback != nullptr);
-    addToIncomingQueue(std::move(callback), Milliseconds::zero(), false);
+    addToIncomingQueue(std::move(callback), from_here, Milliseconds::zero(), false);
 }
 
 void MessageLoop::postNonNestableDelayedTask(
-    PendingTask::Callback callback, const Milliseconds& delay)
+    PendingTask::Callback callback, const Milliseconds& delay, const Location& from_here)
 {
     DCHECK(callback != nullptr);
-    addToIncomingQueue(std::move(callback), delay, false);
+    addToIncomingQueue(std::move(callback), from_here, delay, false);
 }
 
 #if defined(OS_WIN)
@@ -161,19 +170,51 @@ std::shared_ptr<TaskRunner> MessageLoop::taskRunner() const
     return proxy_;
 }
 
-void MessageLoop::runTask(const PendingTask& pending_task)
+void MessageLoop::setProfilingEnabled(bool enable)
+{
+    DCHECK_EQ(this, current());
+
+    if (enable == (profiler_ != nullptr))
+        return;
+
+    if (enable)
+        profiler_ = std::make_unique<MessageLoopProfiler>();
+
+    if (type_ == Type::ASIO || type_ == Type::ASIO_POOL)
+        pumpAsio()->setProfiler(enable ? profiler_.get() : nullptr);
+
+    if (!enable)
+        profiler_.reset();
+
+    profiling_enabled_.store(enable, std::memory_order_relaxed);
+}
+
+void MessageLoop::runTask(PendingTask& pending_task)
 {
     DCHECK(nestable_tasks_allowed_);
 
     // Execute the task and assume the worst: It is probably not reentrant.
     nestable_tasks_allowed_ = false;
 
-    pending_task.callback();
+    if (!profiler_)
+    {
+        pending_task.callback();
+    }
+    else
+    {
+        const TimePoint start_time = Clock::now();
+
+        pending_task.callback();
+
+        // The task could disable the profiling.
+        if (profiler_)
+            profiler_->addTask(pending_task, start_time, Clock::now());
+    }
 
     nestable_tasks_allowed_ = true;
 }
 
-bool MessageLoop::deferOrRunPendingTask(const PendingTask& pending_task)
+bool MessageLoop::deferOrRunPendingTask(PendingTask&& pending_task)
 {
     if (pending_task.nestable)
     {
@@ -185,7 +226,7 @@ bool MessageLoop::deferOrRunPendingTask(const PendingTask& pending_task)
 
     // We couldn't run the task now because we're in a nested message loop
     // and the task isn't nestable.
-    deferred_non_nestable_work_queue_.emplace(pending_task);
+    deferred_non_nestable_work_queue_.push(std::move(pending_task));
     return false;
 }
 
@@ -194,28 +235,26 @@ void MessageLoop::addToDelayedWorkQueue(PendingTask* pending_task)
     // Move to the delayed work queue.  Initialize the sequence number before inserting into the
     // delayed_work_queue_. The sequence number is used to faciliate FIFO sorting when two tasks
     // have the same delayed_run_time value.
-    delayed_work_queue_.emplace(std::move(pending_task->callback),
-                                pending_task->delayed_run_time,
-                                pending_task->nestable,
-                                next_sequence_num_++);
+    pending_task->sequence_num = next_sequence_num_++;
+    delayed_work_queue_.push(std::move(*pending_task));
 }
 
-void MessageLoop::addToIncomingQueue(
-    PendingTask::Callback&& callback, const Milliseconds& delay, bool nestable)
+void MessageLoop::addToIncomingQueue(PendingTask::Callback&& callback,
+                                     const Location& from_here,
+                                     const Milliseconds& delay,
+                                     bool nestable)
 {
-    bool empty;
+    PendingTask pending_task(
+        std::move(callback), from_here, calculateDelayedRuntime(delay), nestable);
 
-    {
-        std::scoped_lock lock(incoming_queue_lock_);
+    if (profiling_enabled_.load(std::memory_order_relaxed))
+        pending_task.queue_time = Clock::now();
 
-        empty = incoming_queue_.empty();
+    incoming_queue_.push(std::move(pending_task));
 
-        incoming_queue_.emplace(std::move(callback),
-                                calculateDelayedRuntime(delay),
-                                nestable);
-    }
-
-    if (!empty)
+    // If the wakeup is already scheduled, then the loop has not yet taken the incoming tasks and
+    // will take this task too.
+    if (wakeup_scheduled_.exchange(true))
         return;
 
     std::shared_ptr<MessagePump> pump(pump_);
@@ -227,13 +266,17 @@ void MessageLoop::reloadWorkQueue()
     if (!work_queue_.empty())
         return;
 
-    std::scoped_lock lock(incoming_queue_lock_);
+    // The flag is cleared before taking the tasks. A task added after that schedules a new wakeup.
+    wakeup_scheduled_.store(false);
 
-    if (incoming_queue_.empty())
-        return;
+    for (;;)
+    {
+        std::optional<PendingTask> pending_task = incoming_queue_.pop();
+        if (!pending_task.has_value())
+            break;
 
-    incoming_queue_.Swap(&work_queue_);
-    DCHECK(incoming_queue_.empty());
+        work_queue_.push(std::move(pending_task.value()));
+    }
 }
 
 bool MessageLoop::deletePendingTasks()
@@ -242,7 +285,7 @@ bool MessageLoop::deletePendingTasks()
 
     while (!work_queue_.empty())
     {
-        PendingTask pending_task = work_queue_.front();
+        PendingTask pending_task = std::move(work_queue_.front());
         work_queue_.pop();
 
         if (pending_task.delayed_run_time != TimePoint())
@@ -295,22 +338,23 @@ bool MessageLoop::doWork()
         // Execute oldest task.
         do
         {
-            PendingTask pending_task = work_queue_.front();
+            PendingTask pending_task = std::move(work_queue_.front());
             work_queue_.pop();
 
             if (pending_task.delayed_run_time != TimePoint())
             {
                 const bool reschedule = delayed_work_queue_.empty();
+                const TimePoint delayed_run_time = pending_task.delayed_run_time;
 
                 addToDelayedWorkQueue(&pending_task);
 
                 // If we changed the topmost task, then it is time to reschedule.
                 if (reschedule)
-                    pump_->scheduleDelayedWork(pending_task.delayed_run_time);
+                    pump_->scheduleDelayedWork(delayed_run_time);
             }
             else
             {
-                if (deferOrRunPendingTask(pending_task))
+                if (deferOrRunPendingTask(std::move(pending_task)))
                     return true;
             }
         }
@@ -347,13 +391,12 @@ bool MessageLoop::doDelayedWork(TimePoint* next_delayed_work_time)
         }
     }
 
-    PendingTask pending_task = delayed_work_queue_.top();
-    delayed_work_queue_.pop();
+    PendingTask pending_task = delayed_work_queue_.pop();
 
     if (!delayed_work_queue_.empty())
         *next_delayed_work_time = delayed_work_queue_.top().delayed_run_time;
 
-    return deferOrRunPendingTask(pending_task);
+    return deferOrRunPendingTask(std::move(pending_task));
 }
 
 bool MessageLoop::doIdleWork()
@@ -361,7 +404,7 @@ bool MessageLoop::doIdleWork()
     if (deferred_non_nestable_work_queue_.empty())
         return false;
 
-    PendingTask pending_task = deferred_non_nestable_work_queue_.front();
+    PendingTask pending_task = std::move(deferred_non_nestable_work_queue_.front());
     deferred_non_nestable_work_queue_.pop();
 
     runTask(pending_task);
@@ -24,13 +24,16 @@
 #include "base/message_loop/message_pump.h"
 #include "base/message_loop/message_pump_dispatcher.h"
 #include "base/message_loop/pending_task.h"
+#include "base/threading/mpsc_queue.h"
 #include "build/build_config.h"
 
+#include <atomic>
 #include <memory>
 #include <mutex>
 
 namespace base {
 
+class MessageLoopProfiler;
 class MessageLoopTaskRunner;
 class MessagePumpForAsio;
 class MessagePumpForWin;
@@ -43,6 +46,10 @@ public:
     {
         DEFAULT,
         ASIO,
+
+        // The same as ASIO, plus a pool of threads (one per processor) that runs a separate
+        // io_context. See MessagePumpForAsio::poolContext().
+        ASIO_POOL,
 #if defined(OS_WIN)
         WIN
 #endif // defined(OS_WIN)
@@ -67,6 +74,16 @@ public:
 
     std::shared_ptr<TaskRunner> taskRunner() const;
 
+    // Enables or disables the collection of queue delays and run times of tasks (grouped by the
+    // posting location) and, for asio loops, of the time spent in I/O handlers. Disabling the
+    // profiling drops the collected statistics. Must be called on the thread of the loop. From
+    // other threads post a task which calls this method.
+    void setProfilingEnabled(bool enable);
+
+    // Returns the profiler or nullptr if the profiling is disabled. The profiler may only be used
+    // on the thread of the loop.
+    MessageLoopProfiler* profiler() const { return profiler_.get(); }
+
 protected:
     friend class MessageLoopTaskRunner;
     friend class Thread;
@@ -75,19 +92,23 @@ protected:
     using TimePoint = MessagePump::TimePoint;
     using Milliseconds = MessagePump::Milliseconds;
 
-    void postTask(PendingTask::Callback callback);
-    void postDelayedTask(PendingTask::Callback callback, const Milliseconds& delay);
-    void postNonNestableTask(PendingTask::Callback callback);
-    void postNonNestableDelayedTask(PendingTask::Callback callback, const Milliseconds& delay);
+    void postTask(PendingTask::Callback callback, const Location& from_here);
+    void postDelayedTask(PendingTask::Callback callback,
+                         const Milliseconds& delay,
+                         const Location& from_here);
+    void postNonNestableTask(PendingTask::Callback callback, const Location& from_here);
+    void postNonNestableDelayedTask(PendingTask::Callback callback,
+                                    const Milliseconds& delay,
+                                    const Location& from_here);
 
     PendingTask::Callback quitClosure();
 
     // Runs the specified PendingTask.
-    void runTask(const PendingTask& pending_task);
+    void runTask(PendingTask& pending_task);
 
     // Calls RunTask or queues the pending_task on the deferred task list if it cannot be run right
     // now. Returns true if the task was run.
-    bool deferOrRunPendingTask(const PendingTask& pending_task);
+    bool deferOrRunPendingTask(PendingTask&& pending_task);
 
     // Adds the pending task to delayed_work_queue_.
     void addToDelayedWorkQueue(PendingTask* pending_task);
@@ -97,10 +118,14 @@ protected:
     // Caller retains ownership of |pending_task|, but this function will reset the value of
     // pending_task->task. This is needed to ensure that the posting call stack does not retain
     // pending_task->task beyond this function call.
-    void addToIncomingQueue(PendingTask::Callback&& callback, const Milliseconds& delay, bool nestable);
+    void addToIncomingQueue(PendingTask::Callback&& callback,
+                            const Location& from_here,
+                            const Milliseconds& delay,
+                            bool nestable);
 
     // Load tasks from the incoming_queue_ into work_queue_ if the latter is empty. The former
-    // requires a lock to access, while the latter is directly accessible on this thread.
+    // is filled from any thread without locks, while the latter is directly accessible on this
+    // thread.
     void reloadWorkQueue();
 
     bool deletePendingTasks();
@@ -135,14 +160,22 @@ protected:
 
     std::shared_ptr<MessagePump> pump_;
 
-    TaskQueue incoming_queue_;
-    std::mutex incoming_queue_lock_;
+    MpscQueue<PendingTask> incoming_queue_;
+
+    // Set when the pump was asked to wake up and the loop has not taken the incoming tasks yet.
+    // While it is set, new tasks are added without waking up the pump again.
+    std::atomic_bool wakeup_scheduled_ { false };
 
     // The next sequence number to use for delayed tasks.
     int next_sequence_num_ = 0;
 
     std::shared_ptr<MessageLoopTaskRunner> proxy_;
 
+    // Checked from any thread when a task is posted. The queue time is recorded only while it is
+    // set.
+    std::atomic_bool profiling_enabled_ { false };
+    std::unique_ptr<MessageLoopProfiler> profiler_;
+
 private:
     void quit();
 
@@ -0,0 +1,203 @@
+//
+// Aspia Project
+// Copyright (C) 2020 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+// Counts the memory allocations per posted task and measures the throughput of tasks posted from
+// several threads. The global operator new is replaced to count the allocations, so this is a
+// separate executable and not a part of aspia_base_tests.
+//
+// Usage: aspia_message_loop_benchmark
+//
+// Returns a non-zero exit code if a task posted with std::bind and a shared_ptr allocates memory
+// once the queues of the loop have grown.
+
+#include "base/message_loop/message_loop.h"
+#include "base/task_runner.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <memory>
+#include <new>
+#include <thread>
+#include <vector>
+
+namespace {
+
+std::atomic_int64_t allocation_count { 0 };
+
+class Counter
+{
+public:
+    void increment(int value) { sum_ += value; }
+    int64_t sum() const { return sum_; }
+
+private:
+    int64_t sum_ = 0;
+};
+
+// Posts |round_count| rounds of |round_size| tasks like std::bind(&Class::method, shared_ptr,
+// argument), running the loop after each round. Prints and returns the number of memory
+// allocations per task.
+double measureAllocationsPerTask(base::MessageLoop::Type type, int round_count, int round_size)
+{
+    base::MessageLoop message_loop(type);
+    std::shared_ptr<base::TaskRunner> task_runner = message_loop.taskRunner();
+    std::shared_ptr<Counter> counter = std::make_shared<Counter>();
+
+    auto post_round = [&]()
+    {
+        for (int i = 0; i < round_size; ++i)
+            task_runner->postTask(std::bind(&Counter::increment, counter, 1));
+
+        task_runner->postQuit();
+        message_loop.run();
+    };
+
+    // The first round grows the queues.
+    post_round();
+
+    const int64_t start_count = allocation_count.load();
+
+    for (int i = 0; i < round_count; ++i)
+        post_round();
+
+    const int64_t count = allocation_count.load() - start_count;
+    const int64_t task_count = static_cast<int64_t>(round_count) * round_size;
+
+    if (counter->sum() != task_count + round_size)
+    {
+        fprintf(stderr, "Not all tasks were executed\n");
+        return -1;
+    }
+
+    const double per_task = static_cast<double>(count) / static_cast<double>(task_count);
+
+    printf("%s loop, %d tasks per round: %.3f allocations per task\n",
+           type == base::MessageLoop::Type::ASIO ? "asio" : "default", round_size, per_task);
+
+    return per_task;
+}
+
+// Posts tasks to a loop from |thread_count| threads and prints the throughput and the delay
+// between posting and running a task.
+void measureCrossThreadPost(base::MessageLoop::Type type, int thread_count, int tasks_per_thread)
+{
+    using Clock = std::chrono::steady_clock;
+
+    base::MessageLoop message_loop(type);
+    std::shared_ptr<base::TaskRunner> task_runner = message_loop.taskRunner();
+
+    const int total_count = thread_count * tasks_per_thread;
+    int executed_count = 0;
+    Clock::duration total_latency = Clock::duration::zero();
+    Clock::duration max_latency = Clock::duration::zero();
+
+    std::vector<std::thread> threads;
+
+    const Clock::time_point start_time = Clock::now();
+
+    for (int i = 0; i < thread_count; ++i)
+    {
+        threads.emplace_back([&]()
+        {
+            for (int j = 0; j < tasks_per_thread; ++j)
+            {
+                const Clock::time_point post_time = Clock::now();
+
+                task_runner->postTask([&, post_time]()
+                {
+                    const Clock::duration latency = Clock::now() - post_time;
+
+                    total_latency += latency;
+                    max_latency = std::max(max_latency, latency);
+
+                    if (++executed_count == total_count)
+                        task_runner->postQuit();
+                });
+            }
+        });
+    }
+
+    message_loop.run();
+
+    const std::chrono::duration<double> duration = Clock::now() - start_time;
+
+    for (auto& thread : threads)
+        thread.join();
+
+    using Microseconds = std::chrono::duration<double, std::micro>;
+
+    printf("%s loop, %d threads: %.0f tasks/s, average delay: %.1f us, max delay: %.1f us\n",
+           type == base::MessageLoop::Type::ASIO ? "asio" : "default",
+           thread_count,
+           static_cast<double>(total_count) / duration.count(),
+           Microseconds(total_latency).count() / static_cast<double>(total_count),
+           Microseconds(max_latency).count());
+}
+
+} // namespace
+
+void* operator new(size_t size)
+{
+    allocation_count.fetch_add(1, std::memory_order_relaxed);
+
+    void* ptr = std::malloc(size ? size : 1);
+    if (!ptr)
+        throw std::bad_alloc();
+
+    return ptr;
+}
+
+void operator delete(void* ptr) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete(void* ptr, size_t /* size */) noexcept
+{
+    ::operator delete(ptr);
+}
+
+int main(int /* argc */, const char* const* /* argv */)
+{
+    int result = 0;
+
+    for (base::MessageLoop::Type type : { base::MessageLoop::Type::DEFAULT,
+                                          base::MessageLoop::Type::ASIO })
+    {
+        const double per_task = measureAllocationsPerTask(type, 100, 1000);
+        if (per_task < 0 || per_task >= 0.1)
+            result = 1;
+
+        // A burst larger than the node pool of the incoming queue.
+        measureAllocationsPerTask(type, 1, 100000);
+    }
+
+    static const int kTasksPerThread = 50000;
+
+    for (int thread_count : { 1, 4 })
+    {
+        measureCrossThreadPost(base::MessageLoop::Type::DEFAULT, thread_count, kTasksPerThread);
+        measureCrossThreadPost(base::MessageLoop::Type::ASIO, thread_count, kTasksPerThread);
+    }
+
+    return result;
+}
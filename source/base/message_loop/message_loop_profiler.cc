@@ -0,0 +1,211 @@
+//
+// Aspia Project
+// Copyright (C) 2020 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "base/message_loop/message_loop_profiler.h"
+
+#include "base/logging.h"
+#include "base/files/file_util.h"
+#include "base/message_loop/pending_task.h"
+#include "base/strings/string_printf.h"
+
+#include <algorithm>
+#include <vector>
+
+namespace base {
+
+namespace {
+
+int64_t toMicroseconds(const MessageLoopProfiler::Clock::duration& duration)
+{
+    return std::max(std::chrono::duration_cast<std::chrono::microseconds>(duration).count(),
+                    int64_t(0));
+}
+
+} // namespace
+
+void MessageLoopProfiler::Histogram::add(const Clock::duration& duration)
+{
+    const int64_t value = toMicroseconds(duration);
+
+    size_t bucket = 0;
+    while (bucket + 1 < kBucketCount && (int64_t(1) << bucket) <= value)
+        ++bucket;
+
+    ++buckets_[bucket];
+    ++count_;
+    total_us_ += value;
+    max_us_ = std::max(max_us_, value);
+}
+
+int64_t MessageLoopProfiler::Histogram::averageUs() const
+{
+    if (!count_)
+        return 0;
+
+    return total_us_ / static_cast<int64_t>(count_);
+}
+
+int64_t MessageLoopProfiler::Histogram::percentileUs(double percent) const
+{
+    if (!count_)
+        return 0;
+
+    const double target = static_cast<double>(count_) * percent / 100.0;
+    uint64_t accumulated = 0;
+
+    for (size_t i = 0; i < kBucketCount; ++i)
+    {
+        accumulated += buckets_[i];
+
+        if (static_cast<double>(accumulated) >= target)
+            return std::min(int64_t(1) << i, max_us_);
+    }
+
+    return max_us_;
+}
+
+std::string MessageLoopProfiler::Histogram::toString() const
+{
+    return stringPrintf("count %llu, avg %lld us, p50 %lld us, p99 %lld us, max %lld us",
+                        static_cast<unsigned long long>(count_),
+                        static_cast<long long>(averageUs()),
+                        static_cast<long long>(percentileUs(50)),
+                        static_cast<long long>(percentileUs(99)),
+                        static_cast<long long>(max_us_));
+}
+
+MessageLoopProfiler::MessageLoopProfiler()
+    : start_time_(Clock::now())
+{
+    // Nothing
+}
+
+MessageLoopProfiler::~MessageLoopProfiler() = default;
+
+void MessageLoopProfiler::addTask(
+    const PendingTask& pending_task, TimePoint start_time, TimePoint end_time)
+{
+    LocationStats& stats = locations_[pending_task.posted_from.programCounter()];
+    if (!stats.run_time.count())
+        stats.location = pending_task.posted_from;
+
+    // Tasks posted before profiling was enabled do not have the queue time.
+    if (pending_task.queue_time != TimePoint())
+    {
+        // A delayed task is not waiting in the queue until its run time comes.
+        const TimePoint ready_time = std::max(pending_task.queue_time,
+                                              pending_task.delayed_run_time);
+        const Clock::duration delay = start_time - ready_time;
+
+        queue_delay_.add(delay);
+        stats.queue_delay.add(delay);
+    }
+
+    const Clock::duration run_time = end_time - start_time;
+
+    run_time_.add(run_time);
+    stats.run_time.add(run_time);
+}
+
+void MessageLoopProfiler::addIoHandlers(size_t count, const Clock::duration& duration)
+{
+    io_handler_count_ += count;
+    io_handler_time_.add(duration);
+}
+
+void MessageLoopProfiler::addIoWait(const Clock::duration& duration)
+{
+    io_wait_time_.add(duration);
+}
+
+void MessageLoopProfiler::reset()
+{
+    start_time_ = Clock::now();
+
+    queue_delay_ = Histogram();
+    run_time_ = Histogram();
+    io_handler_time_ = Histogram();
+    io_wait_time_ = Histogram();
+    io_handler_count_ = 0;
+
+    locations_.clear();
+}
+
+std::string MessageLoopProfiler::snapshot(size_t max_locations) const
+{
+    const std::chrono::duration<double> uptime = Clock::now() - start_time_;
+
+    std::string result = stringPrintf("Message loop profile for %.1f s\n", uptime.count());
+
+    result += "  Queue delay: " + queue_delay_.toString() + "\n";
+    result += "  Task run time: " + run_time_.toString() + "\n";
+
+    if (io_handler_time_.count())
+    {
+        result += stringPrintf("  I/O handlers (%llu handlers): ",
+                               static_cast<unsigned long long>(io_handler_count_));
+        result += io_handler_time_.toString() + "\n";
+        result += "  I/O wait: " + io_wait_time_.toString() + "\n";
+    }
+
+    std::vector<const LocationStats*> locations;
+    locations.reserve(locations_.size());
+
+    for (const auto& location : locations_)
+        locations.emplace_back(&location.second);
+
+    std::sort(locations.begin(), locations.end(),
+              [](const LocationStats* first, const LocationStats* second)
+    {
+        return first->run_time.totalUs() > second->run_time.totalUs();
+    });
+
+    if (locations.size() > max_locations)
+        locations.resize(max_locations);
+
+    result += stringPrintf("  Top %zu posting locations by total run time:\n", locations.size());
+
+    for (const LocationStats* stats : locations)
+    {
+        result += stringPrintf("    %s: total %lld us\n",
+                               stats->location.toString().c_str(),
+                               static_cast<long long>(stats->run_time.totalUs()));
+        result += "      delay: " + stats->queue_delay.toString() + "\n";
+        result += "      run: " + stats->run_time.toString() + "\n";
+    }
+
+    return result;
+}
+
+void MessageLoopProfiler::dumpToLog() const
+{
+    LOG(LS_INFO) << snapshot();
+}
+
+bool MessageLoopProfiler::dumpToFile(const std::filesystem::path& file_path) const
+{
+    if (!writeFile(file_path, snapshot()))
+    {
+        LOG(LS_WARNING) << "Unable to write message loop profile to file: " << file_path;
+        return false;
+    }
+
+    return true;
+}
+
+} // namespace base
@@ -0,0 +1,124 @@
+//
+// Aspia Project
+// Copyright (C) 2020 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#ifndef BASE__MESSAGE_LOOP__MESSAGE_LOOP_PROFILER_H
+#define BASE__MESSAGE_LOOP__MESSAGE_LOOP_PROFILER_H
+
+#include "base/location.h"
+#include "base/macros_magic.h"
+#include "base/message_loop/message_pump.h"
+
+#include <array>
+#include <filesystem>
+#include <string>
+#include <unordered_map>
+
+namespace base {
+
+class PendingTask;
+
+// Collects statistics of a message loop: how long tasks wait in the queue, how long they run (per
+// posting location) and how much time the asio pump spends in I/O handlers and in waiting for I/O.
+// The profiler belongs to the thread of the loop. To take a snapshot from another thread, post a
+// task to the loop (see MessageLoop::setProfilingEnabled).
+class MessageLoopProfiler
+{
+public:
+    using Clock = MessagePump::Clock;
+    using TimePoint = MessagePump::TimePoint;
+
+    // Histogram of durations with power of two buckets in microseconds.
+    class Histogram
+    {
+    public:
+        void add(const Clock::duration& duration);
+
+        uint64_t count() const { return count_; }
+        int64_t totalUs() const { return total_us_; }
+        int64_t maxUs() const { return max_us_; }
+        int64_t averageUs() const;
+
+        // Returns the upper bound of the bucket containing the percentile |percent| (0-100).
+        int64_t percentileUs(double percent) const;
+
+        // Returns a string like "count 10, avg 5 us, p50 4 us, p99 32 us, max 30 us".
+        std::string toString() const;
+
+    private:
+        static const size_t kBucketCount = 40;
+
+        // Bucket N contains values in the range [2^(N-1), 2^N) microseconds.
+        std::array<uint64_t, kBucketCount> buckets_ = {};
+        uint64_t count_ = 0;
+        int64_t total_us_ = 0;
+        int64_t max_us_ = 0;
+    };
+
+    MessageLoopProfiler();
+    ~MessageLoopProfiler();
+
+    // Adds a task that was run from |start_time| to |end_time|.
+    void addTask(const PendingTask& pending_task, TimePoint start_time, TimePoint end_time);
+
+    // Adds |count| asio handlers executed in |duration|.
+    void addIoHandlers(size_t count, const Clock::duration& duration);
+
+    // Adds the time the asio pump was blocked waiting for I/O. It includes the handler that woke
+    // up the pump.
+    void addIoWait(const Clock::duration& duration);
+
+    // Clears all statistics.
+    void reset();
+
+    // Returns a human readable report. At most |max_locations| locations with the largest total
+    // run time are included.
+    std::string snapshot(size_t max_locations = 20) const;
+
+    void dumpToLog() const;
+    bool dumpToFile(const std::filesystem::path& file_path) const;
+
+    const Histogram& queueDelay() const { return queue_delay_; }
+    const Histogram& runTime() const { return run_time_; }
+    const Histogram& ioHandlerTime() const { return io_handler_time_; }
+    const Histogram& ioWaitTime() const { return io_wait_time_; }
+
+private:
+    struct LocationStats
+    {
+        Location location;
+        Histogram queue_delay;
+        Histogram run_time;
+    };
+
+    TimePoint start_time_;
+
+    Histogram queue_delay_;
+    Histogram run_time_;
+    Histogram io_handler_time_;
+    Histogram io_wait_time_;
+    uint64_t io_handler_count_ = 0;
+
+    // The key is the program counter of the location.
+    std::unordered_map<const void*, LocationStats> locations_;
+
+    DISALLOW_COPY_AND_ASSIGN(MessageLoopProfiler);
+};
+
+} // namespace base
+
+#endif // BASE__MESSAGE_LOOP__MESSAGE_LOOP_PROFILER_H
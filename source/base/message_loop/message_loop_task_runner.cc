@@ -36,36 +36,38 @@ bool MessageLoopTaskRunner::belongsToCurrentThread() const
     return thread_id_ == std::this_thread::get_id();
 }
 
-void MessageLoopTaskRunner::postTask(Callback callback)
+void MessageLoopTaskRunner::postTaskImpl(Callback callback, const Location& from_here)
 {
     std::shared_lock lock(loop_lock_);
 
     if (loop_)
-        loop_->postTask(std::move(callback));
+        loop_->postTask(std::move(callback), from_here);
 }
 
-void MessageLoopTaskRunner::postDelayedTask(Callback callback, const Milliseconds& delay)
+void MessageLoopTaskRunner::postDelayedTaskImpl(
+    Callback callback, const Milliseconds& delay, const Location& from_here)
 {
     std::shared_lock lock(loop_lock_);
 
     if (loop_)
-        loop_->postDelayedTask(std::move(callback), delay);
+        loop_->postDelayedTask(std::move(callback), delay, from_here);
 }
 
-void MessageLoopTaskRunner::postNonNestableTask(Callback callback)
+void MessageLoopTaskRunner::postNonNestableTaskImpl(Callback callback, const Location& from_here)
 {
     std::shared_lock lock(loop_lock_);
 
     if (loop_)
-        loop_->postNonNestableTask(std::move(callback));
+        loop_->postNonNestableTask(std::move(callback), from_here);
 }
 
-void MessageLoopTaskRunner::postNonNestableDelayedTask(Callback callback, const Milliseconds& delay)
+void MessageLoopTaskRunner::postNonNestableDelayedTaskImpl(
+    Callback callback, const Milliseconds& delay, const Location& from_here)
 {
     std::shared_lock lock(loop_lock_);
 
     if (loop_)
-        loop_->postNonNestableDelayedTask(std::move(callback), delay);
+        loop_->postNonNestableDelayedTask(std::move(callback), delay, from_here);
 }
 
 void MessageLoopTaskRunner::postQuit()
@@ -73,7 +75,7 @@ void MessageLoopTaskRunner::postQuit()
     std::shared_lock lock(loop_lock_);
 
     if (loop_)
-        loop_->postTask(loop_->quitClosure());
+        loop_->postTask(loop_->quitClosure(), FROM_HERE);
 }
 
 MessageLoopTaskRunner::MessageLoopTaskRunner(MessageLoop* loop)
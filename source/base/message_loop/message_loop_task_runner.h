@@ -34,12 +34,19 @@ public:
 
     // TaskRunner implementation.
     bool belongsToCurrentThread() const override;
-    void postTask(Callback callback) override;
-    void postDelayedTask(Callback callback, const Milliseconds& delay) override;
-    void postNonNestableTask(Callback callback) override;
-    void postNonNestableDelayedTask(Callback callback, const Milliseconds& delay) override;
     void postQuit() override;
 
+protected:
+    // TaskRunner implementation.
+    void postTaskImpl(Callback callback, const Location& from_here) override;
+    void postDelayedTaskImpl(Callback callback,
+                             const Milliseconds& delay,
+                             const Location& from_here) override;
+    void postNonNestableTaskImpl(Callback callback, const Location& from_here) override;
+    void postNonNestableDelayedTaskImpl(Callback callback,
+                                        const Milliseconds& delay,
+                                        const Location& from_here) override;
+
 private:
     friend class MessageLoop;
 
@@ -0,0 +1,232 @@
+//
+// Aspia Project
+// Copyright (C) 2020 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "base/message_loop/message_loop.h"
+
+#include "base/message_loop/message_loop_profiler.h"
+#include "base/message_loop/message_pump_asio.h"
+#include "base/threading/asio_thread_pool.h"
+
+#include <asio/post.hpp>
+#include <gtest/gtest.h>
+
+#include <sstream>
+#include <thread>
+#include <vector>
+
+namespace base {
+
+TEST(MessageLoopTest, PostTaskOrder)
+{
+    MessageLoop message_loop;
+    std::shared_ptr<TaskRunner> task_runner = message_loop.taskRunner();
+
+    std::vector<int> order;
+
+    for (int i = 0; i < 10; ++i)
+        task_runner->postTask([&order, i]() { order.push_back(i); });
+
+    task_runner->postQuit();
+    message_loop.run();
+
+    ASSERT_EQ(order.size(), 10u);
+
+    for (int i = 0; i < 10; ++i)
+        EXPECT_EQ(order[i], i);
+}
+
+TEST(MessageLoopTest, CrossThreadPostOrder)
+{
+    static const int kThreadCount = 4;
+    static const int kTasksPerThread = 1000;
+
+    MessageLoop message_loop;
+    std::shared_ptr<TaskRunner> task_runner = message_loop.taskRunner();
+
+    std::vector<std::vector<int>> order(kThreadCount);
+    int executed_count = 0;
+
+    std::vector<std::thread> threads;
+
+    for (int i = 0; i < kThreadCount; ++i)
+    {
+        threads.emplace_back([&, i]()
+        {
+            for (int j = 0; j < kTasksPerThread; ++j)
+            {
+                task_runner->postTask([&, i, j]()
+                {
+                    order[i].push_back(j);
+
+                    if (++executed_count == kThreadCount * kTasksPerThread)
+                        task_runner->postQuit();
+                });
+            }
+        });
+    }
+
+    message_loop.run();
+
+    for (auto& thread : threads)
+        thread.join();
+
+    // Tasks of one thread run in the order in which they were posted.
+    for (int i = 0; i < kThreadCount; ++i)
+    {
+        ASSERT_EQ(order[i].size(), static_cast<size_t>(kTasksPerThread));
+
+        for (int j = 0; j < kTasksPerThread; ++j)
+            EXPECT_EQ(order[i][j], j);
+    }
+}
+
+TEST(MessageLoopTest, DelayedTaskOrder)
+{
+    MessageLoop message_loop;
+    std::shared_ptr<TaskRunner> task_runner = message_loop.taskRunner();
+
+    std::vector<int> order;
+
+    for (int delay : { 30, 10, 20, 10 })
+    {
+        task_runner->postDelayedTask(
+            [&order, delay]() { order.push_back(delay); }, std::chrono::milliseconds(delay));
+    }
+
+    task_runner->postDelayedTask(
+        [&message_loop]() { message_loop.taskRunner()->postQuit(); },
+        std::chrono::milliseconds(50));
+
+    message_loop.run();
+
+    EXPECT_EQ(order, std::vector<int>({ 10, 10, 20, 30 }));
+}
+
+TEST(MessageLoopTest, MoveOnlyTask)
+{
+    MessageLoop message_loop;
+    std::shared_ptr<TaskRunner> task_runner = message_loop.taskRunner();
+
+    int result = 0;
+    std::unique_ptr<int> value = std::make_unique<int>(42);
+
+    task_runner->postTask([&result, value = std::move(value)]() { result = *value; });
+    task_runner->postQuit();
+    message_loop.run();
+
+    EXPECT_EQ(result, 42);
+}
+
+TEST(MessageLoopTest, AsioPool)
+{
+    MessageLoop message_loop(MessageLoop::Type::ASIO_POOL);
+    std::shared_ptr<TaskRunner> task_runner = message_loop.taskRunner();
+
+    MessagePumpForAsio* pump = message_loop.pumpAsio();
+    ASSERT_NE(pump->threadPool(), nullptr);
+    EXPECT_NE(&pump->poolContext(), &pump->ioContext());
+
+    std::thread::id pool_thread_id;
+
+    // Handlers of the pool context run on the threads of the pool.
+    asio::post(pump->poolContext(), [&]()
+    {
+        pool_thread_id = std::this_thread::get_id();
+        task_runner->postQuit();
+    });
+
+    message_loop.run();
+
+    EXPECT_NE(pool_thread_id, std::thread::id());
+    EXPECT_NE(pool_thread_id, std::this_thread::get_id());
+}
+
+TEST(MessageLoopTest, Profiling)
+{
+    for (MessageLoop::Type type : { MessageLoop::Type::DEFAULT, MessageLoop::Type::ASIO })
+    {
+        MessageLoop message_loop(type);
+        std::shared_ptr<TaskRunner> task_runner = message_loop.taskRunner();
+
+        EXPECT_EQ(message_loop.profiler(), nullptr);
+        message_loop.setProfilingEnabled(true);
+
+        MessageLoopProfiler* profiler = message_loop.profiler();
+        ASSERT_NE(profiler, nullptr);
+
+        for (int i = 0; i < 10; ++i)
+        {
+            task_runner->postTask(
+                []() { std::this_thread::sleep_for(std::chrono::milliseconds(1)); });
+        }
+
+        task_runner->postDelayedTask([]() {}, std::chrono::milliseconds(5));
+        task_runner->postDelayedTask(
+            [&message_loop]() { message_loop.taskRunner()->postQuit(); },
+            std::chrono::milliseconds(10));
+
+        message_loop.run();
+
+        // 12 tasks plus the quit task.
+        EXPECT_EQ(profiler->runTime().count(), 13u);
+        EXPECT_EQ(profiler->queueDelay().count(), 13u);
+        EXPECT_GE(profiler->runTime().totalUs(), 10000);
+        EXPECT_GE(profiler->runTime().maxUs(), 1000);
+
+        std::vector<std::string> lines;
+        std::istringstream snapshot(profiler->snapshot());
+        for (std::string line; std::getline(snapshot, line);)
+            lines.emplace_back(line);
+
+        ASSERT_GE(lines.size(), 4u);
+        EXPECT_EQ(lines[0].rfind("Message loop profile for ", 0), 0u);
+        EXPECT_EQ(lines[1].rfind("  Queue delay: count 13,", 0), 0u);
+        EXPECT_EQ(lines[2].rfind("  Task run time: count 13,", 0), 0u);
+
+        // The I/O handlers are profiled only for the asio pump.
+        size_t index = 3;
+        if (type == MessageLoop::Type::ASIO)
+        {
+            ASSERT_GE(lines.size(), 6u);
+            EXPECT_EQ(lines[3].rfind("  I/O handlers (", 0), 0u);
+            EXPECT_EQ(lines[4].rfind("  I/O wait: ", 0), 0u);
+            index = 5;
+        }
+
+        // Four posting locations with three lines each: the loop of sleeping tasks, two delayed
+        // tasks and postQuit(). The sleeping tasks take the most time and are listed first.
+        ASSERT_EQ(lines.size(), index + 1 + 4 * 3);
+        EXPECT_EQ(lines[index], "  Top 4 posting locations by total run time:");
+        EXPECT_NE(lines[index + 1].find("@message_loop_unittest.cc:"), std::string::npos);
+        EXPECT_EQ(lines[index + 3].rfind("      run: count 10,", 0), 0u);
+
+        int quit_count = 0;
+        for (size_t i = index + 1; i < lines.size(); i += 3)
+        {
+            if (lines[i].find("postQuit@message_loop_task_runner.cc:") != std::string::npos)
+                ++quit_count;
+        }
+
+        EXPECT_EQ(quit_count, 1);
+
+        message_loop.setProfilingEnabled(false);
+        EXPECT_EQ(message_loop.profiler(), nullptr);
+    }
+}
+
+} // namespace base
@@ -19,11 +19,29 @@
 #include "base/message_loop/message_pump_asio.h"
 
 #include "base/logging.h"
+#include "base/message_loop/message_loop_profiler.h"
+#include "base/threading/asio_thread_pool.h"
 
 #include <asio/post.hpp>
 
 namespace base {
 
+MessagePumpForAsio::MessagePumpForAsio(std::unique_ptr<AsioThreadPool> thread_pool)
+    : thread_pool_(std::move(thread_pool))
+{
+    // Nothing
+}
+
+MessagePumpForAsio::~MessagePumpForAsio() = default;
+
+asio::io_context& MessagePumpForAsio::poolContext()
+{
+    if (thread_pool_)
+        return thread_pool_->ioContext();
+
+    return io_context_;
+}
+
 void MessagePumpForAsio::run(Delegate* delegate)
 {
     DCHECK(keep_running_) << "Quit must have been called outside of run!";
@@ -44,7 +62,7 @@ void MessagePumpForAsio::run(Delegate* delegate)
         io_context_.restart();
 
         // Run the io_context object's event processing loop to execute ready handlers.
-        did_work |= io_context_.poll() != 0;
+        did_work |= poll() != 0;
         if (!keep_running_)
             break;
 
@@ -64,7 +82,7 @@ void MessagePumpForAsio::run(Delegate* delegate)
             io_context_.restart();
 
             // Run the io_context object's event processing loop to execute at most one handler.
-            io_context_.run_one();
+            runOne();
         }
         else
         {
@@ -77,7 +95,7 @@ void MessagePumpForAsio::run(Delegate* delegate)
                 io_context_.restart();
 
                 // Run the io_context object's event processing loop to execute at most one handler.
-                io_context_.run_one_for(delay);
+                runOneFor(delay);
             }
             else
             {
@@ -91,6 +109,54 @@ void MessagePumpForAsio::run(Delegate* delegate)
     keep_running_ = true;
 }
 
+size_t MessagePumpForAsio::poll()
+{
+    if (!profiler_)
+        return io_context_.poll();
+
+    const TimePoint start_time = Clock::now();
+
+    const size_t count = io_context_.poll();
+    if (count && profiler_)
+        profiler_->addIoHandlers(count, Clock::now() - start_time);
+
+    return count;
+}
+
+void MessagePumpForAsio::runOne()
+{
+    if (!profiler_)
+    {
+        io_context_.run_one();
+        return;
+    }
+
+    // The waiting and the handler that ends it cannot be separated. The handler is counted as
+    // the waiting time.
+    const TimePoint start_time = Clock::now();
+
+    io_context_.run_one();
+
+    if (profiler_)
+        profiler_->addIoWait(Clock::now() - start_time);
+}
+
+void MessagePumpForAsio::runOneFor(const Milliseconds& delay)
+{
+    if (!profiler_)
+    {
+        io_context_.run_one_for(delay);
+        return;
+    }
+
+    const TimePoint start_time = Clock::now();
+
+    io_context_.run_one_for(delay);
+
+    if (profiler_)
+        profiler_->addIoWait(Clock::now() - start_time);
+}
+
 void MessagePumpForAsio::quit()
 {
     keep_running_ = false;
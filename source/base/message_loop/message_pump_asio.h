@@ -24,13 +24,19 @@
 
 #include <asio/io_context.hpp>
 
+#include <memory>
+
 namespace base {
 
+class AsioThreadPool;
+class MessageLoopProfiler;
+
 class MessagePumpForAsio : public MessagePump
 {
 public:
-    MessagePumpForAsio() = default;
-    ~MessagePumpForAsio() = default;
+    // If |thread_pool| is not null, then the pump owns it and it is available via threadPool().
+    explicit MessagePumpForAsio(std::unique_ptr<AsioThreadPool> thread_pool = nullptr);
+    ~MessagePumpForAsio();
 
     // MessagePump methods:
     void run(Delegate* delegate) override;
@@ -38,9 +44,26 @@ public:
     void scheduleWork() override;
     void scheduleDelayedWork(const TimePoint& delayed_work_time) override;
 
+    // Handlers of I/O objects created with this io_context are run on the thread of the loop.
     asio::io_context& ioContext() { return io_context_; }
 
+    // Returns the thread pool for Type::ASIO_POOL loops and nullptr for other loops.
+    AsioThreadPool* threadPool() const { return thread_pool_.get(); }
+
+    // Returns the io_context of the thread pool if there is one, otherwise ioContext(). I/O objects
+    // created with it must bind their handlers to strands, because the handlers can run on several
+    // threads at once.
+    asio::io_context& poolContext();
+
+    // Sets the profiler that receives the time spent in I/O handlers and in waiting for I/O. Pass
+    // nullptr to stop the profiling. Called by MessageLoop::setProfilingEnabled.
+    void setProfiler(MessageLoopProfiler* profiler) { profiler_ = profiler; }
+
 private:
+    size_t poll();
+    void runOne();
+    void runOneFor(const Milliseconds& delay);
+
     // This flag is set to false when run() should return.
     bool keep_running_ = true;
 
@@ -49,6 +72,10 @@ private:
     // The time at which we should call doDelayedWork.
     TimePoint delayed_work_time_;
 
+    std::unique_ptr<AsioThreadPool> thread_pool_;
+
+    MessageLoopProfiler* profiler_ = nullptr;
+
     DISALLOW_COPY_AND_ASSIGN(MessagePumpForAsio);
 };
 
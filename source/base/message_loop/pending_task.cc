@@ -18,13 +18,19 @@
 
 #include "base/message_loop/pending_task.h"
 
+#include <algorithm>
+
 namespace base {
 
-PendingTask::PendingTask(
-    Callback&& callback, TimePoint delayed_run_time, bool nestable, int sequence_num)
+PendingTask::PendingTask(Callback&& callback,
+                         const Location& posted_from,
+                         TimePoint delayed_run_time,
+                         bool nestable,
+                         int sequence_num)
     : callback(std::move(callback)),
-      delayed_run_time(delayed_run_time),
+      posted_from(posted_from),
       sequence_num(sequence_num),
+      delayed_run_time(delayed_run_time),
       nestable(nestable)
 {
     // Nothing
@@ -46,4 +52,49 @@ bool PendingTask::operator<(const PendingTask& other) const
     return (sequence_num - other.sequence_num) > 0;
 }
 
+void TaskQueue::push(PendingTask&& pending_task)
+{
+    tasks_.emplace_back(std::move(pending_task));
+}
+
+void TaskQueue::pop()
+{
+    // Destroy the callback now, the element itself is removed later.
+    tasks_[front_].callback.reset();
+
+    if (++front_ == tasks_.size())
+    {
+        tasks_.clear();
+        front_ = 0;
+    }
+    else if (front_ >= 1024 && front_ * 2 >= tasks_.size())
+    {
+        // The queue is never empty. Remove the taken elements so that it does not grow forever.
+        tasks_.erase(tasks_.begin(), tasks_.begin() + front_);
+        front_ = 0;
+    }
+}
+
+void TaskQueue::Swap(TaskQueue* queue)
+{
+    tasks_.swap(queue->tasks_);
+    std::swap(front_, queue->front_);
+}
+
+void DelayedTaskQueue::push(PendingTask&& pending_task)
+{
+    heap_.emplace_back(std::move(pending_task));
+    std::push_heap(heap_.begin(), heap_.end());
+}
+
+PendingTask DelayedTaskQueue::pop()
+{
+    std::pop_heap(heap_.begin(), heap_.end());
+
+    PendingTask pending_task = std::move(heap_.back());
+    heap_.pop_back();
+
+    return pending_task;
+}
+
 } // namespace base
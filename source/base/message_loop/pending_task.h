@@ -19,9 +19,12 @@
 #ifndef BASE__MESSAGE_LOOP__PENDING_TASK_H
 #define BASE__MESSAGE_LOOP__PENDING_TASK_H
 
+#include "base/location.h"
+#include "base/macros_magic.h"
+#include "base/once_closure.h"
+
 #include <chrono>
-#include <functional>
-#include <queue>
+#include <vector>
 
 namespace base {
 
@@ -30,14 +33,17 @@ namespace base {
 class PendingTask
 {
 public:
-    using Callback = std::function<void()>;
+    using Callback = OnceClosure;
     using Clock = std::chrono::high_resolution_clock;
     using TimePoint = std::chrono::time_point<Clock>;
 
     PendingTask(Callback&& callback,
+                const Location& posted_from,
                 TimePoint delayed_run_time,
                 bool nestable,
                 int sequence_num = 0);
+    PendingTask(PendingTask&& other) = default;
+    PendingTask& operator=(PendingTask&& other) = default;
     ~PendingTask() = default;
 
     // Used to support sorting.
@@ -46,27 +52,66 @@ public:
     // The task to run.
     Callback callback;
 
+    // The site this PendingTask was posted from.
+    Location posted_from;
+
     // Secondary sort key for run time.
     int sequence_num;
 
     TimePoint delayed_run_time;
 
+    // The time when the task was posted. Set only while the profiling of the loop is enabled.
+    TimePoint queue_time;
+
     // OK to dispatch from a nested loop.
     bool nestable;
 };
 
-// Wrapper around std::queue specialized for PendingTask which adds a Swap helper method.
-class TaskQueue : public std::queue<PendingTask>
+// FIFO queue of PendingTask over a vector. std::deque frees and allocates its blocks as tasks pass
+// through it, while this queue keeps its capacity and does not allocate memory in steady state.
+class TaskQueue
 {
 public:
-    void Swap(TaskQueue* queue)
-    {
-        c.swap(queue->c); // Calls std::deque::swap.
-    }
+    TaskQueue() = default;
+
+    bool empty() const { return front_ == tasks_.size(); }
+    size_t size() const { return tasks_.size() - front_; }
+
+    PendingTask& front() { return tasks_[front_]; }
+
+    void push(PendingTask&& pending_task);
+    void pop();
+
+    void Swap(TaskQueue* queue);
+
+private:
+    std::vector<PendingTask> tasks_;
+    size_t front_ = 0;
+
+    DISALLOW_COPY_AND_ASSIGN(TaskQueue);
 };
 
 // PendingTasks are sorted by their |delayed_run_time| property.
-using DelayedTaskQueue = std::priority_queue<PendingTask>;
+// Binary heap over a vector. Unlike std::priority_queue it allows to move the top task out of the
+// queue, and once the vector has grown it does not allocate memory.
+class DelayedTaskQueue
+{
+public:
+    DelayedTaskQueue() = default;
+
+    bool empty() const { return heap_.empty(); }
+    size_t size() const { return heap_.size(); }
+
+    const PendingTask& top() const { return heap_.front(); }
+
+    void push(PendingTask&& pending_task);
+    PendingTask pop();
+
+private:
+    std::vector<PendingTask> heap_;
+
+    DISALLOW_COPY_AND_ASSIGN(DelayedTaskQueue);
+};
 
 } // namespace base
 
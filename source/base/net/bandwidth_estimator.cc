@@ -0,0 +1,162 @@
+//
+// Aspia Project
+// Copyright (C) 2020 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "base/net/bandwidth_estimator.h"
+
+#include <algorithm>
+
+namespace base {
+
+namespace {
+
+const int kInitialBandwidthKbps = 1000;
+const int kMinBandwidthKbps = 100;
+const int kMaxBandwidthKbps = 100000;
+
+// The queue must stay non-empty for at least this time to give a sample. Shorter bursts are
+// absorbed by the send buffer of the socket and do not show the speed of the link.
+constexpr std::chrono::milliseconds kMinSampleDuration(100);
+
+// The estimate is raised at most once per interval.
+constexpr std::chrono::milliseconds kIncreaseInterval(1000);
+const int kIncreasePercentage = 25;
+
+// The estimate is raised only if the sender used at least this part of it.
+const int kMinUsagePercentage = 50;
+
+// The minimum latency is kept for this period and the previous one, so the link can become slower.
+constexpr std::chrono::seconds kMinLatencyPeriod(10);
+
+// If the latency exceeds the minimum by this value, the link is overloaded and the estimate is
+// lowered (at most once per interval).
+constexpr std::chrono::milliseconds kMaxQueueingDelay(200);
+constexpr std::chrono::milliseconds kDecreaseInterval(500);
+const int kDecreasePercentage = 15;
+
+int64_t toKbps(int64_t bytes, std::chrono::microseconds duration)
+{
+    // Bits per millisecond are kilobits per second.
+    return bytes * 8 * 1000 / std::max(duration.count(), int64_t(1));
+}
+
+} // namespace
+
+BandwidthEstimator::BandwidthEstimator()
+    : min_latency_(std::chrono::milliseconds::max()),
+      prev_min_latency_(std::chrono::milliseconds::max()),
+      bandwidth_kbps_(kInitialBandwidthKbps)
+{
+    // Nothing
+}
+
+BandwidthEstimator::~BandwidthEstimator() = default;
+
+void BandwidthEstimator::onMessageSent(size_t size, TimePoint time)
+{
+    updateInterval(time);
+
+    if (pending_.empty())
+    {
+        // The queue was empty. The link is busy from now on.
+        sample_start_ = time;
+        sample_bytes_ = 0;
+    }
+
+    pending_.emplace_back(size);
+    pending_bytes_ += static_cast<int64_t>(size);
+    interval_bytes_ += static_cast<int64_t>(size);
+}
+
+void BandwidthEstimator::onMessageWritten(TimePoint time)
+{
+    if (pending_.empty())
+        return;
+
+    const size_t size = pending_.front();
+    pending_.pop_front();
+
+    pending_bytes_ -= static_cast<int64_t>(size);
+    sample_bytes_ += static_cast<int64_t>(size);
+
+    const std::chrono::microseconds duration =
+        std::chrono::duration_cast<std::chrono::microseconds>(time - sample_start_);
+
+    if (duration >= kMinSampleDuration)
+    {
+        bandwidth_kbps_ = static_cast<int>(std::clamp(
+            toKbps(sample_bytes_, duration),
+            int64_t(kMinBandwidthKbps),
+            int64_t(kMaxBandwidthKbps)));
+
+        interval_limited_ = true;
+
+        sample_start_ = time;
+        sample_bytes_ = 0;
+    }
+
+    updateInterval(time);
+}
+
+void BandwidthEstimator::onMessageAcknowledged(std::chrono::milliseconds latency, TimePoint time)
+{
+    updateInterval(time);
+
+    if (time - min_latency_start_ >= kMinLatencyPeriod)
+    {
+        prev_min_latency_ = min_latency_;
+        min_latency_ = std::chrono::milliseconds::max();
+        min_latency_start_ = time;
+    }
+
+    min_latency_ = std::min(min_latency_, latency);
+
+    if (latency - std::min(min_latency_, prev_min_latency_) <= kMaxQueueingDelay)
+        return;
+
+    interval_limited_ = true;
+
+    if (time - last_decrease_ < kDecreaseInterval)
+        return;
+
+    bandwidth_kbps_ = std::max(
+        bandwidth_kbps_ - bandwidth_kbps_ * kDecreasePercentage / 100, kMinBandwidthKbps);
+    last_decrease_ = time;
+}
+
+void BandwidthEstimator::updateInterval(TimePoint time)
+{
+    const std::chrono::microseconds duration =
+        std::chrono::duration_cast<std::chrono::microseconds>(time - interval_start_);
+
+    if (duration < kIncreaseInterval)
+        return;
+
+    // The sender used most of the estimate and the link did not slow it down.
+    if (!interval_limited_ &&
+        toKbps(interval_bytes_, duration) * 100 >= bandwidth_kbps_ * kMinUsagePercentage)
+    {
+        bandwidth_kbps_ = std::min(
+            bandwidth_kbps_ + bandwidth_kbps_ * kIncreasePercentage / 100, kMaxBandwidthKbps);
+    }
+
+    interval_start_ = time;
+    interval_bytes_ = 0;
+    interval_limited_ = false;
+}
+
+} // namespace base
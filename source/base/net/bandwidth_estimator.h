@@ -0,0 +1,94 @@
+//
+// Aspia Project
+// Copyright (C) 2020 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#ifndef BASE__NET__BANDWIDTH_ESTIMATOR_H
+#define BASE__NET__BANDWIDTH_ESTIMATOR_H
+
+#include "base/macros_magic.h"
+
+#include <chrono>
+#include <cstdint>
+#include <deque>
+
+namespace base {
+
+// Estimates the bandwidth of a link from the timing of the messages written to a NetworkChannel.
+// While messages wait in the write queue, the channel sends as fast as the link allows and the
+// drain rate of the queue is the bandwidth of the link. If the queue drains quickly while the
+// sender uses most of the estimate, the link is faster than the estimate and the estimate is
+// raised step by step.
+// If the peer acknowledges the messages, their latency is used too. The write queue of the channel
+// can be empty while the data waits in the buffers of the network. The latency grows in this case
+// and the estimate is lowered.
+class BandwidthEstimator
+{
+public:
+    using Clock = std::chrono::steady_clock;
+    using TimePoint = Clock::time_point;
+
+    BandwidthEstimator();
+    ~BandwidthEstimator();
+
+    // Must be called for each message sent to the channel, in the order of sending.
+    void onMessageSent(size_t size, TimePoint time = Clock::now());
+
+    // Must be called for each message written by the channel (see
+    // NetworkChannel::Listener::onMessageWritten).
+    void onMessageWritten(TimePoint time = Clock::now());
+
+    // Must be called when the peer acknowledges a message. |latency| is the time from sending the
+    // message to receiving the acknowledgement.
+    void onMessageAcknowledged(std::chrono::milliseconds latency, TimePoint time = Clock::now());
+
+    // Returns the current estimate in kilobits per second.
+    int bandwidthKbps() const { return bandwidth_kbps_; }
+
+    // Returns the number of bytes sent to the channel and not yet written.
+    int64_t pendingBytes() const { return pending_bytes_; }
+
+private:
+    void updateInterval(TimePoint time);
+
+    // Sizes of the messages in the write queue of the channel.
+    std::deque<size_t> pending_;
+    int64_t pending_bytes_ = 0;
+
+    // The bytes written since |sample_start_|. The write queue was not empty all this time.
+    TimePoint sample_start_;
+    int64_t sample_bytes_ = 0;
+
+    // The bytes sent since |interval_start_| and whether the link limited the sending.
+    TimePoint interval_start_;
+    int64_t interval_bytes_ = 0;
+    bool interval_limited_ = false;
+
+    // The lowest latency in the current and the previous period. Higher latency means that the
+    // messages wait in the buffers of the network.
+    TimePoint min_latency_start_;
+    std::chrono::milliseconds min_latency_;
+    std::chrono::milliseconds prev_min_latency_;
+    TimePoint last_decrease_;
+
+    int bandwidth_kbps_;
+
+    DISALLOW_COPY_AND_ASSIGN(BandwidthEstimator);
+};
+
+} // namespace base
+
+#endif // BASE__NET__BANDWIDTH_ESTIMATOR_H
@@ -0,0 +1,152 @@
+//
+// Aspia Project
+// Copyright (C) 2020 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "base/net/bandwidth_estimator.h"
+
+#include <gtest/gtest.h>
+
+namespace base {
+
+namespace {
+
+using TimePoint = BandwidthEstimator::TimePoint;
+using std::chrono::milliseconds;
+
+// Simulates a link with the given bandwidth. |frame_size| bytes are sent every |frame_interval|
+// and the link writes them one by one.
+TimePoint simulate(BandwidthEstimator* estimator,
+                   TimePoint time,
+                   int link_kbps,
+                   size_t frame_size,
+                   milliseconds frame_interval,
+                   int frame_count)
+{
+    // Time to write one frame at the speed of the link.
+    const milliseconds write_time(static_cast<int64_t>(frame_size) * 8 / link_kbps);
+
+    TimePoint link_free = time;
+
+    for (int i = 0; i < frame_count; ++i)
+    {
+        const TimePoint send_time = time + frame_interval * i;
+
+        // Complete the writes that have finished before the frame is sent.
+        while (estimator->pendingBytes() > 0 && link_free <= send_time)
+        {
+            estimator->onMessageWritten(link_free);
+            if (estimator->pendingBytes() > 0)
+                link_free += write_time;
+        }
+
+        if (estimator->pendingBytes() == 0)
+            link_free = send_time + write_time;
+
+        estimator->onMessageSent(frame_size, send_time);
+    }
+
+    while (estimator->pendingBytes() > 0)
+    {
+        estimator->onMessageWritten(link_free);
+        link_free += write_time;
+    }
+
+    return link_free;
+}
+
+} // namespace
+
+TEST(BandwidthEstimatorTest, InitialEstimate)
+{
+    BandwidthEstimator estimator;
+    EXPECT_EQ(estimator.bandwidthKbps(), 1000);
+    EXPECT_EQ(estimator.pendingBytes(), 0);
+}
+
+TEST(BandwidthEstimatorTest, SlowLink)
+{
+    BandwidthEstimator estimator;
+
+    // 50 KB frames every 33 ms need about 12 Mbit/s, the link has 500 kbit/s.
+    simulate(&estimator, TimePoint(), 500, 50000, milliseconds(33), 100);
+
+    EXPECT_GE(estimator.bandwidthKbps(), 450);
+    EXPECT_LE(estimator.bandwidthKbps(), 550);
+    EXPECT_EQ(estimator.pendingBytes(), 0);
+}
+
+TEST(BandwidthEstimatorTest, FastLink)
+{
+    BandwidthEstimator estimator;
+    TimePoint time;
+
+    // The sender follows the estimate and the link is much faster.
+    for (int i = 0; i < 30; ++i)
+    {
+        const size_t frame_size = static_cast<size_t>(estimator.bandwidthKbps()) * 1000 / 8 / 10;
+        time = simulate(&estimator, time, 1000000, frame_size, milliseconds(100), 10);
+    }
+
+    EXPECT_GT(estimator.bandwidthKbps(), 10000);
+}
+
+TEST(BandwidthEstimatorTest, IdleSenderKeepsEstimate)
+{
+    BandwidthEstimator estimator;
+
+    // Small messages on a fast link do not prove that the link is fast.
+    simulate(&estimator, TimePoint(), 1000000, 100, milliseconds(100), 100);
+
+    EXPECT_EQ(estimator.bandwidthKbps(), 1000);
+}
+
+TEST(BandwidthEstimatorTest, GrowingLatency)
+{
+    BandwidthEstimator estimator;
+    TimePoint time;
+
+    // The latency of the link is 50 ms.
+    for (int i = 0; i < 10; ++i)
+    {
+        time += milliseconds(100);
+        estimator.onMessageAcknowledged(milliseconds(50), time);
+    }
+
+    EXPECT_EQ(estimator.bandwidthKbps(), 1000);
+
+    // The messages wait in the network.
+    for (int i = 0; i < 10; ++i)
+    {
+        time += milliseconds(100);
+        estimator.onMessageAcknowledged(milliseconds(400), time);
+    }
+
+    // The estimate is lowered by 15% once per 500 ms.
+    EXPECT_EQ(estimator.bandwidthKbps(), 723);
+}
+
+TEST(BandwidthEstimatorTest, UnknownWrites)
+{
+    BandwidthEstimator estimator;
+
+    // Messages that were not sent through the estimator are ignored.
+    estimator.onMessageWritten();
+    EXPECT_EQ(estimator.pendingBytes(), 0);
+    EXPECT_EQ(estimator.bandwidthKbps(), 1000);
+}
+
+} // namespace base
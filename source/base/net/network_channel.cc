@@ -43,6 +43,46 @@ namespace {
 
 static const size_t kMaxMessageSize = 16 * 1024 * 1024; // 16 MB
 
+// Messages are added to a batched record while its size does not exceed this value. A message
+// that is larger itself is sent in a separate record.
+static const size_t kMaxBatchSize = 64 * 1024; // 64 kB
+
+// The number of the buffers of the written messages which are kept for reuse and their maximum
+// size. Larger buffers are freed, they are needed only for the first frame of the screen.
+static const size_t kMaxFreeBuffers = 4;
+static const size_t kMaxFreeBufferSize = 2 * 1024 * 1024; // 2 MB
+
+// Parses the variable size from the memory buffer. Returns std::nullopt if the buffer does not
+// contain the complete size. The number of bytes used by the size is stored in |length|.
+std::optional<size_t> parseVariableSize(const uint8_t* data, size_t size, size_t* length)
+{
+    size_t result = 0;
+
+    for (size_t i = 0; i < 4; ++i)
+    {
+        if (i >= size)
+            return std::nullopt;
+
+        if (i < 3)
+        {
+            result += static_cast<size_t>(data[i] & 0x7F) << (i * 7);
+
+            if (!(data[i] & 0x80))
+            {
+                *length = i + 1;
+                return result;
+            }
+        }
+        else
+        {
+            result += static_cast<size_t>(data[i]) << 21;
+        }
+    }
+
+    *length = 4;
+    return result;
+}
+
 int calculateSpeed(int last_speed, const std::chrono::milliseconds& duration, int64_t bytes)
 {
     static const double kAlpha = 0.1;
@@ -105,6 +145,11 @@ void NetworkChannel::setDecryptor(std::unique_ptr<MessageDecryptor> decryptor)
     decryptor_ = std::move(decryptor);
 }
 
+void NetworkChannel::setRecordBatching(bool enable)
+{
+    record_batching_ = enable;
+}
+
 std::u16string NetworkChannel::peerAddress() const
 {
     if (!socket_.is_open())
@@ -174,8 +219,14 @@ void NetworkChannel::resume()
 
     // If we have a message that was received before the pause command.
     if (state_ == ReadState::PENDING)
+    {
         onMessageReceived();
 
+        // The channel was paused again in the middle of a batched record.
+        if (paused_ && read_batch_pending_)
+            return;
+    }
+
     doReadSize();
 }
 
@@ -184,12 +235,22 @@ void NetworkChannel::send(ByteArray&& buffer)
     const bool schedule_write = write_queue_.empty();
 
     // Add the buffer to the queue for sending.
-    write_queue_.emplace(std::move(buffer));
+    write_queue_.emplace_back(std::move(buffer));
 
     if (schedule_write)
         doWrite();
 }
 
+ByteArray NetworkChannel::takeFreeBuffer()
+{
+    if (free_buffers_.empty())
+        return ByteArray();
+
+    ByteArray buffer = std::move(free_buffers_.back());
+    free_buffers_.pop_back();
+    return buffer;
+}
+
 bool NetworkChannel::setNoDelay(bool enable)
 {
     asio::ip::tcp::no_delay option(enable);
@@ -407,34 +468,148 @@ void NetworkChannel::onMessageWritten()
 
 void NetworkChannel::onMessageReceived()
 {
-    const size_t decrypt_buffer_size = decryptor_->decryptedDataSize(read_buffer_.size());
+    // If the delivery of a batched record was interrupted by pause(), then the record is already
+    // decrypted.
+    if (!read_batch_pending_)
+    {
+        const size_t decrypt_buffer_size = decryptor_->decryptedDataSize(read_buffer_.size());
 
-    if (decrypt_buffer_.capacity() < decrypt_buffer_size)
-        decrypt_buffer_.reserve(decrypt_buffer_size);
+        if (decrypt_buffer_.capacity() < decrypt_buffer_size)
+            decrypt_buffer_.reserve(decrypt_buffer_size);
+
+        decrypt_buffer_.resize(decrypt_buffer_size);
+
+        if (!decryptor_->decrypt(read_buffer_.data(), read_buffer_.size(), decrypt_buffer_.data()))
+        {
+            onErrorOccurred(FROM_HERE, asio::error::access_denied);
+            return;
+        }
 
-    decrypt_buffer_.resize(decrypt_buffer_size);
+        if (!record_batching_)
+        {
+            if (listener_)
+                listener_->onMessageReceived(decrypt_buffer_);
+            return;
+        }
 
-    if (!decryptor_->decrypt(read_buffer_.data(), read_buffer_.size(), decrypt_buffer_.data()))
+        read_batch_pos_ = 0;
+        read_batch_pending_ = true;
+    }
+
+    while (read_batch_pos_ < decrypt_buffer_.size())
     {
-        onErrorOccurred(FROM_HERE, asio::error::access_denied);
-        return;
+        const uint8_t* data = decrypt_buffer_.data() + read_batch_pos_;
+        const size_t size = decrypt_buffer_.size() - read_batch_pos_;
+
+        size_t length = 0;
+        std::optional<size_t> message_size = parseVariableSize(data, size, &length);
+
+        if (!message_size.has_value() || !message_size.value() ||
+            message_size.value() > size - length)
+        {
+            read_batch_pending_ = false;
+            onErrorOccurred(FROM_HERE, asio::error::message_size);
+            return;
+        }
+
+        read_batch_message_.assign(data + length, data + length + message_size.value());
+        read_batch_pos_ += length + message_size.value();
+
+        if (listener_)
+            listener_->onMessageReceived(read_batch_message_);
+
+        // The rest of the messages will be delivered after resume().
+        if (paused_ && read_batch_pos_ < decrypt_buffer_.size())
+            return;
     }
 
-    if (listener_)
-        listener_->onMessageReceived(decrypt_buffer_);
+    read_batch_pending_ = false;
+}
+
+size_t NetworkChannel::prepareWriteBatch()
+{
+    size_t count = 0;
+    size_t batch_size = 0;
+
+    for (const auto& message : write_queue_)
+    {
+        if (message.empty())
+            break;
+
+        const size_t size = batch_size +
+            variable_size_writer_.variableSize(message.size()).size() + message.size();
+
+        // The first message is always added.
+        if (count && size > kMaxBatchSize)
+            break;
+
+        batch_size = size;
+        ++count;
+    }
+
+    if (count < 2)
+        return count;
+
+    // Several messages are never larger than kMaxBatchSize together, so the buffer does not grow
+    // beyond it.
+    if (write_batch_buffer_.capacity() < kMaxBatchSize)
+        write_batch_buffer_.reserve(kMaxBatchSize);
+
+    write_batch_buffer_.clear();
+
+    for (size_t i = 0; i < count; ++i)
+    {
+        const ByteArray& message = write_queue_[i];
+
+        asio::const_buffer variable_size = variable_size_writer_.variableSize(message.size());
+        const uint8_t* size_data = reinterpret_cast<const uint8_t*>(variable_size.data());
+
+        write_batch_buffer_.insert(
+            write_batch_buffer_.end(), size_data, size_data + variable_size.size());
+        write_batch_buffer_.insert(write_batch_buffer_.end(), message.begin(), message.end());
+    }
+
+    return count;
 }
 
 void NetworkChannel::doWrite()
 {
-    const ByteArray& source_buffer = write_queue_.front();
-    if (source_buffer.empty())
+    const ByteArray* source = &write_queue_.front();
+    if (source->empty())
     {
         onErrorOccurred(FROM_HERE, asio::error::message_size);
         return;
     }
 
+    write_batch_count_ = 1;
+
+    // The size of a single message in a batched record.
+    uint8_t prefix[4];
+    size_t prefix_size = 0;
+
+    if (record_batching_)
+    {
+        write_batch_count_ = prepareWriteBatch();
+
+        if (write_batch_count_ > 1)
+        {
+            source = &write_batch_buffer_;
+        }
+        else
+        {
+            asio::const_buffer variable_size = variable_size_writer_.variableSize(source->size());
+            DCHECK_LE(variable_size.size(), sizeof(prefix));
+
+            prefix_size = variable_size.size();
+            memcpy(prefix, variable_size.data(), prefix_size);
+        }
+    }
+
+    const ByteArray& source_buffer = *source;
+
     // Calculate the size of the encrypted message.
-    const size_t target_data_size = encryptor_->encryptedDataSize(source_buffer.size());
+    const size_t target_data_size =
+        encryptor_->encryptedDataSize(prefix_size + source_buffer.size());
 
     if (target_data_size > kMaxMessageSize)
     {
@@ -458,7 +633,8 @@ void NetworkChannel::doWrite()
     memcpy(write_buffer_.data(), variable_size.data(), variable_size.size());
 
     // Encrypt the message.
-    if (!encryptor_->encrypt(source_buffer.data(),
+    if (!encryptor_->encrypt(prefix, prefix_size,
+                             source_buffer.data(),
                              source_buffer.size(),
                              write_buffer_.data() + variable_size.size()))
     {
@@ -475,6 +651,18 @@ void NetworkChannel::doWrite()
                                 std::placeholders::_2));
 }
 
+void NetworkChannel::releaseBuffer(ByteArray&& buffer)
+{
+    if (free_buffers_.size() >= kMaxFreeBuffers || buffer.capacity() > kMaxFreeBufferSize)
+        return;
+
+    if (free_buffers_.capacity() < kMaxFreeBuffers)
+        free_buffers_.reserve(kMaxFreeBuffers);
+
+    buffer.clear();
+    free_buffers_.emplace_back(std::move(buffer));
+}
+
 void NetworkChannel::onWrite(const std::error_code& error_code, size_t bytes_transferred)
 {
     if (error_code)
@@ -489,8 +677,17 @@ void NetworkChannel::onWrite(const std::error_code& error_code, size_t bytes_tra
     bytes_tx_ += bytes_transferred;
     total_tx_ += bytes_transferred;
 
-    // Delete the sent message from the queue.
-    write_queue_.pop();
+    DCHECK_GE(write_queue_.size(), write_batch_count_);
+
+    // Delete the sent messages from the queue. The listener is notified about each message.
+    for (size_t i = 0; i < write_batch_count_; ++i)
+    {
+        releaseBuffer(std::move(write_queue_.front()));
+        write_queue_.pop_front();
+
+        if (i + 1 < write_batch_count_)
+            onMessageWritten();
+    }
 
     // If the queue is not empty, then we send the following message.
     bool schedule_write = !write_queue_.empty() || proxy_->reloadWriteQueue(&write_queue_);
@@ -576,7 +773,7 @@ void NetworkChannel::onReadContent(const std::error_code& error_code, size_t byt
 
     if (paused_)
     {
-        state_ = ReadState::IDLE;
+        state_ = read_batch_pending_ ? ReadState::PENDING : ReadState::IDLE;
         return;
     }
 
@@ -24,7 +24,7 @@
 
 #include <asio/ip/tcp.hpp>
 
-#include <queue>
+#include <deque>
 
 namespace base {
 
@@ -97,6 +97,12 @@ public:
     void setEncryptor(std::unique_ptr<MessageEncryptor> encryptor);
     void setDecryptor(std::unique_ptr<MessageDecryptor> decryptor);
 
+    // Enables or disables sealing of several small queued messages into one encrypted record.
+    // This amortizes the per-record encryption cost for small messages. Both sides of the
+    // connection must switch the mode at the same point of the message stream (the authenticator
+    // does this together with the session key).
+    void setRecordBatching(bool enable);
+
     // Gets the address of the remote host as a string.
     std::u16string peerAddress() const;
 
@@ -122,6 +128,11 @@ public:
     // to the queue to be sent.
     void send(ByteArray&& buffer);
 
+    // Returns an empty buffer for the next message. The buffers of the written messages are
+    // reused, so sending messages of similar sizes does not allocate memory. Must be called on
+    // the thread of the channel.
+    ByteArray takeFreeBuffer();
+
     // Disable or enable the algorithm of Nagle.
     bool setNoDelay(bool enable);
 
@@ -166,7 +177,13 @@ private:
     void onMessageWritten();
     void onMessageReceived();
 
+    // Returns the number of messages from the write queue for the next record. If there are
+    // several, they are copied into |write_batch_buffer_|. A single message is encrypted directly
+    // from the queue.
+    size_t prepareWriteBatch();
+
     void doWrite();
+    void releaseBuffer(ByteArray&& buffer);
     void onWrite(const std::error_code& error_code, size_t bytes_transferred);
 
     void doReadSize();
@@ -185,10 +202,17 @@ private:
     std::unique_ptr<MessageEncryptor> encryptor_;
     std::unique_ptr<MessageDecryptor> decryptor_;
 
-    std::queue<ByteArray> write_queue_;
+    std::deque<ByteArray> write_queue_;
     VariableSizeWriter variable_size_writer_;
     ByteArray write_buffer_;
 
+    // The buffers of the written messages for takeFreeBuffer().
+    std::vector<ByteArray> free_buffers_;
+
+    bool record_batching_ = false;
+    ByteArray write_batch_buffer_;
+    size_t write_batch_count_ = 0; // Number of messages in the record being written.
+
     enum class ReadState
     {
         IDLE,         // No reads are in progress right now.
@@ -202,6 +226,13 @@ private:
     ByteArray read_buffer_;
     ByteArray decrypt_buffer_;
 
+    // Position of the next undelivered message in |decrypt_buffer_| if it contains a batched
+    // record. If the channel is paused in the middle of the record, the rest of the messages are
+    // delivered after resume().
+    size_t read_batch_pos_ = 0;
+    bool read_batch_pending_ = false;
+    ByteArray read_batch_message_;
+
     using Clock = std::chrono::high_resolution_clock;
     using TimePoint = std::chrono::time_point<Clock>;
 
@@ -0,0 +1,347 @@
+//
+// Aspia Project
+// Copyright (C) 2020 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "base/net/network_channel.h"
+
+#include "base/message_loop/message_loop.h"
+#include "base/net/network_server.h"
+#include "base/net/variable_size.h"
+
+#include <gtest/gtest.h>
+
+#include <functional>
+
+namespace base {
+
+namespace {
+
+const std::chrono::seconds kTimeout(10);
+
+// The messages are smaller than the batched record, the large message is larger.
+const size_t kSmallMessageSize = 100;
+const size_t kLargeMessageSize = 100 * 1024;
+
+ByteArray makeMessage(size_t size, uint8_t seed)
+{
+    ByteArray message(size);
+
+    for (size_t i = 0; i < size; ++i)
+        message[i] = static_cast<uint8_t>(seed + i);
+
+    return message;
+}
+
+// Returns the contents of a batched record with |messages|.
+ByteArray makeRecord(const std::vector<ByteArray>& messages)
+{
+    VariableSizeWriter writer;
+    ByteArray record;
+
+    for (const auto& message : messages)
+    {
+        asio::const_buffer size = writer.variableSize(message.size());
+        const uint8_t* size_data = reinterpret_cast<const uint8_t*>(size.data());
+
+        record.insert(record.end(), size_data, size_data + size.size());
+        record.insert(record.end(), message.begin(), message.end());
+    }
+
+    return record;
+}
+
+class Peer : public NetworkChannel::Listener
+{
+public:
+    explicit Peer(std::function<void()> on_event)
+        : on_event_(std::move(on_event))
+    {
+        // Nothing
+    }
+
+    // NetworkChannel::Listener implementation.
+    void onConnected() override
+    {
+        connected = true;
+        on_event_();
+    }
+
+    void onDisconnected(NetworkChannel::ErrorCode /* error_code */) override
+    {
+        disconnected = true;
+        on_event_();
+    }
+
+    void onMessageReceived(const ByteArray& buffer) override
+    {
+        received.push_back(buffer);
+
+        if (on_received)
+            on_received();
+
+        on_event_();
+    }
+
+    void onMessageWritten(size_t pending) override
+    {
+        written.push_back(pending);
+        on_event_();
+    }
+
+    bool connected = false;
+    bool disconnected = false;
+    std::vector<ByteArray> received;
+    std::vector<size_t> written;
+    std::function<void()> on_received;
+
+private:
+    std::function<void()> on_event_;
+};
+
+class NetworkChannelTest
+    : public testing::Test,
+      public NetworkServer::Delegate
+{
+protected:
+    NetworkChannelTest()
+        : message_loop_(MessageLoop::Type::ASIO),
+          task_runner_(message_loop_.taskRunner()),
+          client_peer_(std::bind(&NetworkChannelTest::onEvent, this)),
+          host_peer_(std::bind(&NetworkChannelTest::onEvent, this))
+    {
+        // Nothing
+    }
+
+    ~NetworkChannelTest() override
+    {
+        client_.reset();
+        host_.reset();
+        server_.reset();
+    }
+
+    // Connects a client channel to a host channel over loopback.
+    void connect(bool client_batching, bool host_batching)
+    {
+        server_ = std::make_unique<NetworkServer>();
+        server_->start(0, this);
+
+        client_ = std::make_unique<NetworkChannel>();
+        client_->setListener(&client_peer_);
+        client_->connect(u"127.0.0.1", server_->port());
+
+        ASSERT_TRUE(runUntil([this]() { return client_peer_.connected && host_ != nullptr; }));
+
+        client_->setRecordBatching(client_batching);
+        host_->setRecordBatching(host_batching);
+
+        client_->resume();
+        host_->resume();
+    }
+
+    // Runs the message loop until |done| returns true. Returns false on timeout.
+    bool runUntil(std::function<bool()> done)
+    {
+        if (done())
+            return true;
+
+        done_ = std::move(done);
+        timed_out_ = false;
+
+        const int generation = ++generation_;
+
+        task_runner_->postDelayedTask([this, generation]()
+        {
+            if (generation != generation_)
+                return;
+
+            timed_out_ = true;
+            done_ = nullptr;
+            task_runner_->postQuit();
+        }, kTimeout);
+
+        message_loop_.run();
+        ++generation_;
+
+        return !timed_out_;
+    }
+
+    void onEvent()
+    {
+        if (done_ && done_())
+        {
+            done_ = nullptr;
+            task_runner_->postQuit();
+        }
+    }
+
+    // NetworkServer::Delegate implementation.
+    void onNewConnection(std::unique_ptr<NetworkChannel> channel) override
+    {
+        host_ = std::move(channel);
+        host_->setListener(&host_peer_);
+        onEvent();
+    }
+
+    MessageLoop message_loop_;
+    std::shared_ptr<TaskRunner> task_runner_;
+
+    Peer client_peer_;
+    Peer host_peer_;
+
+    std::unique_ptr<NetworkServer> server_;
+    std::unique_ptr<NetworkChannel> client_;
+    std::unique_ptr<NetworkChannel> host_;
+
+private:
+    std::function<bool()> done_;
+    bool timed_out_ = false;
+    int generation_ = 0;
+};
+
+} // namespace
+
+TEST_F(NetworkChannelTest, BatchedMessagesArriveInOrder)
+{
+    connect(true, true);
+
+    std::vector<ByteArray> messages;
+    for (int i = 0; i < 10; ++i)
+        messages.emplace_back(makeMessage(kSmallMessageSize + i, static_cast<uint8_t>(i)));
+
+    for (const auto& message : messages)
+        client_->send(ByteArray(message));
+
+    ASSERT_TRUE(runUntil([&]()
+    {
+        return host_peer_.received.size() == messages.size() &&
+               client_peer_.written.size() == messages.size();
+    }));
+
+    EXPECT_EQ(host_peer_.received, messages);
+
+    // One notification for each message, the last one with an empty queue.
+    EXPECT_EQ(client_peer_.written.back(), 0u);
+}
+
+TEST_F(NetworkChannelTest, QueuedMessagesShareOneRecord)
+{
+    // The host does not unpack the records, so it receives them as they were sent.
+    connect(true, false);
+
+    std::vector<ByteArray> messages;
+    for (int i = 0; i < 10; ++i)
+        messages.emplace_back(makeMessage(kSmallMessageSize, static_cast<uint8_t>(i)));
+
+    for (const auto& message : messages)
+        client_->send(ByteArray(message));
+
+    ASSERT_TRUE(runUntil([&]()
+    {
+        return host_peer_.received.size() == 2 &&
+               client_peer_.written.size() == messages.size();
+    }));
+
+    // The first message is written while the others are queued. They follow in one record.
+    EXPECT_EQ(host_peer_.received[0], makeRecord({ messages[0] }));
+    EXPECT_EQ(host_peer_.received[1],
+              makeRecord(std::vector<ByteArray>(messages.begin() + 1, messages.end())));
+}
+
+TEST_F(NetworkChannelTest, LargeMessageIsSentAlone)
+{
+    connect(true, false);
+
+    std::vector<ByteArray> messages =
+    {
+        makeMessage(kSmallMessageSize, 1),
+        makeMessage(kSmallMessageSize, 2),
+        makeMessage(kLargeMessageSize, 3),
+        makeMessage(kSmallMessageSize, 4)
+    };
+
+    for (const auto& message : messages)
+        client_->send(ByteArray(message));
+
+    ASSERT_TRUE(runUntil([&]()
+    {
+        return host_peer_.received.size() == messages.size() &&
+               client_peer_.written.size() == messages.size();
+    }));
+
+    for (size_t i = 0; i < messages.size(); ++i)
+        EXPECT_EQ(host_peer_.received[i], makeRecord({ messages[i] })) << "message " << i;
+}
+
+TEST_F(NetworkChannelTest, PauseInsideBatch)
+{
+    connect(true, true);
+
+    std::vector<ByteArray> messages;
+    for (int i = 0; i < 6; ++i)
+        messages.emplace_back(makeMessage(kSmallMessageSize, static_cast<uint8_t>(i)));
+
+    size_t received_while_paused = 0;
+
+    // The messages from the second to the last are in one record. Pause after the third one.
+    host_peer_.on_received = [&]()
+    {
+        if (host_peer_.received.size() != 3)
+            return;
+
+        host_->pause();
+
+        task_runner_->postDelayedTask([&]()
+        {
+            received_while_paused = host_peer_.received.size();
+            host_->resume();
+        }, std::chrono::milliseconds(100));
+    };
+
+    for (const auto& message : messages)
+        client_->send(ByteArray(message));
+
+    ASSERT_TRUE(runUntil([&]() { return host_peer_.received.size() == messages.size(); }));
+
+    EXPECT_EQ(received_while_paused, 3u);
+    EXPECT_EQ(host_peer_.received, messages);
+}
+
+TEST_F(NetworkChannelTest, ZeroInnerSize)
+{
+    // The client sends raw records with a broken inner size.
+    connect(false, true);
+
+    client_->send(ByteArray({ 0x00, 0x01, 0x02 }));
+
+    ASSERT_TRUE(runUntil([this]() { return host_peer_.disconnected; }));
+    EXPECT_TRUE(host_peer_.received.empty());
+}
+
+TEST_F(NetworkChannelTest, InnerSizePastEnd)
+{
+    connect(false, true);
+
+    client_->send(ByteArray({ 0x01, 0x01, 0x03, 0x01, 0x02 }));
+
+    ASSERT_TRUE(runUntil([this]() { return host_peer_.disconnected; }));
+
+    // The first message is complete and is delivered.
+    ASSERT_EQ(host_peer_.received.size(), 1u);
+    EXPECT_EQ(host_peer_.received[0], ByteArray({ 0x01 }));
+}
+
+} // namespace base
@@ -69,6 +69,9 @@ void NetworkServer::Impl::start(uint16_t port, Delegate* delegate)
     asio::ip::tcp::endpoint endpoint(asio::ip::tcp::v4(), port);
     acceptor_ = std::make_unique<asio::ip::tcp::acceptor>(io_context_, endpoint);
 
+    // Port 0 selects a free port.
+    port_ = acceptor_->local_endpoint().port();
+
     doAccept();
 }
 
@@ -42,6 +42,7 @@ public:
         virtual void onNewConnection(std::unique_ptr<NetworkChannel> channel) = 0;
     };
 
+    // If |port| is 0, the server listens on a free port which is returned by port().
     void start(uint16_t port, Delegate* delegate);
     void stop();
     uint16_t port() const;
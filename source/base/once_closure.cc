@@ -0,0 +1,73 @@
+//
+// Aspia Project
+// Copyright (C) 2020 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "base/once_closure.h"
+
+#include "base/logging.h"
+
+namespace base {
+
+OnceClosure::OnceClosure(OnceClosure&& other) noexcept
+{
+    if (!other.ops_)
+        return;
+
+    other.ops_->move(other.storage_, storage_);
+    ops_ = other.ops_;
+    other.ops_ = nullptr;
+}
+
+OnceClosure& OnceClosure::operator=(OnceClosure&& other) noexcept
+{
+    if (&other == this)
+        return *this;
+
+    reset();
+
+    if (other.ops_)
+    {
+        other.ops_->move(other.storage_, storage_);
+        ops_ = other.ops_;
+        other.ops_ = nullptr;
+    }
+
+    return *this;
+}
+
+OnceClosure::~OnceClosure()
+{
+    reset();
+}
+
+void OnceClosure::operator()()
+{
+    DCHECK(ops_);
+    ops_->invoke(storage_);
+}
+
+void OnceClosure::reset()
+{
+    if (!ops_)
+        return;
+
+    const Ops* ops = ops_;
+    ops_ = nullptr;
+    ops->destroy(storage_);
+}
+
+} // namespace base
@@ -0,0 +1,145 @@
+//
+// Aspia Project
+// Copyright (C) 2020 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#ifndef BASE__ONCE_CLOSURE_H
+#define BASE__ONCE_CLOSURE_H
+
+#include <cstddef>
+#include <functional>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace base {
+
+// Move-only replacement of std::function<void()> for posted tasks.
+// Callables up to kInlineSize bytes (a member function pointer, a shared_ptr and a couple of
+// arguments bound with std::bind) are stored inside the object without heap allocation. Larger
+// callables are allocated on the heap. Copyable callables (including std::function) are converted
+// implicitly, so existing code that passes std::bind results keeps working.
+class OnceClosure
+{
+public:
+    static constexpr size_t kInlineSize = 56;
+
+    OnceClosure() = default;
+    OnceClosure(std::nullptr_t) { /* Nothing */ }
+
+    template <class Functor,
+              class = std::enable_if_t<!std::is_same_v<std::decay_t<Functor>, OnceClosure> &&
+                                       std::is_invocable_v<std::decay_t<Functor>&>>>
+    OnceClosure(Functor&& functor)
+    {
+        using Type = std::decay_t<Functor>;
+
+        if constexpr (std::is_pointer_v<Type> || std::is_same_v<Type, std::function<void()>>)
+        {
+            // Null pointers and empty std::function objects produce an empty closure.
+            if (!functor)
+                return;
+        }
+
+        if constexpr (isInline<Type>())
+        {
+            new (storage_) Type(std::forward<Functor>(functor));
+            ops_ = &kInlineOps<Type>;
+        }
+        else
+        {
+            *reinterpret_cast<Type**>(storage_) = new Type(std::forward<Functor>(functor));
+            ops_ = &kHeapOps<Type>;
+        }
+    }
+
+    OnceClosure(OnceClosure&& other) noexcept;
+    OnceClosure& operator=(OnceClosure&& other) noexcept;
+    ~OnceClosure();
+
+    // Runs the stored callable. The closure must not be empty.
+    void operator()();
+
+    // Destroys the stored callable.
+    void reset();
+
+    bool isNull() const { return ops_ == nullptr; }
+    explicit operator bool() const { return ops_ != nullptr; }
+
+    bool operator==(std::nullptr_t) const { return ops_ == nullptr; }
+    bool operator!=(std::nullptr_t) const { return ops_ != nullptr; }
+
+    // Returns true if the callable is stored without heap allocation.
+    bool isInline() const { return ops_ && ops_->is_inline; }
+
+private:
+    struct Ops
+    {
+        void (*invoke)(void* storage);
+        void (*move)(void* from, void* to);
+        void (*destroy)(void* storage);
+        bool is_inline;
+    };
+
+    template <class Type>
+    static constexpr bool isInline()
+    {
+        return sizeof(Type) <= kInlineSize &&
+               alignof(Type) <= alignof(std::max_align_t) &&
+               std::is_nothrow_move_constructible_v<Type>;
+    }
+
+    template <class Type>
+    static void invokeInline(void* storage) { (*reinterpret_cast<Type*>(storage))(); }
+
+    template <class Type>
+    static void moveInline(void* from, void* to)
+    {
+        Type* source = reinterpret_cast<Type*>(from);
+        new (to) Type(std::move(*source));
+        source->~Type();
+    }
+
+    template <class Type>
+    static void destroyInline(void* storage) { reinterpret_cast<Type*>(storage)->~Type(); }
+
+    template <class Type>
+    static void invokeHeap(void* storage) { (**reinterpret_cast<Type**>(storage))(); }
+
+    template <class Type>
+    static void moveHeap(void* from, void* to)
+    {
+        *reinterpret_cast<Type**>(to) = *reinterpret_cast<Type**>(from);
+    }
+
+    template <class Type>
+    static void destroyHeap(void* storage) { delete *reinterpret_cast<Type**>(storage); }
+
+    template <class Type>
+    static constexpr Ops kInlineOps =
+        { &invokeInline<Type>, &moveInline<Type>, &destroyInline<Type>, true };
+
+    template <class Type>
+    static constexpr Ops kHeapOps =
+        { &invokeHeap<Type>, &moveHeap<Type>, &destroyHeap<Type>, false };
+
+    alignas(std::max_align_t) unsigned char storage_[kInlineSize];
+    const Ops* ops_ = nullptr;
+};
+
+} // namespace base
+
+#endif // BASE__ONCE_CLOSURE_H
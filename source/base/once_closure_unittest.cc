@@ -0,0 +1,148 @@
+//
+// Aspia Project
+// Copyright (C) 2020 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "base/once_closure.h"
+
+#include <gtest/gtest.h>
+
+#include <array>
+#include <memory>
+
+namespace base {
+
+namespace {
+
+class Counter
+{
+public:
+    void add(int value) { count_ += value; }
+    int count() const { return count_; }
+
+private:
+    int count_ = 0;
+};
+
+void increment(int* value)
+{
+    ++*value;
+}
+
+} // namespace
+
+TEST(OnceClosureTest, Empty)
+{
+    OnceClosure closure;
+    EXPECT_TRUE(closure.isNull());
+    EXPECT_TRUE(closure == nullptr);
+    EXPECT_FALSE(closure);
+
+    std::function<void()> empty_function;
+    OnceClosure from_empty_function(empty_function);
+    EXPECT_TRUE(from_empty_function.isNull());
+
+    void (*null_pointer)() = nullptr;
+    OnceClosure from_null_pointer(null_pointer);
+    EXPECT_TRUE(from_null_pointer.isNull());
+}
+
+TEST(OnceClosureTest, Inline)
+{
+    std::shared_ptr<Counter> counter = std::make_shared<Counter>();
+
+    OnceClosure closure(std::bind(&Counter::add, counter, 5));
+    EXPECT_TRUE(closure != nullptr);
+    EXPECT_TRUE(closure.isInline());
+
+    closure();
+    EXPECT_EQ(counter->count(), 5);
+
+    int value = 0;
+    OnceClosure function_closure(std::bind(&increment, &value));
+    EXPECT_TRUE(function_closure.isInline());
+
+    function_closure();
+    EXPECT_EQ(value, 1);
+
+    std::function<void()> function = std::bind(&increment, &value);
+    OnceClosure from_function(function);
+    EXPECT_TRUE(from_function.isInline());
+
+    from_function();
+    EXPECT_EQ(value, 2);
+}
+
+TEST(OnceClosureTest, Heap)
+{
+    int sum = 0;
+    std::array<int, 32> values;
+    values.fill(1);
+
+    OnceClosure closure([&sum, values]()
+    {
+        for (int value : values)
+            sum += value;
+    });
+    EXPECT_FALSE(closure.isInline());
+
+    OnceClosure moved(std::move(closure));
+    EXPECT_TRUE(closure.isNull());
+
+    moved();
+    EXPECT_EQ(sum, 32);
+}
+
+TEST(OnceClosureTest, MoveOnly)
+{
+    int result = 0;
+    std::unique_ptr<int> value = std::make_unique<int>(7);
+
+    OnceClosure closure([&result, value = std::move(value)]() { result = *value; });
+    EXPECT_TRUE(closure.isInline());
+
+    OnceClosure other;
+    other = std::move(closure);
+    EXPECT_TRUE(closure.isNull());
+    EXPECT_FALSE(other.isNull());
+
+    other();
+    EXPECT_EQ(result, 7);
+}
+
+TEST(OnceClosureTest, Destroy)
+{
+    std::shared_ptr<Counter> counter = std::make_shared<Counter>();
+
+    {
+        OnceClosure closure(std::bind(&Counter::add, counter, 1));
+        EXPECT_EQ(counter.use_count(), 2);
+
+        OnceClosure other(std::move(closure));
+        EXPECT_EQ(counter.use_count(), 2);
+
+        other.reset();
+        EXPECT_EQ(counter.use_count(), 1);
+
+        other = std::bind(&Counter::add, counter, 1);
+        EXPECT_EQ(counter.use_count(), 2);
+    }
+
+    EXPECT_EQ(counter.use_count(), 1);
+    EXPECT_EQ(counter->count(), 0);
+}
+
+} // namespace base
@@ -66,6 +66,12 @@ void Authenticator::start(std::unique_ptr<NetworkChannel> channel, Callback call
         channel_->resume();
 }
 
+void Authenticator::setRecordBatchingAllowed(bool allowed)
+{
+    DCHECK_EQ(state(), State::STOPPED);
+    record_batching_allowed_ = allowed;
+}
+
 std::unique_ptr<NetworkChannel> Authenticator::takeChannel()
 {
     if (state() != State::SUCCESS)
@@ -225,7 +231,21 @@ bool Authenticator::onSessionKeyChanged()
 
     channel_->setEncryptor(std::move(encryptor));
     channel_->setDecryptor(std::move(decryptor));
+
+    // The peers change the session key at the same point of the message stream, so the record
+    // format is switched here too.
+    channel_->setRecordBatching(channel_features_ & proto::CHANNEL_FEATURE_RECORD_BATCHING);
     return true;
 }
 
+uint32_t Authenticator::supportedChannelFeatures() const
+{
+    uint32_t features = proto::CHANNEL_FEATURE_NONE;
+
+    if (record_batching_allowed_)
+        features |= proto::CHANNEL_FEATURE_RECORD_BATCHING;
+
+    return features;
+}
+
 } // namespace base
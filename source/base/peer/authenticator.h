@@ -56,8 +56,13 @@ public:
 
     void start(std::unique_ptr<NetworkChannel> channel, Callback callback);
 
+    // Allows sealing of several small messages into one encrypted record if the peer supports
+    // it. Enabled by default. Must be called before start().
+    void setRecordBatchingAllowed(bool allowed);
+
     [[nodiscard]] proto::Identify identify() const { return identify_; }
     [[nodiscard]] proto::Encryption encryption() const { return encryption_; }
+    [[nodiscard]] uint32_t channelFeatures() const { return channel_features_; }
     [[nodiscard]] const Version& peerVersion() const { return peer_version_; }
     [[nodiscard]] const std::u16string& peerOsName() const { return peer_os_name_; }
     [[nodiscard]] const std::u16string& peerComputerName() const { return peer_computer_name_; }
@@ -92,7 +97,11 @@ protected:
 
     [[nodiscard]] bool onSessionKeyChanged();
 
+    // Returns a bitmask of channel features (proto::ChannelFeature) supported by this side.
+    [[nodiscard]] uint32_t supportedChannelFeatures() const;
+
     proto::Encryption encryption_ = proto::ENCRYPTION_UNKNOWN;
+    uint32_t channel_features_ = proto::CHANNEL_FEATURE_NONE; // Negotiated channel features.
     proto::Identify identify_ = proto::IDENTIFY_SRP;
     ByteArray session_key_;
     ByteArray encrypt_iv_;
@@ -109,6 +118,7 @@ private:
     Version peer_version_; // Remote peer version.
     std::u16string peer_os_name_;
     std::u16string peer_computer_name_;
+    bool record_batching_allowed_ = true;
 };
 
 } // namespace base
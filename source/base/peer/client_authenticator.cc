@@ -215,11 +215,14 @@ void ClientAuthenticator::sendClientHello()
 
     uint32_t encryption = proto::ENCRYPTION_CHACHA20_POLY1305;
 
-    if (CpuidUtil::hasAesNi())
+    // AES GCM is faster than ChaCha20 Poly1305 only if both AES rounds and GHASH (carry-less
+    // multiplication) are accelerated by the processor.
+    if (CpuidUtil::hasAesNi() && CpuidUtil::hasPclmulqdq())
         encryption |= proto::ENCRYPTION_AES256_GCM;
 
     client_hello.set_encryption(encryption);
     client_hello.set_identify(identify_);
+    client_hello.set_features(supportedChannelFeatures());
 
     if (!peer_public_key_.empty())
     {
@@ -291,6 +294,11 @@ bool ClientAuthenticator::readServerHello(const ByteArray& buffer)
             return false;
     }
 
+    // The server can accept only the features offered by the client.
+    channel_features_ = server_hello.features() & supportedChannelFeatures();
+
+    LOG(LS_INFO) << "Channel features: " << channel_features_;
+
     decrypt_iv_ = fromStdString(server_hello.iv());
 
     if (session_key_.empty() != decrypt_iv_.empty())
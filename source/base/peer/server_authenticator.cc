@@ -321,7 +321,8 @@ void ServerAuthenticator::onClientHello(const ByteArray& buffer)
         }
     }
 
-    if ((client_hello.encryption() & proto::ENCRYPTION_AES256_GCM) && CpuidUtil::hasAesNi())
+    if ((client_hello.encryption() & proto::ENCRYPTION_AES256_GCM) &&
+        CpuidUtil::hasAesNi() && CpuidUtil::hasPclmulqdq())
     {
         LOG(LS_INFO) << "Both sides have hardware support AES. Using AES256 GCM";
         // If both sides of the connection support AES, then method AES256 GCM is the fastest option.
@@ -335,6 +336,11 @@ void ServerAuthenticator::onClientHello(const ByteArray& buffer)
         server_hello.set_encryption(proto::ENCRYPTION_CHACHA20_POLY1305);
     }
 
+    channel_features_ = client_hello.features() & supportedChannelFeatures();
+    server_hello.set_features(channel_features_);
+
+    LOG(LS_INFO) << "Channel features: " << channel_features_;
+
     // Now we are in the authentication phase.
     internal_state_ = InternalState::SEND_SERVER_HELLO;
     encryption_ = server_hello.encryption();
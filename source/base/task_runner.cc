@@ -34,11 +34,24 @@ public:
         // Nothing
     }
 
+    DeleteHelper(DeleteHelper&& other) noexcept
+        : deleter_(other.deleter_),
+          object_(other.object_)
+    {
+        other.deleter_ = nullptr;
+        other.object_ = nullptr;
+    }
+
     ~DeleteHelper()
     {
         doDelete();
     }
 
+    void operator()()
+    {
+        doDelete();
+    }
+
     void doDelete()
     {
         if (deleter_ && object_)
@@ -59,10 +72,13 @@ private:
 
 } // namespace
 
-void TaskRunner::deleteSoonInternal(void(*deleter)(const void*), const void* object)
+void TaskRunner::deleteSoonInternal(void(*deleter)(const void*),
+                                    const void* object,
+                                    const Location& from_here)
 {
-    postNonNestableTask(
-        std::bind(&DeleteHelper::doDelete, std::make_shared<DeleteHelper>(deleter, object)));
+    // The helper is stored inside the task. If the task is never run, the object is deleted
+    // together with the task.
+    postNonNestableTask(DeleteHelper(deleter, object), from_here);
 }
 
 } // namespace base
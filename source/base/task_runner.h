@@ -19,8 +19,10 @@
 #ifndef BASE__TASK_RUNNER_H
 #define BASE__TASK_RUNNER_H
 
+#include "base/location.h"
+#include "base/once_closure.h"
+
 #include <chrono>
-#include <functional>
 #include <memory>
 
 namespace base {
@@ -30,14 +32,37 @@ class TaskRunner : public std::enable_shared_from_this<TaskRunner>
 public:
     virtual ~TaskRunner() = default;
 
-    using Callback = std::function<void()>;
+    using Callback = OnceClosure;
     using Milliseconds = std::chrono::milliseconds;
 
     virtual bool belongsToCurrentThread() const = 0;
-    virtual void postTask(Callback task) = 0;
-    virtual void postDelayedTask(Callback callback, const Milliseconds& delay) = 0;
-    virtual void postNonNestableTask(Callback callback) = 0;
-    virtual void postNonNestableDelayedTask(Callback callback, const Milliseconds& delay) = 0;
+
+    // |from_here| is the location of the call. It is filled in automatically and is used to tag
+    // task statistics (see MessageLoopProfiler).
+    void postTask(Callback callback, const Location& from_here = Location::current())
+    {
+        postTaskImpl(std::move(callback), from_here);
+    }
+
+    void postDelayedTask(Callback callback,
+                         const Milliseconds& delay,
+                         const Location& from_here = Location::current())
+    {
+        postDelayedTaskImpl(std::move(callback), delay, from_here);
+    }
+
+    void postNonNestableTask(Callback callback, const Location& from_here = Location::current())
+    {
+        postNonNestableTaskImpl(std::move(callback), from_here);
+    }
+
+    void postNonNestableDelayedTask(Callback callback,
+                                    const Milliseconds& delay,
+                                    const Location& from_here = Location::current())
+    {
+        postNonNestableDelayedTaskImpl(std::move(callback), delay, from_here);
+    }
+
     virtual void postQuit() = 0;
 
     template <class T>
@@ -47,19 +72,31 @@ public:
     }
 
     template <class T>
-    void deleteSoon(const T* object)
+    void deleteSoon(const T* object, const Location& from_here = Location::current())
     {
-        deleteSoonInternal(&TaskRunner::doDelete<T>, object);
+        deleteSoonInternal(&TaskRunner::doDelete<T>, object, from_here);
     }
 
     template <class T>
-    void deleteSoon(std::unique_ptr<T> object)
+    void deleteSoon(std::unique_ptr<T> object, const Location& from_here = Location::current())
     {
-        deleteSoon(object.release());
+        deleteSoon(object.release(), from_here);
     }
 
+protected:
+    virtual void postTaskImpl(Callback callback, const Location& from_here) = 0;
+    virtual void postDelayedTaskImpl(Callback callback,
+                                     const Milliseconds& delay,
+                                     const Location& from_here) = 0;
+    virtual void postNonNestableTaskImpl(Callback callback, const Location& from_here) = 0;
+    virtual void postNonNestableDelayedTaskImpl(Callback callback,
+                                                const Milliseconds& delay,
+                                                const Location& from_here) = 0;
+
 private:
-    void deleteSoonInternal(void(*deleter)(const void*), const void* object);
+    void deleteSoonInternal(void(*deleter)(const void*),
+                            const void* object,
+                            const Location& from_here);
 };
 
 } // namespace base
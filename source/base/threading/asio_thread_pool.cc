@@ -0,0 +1,86 @@
+//
+// Aspia Project
+// Copyright (C) 2020 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "base/threading/asio_thread_pool.h"
+
+#include "base/logging.h"
+#include "base/threading/strand_task_runner.h"
+
+#include <algorithm>
+
+namespace base {
+
+namespace {
+
+size_t threadCountOrDefault(size_t thread_count)
+{
+    if (thread_count)
+        return thread_count;
+
+    return std::max(std::thread::hardware_concurrency(), 1U);
+}
+
+} // namespace
+
+AsioThreadPool::AsioThreadPool(size_t thread_count)
+    : io_context_(static_cast<int>(threadCountOrDefault(thread_count))),
+      work_guard_(asio::make_work_guard(io_context_))
+{
+    thread_count = threadCountOrDefault(thread_count);
+
+    LOG(LS_INFO) << "Starting I/O thread pool with " << thread_count << " threads";
+
+    threads_.reserve(thread_count);
+
+    for (size_t i = 0; i < thread_count; ++i)
+        threads_.emplace_back([this]() { io_context_.run(); });
+}
+
+AsioThreadPool::~AsioThreadPool()
+{
+    stop();
+}
+
+void AsioThreadPool::stop()
+{
+    if (threads_.empty())
+        return;
+
+    work_guard_.reset();
+    io_context_.stop();
+
+    for (auto& thread : threads_)
+    {
+        DCHECK_NE(thread.get_id(), std::this_thread::get_id());
+        thread.join();
+    }
+
+    threads_.clear();
+}
+
+AsioThreadPool::Strand AsioThreadPool::createStrand()
+{
+    return asio::make_strand(io_context_);
+}
+
+std::shared_ptr<TaskRunner> AsioThreadPool::createTaskRunner()
+{
+    return std::make_shared<StrandTaskRunner>(createStrand());
+}
+
+} // namespace base
@@ -0,0 +1,71 @@
+//
+// Aspia Project
+// Copyright (C) 2020 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#ifndef BASE__THREADING__ASIO_THREAD_POOL_H
+#define BASE__THREADING__ASIO_THREAD_POOL_H
+
+#include "base/macros_magic.h"
+
+#include <asio/executor_work_guard.hpp>
+#include <asio/io_context.hpp>
+#include <asio/strand.hpp>
+
+#include <memory>
+#include <thread>
+#include <vector>
+
+namespace base {
+
+class TaskRunner;
+
+// Runs one asio::io_context on several threads. Handlers of an I/O object are executed on any
+// thread of the pool, so objects that have state must bind their handlers to a strand (the socket
+// can be created with the strand as its executor). Handlers of one strand never run concurrently.
+class AsioThreadPool
+{
+public:
+    using Strand = asio::strand<asio::io_context::executor_type>;
+
+    // If |thread_count| is zero, then the number of threads is equal to the number of processors.
+    explicit AsioThreadPool(size_t thread_count = 0);
+    ~AsioThreadPool();
+
+    // Stops the io_context and waits for the threads to exit. Handlers that have not run are
+    // destroyed together with the io_context.
+    void stop();
+
+    asio::io_context& ioContext() { return io_context_; }
+    size_t threadCount() const { return threads_.size(); }
+
+    // Creates a new strand. Handlers posted to different strands can run in parallel.
+    Strand createStrand();
+
+    // Creates a task runner whose tasks are executed sequentially in a new strand.
+    std::shared_ptr<TaskRunner> createTaskRunner();
+
+private:
+    asio::io_context io_context_;
+    asio::executor_work_guard<asio::io_context::executor_type> work_guard_;
+    std::vector<std::thread> threads_;
+
+    DISALLOW_COPY_AND_ASSIGN(AsioThreadPool);
+};
+
+} // namespace base
+
+#endif // BASE__THREADING__ASIO_THREAD_POOL_H
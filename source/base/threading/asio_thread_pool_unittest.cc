@@ -0,0 +1,161 @@
+//
+// Aspia Project
+// Copyright (C) 2020 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "base/threading/asio_thread_pool.h"
+
+#include "base/task_runner.h"
+#include "base/waitable_event.h"
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+namespace base {
+
+TEST(AsioThreadPoolTest, StrandOrder)
+{
+    static const int kTaskCount = 10000;
+
+    // The state is declared before the pool, so the threads are stopped before it is destroyed.
+    std::vector<int> order;
+    std::atomic_int running_count { 0 };
+    bool overlapped = false;
+    bool belongs = true;
+
+    WaitableEvent event;
+
+    AsioThreadPool thread_pool(4);
+    EXPECT_EQ(thread_pool.threadCount(), 4u);
+
+    std::shared_ptr<TaskRunner> task_runner = thread_pool.createTaskRunner();
+
+    for (int i = 0; i < kTaskCount; ++i)
+    {
+        task_runner->postTask([&, i]()
+        {
+            if (running_count.fetch_add(1) != 0)
+                overlapped = true;
+
+            belongs &= task_runner->belongsToCurrentThread();
+            order.push_back(i);
+
+            running_count.fetch_sub(1);
+
+            if (i == kTaskCount - 1)
+                event.signal();
+        });
+    }
+
+    EXPECT_FALSE(task_runner->belongsToCurrentThread());
+    ASSERT_TRUE(event.wait(std::chrono::seconds(10)));
+
+    EXPECT_FALSE(overlapped);
+    EXPECT_TRUE(belongs);
+    ASSERT_EQ(order.size(), static_cast<size_t>(kTaskCount));
+
+    for (int i = 0; i < kTaskCount; ++i)
+        EXPECT_EQ(order[i], i);
+}
+
+TEST(AsioThreadPoolTest, SeveralStrands)
+{
+    static const int kStrandCount = 8;
+    static const int kTaskCount = 1000;
+
+    std::atomic_int done_count { 0 };
+    WaitableEvent event;
+    std::vector<int> counters(kStrandCount, 0);
+
+    AsioThreadPool thread_pool(4);
+    std::vector<std::shared_ptr<TaskRunner>> task_runners;
+
+    for (int i = 0; i < kStrandCount; ++i)
+        task_runners.emplace_back(thread_pool.createTaskRunner());
+
+    for (int j = 0; j < kTaskCount; ++j)
+    {
+        for (int i = 0; i < kStrandCount; ++i)
+        {
+            // Each counter is changed only by tasks of its own strand.
+            task_runners[i]->postTask([&, i]()
+            {
+                if (++counters[i] == kTaskCount && ++done_count == kStrandCount)
+                    event.signal();
+            });
+        }
+    }
+
+    ASSERT_TRUE(event.wait(std::chrono::seconds(10)));
+
+    for (int i = 0; i < kStrandCount; ++i)
+        EXPECT_EQ(counters[i], kTaskCount);
+}
+
+TEST(AsioThreadPoolTest, DelayedTask)
+{
+    std::vector<int> order;
+    WaitableEvent event;
+
+    AsioThreadPool thread_pool(2);
+    std::shared_ptr<TaskRunner> task_runner = thread_pool.createTaskRunner();
+
+    task_runner->postDelayedTask([&]()
+    {
+        order.push_back(2);
+        event.signal();
+    }, std::chrono::milliseconds(20));
+
+    task_runner->postTask([&]() { order.push_back(1); });
+
+    ASSERT_TRUE(event.wait(std::chrono::seconds(10)));
+    EXPECT_EQ(order, std::vector<int>({ 1, 2 }));
+}
+
+TEST(AsioThreadPoolTest, StrandQuit)
+{
+    std::vector<int> order;
+    WaitableEvent event;
+
+    AsioThreadPool thread_pool(2);
+    std::shared_ptr<TaskRunner> task_runner = thread_pool.createTaskRunner();
+
+    // Signals when the last task is run or dropped.
+    std::shared_ptr<int> guard(new int(0), [&](int* value)
+    {
+        delete value;
+        event.signal();
+    });
+
+    task_runner->postDelayedTask([&]() { order.push_back(4); }, std::chrono::milliseconds(20));
+    task_runner->postTask([&]() { order.push_back(1); });
+    task_runner->postTask([&]() { order.push_back(2); });
+    task_runner->postQuit();
+    task_runner->postTask([&, guard = std::move(guard)]() { order.push_back(3); });
+
+    ASSERT_TRUE(event.wait(std::chrono::seconds(10)));
+
+    // The delayed task is dropped when its timer expires.
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+
+    thread_pool.stop();
+    EXPECT_EQ(order, std::vector<int>({ 1, 2 }));
+}
+
+} // namespace base
@@ -0,0 +1,232 @@
+//
+// Aspia Project
+// Copyright (C) 2020 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#ifndef BASE__THREADING__MPSC_QUEUE_H
+#define BASE__THREADING__MPSC_QUEUE_H
+
+#include "base/macros_magic.h"
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <optional>
+
+namespace base {
+
+// Unbounded lock-free multi-producer single-consumer queue (the algorithm of Dmitry Vyukov).
+// push() can be called from any thread, pop() only from one thread at a time.
+// The queue always contains a dummy node. push() takes a single atomic exchange. If a producer is
+// preempted between the exchange and the link of the new node, pop() sees the queue as empty
+// until the link is completed. Callers that need a wakeup must signal it after push() returns.
+//
+// Nodes are taken from a pool owned by the queue, so in steady state push() and pop() do not
+// allocate memory. The pool grows in chunks of kChunkSize nodes up to kMaxChunks chunks, after which
+// nodes are allocated on the heap. The free list head holds the index of the first free node and a
+// modification counter, which protects compare-and-swap from the ABA problem.
+template <class T>
+class MpscQueue
+{
+public:
+    static const uint32_t kChunkSize = 64;
+    static const uint32_t kMaxChunks = 256;
+
+    MpscQueue()
+    {
+        tail_ = allocateNode();
+        head_.store(tail_, std::memory_order_relaxed);
+    }
+
+    ~MpscQueue()
+    {
+        while (pop().has_value())
+            continue;
+
+        releaseNode(tail_);
+
+        for (uint32_t i = 0; i < chunk_count_; ++i)
+            delete[] chunks_[i];
+    }
+
+    // Adds an element to the queue. Thread safe.
+    void push(T&& value)
+    {
+        Node* node = allocateNode();
+        node->value.emplace(std::move(value));
+
+        Node* prev = head_.exchange(node, std::memory_order_acq_rel);
+        prev->next.store(node, std::memory_order_release);
+    }
+
+    // Removes the oldest element from the queue. Must be called only from the consumer thread.
+    std::optional<T> pop()
+    {
+        Node* tail = tail_;
+        Node* next = tail->next.load(std::memory_order_acquire);
+        if (!next)
+            return std::nullopt;
+
+        // The next node becomes the new dummy node.
+        std::optional<T> value(std::move(next->value));
+        next->value.reset();
+
+        tail_ = next;
+        releaseNode(tail);
+
+        return value;
+    }
+
+    // Returns true if the queue has no elements visible to the consumer. Must be called only from
+    // the consumer thread.
+    bool empty() const
+    {
+        return tail_->next.load(std::memory_order_acquire) == nullptr;
+    }
+
+private:
+    struct Node
+    {
+        std::atomic<Node*> next { nullptr };
+        std::optional<T> value;
+
+        // Index of the node in the pool plus one. Zero for nodes allocated on the heap.
+        uint32_t index = 0;
+
+        // Index plus one of the next node in the free list.
+        std::atomic<uint32_t> next_free { 0 };
+    };
+
+    static uint32_t freeIndex(uint64_t head) { return static_cast<uint32_t>(head); }
+
+    static uint64_t makeFreeHead(uint64_t prev_head, uint32_t index)
+    {
+        return (((prev_head >> 32) + 1) << 32) | index;
+    }
+
+    Node* nodeAt(uint32_t index) const
+    {
+        --index;
+        return &chunks_[index / kChunkSize][index % kChunkSize];
+    }
+
+    Node* allocateNode()
+    {
+        uint64_t head = free_head_.load(std::memory_order_acquire);
+
+        for (;;)
+        {
+            uint32_t index = freeIndex(head);
+            if (!index)
+            {
+                if (!addChunk())
+                    return new Node();
+
+                head = free_head_.load(std::memory_order_acquire);
+                continue;
+            }
+
+            // The node may be taken and returned by other threads at this moment. In this case
+            // |next_free| is stale, but the counter in the head changes and the exchange fails.
+            Node* node = nodeAt(index);
+            uint32_t next_free = node->next_free.load(std::memory_order_relaxed);
+
+            if (free_head_.compare_exchange_weak(head, makeFreeHead(head, next_free),
+                                                 std::memory_order_acquire,
+                                                 std::memory_order_acquire))
+            {
+                node->next.store(nullptr, std::memory_order_relaxed);
+                return node;
+            }
+        }
+    }
+
+    void releaseNode(Node* node)
+    {
+        if (!node->index)
+        {
+            delete node;
+            return;
+        }
+
+        uint64_t head = free_head_.load(std::memory_order_relaxed);
+
+        do
+        {
+            node->next_free.store(freeIndex(head), std::memory_order_relaxed);
+        }
+        while (!free_head_.compare_exchange_weak(head, makeFreeHead(head, node->index),
+                                                 std::memory_order_release,
+                                                 std::memory_order_relaxed));
+    }
+
+    // Adds a chunk of free nodes to the pool. Returns false if the pool has reached its limit.
+    bool addChunk()
+    {
+        std::scoped_lock lock(chunk_lock_);
+
+        // Another thread could add a chunk while we were waiting for the lock.
+        if (freeIndex(free_head_.load(std::memory_order_acquire)))
+            return true;
+
+        if (chunk_count_ == kMaxChunks)
+            return false;
+
+        Node* chunk = new Node[kChunkSize];
+        const uint32_t first_index = chunk_count_ * kChunkSize + 1;
+
+        for (uint32_t i = 0; i < kChunkSize; ++i)
+        {
+            chunk[i].index = first_index + i;
+            chunk[i].next_free.store(i + 1 < kChunkSize ? first_index + i + 1 : 0,
+                                     std::memory_order_relaxed);
+        }
+
+        chunks_[chunk_count_++] = chunk;
+
+        // Put the whole chunk at the beginning of the free list.
+        Node* last = &chunk[kChunkSize - 1];
+        uint64_t head = free_head_.load(std::memory_order_relaxed);
+
+        do
+        {
+            last->next_free.store(freeIndex(head), std::memory_order_relaxed);
+        }
+        while (!free_head_.compare_exchange_weak(head, makeFreeHead(head, first_index),
+                                                 std::memory_order_release,
+                                                 std::memory_order_relaxed));
+        return true;
+    }
+
+    // Producers add nodes here.
+    std::atomic<Node*> head_;
+
+    // The consumer takes nodes from here. Points to the dummy node.
+    Node* tail_;
+
+    // Free nodes of the pool.
+    std::atomic<uint64_t> free_head_ { 0 };
+
+    std::mutex chunk_lock_;
+    Node* chunks_[kMaxChunks] = { nullptr };
+    uint32_t chunk_count_ = 0;
+
+    DISALLOW_COPY_AND_ASSIGN(MpscQueue);
+};
+
+} // namespace base
+
+#endif // BASE__THREADING__MPSC_QUEUE_H
@@ -0,0 +1,132 @@
+//
+// Aspia Project
+// Copyright (C) 2020 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "base/threading/mpsc_queue.h"
+
+#include <gtest/gtest.h>
+
+#include <memory>
+#include <thread>
+#include <vector>
+
+namespace base {
+
+TEST(MpscQueueTest, SingleThread)
+{
+    MpscQueue<int> queue;
+    EXPECT_TRUE(queue.empty());
+    EXPECT_FALSE(queue.pop().has_value());
+
+    for (int i = 0; i < 100; ++i)
+        queue.push(int(i));
+
+    EXPECT_FALSE(queue.empty());
+
+    for (int i = 0; i < 100; ++i)
+    {
+        std::optional<int> value = queue.pop();
+        ASSERT_TRUE(value.has_value());
+        EXPECT_EQ(value.value(), i);
+    }
+
+    EXPECT_TRUE(queue.empty());
+    EXPECT_FALSE(queue.pop().has_value());
+}
+
+TEST(MpscQueueTest, PoolOverflow)
+{
+    // More elements than the node pool holds. The rest of the nodes are allocated on the heap.
+    static const int kCount = MpscQueue<int>::kChunkSize * MpscQueue<int>::kMaxChunks + 100;
+
+    MpscQueue<int> queue;
+
+    for (int pass = 0; pass < 2; ++pass)
+    {
+        for (int i = 0; i < kCount; ++i)
+            queue.push(int(i));
+
+        for (int i = 0; i < kCount; ++i)
+        {
+            std::optional<int> value = queue.pop();
+            ASSERT_TRUE(value.has_value());
+            EXPECT_EQ(value.value(), i);
+        }
+
+        EXPECT_TRUE(queue.empty());
+    }
+}
+
+TEST(MpscQueueTest, MoveOnly)
+{
+    MpscQueue<std::unique_ptr<int>> queue;
+
+    queue.push(std::make_unique<int>(1));
+    queue.push(std::make_unique<int>(2));
+
+    std::optional<std::unique_ptr<int>> value = queue.pop();
+    ASSERT_TRUE(value.has_value());
+    EXPECT_EQ(*value.value(), 1);
+
+    // The rest of the elements are destroyed with the queue.
+}
+
+TEST(MpscQueueTest, MultipleProducers)
+{
+    static const int kThreadCount = 4;
+    static const int kCountPerThread = 20000;
+
+    MpscQueue<std::pair<int, int>> queue;
+    std::vector<std::thread> threads;
+
+    for (int i = 0; i < kThreadCount; ++i)
+    {
+        threads.emplace_back([&queue, i]()
+        {
+            for (int j = 0; j < kCountPerThread; ++j)
+                queue.push(std::make_pair(i, j));
+        });
+    }
+
+    // Elements of each producer must arrive in the order in which they were added.
+    std::vector<int> next(kThreadCount, 0);
+    int received = 0;
+
+    while (received < kThreadCount * kCountPerThread)
+    {
+        std::optional<std::pair<int, int>> value = queue.pop();
+        if (!value.has_value())
+        {
+            std::this_thread::yield();
+            continue;
+        }
+
+        ASSERT_GE(value->first, 0);
+        ASSERT_LT(value->first, kThreadCount);
+        ASSERT_EQ(value->second, next[value->first]);
+
+        ++next[value->first];
+        ++received;
+    }
+
+    for (auto& thread : threads)
+        thread.join();
+
+    EXPECT_TRUE(queue.empty());
+}
+
+} // namespace base
@@ -0,0 +1,152 @@
+//
+// Aspia Project
+// Copyright (C) 2020 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+
+#include "base/threading/parallel_for.h"
+
+#include "base/logging.h"
+#include "base/threading/asio_thread_pool.h"
+
+#include <asio/post.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+namespace base {
+
+namespace {
+
+int processorCount()
+{
+    static const int processor_count =
+        static_cast<int>(std::max(std::thread::hardware_concurrency(), 1U));
+    return processor_count;
+}
+
+AsioThreadPool& sharedPool()
+{
+    // The calling thread processes bands too, so one thread less is enough.
+    static AsioThreadPool thread_pool(static_cast<size_t>(std::max(processorCount() - 1, 1)));
+    return thread_pool;
+}
+
+} // namespace
+
+class ParallelFor::Bands
+{
+public:
+    Bands(int count, int band_size, Function function)
+        : function_(std::move(function)),
+          count_(count),
+          band_size_(band_size),
+          band_count_((count + band_size - 1) / band_size)
+    {
+        // Nothing
+    }
+
+    int bandCount() const { return band_count_; }
+
+    // Processes the next band that nobody has taken yet. Returns false if there are no such bands.
+    bool processNext()
+    {
+        const int band = next_band_.fetch_add(1);
+        if (band >= band_count_)
+            return false;
+
+        const int begin = band * band_size_;
+        function_(begin, std::min(begin + band_size_, count_));
+
+        std::scoped_lock lock(lock_);
+        if (++done_count_ == band_count_)
+            done_.notify_all();
+
+        return true;
+    }
+
+    void wait()
+    {
+        while (processNext())
+            continue;
+
+        std::unique_lock lock(lock_);
+        done_.wait(lock, [this]() { return done_count_ == band_count_; });
+    }
+
+private:
+    const Function function_;
+    const int count_;
+    const int band_size_;
+    const int band_count_;
+
+    std::atomic_int next_band_ { 0 };
+
+    std::mutex lock_;
+    std::condition_variable done_;
+    int done_count_ = 0;
+
+    DISALLOW_COPY_AND_ASSIGN(Bands);
+};
+
+ParallelFor::ParallelFor(int count, int min_band_size, int alignment, Function function)
+{
+    DCHECK_GE(count, 0);
+    DCHECK_GT(min_band_size, 0);
+    DCHECK_GT(alignment, 0);
+
+    const int band_count = std::clamp(count / min_band_size, 1, processorCount());
+
+    int band_size = (count + band_count - 1) / band_count;
+    band_size = std::max((band_size + alignment - 1) / alignment * alignment, alignment);
+
+    bands_ = std::make_shared<Bands>(count, band_size, std::move(function));
+
+    // The calling thread takes one of the bands in wait().
+    for (int i = 1; i < bands_->bandCount(); ++i)
+    {
+        asio::post(sharedPool().ioContext(), [bands = bands_]()
+        {
+            bands->processNext();
+        });
+    }
+}
+
+ParallelFor::~ParallelFor()
+{
+    wait();
+}
+
+void ParallelFor::wait()
+{
+    bands_->wait();
+}
+
+int ParallelFor::bandCount() const
+{
+    return bands_->bandCount();
+}
+
+// static
+void ParallelFor::run(int count, int min_band_size, int alignment, Function function)
+{
+    ParallelFor(count, min_band_size, alignment, std::move(function)).wait();
+}
+
+} // namespace base
@@ -0,0 +1,60 @@
+//
+// Aspia Project
+// Copyright (C) 2020 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+
+#ifndef BASE__THREADING__PARALLEL_FOR_H
+#define BASE__THREADING__PARALLEL_FOR_H
+
+#include "base/macros_magic.h"
+
+#include <functional>
+#include <memory>
+
+namespace base {
+
+// Splits the range [0, count) into bands and processes them on the threads of a pool shared by
+// the process. The calling thread can do other work while the bands are processed. wait()
+// processes the bands that the pool has not picked up yet and returns when all bands are done,
+// so the function may safely refer to the caller's stack.
+class ParallelFor
+{
+public:
+    using Function = std::function<void(int begin, int end)>;
+
+    // Each band has at least |min_band_size| items (except when |count| is smaller) and starts at
+    // a multiple of |alignment|. The number of bands does not exceed the number of processors.
+    ParallelFor(int count, int min_band_size, int alignment, Function function);
+    ~ParallelFor();
+
+    void wait();
+
+    int bandCount() const;
+
+    // Processes all bands and waits for them.
+    static void run(int count, int min_band_size, int alignment, Function function);
+
+private:
+    class Bands;
+    std::shared_ptr<Bands> bands_;
+
+    DISALLOW_COPY_AND_ASSIGN(ParallelFor);
+};
+
+} // namespace base
+
+#endif // BASE__THREADING__PARALLEL_FOR_H
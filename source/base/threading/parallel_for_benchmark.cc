@@ -0,0 +1,110 @@
+//
+// Aspia Project
+// Copyright (C) 2020 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+// Measures the ARGB to I420 conversion of a 1080p frame in one pass and in bands of rows on the
+// threads of ParallelFor, as VideoEncoderVPX converts large updates.
+//
+// Usage: aspia_parallel_for_benchmark
+
+#include "base/threading/parallel_for.h"
+
+#include <libyuv/convert.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <thread>
+#include <vector>
+
+namespace {
+
+const int kWidth = 1920;
+const int kHeight = 1080;
+
+// The same band parameters as in VideoEncoderVPX.
+const int kMinRowsPerBand = 64;
+const int kRowAlignment = 16;
+
+std::vector<uint8_t> testFrame()
+{
+    std::vector<uint8_t> argb(static_cast<size_t>(kWidth * kHeight * 4));
+    for (size_t i = 0; i < argb.size(); ++i)
+        argb[i] = static_cast<uint8_t>(i * 7 + i / 4096);
+
+    return argb;
+}
+
+// Converts the rows from |top| to |bottom| of |argb| into the I420 planes in |out|. |out| must
+// have the size of the whole I420 frame.
+void convertRows(const std::vector<uint8_t>& argb, std::vector<uint8_t>* out, int top, int bottom)
+{
+    const int y_stride = kWidth;
+    const int uv_stride = kWidth / 2;
+
+    uint8_t* y_data = out->data();
+    uint8_t* u_data = y_data + y_stride * kHeight;
+    uint8_t* v_data = u_data + uv_stride * kHeight / 2;
+
+    libyuv::ARGBToI420(argb.data() + top * kWidth * 4, kWidth * 4,
+                       y_data + top * y_stride, y_stride,
+                       u_data + top / 2 * uv_stride, uv_stride,
+                       v_data + top / 2 * uv_stride, uv_stride,
+                       kWidth, bottom - top);
+}
+
+} // namespace
+
+int main(int /* argc */, const char* const* /* argv */)
+{
+    static const int kIterations = 50;
+
+    const std::vector<uint8_t> argb = testFrame();
+
+    std::vector<uint8_t> serial(static_cast<size_t>(kWidth * kHeight * 3 / 2));
+    std::vector<uint8_t> parallel(serial.size());
+
+    auto serial_start = std::chrono::steady_clock::now();
+    for (int i = 0; i < kIterations; ++i)
+        convertRows(argb, &serial, 0, kHeight);
+    std::chrono::duration<double, std::milli> serial_time =
+        std::chrono::steady_clock::now() - serial_start;
+
+    auto parallel_start = std::chrono::steady_clock::now();
+    for (int i = 0; i < kIterations; ++i)
+    {
+        base::ParallelFor::run(kHeight, kMinRowsPerBand, kRowAlignment, [&](int top, int bottom)
+        {
+            convertRows(argb, &parallel, top, bottom);
+        });
+    }
+    std::chrono::duration<double, std::milli> parallel_time =
+        std::chrono::steady_clock::now() - parallel_start;
+
+    if (serial != parallel)
+    {
+        fprintf(stderr, "The conversion in bands differs from the serial conversion\n");
+        return 1;
+    }
+
+    printf("ARGB to I420 %dx%d: %.2f ms serial, %.2f ms in bands (%u threads)\n",
+           kWidth, kHeight, serial_time.count() / kIterations,
+           parallel_time.count() / kIterations,
+           std::max(std::thread::hardware_concurrency(), 1U));
+
+    return 0;
+}
@@ -0,0 +1,148 @@
+//
+// Aspia Project
+// Copyright (C) 2020 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+
+#include "base/threading/parallel_for.h"
+
+#include <gtest/gtest.h>
+#include <libyuv/convert.h>
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace base {
+
+namespace {
+
+const int kWidth = 1920;
+const int kHeight = 1080;
+
+// The same band parameters as in VideoEncoderVPX.
+const int kMinRowsPerBand = 64;
+const int kRowAlignment = 16;
+
+std::vector<uint8_t> testFrame()
+{
+    std::vector<uint8_t> argb(static_cast<size_t>(kWidth * kHeight * 4));
+    for (size_t i = 0; i < argb.size(); ++i)
+        argb[i] = static_cast<uint8_t>(i * 7 + i / 4096);
+
+    return argb;
+}
+
+// Converts the rows from |top| to |bottom| of |argb| into the I420 planes in |out|. |out| must
+// have the size of the whole I420 frame.
+void convertRows(const std::vector<uint8_t>& argb, std::vector<uint8_t>* out, int top, int bottom)
+{
+    const int y_stride = kWidth;
+    const int uv_stride = kWidth / 2;
+
+    uint8_t* y_data = out->data();
+    uint8_t* u_data = y_data + y_stride * kHeight;
+    uint8_t* v_data = u_data + uv_stride * kHeight / 2;
+
+    libyuv::ARGBToI420(argb.data() + top * kWidth * 4, kWidth * 4,
+                       y_data + top * y_stride, y_stride,
+                       u_data + top / 2 * uv_stride, uv_stride,
+                       v_data + top / 2 * uv_stride, uv_stride,
+                       kWidth, bottom - top);
+}
+
+} // namespace
+
+TEST(ParallelForTest, EachItemOnce)
+{
+    static const int kCounts[] = { 0, 1, 15, 16, 17, 100, 1080, 1081, 4096 };
+
+    for (int count : kCounts)
+    {
+        std::vector<std::atomic_int> visits(static_cast<size_t>(count));
+        std::mutex lock;
+        std::vector<std::pair<int, int>> bands;
+
+        ParallelFor::run(count, 64, 16, [&](int begin, int end)
+        {
+            {
+                std::scoped_lock scoped_lock(lock);
+                bands.emplace_back(begin, end);
+            }
+
+            for (int i = begin; i < end; ++i)
+                visits[static_cast<size_t>(i)].fetch_add(1);
+        });
+
+        for (int i = 0; i < count; ++i)
+            EXPECT_EQ(visits[static_cast<size_t>(i)].load(), 1) << "count " << count;
+
+        for (const auto& band : bands)
+        {
+            EXPECT_EQ(band.first % 16, 0);
+            EXPECT_LT(band.first, band.second);
+
+            // Only the last band may be shorter than the minimum.
+            if (band.second != count)
+            {
+                EXPECT_GE(band.second - band.first, 64);
+            }
+        }
+    }
+}
+
+TEST(ParallelForTest, CallerWorksMeanwhile)
+{
+    std::atomic_int processed { 0 };
+
+    ParallelFor parallel_for(4096, 16, 16, [&](int begin, int end)
+    {
+        processed.fetch_add(end - begin);
+    });
+
+    // The calling thread is free until wait().
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+
+    parallel_for.wait();
+    EXPECT_EQ(processed.load(), 4096);
+    EXPECT_LE(parallel_for.bandCount(),
+              static_cast<int>(std::max(std::thread::hardware_concurrency(), 1U)));
+
+    // Repeated waiting does nothing.
+    parallel_for.wait();
+    EXPECT_EQ(processed.load(), 4096);
+}
+
+TEST(ParallelForTest, ArgbToI420)
+{
+    const std::vector<uint8_t> argb = testFrame();
+
+    std::vector<uint8_t> serial(static_cast<size_t>(kWidth * kHeight * 3 / 2));
+    convertRows(argb, &serial, 0, kHeight);
+
+    std::vector<uint8_t> parallel(serial.size());
+    ParallelFor::run(kHeight, kMinRowsPerBand, kRowAlignment, [&](int top, int bottom)
+    {
+        convertRows(argb, &parallel, top, bottom);
+    });
+
+    // The bands start at even rows, so the chroma planes are the same as for one pass.
+    EXPECT_EQ(serial, parallel);
+}
+
+} // namespace base
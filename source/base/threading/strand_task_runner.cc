@@ -0,0 +1,96 @@
+//
+// Aspia Project
+// Copyright (C) 2020 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "base/threading/strand_task_runner.h"
+
+#include "base/logging.h"
+
+#include <asio/post.hpp>
+#include <asio/steady_timer.hpp>
+
+namespace base {
+
+StrandTaskRunner::StrandTaskRunner(const Strand& strand)
+    : strand_(strand),
+      quit_(std::make_shared<std::atomic_bool>(false))
+{
+    // Nothing
+}
+
+StrandTaskRunner::~StrandTaskRunner() = default;
+
+bool StrandTaskRunner::belongsToCurrentThread() const
+{
+    // "Current thread" means "inside a handler of the strand" here.
+    return strand_.running_in_this_thread();
+}
+
+void StrandTaskRunner::postTaskImpl(Callback callback, const Location& /* from_here */)
+{
+    DCHECK(callback != nullptr);
+
+    if (quit_->load(std::memory_order_acquire))
+        return;
+
+    asio::post(strand_, [quit = quit_, callback = std::move(callback)]() mutable
+    {
+        if (!quit->load(std::memory_order_relaxed))
+            callback();
+    });
+}
+
+void StrandTaskRunner::postDelayedTaskImpl(
+    Callback callback, const Milliseconds& delay, const Location& /* from_here */)
+{
+    DCHECK(callback != nullptr);
+
+    if (quit_->load(std::memory_order_acquire))
+        return;
+
+    // The timer is kept alive by the handler.
+    std::shared_ptr<asio::steady_timer> timer = std::make_shared<asio::steady_timer>(strand_, delay);
+
+    timer->async_wait([timer, quit = quit_, callback = std::move(callback)](
+        const std::error_code& error_code) mutable
+    {
+        if (!error_code && !quit->load(std::memory_order_relaxed))
+            callback();
+    });
+}
+
+void StrandTaskRunner::postNonNestableTaskImpl(Callback callback, const Location& from_here)
+{
+    postTaskImpl(std::move(callback), from_here);
+}
+
+void StrandTaskRunner::postNonNestableDelayedTaskImpl(
+    Callback callback, const Milliseconds& delay, const Location& from_here)
+{
+    postDelayedTaskImpl(std::move(callback), delay, from_here);
+}
+
+void StrandTaskRunner::postQuit()
+{
+    // The tasks posted before the quit task run before it, because the strand keeps the order.
+    asio::post(strand_, [quit = quit_]()
+    {
+        quit->store(true, std::memory_order_release);
+    });
+}
+
+} // namespace base
@@ -0,0 +1,77 @@
+//
+// Aspia Project
+// Copyright (C) 2020 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#ifndef BASE__THREADING__STRAND_TASK_RUNNER_H
+#define BASE__THREADING__STRAND_TASK_RUNNER_H
+
+#include "base/macros_magic.h"
+#include "base/task_runner.h"
+
+#include <asio/io_context.hpp>
+#include <asio/strand.hpp>
+
+#include <atomic>
+#include <memory>
+
+namespace base {
+
+// Task runner that executes tasks sequentially in an asio strand. The tasks are run on the threads
+// of the io_context (see AsioThreadPool), but never concurrently and in the order of posting.
+// There are no nested loops in a strand, so non-nestable tasks are the same as ordinary ones.
+//
+// A strand has no loop to quit. postQuit() makes the strand stop accepting tasks: the tasks posted
+// before it are run, the tasks posted after it and the delayed tasks that have not run yet are
+// dropped. The threads of the io_context are not stopped.
+class StrandTaskRunner : public TaskRunner
+{
+public:
+    using Strand = asio::strand<asio::io_context::executor_type>;
+
+    explicit StrandTaskRunner(const Strand& strand);
+    ~StrandTaskRunner() override;
+
+    const Strand& strand() const { return strand_; }
+
+    // TaskRunner implementation.
+    bool belongsToCurrentThread() const override;
+    void postQuit() override;
+
+protected:
+    // TaskRunner implementation.
+    void postTaskImpl(Callback callback, const Location& from_here) override;
+    void postDelayedTaskImpl(Callback callback,
+                             const Milliseconds& delay,
+                             const Location& from_here) override;
+    void postNonNestableTaskImpl(Callback callback, const Location& from_here) override;
+    void postNonNestableDelayedTaskImpl(Callback callback,
+                                        const Milliseconds& delay,
+                                        const Location& from_here) override;
+
+private:
+    Strand strand_;
+
+    // Set by the quit task in the strand. It is shared with the posted handlers, which can outlive
+    // the task runner.
+    std::shared_ptr<std::atomic_bool> quit_;
+
+    DISALLOW_COPY_AND_ASSIGN(StrandTaskRunner);
+};
+
+} // namespace base
+
+#endif // BASE__THREADING__STRAND_TASK_RUNNER_H
@@ -56,7 +56,7 @@ void Thread::stopSoon()
 
     state_ = State::STOPPING;
 
-    message_loop_->postTask(message_loop_->quitClosure());
+    message_loop_->postTask(message_loop_->quitClosure(), FROM_HERE);
 }
 
 void Thread::stop()
@@ -34,6 +34,8 @@ namespace client {
 
 namespace {
 
+const int kDecodeTimeWindow = 10;
+
 int calculateFps(int last_fps, const std::chrono::milliseconds& duration, int64_t count)
 {
     static const double kAlpha = 0.1;
@@ -54,7 +56,8 @@ size_t calculateAvgVideoSize(size_t last_avg_size, size_t bytes)
 
 ClientDesktop::ClientDesktop(std::shared_ptr<base::TaskRunner> io_task_runner)
     : Client(io_task_runner),
-      desktop_control_proxy_(std::make_shared<DesktopControlProxy>(io_task_runner, this))
+      desktop_control_proxy_(std::make_shared<DesktopControlProxy>(io_task_runner, this)),
+      decode_time_(kDecodeTimeWindow)
 {
     // Nothing
 }
@@ -91,7 +94,18 @@ void ClientDesktop::onMessageReceived(const base::ByteArray& buffer)
     if (incoming_message_.has_video_packet() || incoming_message_.has_cursor_shape())
     {
         if (incoming_message_.has_video_packet())
-            readVideoPacket(incoming_message_.video_packet());
+        {
+            const proto::VideoPacket& packet = incoming_message_.video_packet();
+
+            TimePoint begin_time = Clock::now();
+            readVideoPacket(packet);
+            decode_time_.record(std::chrono::duration_cast<std::chrono::microseconds>(
+                Clock::now() - begin_time).count());
+
+            // The packet is acknowledged even if it could not be decoded. Otherwise the host
+            // would wait for it.
+            sendVideoAck(packet);
+        }
 
         if (incoming_message_.has_cursor_shape())
             readCursorShape(incoming_message_.cursor_shape());
@@ -260,6 +274,9 @@ void ClientDesktop::onMetricsRequest()
     metrics.max_video_packet = max_video_packet_;
     metrics.avg_video_packet = avg_video_packet_;
     metrics.fps = fps_;
+    metrics.frame_latency = std::chrono::milliseconds(frame_latency_);
+    metrics.frames_in_flight = static_cast<int>(frames_in_flight_);
+    metrics.decode_time = std::chrono::microseconds(static_cast<int64_t>(decode_time_.average()));
     metrics.send_mouse = input_event_filter_.sendMouseCount();
     metrics.drop_mouse = input_event_filter_.dropMouseCount();
     metrics.send_key   = input_event_filter_.sendKeyCount();
@@ -358,6 +375,24 @@ void ClientDesktop::readVideoPacket(const proto::VideoPacket& packet)
     desktop_window_proxy_->drawFrame();
 }
 
+void ClientDesktop::sendVideoAck(const proto::VideoPacket& packet)
+{
+    // Old hosts do not number the frames.
+    if (!packet.sequence_number())
+        return;
+
+    frame_latency_ = packet.frame_latency();
+    frames_in_flight_ = packet.frames_in_flight();
+
+    outgoing_message_.Clear();
+
+    proto::VideoAck* ack = outgoing_message_.mutable_video_ack();
+    ack->set_sequence_number(packet.sequence_number());
+    ack->set_capture_time(packet.capture_time());
+
+    sendMessage(outgoing_message_);
+}
+
 void ClientDesktop::readCursorShape(const proto::CursorShape& cursor_shape)
 {
     if (sessionType() != proto::SESSION_TYPE_DESKTOP_MANAGE)
@@ -20,6 +20,7 @@
 #define CLIENT__CLIENT_DESKTOP_H
 
 #include "base/macros_magic.h"
+#include "base/codec/running_samples.h"
 #include "client/client.h"
 #include "client/desktop_control.h"
 #include "client/input_event_filter.h"
@@ -69,6 +70,7 @@ protected:
 private:
     void readConfigRequest(const proto::DesktopConfigRequest& config_request);
     void readVideoPacket(const proto::VideoPacket& packet);
+    void sendVideoAck(const proto::VideoPacket& packet);
     void readCursorShape(const proto::CursorShape& cursor_shape);
     void readClipboardEvent(const proto::ClipboardEvent& event);
     void readExtension(const proto::DesktopExtension& extension);
@@ -100,6 +102,12 @@ private:
     size_t avg_video_packet_ = 0;
     int fps_ = 0;
 
+    // The time of decoding of video packets and the statistics which the host sends for the
+    // acknowledged frames.
+    base::RunningSamples decode_time_;
+    uint32_t frame_latency_ = 0;
+    uint32_t frames_in_flight_ = 0;
+
     DISALLOW_COPY_AND_ASSIGN(ClientDesktop);
 };
 
@@ -22,19 +22,29 @@
 #include "base/task_runner.h"
 #include "client/file_control_proxy.h"
 #include "client/file_manager_window_proxy.h"
+#include "common/file_list_cursor.h"
 #include "common/file_task_factory.h"
 #include "common/file_task_consumer_proxy.h"
 #include "common/file_task_producer_proxy.h"
 #include "common/file_worker.h"
 
+#include <algorithm>
+
 namespace client {
 
+namespace {
+
+// Local listings, removals and transfers run in parallel on these threads.
+const size_t kLocalWorkerThreads = 4;
+
+} // namespace
+
 ClientFileTransfer::ClientFileTransfer(std::shared_ptr<base::TaskRunner> io_task_runner)
     : Client(io_task_runner),
       file_control_proxy_(std::make_shared<FileControlProxy>(io_task_runner, this)),
       task_consumer_proxy_(std::make_shared<common::FileTaskConsumerProxy>(this)),
       task_producer_proxy_(std::make_shared<common::FileTaskProducerProxy>(this)),
-      local_worker_(std::make_unique<common::FileWorker>(io_task_runner))
+      local_worker_(std::make_unique<common::FileWorker>(io_task_runner, kLocalWorkerThreads))
 {
     // Nothing
 }
@@ -80,20 +90,28 @@ void ClientFileTransfer::onMessageReceived(const base::ByteArray& buffer)
     {
         file_manager_window_proxy_->onErrorOccurred(reply->error_code());
     }
-    else if (!remote_task_queue_.empty())
+    else
     {
-        // Move the reply to the request and notify the sender.
-        remote_task_queue_.front()->setReply(std::move(reply));
+        // The reply belongs to the oldest request of its lane.
+        auto task = std::find_if(remote_task_queue_.begin(), remote_task_queue_.end(),
+            [lane = reply->lane()](const std::shared_ptr<common::FileTask>& other)
+        {
+            return !lane || other->request().lane() == lane;
+        });
+
+        if (task == remote_task_queue_.end())
+        {
+            file_manager_window_proxy_->onErrorOccurred(proto::FILE_ERROR_UNKNOWN);
+            return;
+        }
+
+        std::shared_ptr<common::FileTask> current_task = std::move(*task);
 
         // Remove the request from the queue.
-        remote_task_queue_.pop();
+        remote_task_queue_.erase(task);
 
-        // Execute the next request.
-        doNextRemoteTask();
-    }
-    else
-    {
-        file_manager_window_proxy_->onErrorOccurred(proto::FILE_ERROR_UNKNOWN);
+        // Move the reply to the request and notify the sender.
+        current_task->setReply(std::move(reply));
     }
 }
 
@@ -114,8 +132,36 @@ void ClientFileTransfer::onTaskDone(std::shared_ptr<common::FileTask> task)
     }
     else if (request.has_file_list_request())
     {
-        file_manager_window_proxy_->onFileList(
-            task->target(), reply.error_code(), reply.file_list());
+        const bool is_first_page = !request.file_list_request().page_token();
+        size_t& list_requests = list_requests_[task->target()];
+
+        if (is_first_page)
+        {
+            DCHECK(list_requests);
+            --list_requests;
+        }
+
+        // The user has already requested another list.
+        if (list_requests)
+            return;
+
+        const proto::FileList& file_list = reply.file_list();
+
+        if (is_first_page)
+        {
+            file_manager_window_proxy_->onFileList(task->target(), reply.error_code(), file_list);
+        }
+        else
+        {
+            file_manager_window_proxy_->onFileListPage(
+                task->target(), reply.error_code(), file_list);
+        }
+
+        if (reply.error_code() == proto::FILE_ERROR_SUCCESS && file_list.next_page_token())
+        {
+            task_consumer_proxy_->doTask(taskFactory(task->target())->fileListPage(
+                file_list.next_page_token(), common::kFileListPageSize));
+        }
     }
     else if (request.has_create_directory_request())
     {
@@ -139,26 +185,15 @@ void ClientFileTransfer::doTask(std::shared_ptr<common::FileTask> task)
     }
     else
     {
-        const bool schedule = remote_task_queue_.empty();
+        // Send a request to the remote computer without waiting for replies to the previous
+        // requests. This allows file packets to be pipelined.
+        sendMessage(task->request());
 
         // Add the request to the queue.
-        remote_task_queue_.emplace(std::move(task));
-
-        // If the request queue was empty, then run execution.
-        if (schedule)
-            doNextRemoteTask();
+        remote_task_queue_.emplace_back(std::move(task));
     }
 }
 
-void ClientFileTransfer::doNextRemoteTask()
-{
-    if (remote_task_queue_.empty())
-        return;
-
-    // Send a request to the remote computer.
-    sendMessage(remote_task_queue_.front()->request());
-}
-
 common::FileTaskFactory* ClientFileTransfer::taskFactory(common::FileTask::Target target)
 {
     common::FileTaskFactory* task_factory;
@@ -184,7 +219,8 @@ void ClientFileTransfer::driveList(common::FileTask::Target target)
 
 void ClientFileTransfer::fileList(common::FileTask::Target target, const std::string& path)
 {
-    task_consumer_proxy_->doTask(taskFactory(target)->fileList(path));
+    ++list_requests_[target];
+    task_consumer_proxy_->doTask(taskFactory(target)->fileList(path, common::kFileListPageSize));
 }
 
 void ClientFileTransfer::createDirectory(common::FileTask::Target target, const std::string& path)
@@ -24,6 +24,9 @@
 #include "common/file_task_consumer.h"
 #include "common/file_task_producer.h"
 
+#include <deque>
+#include <map>
+
 namespace common {
 class FileTaskConsumerProxy;
 class FileTaskProducerProxy;
@@ -67,8 +70,6 @@ protected:
     void onTaskDone(std::shared_ptr<common::FileTask> task) override;
 
 private:
-    void doNextRemoteTask();
-
     common::FileTaskFactory* taskFactory(common::FileTask::Target target);
 
     // FileControl implementation.
@@ -93,9 +94,15 @@ private:
     std::unique_ptr<common::FileTaskFactory> local_task_factory_;
     std::unique_ptr<common::FileTaskFactory> remote_task_factory_;
 
-    std::queue<std::shared_ptr<common::FileTask>> remote_task_queue_;
+    // Requests sent to the host and waiting for replies. The host replies to the requests of one
+    // lane in the order of arrival. Old hosts reply to all requests in order.
+    std::deque<std::shared_ptr<common::FileTask>> remote_task_queue_;
     std::unique_ptr<common::FileWorker> local_worker_;
 
+    // The number of file lists requested by the user for each target and waiting for the first
+    // page. The next pages of a list are requested only while no newer list is requested.
+    std::map<common::FileTask::Target, size_t> list_requests_;
+
     std::shared_ptr<FileControlProxy> file_control_proxy_;
     std::shared_ptr<FileManagerWindowProxy> file_manager_window_proxy_;
     std::unique_ptr<FileRemover> remover_;
@@ -29,6 +29,9 @@ const int kDefCompressRatio = 8;
 const int kMinCompressRatio = 1;
 const int kMaxCompressRatio = 22;
 
+// The number of 64x64 tiles that the client keeps for the host (16 MB).
+const uint32_t kTileCacheSize = 1024;
+
 } // namespace
 
 // static
@@ -84,6 +87,7 @@ void ConfigFactory::fixupDesktopConfig(proto::DesktopConfig* config)
 {
     config->set_scale_factor(100);
     config->set_update_interval(30);
+    config->set_tile_cache_size(kTileCacheSize);
 
     if (config->compress_ratio() < kMinCompressRatio || config->compress_ratio() > kMaxCompressRatio)
         config->set_compress_ratio(kDefCompressRatio);
@@ -58,6 +58,9 @@ public:
         size_t max_video_packet = 0;
         size_t avg_video_packet = 0;
         int fps = 0;
+        std::chrono::milliseconds frame_latency { 0 };
+        int frames_in_flight = 0;
+        std::chrono::microseconds decode_time { 0 };
         int send_mouse = 0;
         int drop_mouse = 0;
         int send_key = 0;
@@ -45,6 +45,11 @@ public:
                             proto::FileError error_code,
                             const proto::FileList& file_list) = 0;
 
+    // Called when the next page of a large file list is received.
+    virtual void onFileListPage(common::FileTask::Target target,
+                                proto::FileError error_code,
+                                const proto::FileList& file_list) = 0;
+
     // Called upon receipt of a response to a directory creation request.
     virtual void onCreateDirectory(common::FileTask::Target target, proto::FileError error_code) = 0;
 
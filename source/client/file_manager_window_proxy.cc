@@ -105,6 +105,23 @@ void FileManagerWindowProxy::onFileList(
         file_manager_window_->onFileList(target, error_code, file_list);
 }
 
+void FileManagerWindowProxy::onFileListPage(
+    common::FileTask::Target target, proto::FileError error_code, const proto::FileList& file_list)
+{
+    if (!ui_task_runner_->belongsToCurrentThread())
+    {
+        ui_task_runner_->postTask(std::bind(&FileManagerWindowProxy::onFileListPage,
+                                            shared_from_this(),
+                                            target,
+                                            error_code,
+                                            file_list));
+        return;
+    }
+
+    if (file_manager_window_)
+        file_manager_window_->onFileListPage(target, error_code, file_list);
+}
+
 void FileManagerWindowProxy::onCreateDirectory(
     common::FileTask::Target target, proto::FileError error_code)
 {
@@ -20,6 +20,7 @@
 
 #include "base/logging.h"
 #include "base/strings/string_util.h"
+#include "common/file_list_cursor.h"
 #include "common/file_task_factory.h"
 #include "common/file_task_consumer_proxy.h"
 #include "common/file_task_producer_proxy.h"
@@ -75,14 +76,27 @@ void FileRemoveQueueBuilder::onTaskDone(std::shared_ptr<common::FileTask> task)
         return;
     }
 
-    const std::string& path = request.file_list_request().path();
+    const proto::FileList& file_list = reply.file_list();
 
-    for (int i = 0; i < reply.file_list().item_size(); ++i)
+    for (int i = 0; i < file_list.item_size(); ++i)
     {
-        const proto::FileList::Item& item = reply.file_list().item(i);
-        std::string item_path = path + '/' + item.name();
+        const proto::FileList::Item& item = file_list.item(i);
+        std::string item_path = list_path_ + '/' + item.name();
+
+        // The items of a recursive list follow their directories. In the reverse order the
+        // contents of directories are removed before them. Old peers list only the directory
+        // itself.
+        if (file_list.recursive())
+            tasks_.emplace_front(std::move(item_path), item.is_directory());
+        else
+            pending_tasks_.emplace_back(std::move(item_path), item.is_directory());
+    }
 
-        pending_tasks_.emplace_back(std::move(item_path), item.is_directory());
+    if (file_list.next_page_token())
+    {
+        task_consumer_proxy_->doTask(task_factory_->fileListPage(
+            file_list.next_page_token(), common::kFileListPageSize));
+        return;
     }
 
     doPendingTasks();
@@ -97,7 +111,9 @@ void FileRemoveQueueBuilder::doPendingTasks()
 
         if (tasks_.front().isDirectory())
         {
-            task_consumer_proxy_->doTask(task_factory_->fileList(tasks_.front().path()));
+            list_path_ = tasks_.front().path();
+            task_consumer_proxy_->doTask(
+                task_factory_->fileList(list_path_, common::kFileListPageSize, true));
             return;
         }
     }
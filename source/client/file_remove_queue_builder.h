@@ -57,6 +57,9 @@ private:
     FileRemover::TaskList pending_tasks_;
     FileRemover::TaskList tasks_;
 
+    // The directory which is being listed. The next pages of the list do not contain the path.
+    std::string list_path_;
+
     DISALLOW_COPY_AND_ASSIGN(FileRemoveQueueBuilder);
 };
 
@@ -26,8 +26,23 @@
 #include "common/file_task_consumer_proxy.h"
 #include "common/file_task_producer_proxy.h"
 
+#include <algorithm>
+
 namespace client {
 
+namespace {
+
+// The number of removals which are executed at the same time.
+const size_t kMaxRemovalsInFlight = 4;
+
+// The errors which the user can skip.
+bool canSkip(proto::FileError code)
+{
+    return code == proto::FILE_ERROR_PATH_NOT_FOUND || code == proto::FILE_ERROR_ACCESS_DENIED;
+}
+
+} // namespace
+
 FileRemover::FileRemover(std::shared_ptr<base::TaskRunner> io_task_runner,
                          std::shared_ptr<FileRemoveWindowProxy> remove_window_proxy,
                          std::shared_ptr<common::FileTaskConsumerProxy> task_consumer_proxy,
@@ -40,7 +55,11 @@ FileRemover::FileRemover(std::shared_ptr<base::TaskRunner> io_task_runner,
     DCHECK(remove_window_proxy_);
     DCHECK(task_consumer_proxy_);
 
-    task_factory_ = std::make_unique<common::FileTaskFactory>(task_producer_proxy_, target);
+    for (size_t i = 0; i < kMaxRemovalsInFlight; ++i)
+    {
+        task_factories_.emplace_back(
+            std::make_unique<common::FileTaskFactory>(task_producer_proxy_, target));
+    }
 }
 
 FileRemover::~FileRemover()
@@ -57,7 +76,7 @@ void FileRemover::start(const TaskList& items, const FinishCallback& callback)
     remove_window_proxy_->start(remover_proxy_);
 
     queue_builder_ = std::make_unique<FileRemoveQueueBuilder>(
-        task_consumer_proxy_, task_factory_->target());
+        task_consumer_proxy_, task_factories_.front()->target());
 
     // Start building a list of objects for deletion.
     queue_builder_->start(items, [this](proto::FileError error_code)
@@ -67,7 +86,7 @@ void FileRemover::start(const TaskList& items, const FinishCallback& callback)
             tasks_ = queue_builder_->takeQueue();
             tasks_count_ = tasks_.size();
 
-            doNextTask();
+            doNextTasks();
         }
         else
         {
@@ -88,16 +107,30 @@ void FileRemover::stop()
 
 void FileRemover::setAction(Action action)
 {
+    is_asking_ = false;
+
     switch (action)
     {
         case ACTION_SKIP:
-            doNextTask();
+            if (!failures_.empty())
+                failures_.pop_front();
+            doNextTasks();
             break;
 
         case ACTION_SKIP_ALL:
+        {
             failure_action_ = action;
-            doNextTask();
-            break;
+
+            // The other errors of the same kind are skipped too.
+            failures_.erase(std::remove_if(failures_.begin(), failures_.end(),
+                                           [](const Failure& failure)
+            {
+                return canSkip(failure.code);
+            }), failures_.end());
+
+            doNextTasks();
+        }
+        break;
 
         case ACTION_ABORT:
             onFinished();
@@ -121,60 +154,67 @@ void FileRemover::onTaskDone(std::shared_ptr<common::FileTask> task)
         return;
     }
 
+    DCHECK(tasks_in_flight_);
+    --tasks_in_flight_;
+
     if (reply.error_code() != proto::FILE_ERROR_SUCCESS)
     {
-        uint32_t actions;
-
-        switch (reply.error_code())
-        {
-            case proto::FILE_ERROR_PATH_NOT_FOUND:
-            case proto::FILE_ERROR_ACCESS_DENIED:
-            {
-                if (failure_action_ != ACTION_ASK)
-                {
-                    setAction(failure_action_);
-                    return;
-                }
-
-                actions = ACTION_ABORT | ACTION_SKIP | ACTION_SKIP_ALL;
-            }
-            break;
-
-            default:
-                actions = ACTION_ABORT;
-                break;
-        }
-
-        remove_window_proxy_->errorOccurred(
-            request.remove_request().path(), reply.error_code(), actions);
-        return;
+        if (failure_action_ == ACTION_ASK || !canSkip(reply.error_code()))
+            failures_.push_back({ request.remove_request().path(), reply.error_code() });
     }
 
-    // The task is completed. We delete it.
-    if (!tasks_.empty())
-        tasks_.pop_front();
-
-    doNextTask();
+    doNextTasks();
 }
 
-void FileRemover::doNextTask()
+void FileRemover::doNextTasks()
 {
-    if (tasks_.empty())
+    if (is_asking_)
+        return;
+
+    if (!failures_.empty())
     {
-        onFinished();
+        // The user is asked when the other removals are completed.
+        if (tasks_in_flight_)
+            return;
+
+        const Failure& failure = failures_.front();
+
+        uint32_t actions = ACTION_ABORT;
+        if (canSkip(failure.code))
+            actions |= ACTION_SKIP | ACTION_SKIP_ALL;
+
+        is_asking_ = true;
+        remove_window_proxy_->errorOccurred(failure.path, failure.code, actions);
         return;
     }
 
-    DCHECK_NE(tasks_count_, 0);
+    while (!tasks_.empty() && tasks_in_flight_ < kMaxRemovalsInFlight)
+    {
+        // The contents of a directory precede it in the queue. The directory is removed when the
+        // removals in flight are completed.
+        if (tasks_.front().isDirectory() && tasks_in_flight_)
+            break;
+
+        const std::string& path = tasks_.front().path();
+
+        DCHECK_NE(tasks_count_, 0);
+        const size_t percentage = (tasks_count_ - tasks_.size()) * 100 / tasks_count_;
 
-    const size_t percentage = (tasks_count_ - tasks_.size()) * 100 / tasks_count_;
-    const std::string& path = tasks_.front().path();
+        // Updating progress in UI.
+        remove_window_proxy_->setCurrentProgress(path, percentage);
 
-    // Updating progress in UI.
-    remove_window_proxy_->setCurrentProgress(path, percentage);
+        // Send a request to delete the next item. The next request goes to the next lane.
+        common::FileTaskFactory* task_factory = task_factories_[next_factory_].get();
+        next_factory_ = (next_factory_ + 1) % task_factories_.size();
 
-    // Send a request to delete the next item.
-    task_consumer_proxy_->doTask(task_factory_->remove(path));
+        ++tasks_in_flight_;
+        task_consumer_proxy_->doTask(task_factory->remove(path));
+
+        tasks_.pop_front();
+    }
+
+    if (tasks_.empty() && !tasks_in_flight_)
+        onFinished();
 }
 
 void FileRemover::onFinished()
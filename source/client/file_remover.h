@@ -21,9 +21,11 @@
 
 #include "common/file_task.h"
 #include "common/file_task_producer.h"
+#include "proto/file_transfer.pb.h"
 
 #include <functional>
 #include <deque>
+#include <vector>
 
 namespace base {
 class TaskRunner;
@@ -92,14 +94,19 @@ protected:
     void onTaskDone(std::shared_ptr<common::FileTask> task) override;
 
 private:
-    void doNextTask();
+    struct Failure
+    {
+        std::string path;
+        proto::FileError code;
+    };
+
+    void doNextTasks();
     void onFinished();
 
     std::shared_ptr<FileRemoverProxy> remover_proxy_;
     std::shared_ptr<FileRemoveWindowProxy> remove_window_proxy_;
     std::shared_ptr<common::FileTaskConsumerProxy> task_consumer_proxy_;
     std::shared_ptr<common::FileTaskProducerProxy> task_producer_proxy_;
-    std::unique_ptr<common::FileTaskFactory> task_factory_;
 
     std::unique_ptr<FileRemoveQueueBuilder> queue_builder_;
 
@@ -109,6 +116,17 @@ private:
     Action failure_action_ = ACTION_ASK;
     size_t tasks_count_ = 0;
 
+    // The removals are sent in several lanes and are executed in parallel. Each factory has its
+    // own lane.
+    std::vector<std::unique_ptr<common::FileTaskFactory>> task_factories_;
+    size_t next_factory_ = 0;
+    size_t tasks_in_flight_ = 0;
+
+    // The errors which are not yet shown to the user. The user is asked when the removals in
+    // flight are completed.
+    std::deque<Failure> failures_;
+    bool is_asking_ = false;
+
     DISALLOW_COPY_AND_ASSIGN(FileRemover);
 };
 
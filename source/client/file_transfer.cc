@@ -27,6 +27,9 @@
 #include "common/file_task_producer_proxy.h"
 #include "common/file_packet.h"
 
+#include <algorithm>
+#include <limits>
+
 namespace client {
 
 namespace {
@@ -223,6 +226,20 @@ FileTransfer::Task& FileTransfer::frontTask()
 
 void FileTransfer::targetReply(const proto::FileRequest& request, const proto::FileReply& reply)
 {
+    if (request.has_batch_upload_request())
+    {
+        onBatchWritten(reply);
+        return;
+    }
+
+    // The replies for the packets of a failed file can arrive when its queue is already taken by
+    // batches.
+    if ((request.has_packet() || request.has_chunk_query()) && stale_target_replies_)
+    {
+        --stale_target_replies_;
+        return;
+    }
+
     if (tasks_.empty())
         return;
 
@@ -250,57 +267,115 @@ void FileTransfer::targetReply(const proto::FileRequest& request, const proto::F
             return;
         }
 
-        task_consumer_proxy_->doTask(
-            task_factory_source_->packetRequest(proto::FilePacketRequest::NO_FLAGS));
+        is_target_file_open_ = true;
+
+        // Stop-and-wait and packets of the default size for peers without the support.
+        const uint32_t window_size = std::min(source_window_size_, reply.window_size());
+        const size_t max_packet_size = std::min(source_max_packet_size_, reply.max_packet_size());
+
+        packet_window_.setLimits(std::max(window_size, uint32_t(1)),
+                                 std::max(max_packet_size, common::kDefaultFilePacketSize));
+
+        // The packets are compressed only if both peers support it.
+        if (source_compression_ == proto::FILE_COMPRESSION_ZSTD &&
+            reply.compression() == proto::FILE_COMPRESSION_ZSTD)
+        {
+            compression_ = proto::FILE_COMPRESSION_ZSTD;
+        }
+        else
+        {
+            compression_ = proto::FILE_COMPRESSION_NONE;
+        }
+
+        // The target has a partial or an older version of the file. The source must know it
+        // before the first packet is requested.
+        if (reply.signature().weak_checksum_size() > 0)
+        {
+            ++source_in_flight_;
+            task_consumer_proxy_->doTask(task_factory_source_->sync(reply.signature()));
+            return;
+        }
+
+        // A new file. The source makes the chunk list and the target finds which chunks it has.
+        if (source_chunks_supported_ && reply.chunks_supported() &&
+            bytes_to_request_ >= common::kMinChunkedFileSize &&
+            bytes_to_request_ <= common::kMaxChunkedFileSize)
+        {
+            ++source_in_flight_;
+            task_consumer_proxy_->doTask(task_factory_source_->chunkList());
+            return;
+        }
+
+        doPacketRequests();
     }
-    else if (request.has_packet())
+    else if (request.has_chunk_query())
     {
+        DCHECK(target_in_flight_);
+        --target_in_flight_;
+
         if (reply.error_code() != proto::FILE_ERROR_SUCCESS)
         {
+            // The target closed the file.
+            is_target_file_open_ = false;
+
+            dropPacketsInFlight();
             onError(Error::Type::WRITE_FILE, reply.error_code(), frontTask().targetPath());
             return;
         }
 
-        const int64_t full_task_size = frontTask().size();
-        if (full_task_size && total_size_)
+        // The chunks which the target has are sent as references.
+        const std::string& present_chunks = reply.present_chunks();
+        if (std::any_of(present_chunks.begin(), present_chunks.end(),
+                        [](char bits) { return bits != 0; }))
         {
-            int64_t packet_size = common::kMaxFilePacketSize;
+            ++source_in_flight_;
+            task_consumer_proxy_->doTask(task_factory_source_->syncChunks(present_chunks));
+            return;
+        }
 
-            task_transfered_size_ += packet_size;
+        doPacketRequests();
+    }
+    else if (request.has_packet())
+    {
+        DCHECK(target_in_flight_);
+        --target_in_flight_;
+        packet_window_.onPacketConfirmed();
 
-            if (task_transfered_size_ > full_task_size)
-            {
-                packet_size = task_transfered_size_ - full_task_size;
-                task_transfered_size_ = full_task_size;
-            }
+        if (reply.error_code() != proto::FILE_ERROR_SUCCESS)
+        {
+            is_target_file_open_ = false;
 
-            total_transfered_size_ += packet_size;
+            dropPacketsInFlight();
+            onError(Error::Type::WRITE_FILE, reply.error_code(), frontTask().targetPath());
+            return;
+        }
 
-            const int task_percentage =
-                static_cast<int>(task_transfered_size_ * 100 / full_task_size);
-            const int total_percentage =
-                static_cast<int>(total_transfered_size_ * 100 / total_size_);
+        const proto::FilePacket& packet = request.packet();
+        int64_t packet_size = static_cast<int64_t>(
+            packet.compression() == proto::FILE_COMPRESSION_NONE ?
+                packet.data().size() : packet.uncompressed_size());
 
-            if (task_percentage != task_percentage_ || total_percentage != total_percentage_)
-            {
-                task_percentage_ = task_percentage;
-                total_percentage_ = total_percentage;
+        // The blocks copied from the existing file of the target.
+        for (const auto& op : packet.delta_op())
+            packet_size += op.copy_size();
 
-                transfer_window_proxy_->setCurrentProgress(total_percentage_, task_percentage_);
-            }
-        }
+        task_transfered_size_ += packet_size;
+        total_transfered_size_ += packet_size;
 
-        if (request.packet().flags() & proto::FilePacket::LAST_PACKET)
+        updateProgress();
+
+        if (packet.flags() & proto::FilePacket::LAST_PACKET)
         {
+            is_target_file_open_ = false;
+
+            // If the file became smaller after it was opened, the source finishes earlier than
+            // expected and the remaining requests are answered with errors.
+            dropPacketsInFlight();
             doNextTask();
             return;
         }
 
-        uint32_t flags = proto::FilePacketRequest::NO_FLAGS;
-        if (is_canceled_)
-            flags = proto::FilePacketRequest::CANCEL;
-
-        task_consumer_proxy_->doTask(task_factory_source_->packetRequest(flags));
+        doPacketRequests();
     }
     else
     {
@@ -310,6 +385,19 @@ void FileTransfer::targetReply(const proto::FileRequest& request, const proto::F
 
 void FileTransfer::sourceReply(const proto::FileRequest& request, const proto::FileReply& reply)
 {
+    if (request.has_batch_download_request())
+    {
+        onBatchRead(reply);
+        return;
+    }
+
+    if ((request.has_sync_request() || request.has_chunk_list_request() ||
+         request.has_packet_request()) && stale_source_replies_)
+    {
+        --stale_source_replies_;
+        return;
+    }
+
     if (tasks_.empty())
         return;
 
@@ -323,17 +411,96 @@ void FileTransfer::sourceReply(const proto::FileRequest& request, const proto::F
             return;
         }
 
-        task_consumer_proxy_->doTask(
-            task_factory_target_->upload(front_task.targetPath(), front_task.overwrite()));
+        is_source_file_open_ = true;
+
+        source_window_size_ = reply.window_size();
+        source_max_packet_size_ = reply.max_packet_size();
+        source_compression_ = reply.compression();
+        source_sync_supported_ = reply.sync_supported();
+        source_chunks_supported_ = reply.chunks_supported();
+
+        // Even an empty file is sent in one packet.
+        has_packets_to_request_ = true;
+
+        // The source reports the file size and the packets are requested until the end of the
+        // file. Otherwise packets are requested until the last one arrives.
+        if (source_window_size_)
+            bytes_to_request_ = reply.file_size();
+        else
+            bytes_to_request_ = std::numeric_limits<uint64_t>::max();
+
+        // The partial files are kept and the existing files are updated with the difference only
+        // if the source can continue the transfer.
+        task_consumer_proxy_->doTask(task_factory_target_->upload(front_task.targetPath(),
+                                                                  front_task.overwrite(),
+                                                                  common::kMaxFilePacketWindow,
+                                                                  source_sync_supported_,
+                                                                  source_sync_supported_));
+    }
+    else if (request.has_sync_request())
+    {
+        DCHECK(source_in_flight_);
+        --source_in_flight_;
+
+        if (reply.error_code() != proto::FILE_ERROR_SUCCESS)
+        {
+            // The source closed the file.
+            is_source_file_open_ = false;
+
+            dropPacketsInFlight();
+            onError(Error::Type::READ_FILE, reply.error_code(), frontTask().sourcePath());
+            return;
+        }
+
+        // The part of the file which the target already has is not requested.
+        const uint64_t resume_offset = std::min(reply.resume_offset(), bytes_to_request_);
+
+        bytes_to_request_ -= resume_offset;
+        task_transfered_size_ += static_cast<int64_t>(resume_offset);
+        total_transfered_size_ += static_cast<int64_t>(resume_offset);
+
+        doPacketRequests();
+    }
+    else if (request.has_chunk_list_request())
+    {
+        DCHECK(source_in_flight_);
+        --source_in_flight_;
+
+        if (reply.error_code() != proto::FILE_ERROR_SUCCESS)
+        {
+            // The source closed the file.
+            is_source_file_open_ = false;
+
+            dropPacketsInFlight();
+            onError(Error::Type::READ_FILE, reply.error_code(), frontTask().sourcePath());
+            return;
+        }
+
+        ++target_in_flight_;
+        task_consumer_proxy_->doTask(task_factory_target_->chunkQuery(reply.chunk_list()));
     }
     else if (request.has_packet_request())
     {
+        DCHECK(source_in_flight_);
+        --source_in_flight_;
+
         if (reply.error_code() != proto::FILE_ERROR_SUCCESS)
         {
+            // The packet will not reach the target.
+            packet_window_.onPacketConfirmed();
+            is_source_file_open_ = false;
+
+            dropPacketsInFlight();
             onError(Error::Type::READ_FILE, reply.error_code(), frontTask().sourcePath());
             return;
         }
 
+        // The source closes the file after the last packet.
+        if (reply.packet().flags() & proto::FilePacket::LAST_PACKET)
+            is_source_file_open_ = false;
+
+        ++target_in_flight_;
+
         task_consumer_proxy_->doTask(task_factory_target_->packet(reply.packet()));
     }
     else
@@ -381,7 +548,21 @@ void FileTransfer::doFrontTask(bool overwrite)
     task_percentage_ = 0;
     task_transfered_size_ = 0;
 
+    has_packets_to_request_ = false;
+    bytes_to_request_ = 0;
+    source_in_flight_ = 0;
+    target_in_flight_ = 0;
+
     Task& front_task = frontTask();
+
+    // The errors of files in batches are handled as for single files. If the user chooses to
+    // replace the file, it is transferred alone.
+    if (batch_supported_ && !overwrite && isBatchable(front_task))
+    {
+        doBatches();
+        return;
+    }
+
     front_task.setOverwrite(overwrite);
 
     transfer_window_proxy_->setCurrentItem(front_task.sourcePath(), front_task.targetPath());
@@ -393,8 +574,81 @@ void FileTransfer::doFrontTask(bool overwrite)
     }
     else
     {
+        task_consumer_proxy_->doTask(task_factory_source_->download(
+            front_task.sourcePath(), common::kMaxFilePacketWindow));
+    }
+}
+
+void FileTransfer::doPacketRequests()
+{
+    if (is_canceled_)
+    {
+        // The source replies with an empty last packet and the target deletes the file. Packets
+        // already in flight are written before that.
+        if (has_packets_to_request_)
+        {
+            has_packets_to_request_ = false;
+            ++source_in_flight_;
+            packet_window_.onPacketSent(0);
+
+            task_consumer_proxy_->doTask(
+                task_factory_source_->packetRequest(proto::FilePacketRequest::CANCEL));
+        }
+        return;
+    }
+
+    while (has_packets_to_request_ && packet_window_.canSend())
+    {
+        const size_t packet_size = static_cast<size_t>(
+            std::min(static_cast<uint64_t>(packet_window_.packetSize()), bytes_to_request_));
+
+        bytes_to_request_ -= packet_size;
+        if (!bytes_to_request_)
+            has_packets_to_request_ = false;
+
+        ++source_in_flight_;
+        packet_window_.onPacketSent(packet_size);
+
+        task_consumer_proxy_->doTask(task_factory_source_->packetRequest(
+            proto::FilePacketRequest::NO_FLAGS, static_cast<uint32_t>(packet_size), compression_));
+    }
+}
+
+void FileTransfer::dropPacketsInFlight()
+{
+    stale_source_replies_ += source_in_flight_;
+    stale_target_replies_ += target_in_flight_;
+
+    source_in_flight_ = 0;
+    target_in_flight_ = 0;
+    has_packets_to_request_ = false;
+
+    packet_window_.clear();
+}
+
+void FileTransfer::closeFiles()
+{
+    // The requests of a lane are executed in order, so the cancel reaches the file before the next
+    // task opens another one. The replies are ignored.
+    if (is_source_file_open_)
+    {
+        is_source_file_open_ = false;
+        ++stale_source_replies_;
+
         task_consumer_proxy_->doTask(
-            task_factory_source_->download(front_task.sourcePath()));
+            task_factory_source_->packetRequest(proto::FilePacketRequest::CANCEL));
+    }
+
+    if (is_target_file_open_)
+    {
+        is_target_file_open_ = false;
+        ++stale_target_replies_;
+
+        // An empty last packet cancels the transfer and the target deletes the file.
+        proto::FilePacket packet;
+        packet.set_flags(proto::FilePacket::LAST_PACKET);
+
+        task_consumer_proxy_->doTask(task_factory_target_->packet(packet));
     }
 }
 
@@ -426,6 +680,10 @@ void FileTransfer::doNextTask()
 
 void FileTransfer::onError(Error::Type type, proto::FileError code, const std::string& path)
 {
+    // The file of the failed task is not continued. If the user chooses to replace it, it is
+    // opened again.
+    closeFiles();
+
     auto default_action = actions_.find(type);
     if (default_action != actions_.end())
     {
@@ -436,8 +694,341 @@ void FileTransfer::onError(Error::Type type, proto::FileError code, const std::s
     transfer_window_proxy_->errorOccurred(Error(type, code, path));
 }
 
+bool FileTransfer::isBatchable(const Task& task) const
+{
+    return task.isDirectory() || task.size() <= common::kMaxBatchFileSize;
+}
+
+void FileTransfer::doBatches()
+{
+    while (!is_canceled_ && batch_supported_ && batches_.size() < common::kMaxFileBatchesInFlight &&
+           !tasks_.empty() && isBatchable(frontTask()))
+    {
+        startBatch();
+    }
+
+    // Wait for the batches in flight.
+    if (!batches_.empty())
+        return;
+
+    if (is_canceled_)
+    {
+        tasks_.clear();
+        failed_tasks_.clear();
+    }
+
+    if (!failed_tasks_.empty())
+    {
+        // The first error is reported now. The rest of the failed tasks are tried again when the
+        // user decides what to do with the first one.
+        for (auto it = failed_tasks_.rbegin(); it != failed_tasks_.rend(); ++it)
+            tasks_.emplace_front(std::move(it->task));
+
+        const FailedTask& failed_task = failed_tasks_.front();
+        const Error::Type type = failed_task.type;
+        const proto::FileError code = failed_task.code;
+
+        failed_tasks_.clear();
+
+        const Task& front_task = frontTask();
+        onError(type, code, type == Error::Type::OPEN_FILE ?
+            front_task.sourcePath() : front_task.targetPath());
+        return;
+    }
+
+    if (tasks_.empty())
+    {
+        if (cancel_timer_.isActive())
+            cancel_timer_.stop();
+
+        onFinished();
+        return;
+    }
+
+    // The front task is a large file.
+    doFrontTask(false);
+}
+
+void FileTransfer::startBatch()
+{
+    Batch batch;
+    batch.upload = std::make_unique<proto::FileBatch>();
+
+    std::vector<std::string> paths;
+    size_t batch_size = 0;
+
+    while (!tasks_.empty() && isBatchable(frontTask()) &&
+           batch.tasks.size() < common::kMaxFileBatchItems &&
+           batch_size + static_cast<size_t>(frontTask().size()) <= common::kMaxFileBatchSize)
+    {
+        Task& task = frontTask();
+
+        if (!task.isDirectory())
+            paths.emplace_back(task.sourcePath());
+
+        batch_size += static_cast<size_t>(task.size());
+        batch.tasks.emplace_back(std::move(task));
+        tasks_.pop_front();
+    }
+
+    const Task& last_task = batch.tasks.back();
+    transfer_window_proxy_->setCurrentItem(last_task.sourcePath(), last_task.targetPath());
+
+    if (paths.empty())
+    {
+        // Only directories. The source is not needed.
+        for (auto& task : batch.tasks)
+        {
+            proto::FileBatch::Item* item = batch.upload->add_item();
+            item->set_path(task.targetPath());
+            item->set_is_directory(true);
+
+            batch.upload_tasks.emplace_back(std::move(task));
+        }
+
+        batch.tasks.clear();
+        batch.state = Batch::State::READY;
+    }
+    else
+    {
+        task_consumer_proxy_->doTask(
+            task_factory_source_->batchDownload(paths, proto::FILE_COMPRESSION_ZSTD));
+    }
+
+    batches_.emplace_back(std::move(batch));
+    sendReadyBatches();
+}
+
+void FileTransfer::sendReadyBatches()
+{
+    auto replace_action = actions_.find(Error::Type::ALREADY_EXISTS);
+    const bool overwrite = replace_action != actions_.end() &&
+        replace_action->second == Error::ACTION_REPLACE_ALL;
+
+    for (auto& batch : batches_)
+    {
+        if (batch.state == Batch::State::WRITING)
+            continue;
+
+        // The previous batches must be written first. They can contain the directories for the
+        // files of this batch.
+        if (batch.state == Batch::State::READING)
+            break;
+
+        batch.state = Batch::State::WRITING;
+        task_consumer_proxy_->doTask(
+            task_factory_target_->batchUpload(std::move(batch.upload), overwrite));
+    }
+}
+
+void FileTransfer::onBatchRead(const proto::FileReply& reply)
+{
+    auto batch = std::find_if(batches_.begin(), batches_.end(), [](const Batch& other)
+    {
+        return other.state == Batch::State::READING;
+    });
+
+    if (batch == batches_.end())
+        return;
+
+    if (reply.error_code() == proto::FILE_ERROR_INVALID_REQUEST)
+    {
+        onBatchesUnsupported();
+        return;
+    }
+
+    int file_index = 0;
+
+    // The files for which the reply has no items. The source cut the batch and they are requested
+    // again.
+    std::vector<Task> rest_tasks;
+
+    for (auto& task : batch->tasks)
+    {
+        if (task.isDirectory())
+        {
+            proto::FileBatch::Item* item = batch->upload->add_item();
+            item->set_path(task.targetPath());
+            item->set_is_directory(true);
+
+            batch->upload_tasks.emplace_back(std::move(task));
+            continue;
+        }
+
+        const int index = file_index++;
+
+        proto::FileError error_code = reply.error_code();
+        if (error_code == proto::FILE_ERROR_SUCCESS)
+        {
+            if (index < reply.batch().item_size())
+            {
+                error_code = reply.batch().item(index).error_code();
+            }
+            else if (reply.batch().item_size() > 0)
+            {
+                rest_tasks.emplace_back(std::move(task));
+                continue;
+            }
+            else
+            {
+                error_code = proto::FILE_ERROR_UNKNOWN;
+            }
+        }
+
+        if (error_code != proto::FILE_ERROR_SUCCESS)
+        {
+            addFailedTask(std::move(task), Error::Type::OPEN_FILE, error_code);
+            continue;
+        }
+
+        const proto::FileBatch::Item& source_item = reply.batch().item(index);
+
+        proto::FileBatch::Item* item = batch->upload->add_item();
+        item->set_path(task.targetPath());
+        item->set_data(source_item.data());
+        item->set_compression(source_item.compression());
+        item->set_uncompressed_size(source_item.uncompressed_size());
+
+        batch->upload_tasks.emplace_back(std::move(task));
+    }
+
+    batch->tasks.clear();
+    batch->state = Batch::State::READY;
+
+    // Their directories are created by this batch or by the previous ones.
+    for (auto task = rest_tasks.rbegin(); task != rest_tasks.rend(); ++task)
+        tasks_.emplace_front(std::move(*task));
+
+    sendReadyBatches();
+}
+
+void FileTransfer::onBatchWritten(const proto::FileReply& reply)
+{
+    if (batches_.empty() || batches_.front().state != Batch::State::WRITING)
+        return;
+
+    if (reply.error_code() == proto::FILE_ERROR_INVALID_REQUEST)
+    {
+        onBatchesUnsupported();
+        return;
+    }
+
+    Batch& batch = batches_.front();
+
+    for (size_t i = 0; i < batch.upload_tasks.size(); ++i)
+    {
+        Task& task = batch.upload_tasks[i];
+
+        proto::FileError error_code = reply.error_code();
+        if (error_code == proto::FILE_ERROR_SUCCESS)
+        {
+            if (i < static_cast<size_t>(reply.batch().item_size()))
+                error_code = reply.batch().item(static_cast<int>(i)).error_code();
+            else
+                error_code = proto::FILE_ERROR_UNKNOWN;
+        }
+
+        if (task.isDirectory())
+        {
+            if (error_code != proto::FILE_ERROR_SUCCESS &&
+                error_code != proto::FILE_ERROR_PATH_ALREADY_EXISTS)
+            {
+                addFailedTask(std::move(task), Error::Type::CREATE_DIRECTORY, error_code);
+            }
+            continue;
+        }
+
+        switch (error_code)
+        {
+            case proto::FILE_ERROR_SUCCESS:
+                total_transfered_size_ += task.size();
+                break;
+
+            case proto::FILE_ERROR_PATH_ALREADY_EXISTS:
+                addFailedTask(std::move(task), Error::Type::ALREADY_EXISTS, error_code);
+                break;
+
+            case proto::FILE_ERROR_FILE_CREATE_ERROR:
+                addFailedTask(std::move(task), Error::Type::CREATE_FILE, error_code);
+                break;
+
+            default:
+                addFailedTask(std::move(task), Error::Type::WRITE_FILE, error_code);
+                break;
+        }
+    }
+
+    batches_.pop_front();
+
+    // The files of a batch are written at once.
+    if (total_size_)
+    {
+        total_percentage_ = static_cast<int>(
+            std::min(total_transfered_size_, total_size_) * 100 / total_size_);
+        task_percentage_ = 100;
+
+        transfer_window_proxy_->setCurrentProgress(total_percentage_, task_percentage_);
+    }
+
+    sendReadyBatches();
+    doBatches();
+}
+
+void FileTransfer::onBatchesUnsupported()
+{
+    LOG(LS_INFO) << "The peer does not support batches of files";
+
+    batch_supported_ = false;
+
+    // The replies to the other batches in flight are ignored. Their tasks return to the queue in
+    // the original order and are transferred one by one.
+    for (auto batch = batches_.rbegin(); batch != batches_.rend(); ++batch)
+    {
+        for (auto task = batch->tasks.rbegin(); task != batch->tasks.rend(); ++task)
+            tasks_.emplace_front(std::move(*task));
+
+        for (auto task = batch->upload_tasks.rbegin(); task != batch->upload_tasks.rend(); ++task)
+            tasks_.emplace_front(std::move(*task));
+    }
+
+    batches_.clear();
+    doBatches();
+}
+
+void FileTransfer::addFailedTask(Task&& task, Error::Type type, proto::FileError code)
+{
+    failed_tasks_.push_back({ std::move(task), type, code });
+}
+
+void FileTransfer::updateProgress()
+{
+    // The sizes were taken when the queue was built. The file could grow since then.
+    const int64_t full_task_size = frontTask().size();
+    if (!full_task_size || !total_size_)
+        return;
+
+    const int task_percentage = static_cast<int>(
+        std::min(task_transfered_size_, full_task_size) * 100 / full_task_size);
+    const int total_percentage = static_cast<int>(
+        std::min(total_transfered_size_, total_size_) * 100 / total_size_);
+
+    if (task_percentage != task_percentage_ || total_percentage != total_percentage_)
+    {
+        task_percentage_ = task_percentage;
+        total_percentage_ = total_percentage;
+
+        transfer_window_proxy_->setCurrentProgress(total_percentage_, task_percentage_);
+    }
+}
+
 void FileTransfer::onFinished()
 {
+    // The transfer is aborted or stopped by the cancel timer in the middle of a file.
+    closeFiles();
+
+    // The replies to the batches in flight are ignored.
+    batches_.clear();
+
     FinishCallback callback;
     callback.swap(finish_callback_);
 
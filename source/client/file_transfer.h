@@ -20,6 +20,7 @@
 #define CLIENT__FILE_TRANSFER_H
 
 #include "base/waitable_timer.h"
+#include "common/file_packet_window.h"
 #include "common/file_task.h"
 #include "common/file_task_producer.h"
 #include "proto/file_transfer.pb.h"
@@ -179,6 +180,18 @@ private:
     void sourceReply(const proto::FileRequest& request, const proto::FileReply& reply);
     void doFrontTask(bool overwrite);
     void doNextTask();
+    void doPacketRequests();
+    void dropPacketsInFlight();
+    void closeFiles();
+    bool isBatchable(const Task& task) const;
+    void doBatches();
+    void startBatch();
+    void sendReadyBatches();
+    void onBatchRead(const proto::FileReply& reply);
+    void onBatchWritten(const proto::FileReply& reply);
+    void onBatchesUnsupported();
+    void addFailedTask(Task&& task, Error::Type type, proto::FileError code);
+    void updateProgress();
     void onError(Error::Type type, proto::FileError code, const std::string& path = std::string());
     void setActionForErrorType(Error::Type error_type, Error::Action action);
     void onFinished();
@@ -208,6 +221,73 @@ private:
     int total_percentage_ = 0;
     int task_percentage_ = 0;
 
+    // Packets of the current file are requested from the source without waiting for the previous
+    // packet to be written, as long as the window allows.
+    common::FilePacketWindow packet_window_;
+    uint32_t source_window_size_ = 0;
+    uint32_t source_max_packet_size_ = 0;
+
+    // The compression of the packet data. The source compresses packets in its file worker thread
+    // and the target decompresses them in its own.
+    proto::FileCompression source_compression_ = proto::FILE_COMPRESSION_NONE;
+    proto::FileCompression compression_ = proto::FILE_COMPRESSION_NONE;
+
+    // The source continues partial files and sends the difference to existing files.
+    bool source_sync_supported_ = false;
+
+    // The source splits files into chunks. New files are sent as references to the chunks which
+    // the target has from earlier transfers.
+    bool source_chunks_supported_ = false;
+
+    // The number of bytes of the current file which are not yet requested. The old peers do not
+    // report the file size; then packets are requested one by one until the last packet.
+    bool has_packets_to_request_ = false;
+    uint64_t bytes_to_request_ = 0;
+
+    // Packet requests waiting for the reply from the source and packets waiting for the reply from
+    // the target.
+    size_t source_in_flight_ = 0;
+    size_t target_in_flight_ = 0;
+
+    // Replies for the packets of a file whose transfer failed. They are still on the way and must
+    // be ignored.
+    size_t stale_source_replies_ = 0;
+    size_t stale_target_replies_ = 0;
+
+    // The source and the target keep the current file open until its last packet. If the transfer
+    // of the file ends earlier, the file is closed with a cancel. Otherwise the peer keeps its
+    // state and the lane of the file worker stays busy.
+    bool is_source_file_open_ = false;
+    bool is_target_file_open_ = false;
+
+    // Small files and directories from the front of the queue are transferred in batches. The
+    // batches are sent to the target in the order of the queue.
+    struct Batch
+    {
+        enum class State { READING, READY, WRITING };
+
+        State state = State::READING;
+        std::vector<Task> tasks;
+
+        // The items for the target and their tasks.
+        std::unique_ptr<proto::FileBatch> upload;
+        std::vector<Task> upload_tasks;
+    };
+
+    struct FailedTask
+    {
+        Task task;
+        Error::Type type;
+        proto::FileError code;
+    };
+
+    std::deque<Batch> batches_;
+    bool batch_supported_ = true;
+
+    // The tasks of the batches that failed. When the batches are completed, the tasks return to the
+    // front of the queue and their errors are handled as for single files.
+    std::deque<FailedTask> failed_tasks_;
+
     bool is_canceled_ = false;
 
     DISALLOW_COPY_AND_ASSIGN(FileTransfer);
@@ -0,0 +1,737 @@
+//
+// Aspia Project
+// Copyright (C) 2020 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+// Measures the throughput of file transfers without the UI. The client and the host run in one
+// process and are connected through a loopback NetworkChannel. The link between them can be slowed
+// down with a latency and a bandwidth limit.
+//
+// Usage: aspia_file_transfer_benchmark [--workload=large|small|mixed|all] [--download]
+//            [--latency=<ms>] [--bandwidth=<Mbit/s>] [--large-size=<MB>] [--small-count=<n>]
+//            [--dir=<path>]
+
+#include "base/command_line.h"
+#include "base/logging.h"
+#include "base/task_runner.h"
+#include "base/memory/byte_array.h"
+#include "base/message_loop/message_loop.h"
+#include "base/net/network_channel.h"
+#include "base/net/network_channel_proxy.h"
+#include "base/net/network_server.h"
+#include "base/strings/string_number_conversions.h"
+#include "base/strings/unicode.h"
+#include "base/threading/thread.h"
+#include "build/build_config.h"
+#include "client/file_transfer.h"
+#include "client/file_transfer_proxy.h"
+#include "client/file_transfer_window.h"
+#include "client/file_transfer_window_proxy.h"
+#include "common/file_task.h"
+#include "common/file_task_consumer.h"
+#include "common/file_task_consumer_proxy.h"
+#include "common/file_task_producer.h"
+#include "common/file_task_producer_proxy.h"
+#include "common/file_worker.h"
+#include "proto/file_transfer.pb.h"
+
+#if defined(OS_WIN)
+#include <Windows.h>
+#else
+#include <sys/resource.h>
+#endif // defined(OS_WIN)
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <filesystem>
+#include <fstream>
+#include <future>
+#include <random>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+// The file workers use as many threads as in the client and in the host.
+const size_t kWorkerThreads = 4;
+
+struct Options
+{
+    std::string workload = "all";
+    bool download = false;
+    std::chrono::milliseconds latency = std::chrono::milliseconds::zero();
+    int64_t bandwidth = 0; // bits per second, 0 means unlimited.
+    int64_t large_size = 512LL * 1024 * 1024;
+    int small_count = 5000;
+    std::filesystem::path dir;
+};
+
+struct Result
+{
+    bool succeeded = false;
+    int64_t messages = 0;
+    double seconds = 0;
+    double cpu_seconds = 0;
+};
+
+double processCpuSeconds()
+{
+#if defined(OS_WIN)
+    FILETIME creation_time, exit_time, kernel_time, user_time;
+    if (!GetProcessTimes(GetCurrentProcess(), &creation_time, &exit_time, &kernel_time, &user_time))
+        return 0;
+
+    auto toSeconds = [](const FILETIME& time)
+    {
+        ULARGE_INTEGER value;
+        value.LowPart = time.dwLowDateTime;
+        value.HighPart = time.dwHighDateTime;
+        return static_cast<double>(value.QuadPart) / 1e7; // 100 ns units.
+    };
+
+    return toSeconds(kernel_time) + toSeconds(user_time);
+#else
+    rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0)
+        return 0;
+
+    auto toSeconds = [](const timeval& time)
+    {
+        return static_cast<double>(time.tv_sec) + static_cast<double>(time.tv_usec) / 1e6;
+    };
+
+    return toSeconds(usage.ru_utime) + toSeconds(usage.ru_stime);
+#endif // defined(OS_WIN)
+}
+
+// Delays the messages of one direction of the link. A message leaves after the previous ones when
+// the link is limited and arrives |latency| later.
+class Link
+{
+public:
+    Link(std::shared_ptr<base::TaskRunner> task_runner,
+         std::shared_ptr<base::NetworkChannelProxy> channel_proxy,
+         const Options& options)
+        : task_runner_(std::move(task_runner)),
+          channel_proxy_(std::move(channel_proxy)),
+          latency_(options.latency),
+          bandwidth_(options.bandwidth)
+    {
+        // Nothing
+    }
+
+    void send(base::ByteArray&& message)
+    {
+        if (latency_ == std::chrono::milliseconds::zero() && !bandwidth_)
+        {
+            channel_proxy_->send(std::move(message));
+            return;
+        }
+
+        const Clock::time_point now = Clock::now();
+        Clock::time_point send_time = std::max(now, free_time_);
+
+        if (bandwidth_)
+        {
+            send_time += std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(
+                static_cast<double>(message.size()) * 8 / static_cast<double>(bandwidth_)));
+        }
+
+        free_time_ = send_time;
+
+        // The delays are rounded up, so the messages keep their order.
+        const auto delay = std::chrono::ceil<std::chrono::milliseconds>(send_time - now) + latency_;
+
+        task_runner_->postDelayedTask(
+            [channel_proxy = channel_proxy_, message = std::move(message)]() mutable
+        {
+            channel_proxy->send(std::move(message));
+        },
+        delay);
+    }
+
+private:
+    std::shared_ptr<base::TaskRunner> task_runner_;
+    std::shared_ptr<base::NetworkChannelProxy> channel_proxy_;
+    const std::chrono::milliseconds latency_;
+    const int64_t bandwidth_;
+
+    // The time when the link becomes free.
+    Clock::time_point free_time_;
+
+    DISALLOW_COPY_AND_ASSIGN(Link);
+};
+
+// The host side of the connection. Works on its own thread like the file transfer session of the
+// host.
+class Host
+    : public base::NetworkServer::Delegate,
+      public base::NetworkChannel::Listener,
+      public common::FileTaskProducer
+{
+public:
+    explicit Host(const Options& options)
+        : options_(options),
+          task_runner_(base::MessageLoop::current()->taskRunner()),
+          producer_proxy_(std::make_shared<common::FileTaskProducerProxy>(this)),
+          worker_(task_runner_, kWorkerThreads)
+    {
+        server_.start(0, this);
+    }
+
+    ~Host() override
+    {
+        producer_proxy_->dettach();
+        server_.stop();
+    }
+
+    uint16_t port() const { return server_.port(); }
+
+protected:
+    // base::NetworkServer::Delegate implementation.
+    void onNewConnection(std::unique_ptr<base::NetworkChannel> channel) override
+    {
+        channel_ = std::move(channel);
+        channel_->setListener(this);
+        channel_->setNoDelay(true);
+        channel_->resume();
+
+        link_ = std::make_unique<Link>(task_runner_, channel_->channelProxy(), options_);
+    }
+
+    // base::NetworkChannel::Listener implementation.
+    void onConnected() override
+    {
+        // Nothing
+    }
+
+    void onDisconnected(base::NetworkChannel::ErrorCode /* error_code */) override
+    {
+        // Nothing
+    }
+
+    void onMessageReceived(const base::ByteArray& buffer) override
+    {
+        std::unique_ptr<proto::FileRequest> request = std::make_unique<proto::FileRequest>();
+        if (!base::parse(buffer, request.get()))
+        {
+            LOG(LS_ERROR) << "Invalid message from client";
+            return;
+        }
+
+        worker_.doTask(std::make_shared<common::FileTask>(
+            producer_proxy_, std::move(request), common::FileTask::Target::LOCAL));
+    }
+
+    void onMessageWritten(size_t /* pending */) override
+    {
+        // Nothing
+    }
+
+    // common::FileTaskProducer implementation.
+    void onTaskDone(std::shared_ptr<common::FileTask> task) override
+    {
+        if (link_)
+            link_->send(base::serialize(task->reply()));
+    }
+
+private:
+    const Options options_;
+    std::shared_ptr<base::TaskRunner> task_runner_;
+    std::shared_ptr<common::FileTaskProducerProxy> producer_proxy_;
+    common::FileWorker worker_;
+    base::NetworkServer server_;
+    std::unique_ptr<base::NetworkChannel> channel_;
+    std::unique_ptr<Link> link_;
+
+    DISALLOW_COPY_AND_ASSIGN(Host);
+};
+
+// The client side. Runs the workloads one after another with client::FileTransfer.
+class Client
+    : public base::NetworkChannel::Listener,
+      public common::FileTaskConsumer,
+      public client::FileTransferWindow
+{
+public:
+    struct Workload
+    {
+        std::string name;
+        std::filesystem::path source;
+        std::filesystem::path target;
+        int64_t total_size = 0;
+        size_t file_count = 0;
+        Result result;
+    };
+
+    Client(const Options& options, std::vector<Workload>* workloads)
+        : options_(options),
+          task_runner_(base::MessageLoop::current()->taskRunner()),
+          workloads_(workloads),
+          consumer_proxy_(std::make_shared<common::FileTaskConsumerProxy>(this)),
+          window_proxy_(std::make_shared<client::FileTransferWindowProxy>(task_runner_, this)),
+          worker_(task_runner_, kWorkerThreads)
+    {
+        // Nothing
+    }
+
+    ~Client() override
+    {
+        transfer_.reset();
+        window_proxy_->dettach();
+        consumer_proxy_->dettach();
+    }
+
+    void connectToHost(uint16_t port)
+    {
+        channel_.setListener(this);
+        channel_.connect(u"127.0.0.1", port);
+    }
+
+    // common::FileTaskConsumer implementation.
+    void doTask(std::shared_ptr<common::FileTask> task) override
+    {
+        if (task->target() == common::FileTask::Target::LOCAL)
+        {
+            worker_.doTask(std::move(task));
+        }
+        else
+        {
+            ++messages_;
+            link_->send(base::serialize(task->request()));
+            remote_tasks_.emplace_back(std::move(task));
+        }
+    }
+
+protected:
+    // base::NetworkChannel::Listener implementation.
+    void onConnected() override
+    {
+        channel_.setNoDelay(true);
+        channel_.resume();
+
+        link_ = std::make_unique<Link>(task_runner_, channel_.channelProxy(), options_);
+        startWorkload();
+    }
+
+    void onDisconnected(base::NetworkChannel::ErrorCode error_code) override
+    {
+        LOG(LS_ERROR) << "Connection lost: " << base::NetworkChannel::errorToString(error_code);
+        task_runner_->postQuit();
+    }
+
+    void onMessageReceived(const base::ByteArray& buffer) override
+    {
+        std::unique_ptr<proto::FileReply> reply = std::make_unique<proto::FileReply>();
+        if (!base::parse(buffer, reply.get()))
+        {
+            LOG(LS_ERROR) << "Invalid message from host";
+            return;
+        }
+
+        ++messages_;
+
+        // The reply belongs to the oldest request of its lane.
+        auto task = std::find_if(remote_tasks_.begin(), remote_tasks_.end(),
+            [lane = reply->lane()](const std::shared_ptr<common::FileTask>& other)
+        {
+            return !lane || other->request().lane() == lane;
+        });
+
+        if (task == remote_tasks_.end())
+        {
+            LOG(LS_ERROR) << "Unexpected reply";
+            return;
+        }
+
+        std::shared_ptr<common::FileTask> current_task = std::move(*task);
+        remote_tasks_.erase(task);
+
+        current_task->setReply(std::move(reply));
+    }
+
+    void onMessageWritten(size_t /* pending */) override
+    {
+        // Nothing
+    }
+
+    // client::FileTransferWindow implementation.
+    void start(std::shared_ptr<client::FileTransferProxy> transfer_proxy) override
+    {
+        transfer_proxy_ = std::move(transfer_proxy);
+    }
+
+    void stop() override
+    {
+        // Nothing
+    }
+
+    void setCurrentItem(const std::string& /* source_path */,
+                        const std::string& /* target_path */) override
+    {
+        // Nothing
+    }
+
+    void setCurrentProgress(int /* total */, int /* current */) override
+    {
+        // Nothing
+    }
+
+    void errorOccurred(const client::FileTransfer::Error& error) override
+    {
+        fprintf(stderr, "Error %d (code %d) for '%s'. The workload is aborted.\n",
+                static_cast<int>(error.type()), static_cast<int>(error.code()),
+                error.path().c_str());
+
+        has_error_ = true;
+        transfer_proxy_->setAction(error.type(), client::FileTransfer::Error::ACTION_ABORT);
+    }
+
+private:
+    void startWorkload()
+    {
+        if (current_ == workloads_->size())
+        {
+            task_runner_->postQuit();
+            return;
+        }
+
+        Workload& workload = (*workloads_)[current_];
+
+        std::error_code ignored_error;
+        std::filesystem::remove_all(workload.target, ignored_error);
+        std::filesystem::create_directories(workload.target, ignored_error);
+
+        // The source directory is transferred as one item.
+        std::vector<client::FileTransfer::Item> items;
+        items.emplace_back(workload.source.filename().u8string(), 0, true);
+
+        const client::FileTransfer::Type type = options_.download ?
+            client::FileTransfer::Type::DOWNLOADER : client::FileTransfer::Type::UPLOADER;
+
+        transfer_ = std::make_unique<client::FileTransfer>(
+            task_runner_, window_proxy_, consumer_proxy_, type);
+
+        has_error_ = false;
+        messages_ = 0;
+        start_time_ = Clock::now();
+        start_cpu_ = processCpuSeconds();
+
+        transfer_->start(workload.source.parent_path().u8string(),
+                         workload.target.u8string(),
+                         items,
+                         [this]()
+        {
+            // The transfer is deleted outside of its own call.
+            task_runner_->postTask(std::bind(&Client::onWorkloadFinished, this));
+        });
+    }
+
+    void onWorkloadFinished()
+    {
+        Workload& workload = (*workloads_)[current_];
+
+        workload.result.seconds = std::chrono::duration<double>(Clock::now() - start_time_).count();
+        workload.result.cpu_seconds = processCpuSeconds() - start_cpu_;
+        workload.result.messages = messages_;
+        workload.result.succeeded = !has_error_ &&
+            directorySize(workload.target / workload.source.filename()) == workload.total_size;
+
+        transfer_.reset();
+        transfer_proxy_.reset();
+
+        ++current_;
+        startWorkload();
+    }
+
+    static int64_t directorySize(const std::filesystem::path& path)
+    {
+        int64_t size = 0;
+        std::error_code error_code;
+
+        for (std::filesystem::recursive_directory_iterator it(path, error_code), end;
+             !error_code && it != end;
+             it.increment(error_code))
+        {
+            std::error_code ignored_error;
+            if (it->is_regular_file(ignored_error))
+                size += static_cast<int64_t>(it->file_size(ignored_error));
+        }
+
+        return size;
+    }
+
+    const Options options_;
+    std::shared_ptr<base::TaskRunner> task_runner_;
+    std::vector<Workload>* workloads_;
+    size_t current_ = 0;
+
+    std::shared_ptr<common::FileTaskConsumerProxy> consumer_proxy_;
+    std::shared_ptr<client::FileTransferWindowProxy> window_proxy_;
+    std::shared_ptr<client::FileTransferProxy> transfer_proxy_;
+    common::FileWorker worker_;
+
+    base::NetworkChannel channel_;
+    std::unique_ptr<Link> link_;
+    std::deque<std::shared_ptr<common::FileTask>> remote_tasks_;
+
+    std::unique_ptr<client::FileTransfer> transfer_;
+    bool has_error_ = false;
+    int64_t messages_ = 0;
+    Clock::time_point start_time_;
+    double start_cpu_ = 0;
+
+    DISALLOW_COPY_AND_ASSIGN(Client);
+};
+
+// Writes a file of |size| bytes. Half of each block is random and half is repeated text, so the
+// data is partly compressible like typical files.
+bool writeFile(const std::filesystem::path& path, int64_t size, std::mt19937_64* random)
+{
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    if (!file)
+        return false;
+
+    static const char kText[] = "The quick brown fox jumps over the lazy dog. ";
+    std::string block(64 * 1024, 0);
+
+    while (size > 0)
+    {
+        for (size_t i = 0; i < block.size() / 2; i += sizeof(uint64_t))
+        {
+            const uint64_t value = (*random)();
+            memcpy(block.data() + i, &value, sizeof(value));
+        }
+
+        for (size_t i = block.size() / 2; i < block.size(); ++i)
+            block[i] = kText[i % (sizeof(kText) - 1)];
+
+        const size_t write_size = static_cast<size_t>(std::min<int64_t>(size, block.size()));
+        file.write(block.data(), static_cast<std::streamsize>(write_size));
+        size -= static_cast<int64_t>(write_size);
+    }
+
+    return static_cast<bool>(file);
+}
+
+// Creates |count| files of |size| bytes in subdirectories of 100 files.
+bool writeFiles(const std::filesystem::path& path,
+                int count,
+                int64_t size,
+                std::mt19937_64* random,
+                Client::Workload* workload)
+{
+    for (int i = 0; i < count; ++i)
+    {
+        std::filesystem::path file_path = path;
+        file_path.append("dir" + std::to_string(i / 100));
+
+        std::error_code ignored_error;
+        std::filesystem::create_directories(file_path, ignored_error);
+
+        file_path.append("file" + std::to_string(i) + ".bin");
+        if (!writeFile(file_path, size, random))
+            return false;
+
+        workload->total_size += size;
+        ++workload->file_count;
+    }
+
+    return true;
+}
+
+bool createWorkload(const std::string& name, const Options& options, Client::Workload* workload)
+{
+    std::mt19937_64 random(1);
+
+    workload->name = name;
+    workload->source = options.dir / "source" / name;
+    workload->target = options.dir / "target" / name;
+
+    std::error_code ignored_error;
+    std::filesystem::remove_all(workload->source, ignored_error);
+    std::filesystem::create_directories(workload->source, ignored_error);
+
+    if (name == "large")
+        return writeFiles(workload->source, 1, options.large_size, &random, workload);
+
+    if (name == "small")
+        return writeFiles(workload->source, options.small_count, 4 * 1024, &random, workload);
+
+    // Mixed: some large files, many small files and medium files between them.
+    return writeFiles(workload->source / "large", 4, options.large_size / 16, &random, workload) &&
+           writeFiles(workload->source / "medium", 200, 256 * 1024, &random, workload) &&
+           writeFiles(workload->source / "small", options.small_count / 2, 8 * 1024, &random,
+                      workload);
+}
+
+bool parseOptions(const base::CommandLine& command_line, Options* options)
+{
+    if (command_line.hasSwitch(u"workload"))
+        options->workload = base::utf8FromUtf16(command_line.switchValue(u"workload"));
+
+    options->download = command_line.hasSwitch(u"download");
+
+    if (command_line.hasSwitch(u"latency"))
+    {
+        int latency;
+        if (!base::stringToInt(command_line.switchValue(u"latency"), &latency) || latency < 0)
+            return false;
+
+        options->latency = std::chrono::milliseconds(latency);
+    }
+
+    if (command_line.hasSwitch(u"bandwidth"))
+    {
+        int64_t bandwidth;
+        if (!base::stringToInt64(command_line.switchValue(u"bandwidth"), &bandwidth) ||
+            bandwidth < 0)
+        {
+            return false;
+        }
+
+        options->bandwidth = bandwidth * 1000 * 1000;
+    }
+
+    if (command_line.hasSwitch(u"large-size"))
+    {
+        int64_t size;
+        if (!base::stringToInt64(command_line.switchValue(u"large-size"), &size) || size <= 0)
+            return false;
+
+        options->large_size = size * 1024 * 1024;
+    }
+
+    if (command_line.hasSwitch(u"small-count"))
+    {
+        if (!base::stringToInt(command_line.switchValue(u"small-count"), &options->small_count) ||
+            options->small_count <= 0)
+        {
+            return false;
+        }
+    }
+
+    if (command_line.hasSwitch(u"dir"))
+    {
+        options->dir = command_line.switchValuePath(u"dir");
+    }
+    else
+    {
+        std::error_code ignored_error;
+        options->dir = std::filesystem::temp_directory_path(ignored_error);
+        options->dir.append("aspia_file_transfer_benchmark");
+    }
+
+    return options->workload == "all" || options->workload == "large" ||
+           options->workload == "small" || options->workload == "mixed";
+}
+
+} // namespace
+
+int main(int argc, const char* const* argv)
+{
+    base::CommandLine::init(argc, argv);
+
+    Options options;
+    if (!parseOptions(*base::CommandLine::forCurrentProcess(), &options))
+    {
+        fprintf(stderr, "Usage: aspia_file_transfer_benchmark [--workload=large|small|mixed|all] "
+                        "[--download] [--latency=<ms>] [--bandwidth=<Mbit/s>] "
+                        "[--large-size=<MB>] [--small-count=<n>] [--dir=<path>]\n");
+        return 1;
+    }
+
+    std::vector<Client::Workload> workloads;
+
+    for (const char* name : { "large", "small", "mixed" })
+    {
+        if (options.workload != "all" && options.workload != name)
+            continue;
+
+        printf("Creating %s workload...\n", name);
+
+        Client::Workload workload;
+        if (!createWorkload(name, options, &workload))
+        {
+            fprintf(stderr, "Unable to create the files in %s\n", options.dir.u8string().c_str());
+            return 1;
+        }
+
+        // For downloads the files of the host are copied to the client.
+        workloads.emplace_back(std::move(workload));
+    }
+
+    base::Thread host_thread;
+    host_thread.start(base::MessageLoop::Type::ASIO);
+
+    std::unique_ptr<Host> host;
+    std::promise<uint16_t> port;
+
+    host_thread.taskRunner()->postTask([&]()
+    {
+        host = std::make_unique<Host>(options);
+        port.set_value(host->port());
+    });
+
+    {
+        base::MessageLoop message_loop(base::MessageLoop::Type::ASIO);
+
+        Client client(options, &workloads);
+        client.connectToHost(port.get_future().get());
+
+        message_loop.run();
+    }
+
+    host_thread.taskRunner()->postTask([&]()
+    {
+        host.reset();
+    });
+    host_thread.stop();
+
+    printf("\n%s, latency %lld ms, bandwidth %s\n",
+           options.download ? "Download" : "Upload",
+           static_cast<long long>(options.latency.count()),
+           options.bandwidth ? (std::to_string(options.bandwidth / 1000000) + " Mbit/s").c_str() :
+                               "unlimited");
+    printf("%-8s %8s %10s %9s %9s %11s %10s  %s\n",
+           "workload", "files", "MB", "seconds", "MB/s", "messages/s", "CPU s/GB", "result");
+
+    bool succeeded = true;
+
+    for (const auto& workload : workloads)
+    {
+        const Result& result = workload.result;
+        const double megabytes = static_cast<double>(workload.total_size) / (1024 * 1024);
+        const double seconds = std::max(result.seconds, 1e-6);
+
+        printf("%-8s %8zu %10.1f %9.2f %9.1f %11.0f %10.2f  %s\n",
+               workload.name.c_str(),
+               workload.file_count,
+               megabytes,
+               result.seconds,
+               megabytes / seconds,
+               static_cast<double>(result.messages) / seconds,
+               result.cpu_seconds / (megabytes / 1024),
+               result.succeeded ? "ok" : "FAILED");
+
+        succeeded = succeeded && result.succeeded;
+    }
+
+    // The CPU time includes both peers and the loopback network.
+    return succeeded ? 0 : 1;
+}
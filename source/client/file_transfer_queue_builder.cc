@@ -19,12 +19,20 @@
 #include "client/file_transfer_queue_builder.h"
 
 #include "base/logging.h"
+#include "common/file_list_cursor.h"
 #include "common/file_task_factory.h"
 #include "common/file_task_consumer_proxy.h"
 #include "common/file_task_producer_proxy.h"
 
 namespace client {
 
+namespace {
+
+// The maximum number of directories which are listed at the same time.
+const size_t kMaxListRequests = 8;
+
+} // namespace
+
 FileTransferQueueBuilder::FileTransferQueueBuilder(
     std::shared_ptr<common::FileTaskConsumerProxy> task_consumer_proxy,
     common::FileTask::Target target)
@@ -50,7 +58,7 @@ void FileTransferQueueBuilder::start(const std::string& source_path,
     DCHECK(callback_);
 
     for (const auto& item : items)
-        addPendingTask(source_path, target_path, item.name, item.is_directory, item.size);
+        addTask(&pending_tasks_, source_path, target_path, item.name, item.is_directory, item.size);
 
     doPendingTasks();
 }
@@ -67,7 +75,7 @@ int64_t FileTransferQueueBuilder::totalSize() const
 
 void FileTransferQueueBuilder::onTaskDone(std::shared_ptr<common::FileTask> task)
 {
-    DCHECK(!tasks_.empty());
+    DCHECK(!listing_.empty());
 
     const proto::FileRequest& request = task->request();
     const proto::FileReply& reply = task->reply();
@@ -84,58 +92,85 @@ void FileTransferQueueBuilder::onTaskDone(std::shared_ptr<common::FileTask> task
         return;
     }
 
-    // If we get a list of files, then the last task is a directory.
-    const FileTransfer::Task& last_task = tasks_.back();
-    DCHECK(last_task.isDirectory());
+    const size_t directory_index = listing_.front();
+    listing_.pop_front();
+
+    const FileTransfer::Task& directory = tasks_[directory_index];
+    DCHECK(directory.isDirectory());
+
+    const proto::FileList& file_list = reply.file_list();
 
-    for (int i = 0; i < reply.file_list().item_size(); ++i)
+    // The items of a recursive list follow their directories and need no more requests. Old peers
+    // list only the directory itself.
+    FileTransfer::TaskList* list = file_list.recursive() ? &tasks_ : &pending_tasks_;
+
+    for (int i = 0; i < file_list.item_size(); ++i)
     {
-        const proto::FileList::Item& item = reply.file_list().item(i);
+        const proto::FileList::Item& item = file_list.item(i);
+
+        addTask(list,
+                directory.sourcePath(),
+                directory.targetPath(),
+                item.name(),
+                item.is_directory(),
+                item.size());
+    }
 
-        addPendingTask(last_task.sourcePath(),
-                       last_task.targetPath(),
-                       item.name(),
-                       item.is_directory(),
-                       item.size());
+    if (file_list.next_page_token())
+    {
+        listing_.emplace_back(directory_index);
+        task_consumer_proxy_->doTask(task_factory_->fileListPage(
+            file_list.next_page_token(), common::kFileListPageSize));
     }
 
     doPendingTasks();
 }
 
-void FileTransferQueueBuilder::addPendingTask(const std::string& source_dir,
-                                              const std::string& target_dir,
-                                              const std::string& item_name,
-                                              bool is_directory,
-                                              int64_t size)
+void FileTransferQueueBuilder::addTask(FileTransfer::TaskList* list,
+                                       const std::string& source_dir,
+                                       const std::string& target_dir,
+                                       const std::string& item_name,
+                                       bool is_directory,
+                                       int64_t size)
 {
     total_size_ += size;
 
     std::string source_path = source_dir + '/' + item_name;
     std::string target_path = target_dir + '/' + item_name;
 
-    pending_tasks_.emplace_back(std::move(source_path), std::move(target_path), is_directory, size);
+    list->emplace_back(std::move(source_path), std::move(target_path), is_directory, size);
 }
 
 void FileTransferQueueBuilder::doPendingTasks()
 {
+    // The tasks are added in the order of the pending tasks, so a directory always precedes its
+    // contents.
     while (!pending_tasks_.empty())
     {
-        tasks_.emplace_back(std::move(pending_tasks_.front()));
-        pending_tasks_.pop_front();
-
-        if (tasks_.back().isDirectory())
+        if (pending_tasks_.front().isDirectory())
         {
-            task_consumer_proxy_->doTask(task_factory_->fileList(tasks_.back().sourcePath()));
-            return;
+            if (listing_.size() >= kMaxListRequests)
+                return;
+
+            listing_.emplace_back(tasks_.size());
+            task_consumer_proxy_->doTask(task_factory_->fileList(
+                pending_tasks_.front().sourcePath(), common::kFileListPageSize, true));
         }
+
+        tasks_.emplace_back(std::move(pending_tasks_.front()));
+        pending_tasks_.pop_front();
     }
 
+    if (!listing_.empty())
+        return;
+
     callback_(proto::FILE_ERROR_SUCCESS);
 }
 
 void FileTransferQueueBuilder::onAborted(proto::FileError error_code)
 {
     pending_tasks_.clear();
+    listing_.clear();
     tasks_.clear();
     total_size_ = 0;
 
@@ -48,11 +48,12 @@ protected:
     void onTaskDone(std::shared_ptr<common::FileTask> task) override;
 
 private:
-    void addPendingTask(const std::string& source_dir,
-                        const std::string& target_dir,
-                        const std::string& item_name,
-                        bool is_directory,
-                        int64_t size);
+    void addTask(FileTransfer::TaskList* list,
+                 const std::string& source_dir,
+                 const std::string& target_dir,
+                 const std::string& item_name,
+                 bool is_directory,
+                 int64_t size);
     void doPendingTasks();
     void onAborted(proto::FileError error_code);
 
@@ -64,6 +65,10 @@ private:
 
     FileTransfer::TaskList pending_tasks_;
     FileTransfer::TaskList tasks_;
+
+    // The directories are listed without waiting for the previous lists. The replies come in the
+    // order of the requests. The queue contains indexes of the directories in |tasks_|.
+    std::deque<size_t> listing_;
     int64_t total_size_ = 0;
 
     DISALLOW_COPY_AND_ASSIGN(FileTransferQueueBuilder);
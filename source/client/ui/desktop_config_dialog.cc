@@ -59,6 +59,9 @@ DesktopConfigDialog::DesktopConfigDialog(proto::SessionType session_type,
     if (video_encodings & proto::VIDEO_ENCODING_ZSTD)
         combo_codec->addItem(QLatin1String("ZSTD"), proto::VIDEO_ENCODING_ZSTD);
 
+    if (video_encodings & proto::VIDEO_ENCODING_HYBRID)
+        combo_codec->addItem(QLatin1String("ZSTD + VP9"), proto::VIDEO_ENCODING_HYBRID);
+
     int current_codec = combo_codec->findData(config_.video_encoding());
     if (current_codec == -1)
         current_codec = 0;
@@ -125,6 +128,12 @@ DesktopConfigDialog::DesktopConfigDialog(proto::SessionType session_type,
     if (config_.flags() & proto::DISABLE_FONT_SMOOTHING)
         ui.checkbox_font_smoothing->setChecked(true);
 
+    if (config_.flags() & proto::ENABLE_COLOR_444)
+        ui.checkbox_color_444->setChecked(true);
+
+    if (config_.flags() & proto::ENABLE_PROGRESSIVE)
+        ui.checkbox_progressive->setChecked(true);
+
     connect(combo_codec, QOverload<int>::of(&QComboBox::currentIndexChanged),
             this, &DesktopConfigDialog::onCodecChanged);
 
@@ -139,8 +148,11 @@ DesktopConfigDialog::~DesktopConfigDialog() = default;
 
 void DesktopConfigDialog::onCodecChanged(int item_index)
 {
-    bool has_pixel_format =
-        (ui.combo_codec->itemData(item_index).toInt() == proto::VIDEO_ENCODING_ZSTD);
+    const int video_encoding = ui.combo_codec->itemData(item_index).toInt();
+
+    // The hybrid encoding sends the text with Zstd.
+    bool has_pixel_format = (video_encoding == proto::VIDEO_ENCODING_ZSTD ||
+                             video_encoding == proto::VIDEO_ENCODING_HYBRID);
 
     ui.label_color_depth->setEnabled(has_pixel_format);
     ui.combo_color_depth->setEnabled(has_pixel_format);
@@ -148,6 +160,12 @@ void DesktopConfigDialog::onCodecChanged(int item_index)
     ui.slider_compression_ratio->setEnabled(has_pixel_format);
     ui.label_fast->setEnabled(has_pixel_format);
     ui.label_best->setEnabled(has_pixel_format);
+
+    // Only VP9 supports images without chroma subsampling.
+    ui.checkbox_color_444->setEnabled(video_encoding == proto::VIDEO_ENCODING_VP9);
+
+    // The progressive mode improves the reduced pixel formats of Zstd.
+    ui.checkbox_progressive->setEnabled(video_encoding == proto::VIDEO_ENCODING_ZSTD);
 }
 
 void DesktopConfigDialog::onCompressionRatioChanged(int value)
@@ -164,7 +182,8 @@ void DesktopConfigDialog::onButtonBoxClicked(QAbstractButton* button)
 
         config_.set_video_encoding(video_encoding);
 
-        if (video_encoding == proto::VIDEO_ENCODING_ZSTD)
+        if (video_encoding == proto::VIDEO_ENCODING_ZSTD ||
+            video_encoding == proto::VIDEO_ENCODING_HYBRID)
         {
             base::PixelFormat pixel_format;
 
@@ -223,6 +242,12 @@ void DesktopConfigDialog::onButtonBoxClicked(QAbstractButton* button)
         if (ui.checkbox_lock_at_disconnect->isChecked())
             flags |= proto::LOCK_AT_DISCONNECT;
 
+        if (ui.checkbox_color_444->isChecked() && ui.checkbox_color_444->isEnabled())
+            flags |= proto::ENABLE_COLOR_444;
+
+        if (ui.checkbox_progressive->isChecked() && ui.checkbox_progressive->isEnabled())
+            flags |= proto::ENABLE_PROGRESSIVE;
+
         config_.set_flags(flags);
 
         emit configChanged(config_);
@@ -105,6 +105,11 @@ void FileList::showFileList(const proto::FileList& file_list)
     model_->setFileList(file_list);
 }
 
+void FileList::addFileList(const proto::FileList& file_list)
+{
+    model_->addFileList(file_list);
+}
+
 void FileList::setMimeType(const QString& mime_type)
 {
     model_->setMimeType(mime_type);
@@ -39,6 +39,7 @@ public:
 
     void showDriveList(AddressBarModel* model);
     void showFileList(const proto::FileList& file_list);
+    void addFileList(const proto::FileList& file_list);
     void setMimeType(const QString& mime_type);
     bool isDriveListShown() const;
     bool isFileListShown() const;
@@ -104,11 +104,13 @@ void FileListModel::setMimeType(const QString& mime_type)
 void FileListModel::setFileList(const proto::FileList& list)
 {
     clear();
+    addFileList(list);
+}
 
-    if (!list.item_size())
-        return;
-
-    beginInsertRows(QModelIndex(), 0, list.item_size() - 1);
+void FileListModel::addFileList(const proto::FileList& list)
+{
+    QList<Folder> folders;
+    QList<File> files;
 
     for (int i = 0; i < list.item_size(); ++i)
     {
@@ -120,7 +122,7 @@ void FileListModel::setFileList(const proto::FileList& list)
             folder.name       = QString::fromStdString(item.name());
             folder.last_write = item.modification_time();
 
-            folder_items_.append(folder);
+            folders.append(folder);
         }
         else
         {
@@ -133,13 +135,37 @@ void FileListModel::setFileList(const proto::FileList& list)
             file.icon = file_info.first;
             file.type = file_info.second;
 
-            file_items_.append(file);
+            files.append(file);
         }
     }
 
-    sortItems(current_column_, current_order_);
+    // The folders are shown before the files.
+    if (!folders.isEmpty())
+    {
+        const int first_row = folder_items_.count();
 
-    endInsertRows();
+        beginInsertRows(QModelIndex(), first_row, first_row + folders.count() - 1);
+        folder_items_.append(folders);
+        endInsertRows();
+    }
+
+    if (!files.isEmpty())
+    {
+        const int first_row = folder_items_.count() + file_items_.count();
+
+        beginInsertRows(QModelIndex(), first_row, first_row + files.count() - 1);
+        file_items_.append(files);
+        endInsertRows();
+    }
+
+    // A large list comes in pages. The pages are shown as they arrive and the whole list is sorted
+    // once after the last one.
+    if (!list.next_page_token())
+    {
+        emit layoutAboutToBeChanged();
+        sortItems(current_column_, current_order_);
+        emit layoutChanged();
+    }
 }
 
 void FileListModel::setSortOrder(int column, Qt::SortOrder order)
@@ -36,6 +36,7 @@ public:
     void setMimeType(const QString& mime_type);
     QString mimeType() const { return mime_type_; }
     void setFileList(const proto::FileList& file_list);
+    void addFileList(const proto::FileList& file_list);
     void setSortOrder(int column, Qt::SortOrder order);
     void clear();
     bool isFolder(const QModelIndex& index) const;
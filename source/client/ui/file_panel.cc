@@ -128,6 +128,18 @@ void FilePanel::onFileList(proto::FileError error_code, const proto::FileList& f
     setEnabled(true);
 }
 
+void FilePanel::onFileListPage(proto::FileError error_code, const proto::FileList& file_list)
+{
+    if (error_code != proto::FILE_ERROR_SUCCESS)
+    {
+        showError(tr("Failed to get list of files: %1").arg(fileErrorToString(error_code)));
+        return;
+    }
+
+    if (ui.list->isFileListShown())
+        ui.list->addFileList(file_list);
+}
+
 void FilePanel::onCreateDirectory(proto::FileError error_code)
 {
     if (error_code != proto::FILE_ERROR_SUCCESS)
@@ -36,6 +36,7 @@ public:
 
     void onDriveList(proto::FileError error_code, const proto::DriveList& drive_list);
     void onFileList(proto::FileError error_code, const proto::FileList& file_list);
+    void onFileListPage(proto::FileError error_code, const proto::FileList& file_list);
     void onCreateDirectory(proto::FileError error_code);
     void onRename(proto::FileError error_code);
 
@@ -59,6 +59,9 @@ public:
     void onFileList(common::FileTask::Target target,
                     proto::FileError error_code,
                     const proto::FileList& file_list) override;
+    void onFileListPage(common::FileTask::Target target,
+                        proto::FileError error_code,
+                        const proto::FileList& file_list) override;
     void onCreateDirectory(common::FileTask::Target target, proto::FileError error_code) override;
     void onRename(common::FileTask::Target target, proto::FileError error_code) override;
 
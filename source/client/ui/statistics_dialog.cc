@@ -99,6 +99,19 @@ void StatisticsDialog::setMetrics(const DesktopWindow::Metrics& metrics)
             case 13:
                 item->setText(1, QString::number(metrics.send_clipboard));
                 break;
+
+            case 14:
+                item->setText(1, QString("%1 ms").arg(metrics.frame_latency.count()));
+                break;
+
+            case 15:
+                item->setText(1, QString::number(metrics.frames_in_flight));
+                break;
+
+            case 16:
+                item->setText(1, QString("%1 ms").arg(
+                    static_cast<double>(metrics.decode_time.count()) / 1000.0, 0, 'f', 2));
+                break;
         }
     }
 }
@@ -35,6 +35,6 @@ const char kSupportedExtensionsForView[] =
 
 const uint32_t kSupportedVideoEncodings =
     proto::VIDEO_ENCODING_VP8 | proto::VIDEO_ENCODING_VP9 |
-    proto::VIDEO_ENCODING_ZSTD;
+    proto::VIDEO_ENCODING_ZSTD | proto::VIDEO_ENCODING_HYBRID;
 
 } // namespace common
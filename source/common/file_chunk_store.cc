@@ -0,0 +1,352 @@
+//
+// Aspia Project
+// Copyright (C) 2020 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "common/file_chunk_store.h"
+
+#include "base/logging.h"
+#include "base/files/base_paths.h"
+#include "base/files/file.h"
+#include "base/memory/byte_array.h"
+#include "common/file_chunker.h"
+
+#include <algorithm>
+#include <map>
+#include <vector>
+
+namespace common {
+
+namespace {
+
+const char kTempFileExtension[] = ".tmp";
+
+std::string hashToName(std::string_view hash)
+{
+    return base::toHex(base::fromData(hash.data(), hash.size()));
+}
+
+} // namespace
+
+FileChunkStore::FileChunkStore(const std::filesystem::path& directory, uint64_t max_size)
+    : directory_(directory),
+      max_size_(max_size)
+{
+    // Nothing
+}
+
+FileChunkStore::~FileChunkStore() = default;
+
+// static
+std::shared_ptr<FileChunkStore> FileChunkStore::open(
+    const std::filesystem::path& directory, uint64_t max_size)
+{
+    static std::mutex stores_lock;
+    static std::map<std::filesystem::path, std::weak_ptr<FileChunkStore>> stores;
+
+    std::scoped_lock lock(stores_lock);
+
+    std::shared_ptr<FileChunkStore> store = stores[directory].lock();
+    if (store)
+        return store;
+
+    std::error_code error_code;
+    std::filesystem::create_directories(directory, error_code);
+    if (error_code)
+    {
+        LOG(LS_WARNING) << "Unable to create chunk store: " << error_code.message();
+        return nullptr;
+    }
+
+    store.reset(new FileChunkStore(directory, max_size));
+    store->load();
+
+    stores[directory] = store;
+    return store;
+}
+
+// static
+std::shared_ptr<FileChunkStore> FileChunkStore::openForCurrentUser()
+{
+    std::filesystem::path directory;
+    if (!base::BasePaths::userLocalAppData(&directory))
+        return nullptr;
+
+    directory.append("aspia");
+    directory.append("file_chunks");
+
+    return open(directory);
+}
+
+std::string FileChunkStore::find(const proto::FileChunkList& chunk_list)
+{
+    std::string present_chunks;
+    present_chunks.resize((chunk_list.size_size() + 7) / 8);
+
+    std::scoped_lock lock(lock_);
+
+    for (int i = 0; i < chunk_list.size_size(); ++i)
+    {
+        auto chunk = chunks_.find(std::string(fileChunkHashAt(chunk_list, i)));
+        if (chunk == chunks_.end() || chunk->second.size != chunk_list.size(i))
+            continue;
+
+        touch(chunk->second);
+        ++chunk->second.pin_count;
+        present_chunks[i / 8] |= static_cast<char>(1 << (i % 8));
+    }
+
+    return present_chunks;
+}
+
+void FileChunkStore::unpin(const proto::FileChunkList& chunk_list,
+                           const std::string& present_chunks)
+{
+    std::scoped_lock lock(lock_);
+
+    for (int i = 0; i < chunk_list.size_size(); ++i)
+    {
+        if (!isChunkPresent(present_chunks, static_cast<size_t>(i)))
+            continue;
+
+        // A damaged chunk could be removed and added again while it was pinned.
+        auto chunk = chunks_.find(std::string(fileChunkHashAt(chunk_list, i)));
+        if (chunk != chunks_.end() && chunk->second.pin_count)
+            --chunk->second.pin_count;
+    }
+
+    // The chunks added while the store was full of pinned chunks.
+    evict();
+}
+
+bool FileChunkStore::read(std::string_view hash, std::string* data)
+{
+    DCHECK(data);
+
+    std::scoped_lock lock(lock_);
+
+    auto chunk = chunks_.find(std::string(hash));
+    if (chunk == chunks_.end())
+        return false;
+
+    const std::filesystem::path file_path = chunkPath(hash);
+
+    base::File file(file_path, base::File::FLAG_OPEN | base::File::FLAG_READ);
+    if (file.isValid())
+    {
+        data->resize(static_cast<size_t>(chunk->second.size));
+
+        if (file.read(0, data->data(), data->size()) == static_cast<int64_t>(data->size()) &&
+            fileChunkHash(reinterpret_cast<const uint8_t*>(data->data()), data->size()) == hash)
+        {
+            file.close();
+            touch(chunk->second);
+
+            // The order of the chunks is restored from the modification times when the store is
+            // opened again.
+            std::error_code ignored_error;
+            std::filesystem::last_write_time(
+                file_path, std::filesystem::file_time_type::clock::now(), ignored_error);
+            return true;
+        }
+
+        file.close();
+    }
+
+    LOG(LS_WARNING) << "Damaged chunk: " << file_path;
+    remove(std::string(hash));
+    return false;
+}
+
+bool FileChunkStore::add(std::string_view hash, std::string_view data)
+{
+    if (data.empty() || data.size() > kMaxFileChunkSize || data.size() > max_size_ ||
+        fileChunkHash(reinterpret_cast<const uint8_t*>(data.data()), data.size()) != hash)
+    {
+        return false;
+    }
+
+    std::scoped_lock lock(lock_);
+
+    std::string key(hash);
+
+    auto chunk = chunks_.find(key);
+    if (chunk != chunks_.end())
+    {
+        touch(chunk->second);
+        return true;
+    }
+
+    const std::filesystem::path file_path = chunkPath(hash);
+
+    std::error_code error_code;
+    std::filesystem::create_directories(file_path.parent_path(), error_code);
+
+    // The chunk appears in the store only when its file is complete.
+    std::filesystem::path temp_path = file_path;
+    temp_path += kTempFileExtension;
+
+    base::File file(temp_path, base::File::FLAG_CREATE_ALWAYS | base::File::FLAG_WRITE);
+    if (!file.isValid() || !file.write(0, data.data(), data.size()))
+    {
+        LOG(LS_WARNING) << "Unable to write chunk: " << temp_path;
+        file.close();
+        std::filesystem::remove(temp_path, error_code);
+        return false;
+    }
+
+    file.close();
+
+    std::filesystem::rename(temp_path, file_path, error_code);
+    if (error_code)
+    {
+        LOG(LS_WARNING) << "Unable to rename chunk: " << error_code.message();
+        std::filesystem::remove(temp_path, error_code);
+        return false;
+    }
+
+    lru_.push_front(key);
+    chunks_.emplace(std::move(key), Chunk{ data.size(), lru_.begin() });
+    total_size_ += data.size();
+
+    evict();
+    return true;
+}
+
+uint64_t FileChunkStore::size() const
+{
+    std::scoped_lock lock(lock_);
+    return total_size_;
+}
+
+void FileChunkStore::load()
+{
+    struct Entry
+    {
+        std::filesystem::file_time_type time;
+        std::string hash;
+        uint64_t size;
+    };
+
+    std::vector<Entry> entries;
+    std::error_code error_code;
+
+    for (std::filesystem::recursive_directory_iterator it(directory_, error_code), end;
+         !error_code && it != end;
+         it.increment(error_code))
+    {
+        std::error_code ignored_error;
+        if (!it->is_regular_file(ignored_error))
+            continue;
+
+        const std::filesystem::path& file_path = it->path();
+
+        // The chunks which were not completely written.
+        if (file_path.extension() == kTempFileExtension)
+        {
+            std::filesystem::remove(file_path, ignored_error);
+            continue;
+        }
+
+        const std::string name = file_path.filename().u8string();
+        base::ByteArray hash = base::fromHex(name);
+        if (hash.size() != kFileChunkHashSize || hashToName(base::toStdString(hash)) != name)
+            continue;
+
+        const uintmax_t size = it->file_size(ignored_error);
+        if (ignored_error || !size || size > kMaxFileChunkSize)
+            continue;
+
+        entries.push_back(
+            Entry{ it->last_write_time(ignored_error), base::toStdString(hash), size });
+    }
+
+    // The most recently used chunks are at the front of the list.
+    std::sort(entries.begin(), entries.end(), [](const Entry& first, const Entry& second)
+    {
+        return first.time > second.time;
+    });
+
+    std::scoped_lock lock(lock_);
+
+    for (auto& entry : entries)
+    {
+        lru_.push_back(entry.hash);
+        chunks_.emplace(std::move(entry.hash), Chunk{ entry.size, std::prev(lru_.end()) });
+        total_size_ += entry.size;
+    }
+
+    LOG(LS_INFO) << "Chunk store: " << chunks_.size() << " chunks, " << total_size_ << " bytes";
+
+    evict();
+}
+
+std::filesystem::path FileChunkStore::chunkPath(std::string_view hash) const
+{
+    // The chunks are spread over subdirectories by the first byte of the hash.
+    const std::string name = hashToName(hash);
+
+    std::filesystem::path path = directory_;
+    path.append(name.substr(0, 2));
+    path.append(name);
+    return path;
+}
+
+void FileChunkStore::touch(const Chunk& chunk)
+{
+    lru_.splice(lru_.begin(), lru_, chunk.lru);
+}
+
+void FileChunkStore::remove(const std::string& hash)
+{
+    auto chunk = chunks_.find(hash);
+    if (chunk == chunks_.end())
+        return;
+
+    std::error_code ignored_error;
+    std::filesystem::remove(chunkPath(hash), ignored_error);
+
+    total_size_ -= chunk->second.size;
+    lru_.erase(chunk->second.lru);
+    chunks_.erase(chunk);
+}
+
+void FileChunkStore::evict()
+{
+    // The pinned chunks are referenced by transfers in progress. The store exceeds |max_size_|
+    // while they are not unpinned.
+    auto next = lru_.end();
+
+    while (total_size_ > max_size_ && next != lru_.begin())
+    {
+        auto current = std::prev(next);
+
+        auto chunk = chunks_.find(*current);
+        DCHECK(chunk != chunks_.end());
+
+        if (chunk->second.pin_count)
+        {
+            next = current;
+            continue;
+        }
+
+        // The key is removed together with the list item.
+        const std::string hash = *current;
+        remove(hash);
+    }
+}
+
+} // namespace common
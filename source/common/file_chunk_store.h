@@ -0,0 +1,116 @@
+//
+// Aspia Project
+// Copyright (C) 2020 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#ifndef COMMON__FILE_CHUNK_STORE_H
+#define COMMON__FILE_CHUNK_STORE_H
+
+#include "base/macros_magic.h"
+#include "proto/file_transfer.pb.h"
+
+#include <filesystem>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+namespace common {
+
+// The largest total size of the chunks in a store.
+static const uint64_t kMaxFileChunkStoreSize = 512 * 1024 * 1024; // 512 MB
+
+// Keeps the chunks (see FileChunkList) of the received files. When the same data is sent again,
+// for example an installer pushed to many computers, the source sends references to the chunks
+// instead of their data. Each chunk is a file named by its hash. When the store becomes too large,
+// the least recently used chunks are removed.
+class FileChunkStore
+{
+public:
+    ~FileChunkStore();
+
+    // Returns the store in |directory|. The file workers of the process share one instance for
+    // each directory. Returns nullptr if the directory can not be created.
+    static std::shared_ptr<FileChunkStore> open(const std::filesystem::path& directory,
+                                                uint64_t max_size = kMaxFileChunkStoreSize);
+
+    // Returns the store in the local application data of the current user.
+    static std::shared_ptr<FileChunkStore> openForCurrentUser();
+
+    // Returns the bits of the chunks of the list which are in the store (in the format of
+    // FileSyncRequest::present_chunks). The found chunks become the most recently used and are
+    // pinned: they are not evicted until unpin() is called with the returned bits.
+    std::string find(const proto::FileChunkList& chunk_list);
+
+    // Unpins the chunks pinned by find().
+    void unpin(const proto::FileChunkList& chunk_list, const std::string& present_chunks);
+
+    // Reads the chunk with |hash|. Returns false if the chunk is not in the store or is damaged.
+    bool read(std::string_view hash, std::string* data);
+
+    // Adds the chunk with |hash| if its data matches the hash.
+    bool add(std::string_view hash, std::string_view data);
+
+    // The total size of the chunks.
+    uint64_t size() const;
+
+private:
+    struct Chunk
+    {
+        uint64_t size;
+        std::list<std::string>::iterator lru;
+
+        // The number of times the chunk is pinned by find().
+        uint32_t pin_count = 0;
+    };
+
+    FileChunkStore(const std::filesystem::path& directory, uint64_t max_size);
+
+    // Builds the index of the chunks from the files of the directory.
+    void load();
+
+    std::filesystem::path chunkPath(std::string_view hash) const;
+
+    // Moves the chunk to the front of the LRU list.
+    void touch(const Chunk& chunk);
+
+    // Removes the chunk from the index and its file.
+    void remove(const std::string& hash);
+
+    // Removes the least recently used chunks which are not pinned until the store fits
+    // |max_size_|.
+    void evict();
+
+    const std::filesystem::path directory_;
+    const uint64_t max_size_;
+
+    // The store is used by the threads of all lanes. The chunks are small, so their files are
+    // read and written under the lock.
+    mutable std::mutex lock_;
+
+    std::unordered_map<std::string, Chunk> chunks_;
+
+    // The hashes from the most to the least recently used.
+    std::list<std::string> lru_;
+    uint64_t total_size_ = 0;
+
+    DISALLOW_COPY_AND_ASSIGN(FileChunkStore);
+};
+
+} // namespace common
+
+#endif // COMMON__FILE_CHUNK_STORE_H
@@ -0,0 +1,254 @@
+//
+// Aspia Project
+// Copyright (C) 2020 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "common/file_chunk_store.h"
+
+#include "base/files/file_util.h"
+#include "common/file_chunker.h"
+
+#include <gtest/gtest.h>
+
+#include <random>
+
+namespace common {
+
+namespace {
+
+const size_t kChunkSize = 1000;
+
+// The store holds three chunks.
+const uint64_t kMaxStoreSize = 3 * kChunkSize;
+
+struct Chunk
+{
+    std::string data;
+    std::string hash;
+};
+
+Chunk makeChunk(uint32_t seed)
+{
+    std::mt19937 engine(seed);
+    std::string data(kChunkSize, 0);
+
+    for (size_t i = 0; i < data.size(); ++i)
+        data[i] = static_cast<char>(engine() & 0xFF);
+
+    std::string hash = fileChunkHash(reinterpret_cast<const uint8_t*>(data.data()), data.size());
+    return Chunk{ std::move(data), std::move(hash) };
+}
+
+proto::FileChunkList makeChunkList(const std::vector<Chunk>& chunks)
+{
+    proto::FileChunkList chunk_list;
+
+    for (const auto& chunk : chunks)
+    {
+        chunk_list.add_size(static_cast<uint32_t>(chunk.data.size()));
+        chunk_list.mutable_hashes()->append(chunk.hash);
+    }
+
+    return chunk_list;
+}
+
+class FileChunkStoreTest : public testing::Test
+{
+protected:
+    FileChunkStoreTest()
+        : directory_(std::filesystem::temp_directory_path() / "aspia_file_chunk_store_unittest")
+    {
+        std::error_code ignored_code;
+        std::filesystem::remove_all(directory_, ignored_code);
+
+        for (uint32_t i = 0; i < 6; ++i)
+            chunks_.push_back(makeChunk(i));
+    }
+
+    ~FileChunkStoreTest() override
+    {
+        std::error_code ignored_code;
+        std::filesystem::remove_all(directory_, ignored_code);
+    }
+
+    bool isInStore(FileChunkStore* store, const Chunk& chunk)
+    {
+        std::string data;
+        return store->read(chunk.hash, &data) && data == chunk.data;
+    }
+
+    const std::filesystem::path directory_;
+    std::vector<Chunk> chunks_;
+};
+
+} // namespace
+
+TEST_F(FileChunkStoreTest, AddAndRead)
+{
+    std::shared_ptr<FileChunkStore> store = FileChunkStore::open(directory_, kMaxStoreSize);
+    ASSERT_TRUE(store);
+
+    // The stores are shared.
+    EXPECT_EQ(FileChunkStore::open(directory_, kMaxStoreSize), store);
+
+    EXPECT_TRUE(store->add(chunks_[0].hash, chunks_[0].data));
+    EXPECT_TRUE(isInStore(store.get(), chunks_[0]));
+    EXPECT_FALSE(isInStore(store.get(), chunks_[1]));
+    EXPECT_EQ(store->size(), kChunkSize);
+
+    // The data does not match the hash.
+    EXPECT_FALSE(store->add(chunks_[1].hash, chunks_[2].data));
+    EXPECT_FALSE(isInStore(store.get(), chunks_[1]));
+
+    // The same chunk is stored once.
+    EXPECT_TRUE(store->add(chunks_[0].hash, chunks_[0].data));
+    EXPECT_EQ(store->size(), kChunkSize);
+
+    // Only the chunks which are in the store and have the same size are found.
+    proto::FileChunkList chunk_list = makeChunkList({ chunks_[0], chunks_[1], chunks_[0] });
+    EXPECT_EQ(store->find(chunk_list), std::string(1, 0x05));
+    store->unpin(chunk_list, std::string(1, 0x05));
+
+    chunk_list.set_size(0, kChunkSize - 1);
+    EXPECT_EQ(store->find(chunk_list), std::string(1, 0x04));
+    store->unpin(chunk_list, std::string(1, 0x04));
+}
+
+TEST_F(FileChunkStoreTest, EvictLeastRecentlyUsed)
+{
+    std::shared_ptr<FileChunkStore> store = FileChunkStore::open(directory_, kMaxStoreSize);
+    ASSERT_TRUE(store);
+
+    for (int i = 0; i < 3; ++i)
+        ASSERT_TRUE(store->add(chunks_[i].hash, chunks_[i].data));
+
+    // The first chunk becomes the most recently used, the second one is evicted.
+    EXPECT_TRUE(isInStore(store.get(), chunks_[0]));
+    ASSERT_TRUE(store->add(chunks_[3].hash, chunks_[3].data));
+
+    EXPECT_EQ(store->size(), kMaxStoreSize);
+    EXPECT_FALSE(isInStore(store.get(), chunks_[1]));
+    EXPECT_TRUE(isInStore(store.get(), chunks_[0]));
+    EXPECT_TRUE(isInStore(store.get(), chunks_[2]));
+    EXPECT_TRUE(isInStore(store.get(), chunks_[3]));
+}
+
+TEST_F(FileChunkStoreTest, EvictSkipsPinned)
+{
+    std::shared_ptr<FileChunkStore> store = FileChunkStore::open(directory_, kMaxStoreSize);
+    ASSERT_TRUE(store);
+
+    for (int i = 0; i < 3; ++i)
+        ASSERT_TRUE(store->add(chunks_[i].hash, chunks_[i].data));
+
+    const proto::FileChunkList chunk_list = makeChunkList({ chunks_[0] });
+    const std::string present_chunks = store->find(chunk_list);
+    ASSERT_EQ(present_chunks, std::string(1, 0x01));
+
+    // The pinned chunk becomes the least recently used, but the next chunks are evicted instead.
+    for (int i = 3; i < 6; ++i)
+        ASSERT_TRUE(store->add(chunks_[i].hash, chunks_[i].data));
+
+    EXPECT_EQ(store->size(), kMaxStoreSize);
+    EXPECT_FALSE(isInStore(store.get(), chunks_[3]));
+    EXPECT_TRUE(isInStore(store.get(), chunks_[0]));
+
+    // After unpin() the chunk is evicted as usual.
+    store->unpin(chunk_list, present_chunks);
+    EXPECT_TRUE(isInStore(store.get(), chunks_[4]));
+    EXPECT_TRUE(isInStore(store.get(), chunks_[5]));
+
+    ASSERT_TRUE(store->add(chunks_[1].hash, chunks_[1].data));
+    EXPECT_FALSE(isInStore(store.get(), chunks_[0]));
+}
+
+TEST_F(FileChunkStoreTest, AllPinned)
+{
+    std::shared_ptr<FileChunkStore> store = FileChunkStore::open(directory_, kMaxStoreSize);
+    ASSERT_TRUE(store);
+
+    for (int i = 0; i < 3; ++i)
+        ASSERT_TRUE(store->add(chunks_[i].hash, chunks_[i].data));
+
+    const proto::FileChunkList chunk_list =
+        makeChunkList({ chunks_[0], chunks_[1], chunks_[2] });
+    const std::string present_chunks = store->find(chunk_list);
+
+    // While all chunks are pinned, a new chunk does not fit into the store.
+    EXPECT_TRUE(store->add(chunks_[3].hash, chunks_[3].data));
+    EXPECT_EQ(store->size(), kMaxStoreSize);
+    EXPECT_FALSE(isInStore(store.get(), chunks_[3]));
+
+    for (int i = 0; i < 3; ++i)
+        EXPECT_TRUE(isInStore(store.get(), chunks_[i]));
+
+    store->unpin(chunk_list, present_chunks);
+
+    ASSERT_TRUE(store->add(chunks_[3].hash, chunks_[3].data));
+    EXPECT_EQ(store->size(), kMaxStoreSize);
+    EXPECT_TRUE(isInStore(store.get(), chunks_[3]));
+}
+
+TEST_F(FileChunkStoreTest, Load)
+{
+    std::shared_ptr<FileChunkStore> store = FileChunkStore::open(directory_, kMaxStoreSize);
+    ASSERT_TRUE(store);
+
+    ASSERT_TRUE(store->add(chunks_[0].hash, chunks_[0].data));
+    ASSERT_TRUE(store->add(chunks_[1].hash, chunks_[1].data));
+    store.reset();
+
+    // A chunk which was not completely written and a file which is not a chunk.
+    const std::filesystem::path temp_path = directory_ / "00" / "0000.tmp";
+    const std::filesystem::path other_path = directory_ / "other.txt";
+
+    std::error_code ignored_code;
+    std::filesystem::create_directories(temp_path.parent_path(), ignored_code);
+    ASSERT_TRUE(base::writeFile(temp_path, chunks_[2].data));
+    ASSERT_TRUE(base::writeFile(other_path, chunks_[3].data));
+
+    store = FileChunkStore::open(directory_, kMaxStoreSize);
+    ASSERT_TRUE(store);
+
+    EXPECT_EQ(store->size(), 2 * kChunkSize);
+    EXPECT_TRUE(isInStore(store.get(), chunks_[0]));
+    EXPECT_TRUE(isInStore(store.get(), chunks_[1]));
+
+    EXPECT_FALSE(std::filesystem::exists(temp_path, ignored_code));
+    EXPECT_TRUE(std::filesystem::exists(other_path, ignored_code));
+}
+
+TEST_F(FileChunkStoreTest, DamagedChunk)
+{
+    std::shared_ptr<FileChunkStore> store = FileChunkStore::open(directory_, kMaxStoreSize);
+    ASSERT_TRUE(store);
+
+    ASSERT_TRUE(store->add(chunks_[0].hash, chunks_[0].data));
+
+    // Replace the file of the chunk with other data of the same size.
+    for (std::filesystem::recursive_directory_iterator it(directory_), end; it != end; ++it)
+    {
+        if (it->is_regular_file())
+        {
+            ASSERT_TRUE(base::writeFile(it->path(), chunks_[1].data));
+        }
+    }
+
+    EXPECT_FALSE(isInStore(store.get(), chunks_[0]));
+    EXPECT_EQ(store->size(), 0u);
+}
+
+} // namespace common
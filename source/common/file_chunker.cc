@@ -0,0 +1,177 @@
+//
+// Aspia Project
+// Copyright (C) 2020 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "common/file_chunker.h"
+
+#include "base/logging.h"
+#include "base/crypto/generic_hash.h"
+#include "base/files/file.h"
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+
+namespace common {
+
+namespace {
+
+// The size of file reads. It must be larger than the largest chunk.
+const size_t kReadSize = 1024 * 1024;
+
+// The masks of the hash before and after the average size. The bits are taken from the top of the
+// hash, which depends on the last 64 bytes.
+const uint64_t kMaskSmall = ~uint64_t(0) << (64 - 18);
+const uint64_t kMaskLarge = ~uint64_t(0) << (64 - 14);
+
+// The random values of the gear hash for each byte. The chunks must be the same in all versions,
+// so the values are generated with a fixed seed.
+constexpr std::array<uint64_t, 256> makeGearTable()
+{
+    std::array<uint64_t, 256> table = {};
+    uint64_t state = 0x61737069612D6364; // "aspia-cd"
+
+    // SplitMix64.
+    for (size_t i = 0; i < table.size(); ++i)
+    {
+        state += 0x9E3779B97F4A7C15;
+
+        uint64_t value = state;
+        value = (value ^ (value >> 30)) * 0xBF58476D1CE4E5B9;
+        value = (value ^ (value >> 27)) * 0x94D049BB133111EB;
+        table[i] = value ^ (value >> 31);
+    }
+
+    return table;
+}
+
+constexpr std::array<uint64_t, 256> kGearTable = makeGearTable();
+
+} // namespace
+
+size_t fileChunkSize(const uint8_t* data, size_t size)
+{
+    if (size <= kMinFileChunkSize)
+        return size;
+
+    const size_t normal_size = std::min(size, kAvgFileChunkSize);
+    const size_t max_size = std::min(size, kMaxFileChunkSize);
+
+    // The data before the minimum size can not change the cut point, so it is not hashed.
+    uint64_t hash = 0;
+    size_t i = kMinFileChunkSize;
+
+    for (; i < normal_size; ++i)
+    {
+        hash = (hash << 1) + kGearTable[data[i]];
+        if (!(hash & kMaskSmall))
+            return i + 1;
+    }
+
+    for (; i < max_size; ++i)
+    {
+        hash = (hash << 1) + kGearTable[data[i]];
+        if (!(hash & kMaskLarge))
+            return i + 1;
+    }
+
+    return max_size;
+}
+
+std::string fileChunkHash(const uint8_t* data, size_t size)
+{
+    base::ByteArray hash = base::GenericHash::hash(base::GenericHash::BLAKE2b512, data, size);
+    DCHECK_GE(hash.size(), kFileChunkHashSize);
+
+    return std::string(reinterpret_cast<const char*>(hash.data()), kFileChunkHashSize);
+}
+
+bool makeFileChunkList(base::File* file, uint64_t file_size, proto::FileChunkList* chunk_list)
+{
+    DCHECK(file);
+    DCHECK(chunk_list);
+
+    chunk_list->Clear();
+
+    std::string buffer;
+    buffer.resize(kReadSize);
+
+    uint8_t* data = reinterpret_cast<uint8_t*>(buffer.data());
+    size_t begin = 0;
+    size_t end = 0;
+
+    // The offset in the file of the data after the buffer.
+    uint64_t read_offset = 0;
+
+    while (true)
+    {
+        // A chunk is searched only when the buffer has the largest chunk or the end of the file.
+        if (end - begin < kMaxFileChunkSize && read_offset < file_size)
+        {
+            memmove(data, data + begin, end - begin);
+            end -= begin;
+            begin = 0;
+
+            const size_t read_size =
+                static_cast<size_t>(std::min<uint64_t>(kReadSize - end, file_size - read_offset));
+
+            if (file->read(static_cast<int64_t>(read_offset), data + end, read_size) !=
+                static_cast<int64_t>(read_size))
+            {
+                LOG(LS_WARNING) << "Unable to read file";
+                return false;
+            }
+
+            end += read_size;
+            read_offset += read_size;
+        }
+
+        if (begin == end)
+            break;
+
+        const size_t chunk_size = fileChunkSize(data + begin, end - begin);
+
+        chunk_list->add_size(static_cast<uint32_t>(chunk_size));
+        chunk_list->mutable_hashes()->append(fileChunkHash(data + begin, chunk_size));
+
+        begin += chunk_size;
+    }
+
+    return true;
+}
+
+bool isValidFileChunkList(const proto::FileChunkList& chunk_list)
+{
+    if (chunk_list.hashes().size() != chunk_list.size_size() * kFileChunkHashSize)
+        return false;
+
+    for (const auto& size : chunk_list.size())
+    {
+        if (!size || size > kMaxFileChunkSize)
+            return false;
+    }
+
+    return true;
+}
+
+std::string_view fileChunkHashAt(const proto::FileChunkList& chunk_list, size_t index)
+{
+    return std::string_view(chunk_list.hashes()).substr(
+        index * kFileChunkHashSize, kFileChunkHashSize);
+}
+
+} // namespace common
@@ -0,0 +1,70 @@
+//
+// Aspia Project
+// Copyright (C) 2020 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#ifndef COMMON__FILE_CHUNKER_H
+#define COMMON__FILE_CHUNKER_H
+
+#include "proto/file_transfer.pb.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+namespace base {
+class File;
+} // namespace base
+
+namespace common {
+
+// The limits of the content-defined chunks. The size of most chunks is close to the average.
+static const size_t kMinFileChunkSize = 16 * 1024; // 16 kB
+static const size_t kAvgFileChunkSize = 64 * 1024; // 64 kB
+static const size_t kMaxFileChunkSize = 256 * 1024; // 256 kB
+
+// The size of the chunk hashes in FileChunkList.
+static const size_t kFileChunkHashSize = 16;
+
+// Returns the size of the chunk at the beginning of |data|. The boundary is found with the gear
+// hash of FastCDC: a cut point is a position where the masked bits of the hash are zero. The mask
+// is stricter before the average size and looser after it, so the sizes are kept close to the
+// average. |size| must be at least kMaxFileChunkSize unless |data| is the end of the file.
+size_t fileChunkSize(const uint8_t* data, size_t size);
+
+// Returns the hash of the chunk for FileChunkList.
+std::string fileChunkHash(const uint8_t* data, size_t size);
+
+// Splits |file| into chunks. Returns false if the file can not be read.
+bool makeFileChunkList(base::File* file, uint64_t file_size, proto::FileChunkList* chunk_list);
+
+// Returns false if the chunk list received from the peer is malformed.
+bool isValidFileChunkList(const proto::FileChunkList& chunk_list);
+
+// Returns the hash of the chunk |index| of the list.
+std::string_view fileChunkHashAt(const proto::FileChunkList& chunk_list, size_t index);
+
+// The bits of FileSyncRequest::present_chunks.
+inline bool isChunkPresent(const std::string& present_chunks, size_t index)
+{
+    const size_t byte = index / 8;
+    return byte < present_chunks.size() && (present_chunks[byte] & (1 << (index % 8)));
+}
+
+} // namespace common
+
+#endif // COMMON__FILE_CHUNKER_H
@@ -0,0 +1,158 @@
+//
+// Aspia Project
+// Copyright (C) 2020 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "common/file_chunker.h"
+
+#include <gtest/gtest.h>
+
+#include <random>
+#include <set>
+#include <vector>
+
+namespace common {
+
+namespace {
+
+std::string randomData(size_t size, uint32_t seed)
+{
+    std::mt19937 engine(seed);
+    std::string data(size, 0);
+
+    for (size_t i = 0; i < size; ++i)
+        data[i] = static_cast<char>(engine() & 0xFF);
+
+    return data;
+}
+
+std::vector<size_t> chunkSizes(const std::string& data)
+{
+    std::vector<size_t> sizes;
+    size_t offset = 0;
+
+    while (offset < data.size())
+    {
+        const size_t size = fileChunkSize(
+            reinterpret_cast<const uint8_t*>(data.data()) + offset, data.size() - offset);
+        sizes.push_back(size);
+        offset += size;
+    }
+
+    return sizes;
+}
+
+std::set<std::string> chunkHashes(const std::string& data)
+{
+    std::set<std::string> hashes;
+    size_t offset = 0;
+
+    for (size_t size : chunkSizes(data))
+    {
+        hashes.insert(
+            fileChunkHash(reinterpret_cast<const uint8_t*>(data.data()) + offset, size));
+        offset += size;
+    }
+
+    return hashes;
+}
+
+const size_t kDataSize = 4 * 1024 * 1024;
+
+} // namespace
+
+TEST(FileChunkerTest, SizeLimits)
+{
+    const std::vector<size_t> sizes = chunkSizes(randomData(kDataSize, 1));
+
+    for (size_t i = 0; i + 1 < sizes.size(); ++i)
+    {
+        EXPECT_GE(sizes[i], kMinFileChunkSize);
+        EXPECT_LE(sizes[i], kMaxFileChunkSize);
+    }
+
+    // The sizes are close to the average.
+    EXPECT_GT(sizes.size(), kDataSize / kAvgFileChunkSize / 2);
+    EXPECT_LT(sizes.size(), kDataSize / kAvgFileChunkSize * 2);
+
+    // Data without content has no cut points.
+    EXPECT_EQ(chunkSizes(std::string(kDataSize, 0)),
+              std::vector<size_t>(kDataSize / kMaxFileChunkSize, kMaxFileChunkSize));
+
+    // The end of the data is the end of the last chunk.
+    EXPECT_EQ(chunkSizes(randomData(100, 1)), std::vector<size_t>({ 100 }));
+}
+
+TEST(FileChunkerTest, PrefixInsertion)
+{
+    const std::string data = randomData(kDataSize, 1);
+    const std::set<std::string> hashes = chunkHashes(data);
+
+    // The cut points depend only on the last bytes before them, so the chunks after the first
+    // cut point are the same.
+    const std::set<std::string> shifted_hashes = chunkHashes(randomData(100, 2) + data);
+
+    size_t common_count = 0;
+    for (const auto& hash : shifted_hashes)
+        common_count += hashes.count(hash);
+
+    EXPECT_GE(common_count + 1, hashes.size());
+}
+
+TEST(FileChunkerTest, CutPoints)
+{
+    // The cut points are a part of the protocol: the peers of different versions find the same
+    // chunks only if the gear table and the masks do not change.
+    const std::vector<size_t> sizes = chunkSizes(randomData(kDataSize / 4, 1));
+
+    const std::vector<size_t> expected_sizes =
+    {
+        86144, 85245, 86460, 67495, 84482, 65980, 78770, 78423,
+        93847, 31913, 108711, 73527, 22615, 27283, 51444, 6237
+    };
+    EXPECT_EQ(sizes, expected_sizes);
+}
+
+TEST(FileChunkerTest, ChunkList)
+{
+    proto::FileChunkList chunk_list;
+    EXPECT_TRUE(isValidFileChunkList(chunk_list));
+
+    const std::string data = randomData(1000, 1);
+    const std::string hash = fileChunkHash(reinterpret_cast<const uint8_t*>(data.data()),
+                                           data.size());
+    EXPECT_EQ(hash.size(), kFileChunkHashSize);
+
+    chunk_list.add_size(1000);
+    chunk_list.mutable_hashes()->append(hash);
+    EXPECT_TRUE(isValidFileChunkList(chunk_list));
+    EXPECT_EQ(fileChunkHashAt(chunk_list, 0), hash);
+
+    // The number of hashes does not match the number of sizes.
+    chunk_list.add_size(1000);
+    EXPECT_FALSE(isValidFileChunkList(chunk_list));
+
+    chunk_list.mutable_hashes()->append(hash);
+    EXPECT_TRUE(isValidFileChunkList(chunk_list));
+
+    chunk_list.set_size(1, kMaxFileChunkSize + 1);
+    EXPECT_FALSE(isValidFileChunkList(chunk_list));
+
+    chunk_list.set_size(1, 0);
+    EXPECT_FALSE(isValidFileChunkList(chunk_list));
+}
+
+} // namespace common
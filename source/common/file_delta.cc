@@ -0,0 +1,372 @@
+//
+// Aspia Project
+// Copyright (C) 2020 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+
+#include "common/file_delta.h"
+
+#include "base/logging.h"
+#include "base/crypto/generic_hash.h"
+#include "base/files/file.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace common {
+
+namespace {
+
+const uint32_t kMinBlockSize = 2 * 1024;
+
+// The signature of 12 bytes per block must fit into one message.
+const uint64_t kMaxBlockCount = 1024 * 1024;
+
+// The size of file reads.
+const size_t kReadSize = 1024 * 1024;
+
+uint64_t strongChecksum(const uint8_t* data, size_t size)
+{
+    base::ByteArray hash = base::GenericHash::hash(base::GenericHash::BLAKE2b512, data, size);
+    DCHECK_GE(hash.size(), sizeof(uint64_t));
+
+    uint64_t checksum;
+    memcpy(&checksum, hash.data(), sizeof(checksum));
+    return checksum;
+}
+
+uint32_t filterHash(uint32_t weak_checksum)
+{
+    return (weak_checksum ^ (weak_checksum >> 16)) & 0xFFFF;
+}
+
+} // namespace
+
+void RollingChecksum::reset(const uint8_t* data, size_t size)
+{
+    a_ = 0;
+    b_ = 0;
+    size_ = static_cast<uint32_t>(size);
+
+    for (size_t i = 0; i < size; ++i)
+    {
+        a_ += data[i];
+        b_ += static_cast<uint32_t>(size - i) * data[i];
+    }
+}
+
+void RollingChecksum::roll(uint8_t out, uint8_t in)
+{
+    a_ += static_cast<uint32_t>(in) - out;
+    b_ += a_ - size_ * out;
+}
+
+uint32_t fileDeltaBlockSize(uint64_t file_size)
+{
+    uint64_t block_size = kMinBlockSize;
+
+    while (block_size * block_size < file_size || file_size / block_size > kMaxBlockCount)
+        block_size *= 2;
+
+    return static_cast<uint32_t>(block_size);
+}
+
+bool makeFileSignature(base::File* file,
+                       proto::FileSignature::Type type,
+                       proto::FileSignature* signature)
+{
+    DCHECK(file && signature);
+
+    const int64_t file_size = file->length();
+    if (file_size < 0)
+        return false;
+
+    const uint32_t block_size = fileDeltaBlockSize(static_cast<uint64_t>(file_size));
+    const uint64_t block_count = static_cast<uint64_t>(file_size) / block_size;
+
+    signature->Clear();
+    signature->set_type(type);
+    signature->set_block_size(block_size);
+    signature->mutable_weak_checksum()->Reserve(static_cast<int>(block_count));
+    signature->mutable_strong_checksum()->Reserve(static_cast<int>(block_count));
+
+    const size_t blocks_per_read = std::max(kReadSize / block_size, size_t(1));
+    std::string buffer(blocks_per_read * block_size, 0);
+
+    for (uint64_t index = 0; index < block_count; index += blocks_per_read)
+    {
+        const size_t count =
+            static_cast<size_t>(std::min(block_count - index, uint64_t(blocks_per_read)));
+        const size_t size = count * block_size;
+
+        if (file->read(static_cast<int64_t>(index * block_size), buffer.data(), size) !=
+            static_cast<int64_t>(size))
+        {
+            return false;
+        }
+
+        for (size_t i = 0; i < count; ++i)
+        {
+            const uint8_t* block = reinterpret_cast<const uint8_t*>(buffer.data()) +
+                i * block_size;
+
+            RollingChecksum checksum;
+            checksum.reset(block, block_size);
+
+            signature->add_weak_checksum(checksum.value());
+            signature->add_strong_checksum(strongChecksum(block, block_size));
+        }
+    }
+
+    return true;
+}
+
+bool isValidFileSignature(const proto::FileSignature& signature)
+{
+    const uint32_t block_size = signature.block_size();
+
+    if (block_size < kMinBlockSize || (block_size & (block_size - 1)) != 0)
+        return false;
+
+    if (static_cast<uint64_t>(signature.weak_checksum_size()) > kMaxBlockCount)
+        return false;
+
+    return signature.weak_checksum_size() == signature.strong_checksum_size();
+}
+
+int64_t partialFileMatch(base::File* file, const proto::FileSignature& signature)
+{
+    DCHECK(file);
+    DCHECK(isValidFileSignature(signature));
+
+    const uint32_t block_size = signature.block_size();
+    std::string buffer(block_size, 0);
+
+    int64_t offset = 0;
+
+    for (int i = 0; i < signature.weak_checksum_size(); ++i)
+    {
+        const int64_t result = file->read(offset, buffer.data(), block_size);
+        if (result < 0)
+            return -1;
+
+        // The source file is shorter than the partial one.
+        if (result != block_size)
+            break;
+
+        const uint8_t* block = reinterpret_cast<const uint8_t*>(buffer.data());
+
+        RollingChecksum checksum;
+        checksum.reset(block, block_size);
+
+        if (checksum.value() != signature.weak_checksum(i) ||
+            strongChecksum(block, block_size) != signature.strong_checksum(i))
+        {
+            break;
+        }
+
+        offset += block_size;
+    }
+
+    return offset;
+}
+
+FileDeltaEncoder::FileDeltaEncoder(base::File* file,
+                                   uint64_t file_size,
+                                   const proto::FileSignature& signature)
+    : file_(file),
+      file_size_(file_size),
+      block_size_(signature.block_size()),
+      weak_filter_(65536 / 8)
+{
+    DCHECK(file_);
+    DCHECK(isValidFileSignature(signature));
+
+    const uint32_t block_count = static_cast<uint32_t>(signature.weak_checksum_size());
+
+    weak_index_.reserve(block_count);
+    strong_checksums_.reserve(block_count);
+
+    for (uint32_t i = 0; i < block_count; ++i)
+    {
+        const uint32_t weak_checksum = signature.weak_checksum(static_cast<int>(i));
+        const uint32_t hash = filterHash(weak_checksum);
+
+        weak_index_.emplace_back(weak_checksum, i);
+        strong_checksums_.push_back(signature.strong_checksum(static_cast<int>(i)));
+        weak_filter_[hash / 8] |= static_cast<uint8_t>(1 << (hash % 8));
+    }
+
+    std::sort(weak_index_.begin(), weak_index_.end());
+}
+
+FileDeltaEncoder::~FileDeltaEncoder() = default;
+
+bool FileDeltaEncoder::encode(size_t size, proto::FilePacket* packet)
+{
+    DCHECK(packet);
+
+    const uint64_t end = std::min(encoded_offset_ + size, file_size_);
+    std::string* data = packet->mutable_data();
+    uint32_t literal_size = 0;
+
+    while (encoded_offset_ < end)
+    {
+        if (copy_left_)
+        {
+            const uint64_t copy_size = std::min(copy_left_, end - encoded_offset_);
+
+            proto::FilePacket::DeltaOp* op = packet->add_delta_op();
+            op->set_literal_size(literal_size);
+            op->set_copy_offset(copy_offset_);
+            op->set_copy_size(static_cast<uint32_t>(copy_size));
+
+            literal_size = 0;
+            copy_offset_ += copy_size;
+            copy_left_ -= copy_size;
+            copied_bytes_ += copy_size;
+            encoded_offset_ += copy_size;
+            continue;
+        }
+
+        bool found = false;
+        uint32_t index = 0;
+
+        // The blocks are searched at every position of the packet.
+        while (scan_offset_ < end && file_size_ - scan_offset_ >= block_size_)
+        {
+            if (!ensureBuffer(scan_offset_ + block_size_ + 1))
+                return false;
+
+            const uint8_t* block = bufferAt(scan_offset_);
+
+            if (!checksum_valid_)
+            {
+                checksum_.reset(block, block_size_);
+                checksum_valid_ = true;
+            }
+
+            if (findBlock(checksum_.value(), block, &index))
+            {
+                found = true;
+                break;
+            }
+
+            if (file_size_ - scan_offset_ > block_size_)
+                checksum_.roll(block[0], block[block_size_]);
+            else
+                checksum_valid_ = false;
+
+            ++scan_offset_;
+        }
+
+        // The rest of the file is shorter than a block.
+        if (!found)
+            scan_offset_ = std::max(scan_offset_, end);
+
+        const uint64_t literal_end = found ? scan_offset_ : end;
+        if (literal_end > encoded_offset_)
+        {
+            if (!ensureBuffer(literal_end))
+                return false;
+
+            const size_t count = static_cast<size_t>(literal_end - encoded_offset_);
+            data->append(reinterpret_cast<const char*>(bufferAt(encoded_offset_)), count);
+
+            literal_size += static_cast<uint32_t>(count);
+            encoded_offset_ = literal_end;
+        }
+
+        if (found)
+        {
+            copy_offset_ = static_cast<uint64_t>(index) * block_size_;
+            copy_left_ = block_size_;
+            scan_offset_ += block_size_;
+            checksum_valid_ = false;
+        }
+    }
+
+    // The data after the last copied block.
+    if (literal_size && packet->delta_op_size())
+        packet->add_delta_op()->set_literal_size(literal_size);
+
+    return true;
+}
+
+bool FileDeltaEncoder::ensureBuffer(uint64_t end)
+{
+    end = std::min(end, file_size_);
+
+    const uint64_t buffer_end = buffer_offset_ + buffer_.size();
+    if (end <= buffer_end)
+        return true;
+
+    // The data before the encoded offset is not needed anymore.
+    const size_t unused_size = static_cast<size_t>(encoded_offset_ - buffer_offset_);
+    buffer_.erase(0, unused_size);
+    buffer_offset_ = encoded_offset_;
+
+    const size_t read_size = static_cast<size_t>(
+        std::min(std::max(end - buffer_end, uint64_t(kReadSize)), file_size_ - buffer_end));
+    const size_t old_size = buffer_.size();
+
+    buffer_.resize(old_size + read_size);
+
+    if (file_->read(static_cast<int64_t>(buffer_end), buffer_.data() + old_size, read_size) !=
+        static_cast<int64_t>(read_size))
+    {
+        LOG(LS_WARNING) << "Unable to read file";
+        return false;
+    }
+
+    return true;
+}
+
+const uint8_t* FileDeltaEncoder::bufferAt(uint64_t offset) const
+{
+    DCHECK_GE(offset, buffer_offset_);
+    DCHECK_LE(offset, buffer_offset_ + buffer_.size());
+
+    return reinterpret_cast<const uint8_t*>(buffer_.data()) + (offset - buffer_offset_);
+}
+
+bool FileDeltaEncoder::findBlock(
+    uint32_t weak_checksum, const uint8_t* block, uint32_t* index) const
+{
+    const uint32_t hash = filterHash(weak_checksum);
+    if (!(weak_filter_[hash / 8] & (1 << (hash % 8))))
+        return false;
+
+    auto it = std::lower_bound(weak_index_.begin(), weak_index_.end(),
+                               std::make_pair(weak_checksum, uint32_t(0)));
+    if (it == weak_index_.end() || it->first != weak_checksum)
+        return false;
+
+    const uint64_t strong_checksum = strongChecksum(block, block_size_);
+
+    for (; it != weak_index_.end() && it->first == weak_checksum; ++it)
+    {
+        if (strong_checksums_[it->second] == strong_checksum)
+        {
+            *index = it->second;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+} // namespace common
@@ -0,0 +1,126 @@
+//
+// Aspia Project
+// Copyright (C) 2020 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+
+#ifndef COMMON__FILE_DELTA_H
+#define COMMON__FILE_DELTA_H
+
+#include "base/macros_magic.h"
+#include "proto/file_transfer.pb.h"
+
+#include <string>
+#include <vector>
+
+namespace base {
+class File;
+} // namespace base
+
+namespace common {
+
+// The rolling checksum of rsync. It can be moved over the data one byte at a time.
+class RollingChecksum
+{
+public:
+    RollingChecksum() = default;
+
+    void reset(const uint8_t* data, size_t size);
+
+    // Moves the checksum one byte forward: |out| leaves the block and |in| enters it.
+    void roll(uint8_t out, uint8_t in);
+
+    uint32_t value() const { return (a_ & 0xFFFF) | (b_ << 16); }
+
+private:
+    uint32_t a_ = 0;
+    uint32_t b_ = 0;
+    uint32_t size_ = 0;
+};
+
+// Returns the block size of the signature of a file of |file_size| bytes. The size grows with the
+// square root of the file size, as in rsync.
+uint32_t fileDeltaBlockSize(uint64_t file_size);
+
+// Computes the signature of the full blocks of |file|. Returns false if the file can not be read.
+bool makeFileSignature(base::File* file,
+                       proto::FileSignature::Type type,
+                       proto::FileSignature* signature);
+
+// Returns false if the signature received from the peer is malformed.
+bool isValidFileSignature(const proto::FileSignature& signature);
+
+// Compares the blocks of |file| with the signature of a partial copy of it. Returns the size of
+// the beginning of the file that the partial copy already has, or -1 if the file can not be read.
+int64_t partialFileMatch(base::File* file, const proto::FileSignature& signature);
+
+// Builds the packets of |file| as a difference to the existing file of the peer. The blocks found
+// in the signature are sent as references, the rest of the data is sent as is.
+class FileDeltaEncoder
+{
+public:
+    FileDeltaEncoder(base::File* file, uint64_t file_size, const proto::FileSignature& signature);
+    ~FileDeltaEncoder();
+
+    // Fills |packet| with the next |size| bytes of the file. Returns false if the file can not be
+    // read.
+    bool encode(size_t size, proto::FilePacket* packet);
+
+    // Total number of bytes sent as references to the existing file.
+    uint64_t copiedBytes() const { return copied_bytes_; }
+
+private:
+    // Makes the data up to |end| available in the buffer.
+    bool ensureBuffer(uint64_t end);
+    const uint8_t* bufferAt(uint64_t offset) const;
+
+    // Searches the block at |scan_offset_| in the signature.
+    bool findBlock(uint32_t weak_checksum, const uint8_t* block, uint32_t* index) const;
+
+    base::File* file_;
+    const uint64_t file_size_;
+    const uint32_t block_size_;
+
+    // Weak checksums with block indexes sorted by the checksum. The filter has a bit for every
+    // 16-bit hash of the weak checksums, so most positions are rejected without a search.
+    std::vector<std::pair<uint32_t, uint32_t>> weak_index_;
+    std::vector<uint64_t> strong_checksums_;
+    std::vector<uint8_t> weak_filter_;
+
+    // The data of the file from |buffer_offset_|.
+    std::string buffer_;
+    uint64_t buffer_offset_ = 0;
+
+    // The data before |encoded_offset_| is already in packets. The block at |scan_offset_| is
+    // checked next.
+    uint64_t encoded_offset_ = 0;
+    uint64_t scan_offset_ = 0;
+
+    RollingChecksum checksum_;
+    bool checksum_valid_ = false;
+
+    // The part of a matched block which did not fit into the previous packet.
+    uint64_t copy_offset_ = 0;
+    uint64_t copy_left_ = 0;
+
+    uint64_t copied_bytes_ = 0;
+
+    DISALLOW_COPY_AND_ASSIGN(FileDeltaEncoder);
+};
+
+} // namespace common
+
+#endif // COMMON__FILE_DELTA_H
@@ -0,0 +1,208 @@
+//
+// Aspia Project
+// Copyright (C) 2020 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "common/file_delta.h"
+
+#include "base/files/file_util.h"
+#include "common/file_depacketizer.h"
+#include "common/file_packet.h"
+#include "common/file_packetizer.h"
+
+#include <gtest/gtest.h>
+
+#include <random>
+
+namespace common {
+
+namespace {
+
+std::string randomData(size_t size, uint32_t seed)
+{
+    std::mt19937 engine(seed);
+    std::string data(size, 0);
+
+    for (size_t i = 0; i < size; ++i)
+        data[i] = static_cast<char>(engine() & 0xFF);
+
+    return data;
+}
+
+// The size is not a multiple of the block size, the last part of the file is not in the signature.
+const size_t kFileSize = 300000;
+
+// The copied blocks do not start at the packet boundaries.
+const uint32_t kPacketSize = 5000;
+
+// Sends |source| to the target which has |existing| and returns the file of the target in
+// |result|. |copied_bytes| receives the number of bytes taken from the existing file.
+void transfer(const std::string& existing, const std::string& source, uint32_t packet_size,
+              std::string* result, uint64_t* copied_bytes)
+{
+    const std::filesystem::path temp_path = std::filesystem::temp_directory_path();
+    const std::filesystem::path source_path = temp_path / "aspia_file_delta_unittest_source.bin";
+    const std::filesystem::path target_path = temp_path / "aspia_file_delta_unittest_target.bin";
+
+    ASSERT_TRUE(base::writeFile(source_path, source));
+    ASSERT_TRUE(base::writeFile(target_path, existing));
+
+    proto::FileSignature signature;
+    std::unique_ptr<FileDepacketizer> depacketizer =
+        FileDepacketizer::createPartial(target_path, false, true, &signature);
+    ASSERT_TRUE(depacketizer);
+    ASSERT_EQ(signature.type(), proto::FileSignature::TYPE_EXISTING_FILE);
+
+    std::unique_ptr<FilePacketizer> packetizer = FilePacketizer::create(source_path);
+    ASSERT_TRUE(packetizer);
+
+    uint64_t resume_offset = 0;
+    ASSERT_TRUE(packetizer->sync(signature, &resume_offset));
+    EXPECT_EQ(resume_offset, 0u);
+
+    proto::FilePacketRequest request;
+    request.set_packet_size(packet_size);
+
+    *copied_bytes = 0;
+
+    while (true)
+    {
+        std::unique_ptr<proto::FilePacket> packet = packetizer->readNextPacket(request);
+        ASSERT_TRUE(packet);
+
+        for (const auto& op : packet->delta_op())
+            *copied_bytes += op.copy_size();
+
+        ASSERT_TRUE(depacketizer->writeNextPacket(*packet));
+
+        if (packet->flags() & proto::FilePacket::LAST_PACKET)
+            break;
+    }
+
+    depacketizer.reset();
+    packetizer.reset();
+
+    ASSERT_TRUE(base::readFile(target_path, result));
+
+    std::error_code ignored_code;
+    std::filesystem::remove(source_path, ignored_code);
+    std::filesystem::remove(target_path, ignored_code);
+}
+
+} // namespace
+
+TEST(RollingChecksumTest, RollEqualsReset)
+{
+    const std::string data = randomData(4096, 1);
+    const uint8_t* bytes = reinterpret_cast<const uint8_t*>(data.data());
+
+    for (size_t block_size : { 1, 2, 7, 2048 })
+    {
+        RollingChecksum rolling;
+        rolling.reset(bytes, block_size);
+
+        for (size_t offset = 0; offset + block_size <= data.size(); ++offset)
+        {
+            if (offset)
+                rolling.roll(bytes[offset - 1], bytes[offset + block_size - 1]);
+
+            RollingChecksum checksum;
+            checksum.reset(bytes + offset, block_size);
+
+            ASSERT_EQ(rolling.value(), checksum.value())
+                << "block size " << block_size << " offset " << offset;
+        }
+    }
+}
+
+TEST(FileDeltaTest, BlockSize)
+{
+    EXPECT_EQ(fileDeltaBlockSize(0), 2048u);
+    EXPECT_EQ(fileDeltaBlockSize(kFileSize), 2048u);
+
+    // The block size grows with the square root of the file size.
+    EXPECT_EQ(fileDeltaBlockSize(1024ULL * 1024 * 1024), 32768u);
+}
+
+TEST(FileDeltaTest, InsertedByte)
+{
+    const std::string existing = randomData(kFileSize, 1);
+
+    std::string source = existing;
+    source.insert(source.begin() + 100000, 'x');
+
+    for (uint32_t packet_size : { kPacketSize, uint32_t(kDefaultFilePacketSize) })
+    {
+        std::string result;
+        uint64_t copied_bytes = 0;
+        ASSERT_NO_FATAL_FAILURE(transfer(existing, source, packet_size, &result, &copied_bytes));
+
+        EXPECT_EQ(result, source);
+
+        // Only the block with the inserted byte and the tail are sent as is.
+        const uint32_t block_size = fileDeltaBlockSize(kFileSize);
+        EXPECT_EQ(copied_bytes, kFileSize / block_size * block_size - block_size);
+    }
+}
+
+TEST(FileDeltaTest, ShortTail)
+{
+    const std::string existing = randomData(kFileSize, 1);
+
+    // The tail of the new file is shorter than a block.
+    const std::string source = existing + randomData(100, 2);
+
+    std::string result;
+    uint64_t copied_bytes = 0;
+    ASSERT_NO_FATAL_FAILURE(transfer(existing, source, kPacketSize, &result, &copied_bytes));
+
+    EXPECT_EQ(result, source);
+
+    const uint32_t block_size = fileDeltaBlockSize(kFileSize);
+    EXPECT_EQ(copied_bytes, kFileSize / block_size * block_size);
+}
+
+TEST(FileDeltaTest, MovedBlocks)
+{
+    const std::string existing = randomData(kFileSize, 1);
+
+    // The halves are swapped, the blocks are found at other offsets and cross the packet
+    // boundaries.
+    const std::string source =
+        existing.substr(kFileSize / 2 + 1000) + existing.substr(0, kFileSize / 2 + 1000);
+
+    std::string result;
+    uint64_t copied_bytes = 0;
+    ASSERT_NO_FATAL_FAILURE(transfer(existing, source, kPacketSize, &result, &copied_bytes));
+
+    EXPECT_EQ(result, source);
+    EXPECT_GT(copied_bytes, kFileSize - 4 * fileDeltaBlockSize(kFileSize));
+}
+
+TEST(FileDeltaTest, NoMatches)
+{
+    const std::string existing = randomData(kFileSize, 1);
+    const std::string source = randomData(kFileSize, 2);
+
+    std::string result;
+    uint64_t copied_bytes = 0;
+    ASSERT_NO_FATAL_FAILURE(transfer(existing, source, kPacketSize, &result, &copied_bytes));
+
+    EXPECT_EQ(result, source);
+    EXPECT_EQ(copied_bytes, 0u);
+}
+
+} // namespace common
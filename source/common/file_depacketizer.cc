@@ -19,23 +19,47 @@
 #include "common/file_depacketizer.h"
 
 #include "base/logging.h"
+#include "common/file_chunk_store.h"
+#include "common/file_chunker.h"
+#include "common/file_delta.h"
+#include "common/file_packet.h"
+
+#include <algorithm>
+#include <cstring>
 
 namespace common {
 
-FileDepacketizer::FileDepacketizer(const std::filesystem::path& file_path,
-                                   std::ofstream&& file_stream)
+namespace {
+
+const char kPartialFileExtension[] = ".aspia-part";
+
+} // namespace
+
+FileDepacketizer::FileDepacketizer(const std::filesystem::path& file_path, base::File&& file)
     : file_path_(file_path),
-      file_stream_(std::move(file_stream))
+      file_(std::move(file))
 {
     // Nothing
 }
 
 FileDepacketizer::~FileDepacketizer()
 {
+    // The chunks which the packets could refer to.
+    if (chunk_store_)
+        chunk_store_->unpin(chunk_list_, present_chunks_);
+
     // If the file is opened, it was not completely written.
-    if (file_stream_.is_open())
+    if (file_.isValid())
     {
-        file_stream_.close();
+        if (keep_partial_ && !is_canceled_)
+        {
+            // The transfer was interrupted. The next transfer continues the partial file.
+            flush();
+            file_.close();
+            return;
+        }
+
+        file_.close();
 
         // The transfer of files was canceled. Delete the file.
         std::error_code ignored_error;
@@ -44,61 +68,409 @@ FileDepacketizer::~FileDepacketizer()
 }
 
 // static
-std::unique_ptr<FileDepacketizer> FileDepacketizer::create(
-    const std::filesystem::path& file_path, bool overwrite)
+std::unique_ptr<FileDepacketizer> FileDepacketizer::create(const std::filesystem::path& file_path)
+{
+    // The existing file is truncated. If it must not be overwritten, the caller checks that it
+    // does not exist.
+    base::File file(file_path,
+                    base::File::FLAG_CREATE_ALWAYS | base::File::FLAG_WRITE |
+                    base::File::FLAG_SEQUENTIAL);
+    if (!file.isValid())
+        return nullptr;
+
+    return std::unique_ptr<FileDepacketizer>(new FileDepacketizer(file_path, std::move(file)));
+}
+
+// static
+std::unique_ptr<FileDepacketizer> FileDepacketizer::createPartial(
+    const std::filesystem::path& file_path,
+    bool keep_partial,
+    bool delta,
+    proto::FileSignature* signature)
 {
-    std::ofstream::openmode mode = std::ofstream::binary;
+    DCHECK(signature);
 
-    if (overwrite)
-        mode |= std::ofstream::trunc;
+    std::filesystem::path partial_path = file_path;
+    partial_path += kPartialFileExtension;
 
-    std::ofstream file_stream;
+    base::File file;
+    base::File existing_file;
 
-    file_stream.open(file_path, mode);
-    if (!file_stream.is_open())
-        return nullptr;
+    std::error_code ignored_error;
+    if (keep_partial && std::filesystem::exists(partial_path, ignored_error))
+    {
+        file = base::File(partial_path,
+                          base::File::FLAG_OPEN | base::File::FLAG_READ | base::File::FLAG_WRITE);
+        if (file.isValid() &&
+            !makeFileSignature(&file, proto::FileSignature::TYPE_PARTIAL_FILE, signature))
+        {
+            return nullptr;
+        }
+    }
+
+    if (!file.isValid())
+    {
+        file = base::File(partial_path,
+                          base::File::FLAG_CREATE_ALWAYS | base::File::FLAG_WRITE |
+                          base::File::FLAG_SEQUENTIAL);
+        if (!file.isValid())
+            return nullptr;
+
+        if (delta)
+        {
+            existing_file = base::File(file_path, base::File::FLAG_OPEN | base::File::FLAG_READ);
+            if (existing_file.isValid() &&
+                !makeFileSignature(
+                    &existing_file, proto::FileSignature::TYPE_EXISTING_FILE, signature))
+            {
+                existing_file.close();
+                signature->Clear();
+            }
+        }
+    }
+
+    std::unique_ptr<FileDepacketizer> depacketizer(
+        new FileDepacketizer(partial_path, std::move(file)));
 
-    return std::unique_ptr<FileDepacketizer>(
-        new FileDepacketizer(file_path, std::move(file_stream)));
+    depacketizer->target_path_ = file_path;
+    depacketizer->existing_file_ = std::move(existing_file);
+    depacketizer->keep_partial_ = keep_partial;
+
+    return depacketizer;
+}
+
+bool FileDepacketizer::setChunkList(const proto::FileChunkList& chunk_list,
+                                    std::shared_ptr<FileChunkStore> chunk_store,
+                                    std::string* present_chunks)
+{
+    DCHECK(chunk_store);
+    DCHECK(present_chunks);
+
+    if (file_size_ || write_offset_ || !isValidFileChunkList(chunk_list))
+    {
+        LOG(LS_WARNING) << "Unexpected chunk list";
+        return false;
+    }
+
+    chunk_store_ = std::move(chunk_store);
+    chunk_list_ = chunk_list;
+    // The present chunks are pinned in the store until the depacketizer is destroyed, so the other
+    // transfers can not evict them.
+    present_chunks_ = chunk_store_->find(chunk_list_);
+
+    *present_chunks = present_chunks_;
+    return true;
 }
 
 bool FileDepacketizer::writeNextPacket(const proto::FilePacket& packet)
 {
-    DCHECK(file_stream_.is_open());
+    DCHECK(file_.isValid());
+
+    std::string_view data = packet.data();
+
+    if (packet.compression() == proto::FILE_COMPRESSION_ZSTD)
+    {
+        if (!decompressor_)
+            decompressor_ = std::make_unique<base::ChunkDecompressor>();
+
+        if (!decompressor_->decompress(data, kMaxFilePacketSize, &decompressed_) ||
+            decompressed_.size() != packet.uncompressed_size())
+        {
+            LOG(LS_WARNING) << "Unable to decompress packet";
+            return false;
+        }
+
+        data = decompressed_;
+    }
+    else if (packet.compression() != proto::FILE_COMPRESSION_NONE)
+    {
+        LOG(LS_WARNING) << "Unsupported compression: " << packet.compression();
+        return false;
+    }
+
+    if (packet.delta_op_size() && !applyDelta(packet, &data))
+        return false;
+
+    const size_t packet_size = data.size();
+    if (packet_size > kMaxFilePacketSize)
+    {
+        LOG(LS_WARNING) << "Too large packet: " << packet_size;
+        return false;
+    }
+
+    // The first packet must have the full file size.
+    if (packet.flags() & proto::FilePacket::FIRST_PACKET)
+    {
+        if (!seek(packet.offset()))
+            return false;
+
+        file_size_ = packet.file_size();
+        left_size_ = file_size_;
+
+        if (chunk_store_)
+        {
+            uint64_t chunks_size = 0;
+            for (const auto& size : chunk_list_.size())
+                chunks_size += size;
+
+            if (packet.offset() || chunks_size != file_size_)
+            {
+                LOG(LS_WARNING) << "File does not match chunk list";
+                return false;
+            }
+        }
+    }
+
+    if (chunk_store_)
+        storeChunks(data);
 
-    const size_t packet_size = packet.data().size();
     if (!packet_size)
     {
+        // An empty file is sent in one empty packet.
+        const uint32_t kEmptyFileFlags =
+            proto::FilePacket::FIRST_PACKET | proto::FilePacket::LAST_PACKET;
+        if ((packet.flags() & kEmptyFileFlags) == kEmptyFileFlags)
+            return finish();
+
         // If an empty data packet with the last packet flag set is received, the transfer
         // is canceled.
         if (packet.flags() & proto::FilePacket::LAST_PACKET)
+        {
+            is_canceled_ = true;
             return true;
+        }
 
         LOG(LS_WARNING) << "Wrong packet size";
         return false;
     }
 
-    // The first packet must have the full file size.
-    if (packet.flags() & proto::FilePacket::FIRST_PACKET)
+    if (buffer_size_ + packet_size > kFileBufferSize && !flush())
+        return false;
+
+    if (packet_size >= kFileBufferSize)
     {
-        file_size_ = packet.file_size();
-        left_size_ = file_size_;
+        // Large packets are written directly.
+        if (!file_.write(write_offset_, data.data(), packet_size))
+        {
+            LOG(LS_WARNING) << "Unable to write file";
+            return false;
+        }
+
+        write_offset_ += packet_size;
+    }
+    else
+    {
+        if (!buffer_)
+        {
+            buffer_.reset(static_cast<char*>(
+                base::alignedAlloc(kFileBufferSize, kFileBufferAlignment)));
+        }
+
+        memcpy(buffer_.get() + buffer_size_, data.data(), packet_size);
+        buffer_size_ += packet_size;
     }
 
-    file_stream_.seekp(file_size_ - left_size_);
-    file_stream_.write(packet.data().data(), packet_size);
-    if (file_stream_.fail())
+    left_size_ -= packet_size;
+
+    if (packet.flags() & proto::FilePacket::LAST_PACKET)
+        return finish();
+
+    return true;
+}
+
+bool FileDepacketizer::seek(uint64_t offset)
+{
+    // Only the temporary files can be continued.
+    if (target_path_.empty())
+    {
+        if (offset)
+        {
+            LOG(LS_WARNING) << "Unexpected file offset: " << offset;
+            return false;
+        }
+
+        return true;
+    }
+
+    const int64_t file_size = file_.length();
+    if (file_size < 0 || offset > static_cast<uint64_t>(file_size))
+    {
+        LOG(LS_WARNING) << "Wrong file offset: " << offset;
+        return false;
+    }
+
+    // The data after the offset is sent again.
+    if (!file_.setLength(static_cast<int64_t>(offset)))
+    {
+        LOG(LS_WARNING) << "Unable to truncate file";
+        return false;
+    }
+
+    write_offset_ = offset;
+    return true;
+}
+
+bool FileDepacketizer::applyDelta(const proto::FilePacket& packet, std::string_view* data)
+{
+    uint64_t literal_size = 0;
+    uint64_t total_size = 0;
+
+    for (const auto& op : packet.delta_op())
+    {
+        literal_size += op.literal_size();
+        total_size += static_cast<uint64_t>(op.literal_size()) + op.copy_size();
+    }
+
+    if (literal_size != data->size() || total_size > kMaxFilePacketSize)
+    {
+        LOG(LS_WARNING) << "Invalid delta packet";
+        return false;
+    }
+
+    delta_data_.resize(static_cast<size_t>(total_size));
+
+    char* output = delta_data_.data();
+    const char* literal = data->data();
+
+    for (const auto& op : packet.delta_op())
+    {
+        memcpy(output, literal, op.literal_size());
+        output += op.literal_size();
+        literal += op.literal_size();
+
+        if (!op.copy_size())
+            continue;
+
+        if (!op.chunk_hash().empty())
+        {
+            if (!readChunk(op.chunk_hash(), op.copy_offset(), op.copy_size(), output))
+                return false;
+
+            output += op.copy_size();
+            continue;
+        }
+
+        if (!existing_file_.isValid())
+        {
+            LOG(LS_WARNING) << "Unexpected delta packet";
+            return false;
+        }
+
+        if (existing_file_.read(static_cast<int64_t>(op.copy_offset()), output, op.copy_size()) !=
+            static_cast<int64_t>(op.copy_size()))
+        {
+            LOG(LS_WARNING) << "Unable to read existing file";
+            return false;
+        }
+
+        output += op.copy_size();
+    }
+
+    *data = delta_data_;
+    return true;
+}
+
+bool FileDepacketizer::readChunk(
+    std::string_view hash, uint64_t offset, uint32_t size, char* output)
+{
+    if (!chunk_store_)
+    {
+        LOG(LS_WARNING) << "Unexpected chunk reference";
+        return false;
+    }
+
+    if (cached_chunk_hash_ != hash)
+    {
+        cached_chunk_hash_.clear();
+
+        if (!chunk_store_->read(hash, &cached_chunk_))
+        {
+            LOG(LS_WARNING) << "Unable to read chunk";
+            return false;
+        }
+
+        cached_chunk_hash_ = hash;
+    }
+
+    if (offset > cached_chunk_.size() || size > cached_chunk_.size() - offset)
+    {
+        LOG(LS_WARNING) << "Invalid chunk reference";
+        return false;
+    }
+
+    memcpy(output, cached_chunk_.data() + offset, size);
+    return true;
+}
+
+void FileDepacketizer::storeChunks(std::string_view data)
+{
+    while (!data.empty() && chunk_index_ < chunk_list_.size_size())
+    {
+        const uint32_t chunk_size = chunk_list_.size(chunk_index_);
+        const size_t part_size = std::min<size_t>(data.size(), chunk_size - chunk_offset_);
+        const bool is_present = isChunkPresent(present_chunks_, chunk_index_);
+
+        if (!is_present)
+            chunk_data_.append(data.substr(0, part_size));
+
+        data.remove_prefix(part_size);
+        chunk_offset_ += static_cast<uint32_t>(part_size);
+
+        if (chunk_offset_ < chunk_size)
+            break;
+
+        // A chunk whose data does not match its hash is not added. The file is still written as
+        // it is received.
+        if (!is_present &&
+            !chunk_store_->add(fileChunkHashAt(chunk_list_, chunk_index_), chunk_data_))
+        {
+            LOG(LS_WARNING) << "Unable to add chunk " << chunk_index_;
+        }
+
+        chunk_data_.clear();
+        chunk_offset_ = 0;
+        ++chunk_index_;
+    }
+}
+
+bool FileDepacketizer::flush()
+{
+    if (!buffer_size_)
+        return true;
+
+    if (!file_.write(write_offset_, buffer_.get(), buffer_size_))
     {
         LOG(LS_WARNING) << "Unable to write file";
         return false;
     }
 
-    left_size_ -= packet_size;
+    write_offset_ += buffer_size_;
+    buffer_size_ = 0;
+    return true;
+}
 
-    if (packet.flags() & proto::FilePacket::LAST_PACKET)
+bool FileDepacketizer::finish()
+{
+    if (!flush())
+        return false;
+
+    file_size_ = 0;
+    file_.close();
+    existing_file_.close();
+
+    if (!target_path_.empty())
     {
-        file_size_ = 0;
-        file_stream_.close();
+        std::error_code error_code;
+        std::filesystem::rename(file_path_, target_path_, error_code);
+
+        if (error_code)
+        {
+            LOG(LS_WARNING) << "Unable to rename file: " << error_code.message();
+
+            std::error_code ignored_error;
+            std::filesystem::remove(file_path_, ignored_error);
+            return false;
+        }
     }
 
     return true;
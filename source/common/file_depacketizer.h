@@ -19,35 +19,108 @@
 #ifndef COMMON__FILE_DEPACKETIZER_H
 #define COMMON__FILE_DEPACKETIZER_H
 
-#include "base/macros_magic.h"
+#include "base/codec/chunk_compressor.h"
+#include "base/files/file.h"
+#include "base/memory/aligned_memory.h"
 #include "proto/file_transfer.pb.h"
 
 #include <filesystem>
-#include <fstream>
 #include <memory>
+#include <string>
 
 namespace common {
 
+class FileChunkStore;
+
 class FileDepacketizer
 {
 public:
     ~FileDepacketizer();
 
-    static std::unique_ptr<FileDepacketizer> create(const std::filesystem::path& file_path,
-                                                    bool overwrite);
+    // Creates the file at |file_path|. If the transfer is not completed, the file is deleted.
+    static std::unique_ptr<FileDepacketizer> create(const std::filesystem::path& file_path);
+
+    // The file is written under a temporary name and renamed to |file_path| when it is complete.
+    // If |keep_partial| is true and the transfer is interrupted, the temporary file is kept. If
+    // it remains from a previous transfer, the signature of the partial file is returned in
+    // |signature|. Otherwise, if |delta| is true and the file exists, the signature of the
+    // existing file is returned; the packets may then refer to its blocks.
+    static std::unique_ptr<FileDepacketizer> createPartial(const std::filesystem::path& file_path,
+                                                           bool keep_partial,
+                                                           bool delta,
+                                                           proto::FileSignature* signature);
+
+    // Called before the first packet if the source splits the file into chunks. The chunks which
+    // are in |chunk_store| are returned in |present_chunks| (see FileSyncRequest) and the packets
+    // may refer to them. The other chunks are added to the store when they are received.
+    bool setChunkList(const proto::FileChunkList& chunk_list,
+                      std::shared_ptr<FileChunkStore> chunk_store,
+                      std::string* present_chunks);
 
     // Reads the packet and writes its contents to a file.
     bool writeNextPacket(const proto::FilePacket& packet);
 
 private:
-    FileDepacketizer(const std::filesystem::path& file_path, std::ofstream&& file_stream);
+    FileDepacketizer(const std::filesystem::path& file_path, base::File&& file);
+
+    // Moves the write position to |offset| of the first packet.
+    bool seek(uint64_t offset);
+
+    // Builds the data of the packet from the literal data and the blocks of the existing file.
+    bool applyDelta(const proto::FilePacket& packet, std::string_view* data);
+
+    // Copies |size| bytes at |offset| of the chunk with |hash| from the chunk store.
+    bool readChunk(std::string_view hash, uint64_t offset, uint32_t size, char* output);
+
+    // Adds the chunks of the data which are not in the chunk store.
+    void storeChunks(std::string_view data);
+
+    // Writes the buffered data to the file.
+    bool flush();
+
+    // Closes the completed file and gives it the target name.
+    bool finish();
 
+    // The path of the file being written.
     std::filesystem::path file_path_;
-    std::ofstream file_stream_;
+    base::File file_;
+
+    // The name of the completed file and the existing version of it for the temporary files.
+    std::filesystem::path target_path_;
+    base::File existing_file_;
+    std::string delta_data_;
+
+    // The chunks of the file and the position of the next packet in them.
+    std::shared_ptr<FileChunkStore> chunk_store_;
+    proto::FileChunkList chunk_list_;
+    std::string present_chunks_;
+    int chunk_index_ = 0;
+
+    // The received part of the current chunk if it is not in the store.
+    std::string chunk_data_;
+    uint32_t chunk_offset_ = 0;
+
+    // The last chunk read from the store. Its parts are often referenced by several packets.
+    std::string cached_chunk_hash_;
+    std::string cached_chunk_;
+
+    bool keep_partial_ = false;
+    bool is_canceled_ = false;
+
+    // Small packets are collected in the buffer and written with one large write.
+    std::unique_ptr<char, base::AlignedFreeDeleter> buffer_;
+    size_t buffer_size_ = 0;
+
+    // The offset in the file of the data in the buffer.
+    uint64_t write_offset_ = 0;
 
     uint64_t file_size_ = 0;
     uint64_t left_size_ = 0;
 
+    // Created when the first compressed packet is received.
+    std::unique_ptr<base::ChunkDecompressor> decompressor_;
+    std::string decompressed_;
+
     DISALLOW_COPY_AND_ASSIGN(FileDepacketizer);
 };
 
@@ -0,0 +1,118 @@
+//
+// Aspia Project
+// Copyright (C) 2020 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+
+#include "common/file_list_cursor.h"
+
+#include "base/logging.h"
+#include "build/build_config.h"
+
+#if defined(OS_WIN)
+#include "common/win/file_enumerator.h"
+#endif // defined(OS_WIN)
+
+namespace common {
+
+namespace {
+
+// The serialized page must fit into one network message (16 MB) with a large margin.
+const size_t kMaxFileListPageBytes = 4 * 1024 * 1024; // 4 MB
+
+// The approximate size of the fields of an item besides the name.
+const size_t kFileListItemOverhead = 32;
+
+} // namespace
+
+FileListCursor::FileListCursor(const std::filesystem::path& root_path, bool recursive)
+    : root_path_(root_path),
+      recursive_(recursive)
+{
+    pushLevel(root_path_, std::string());
+}
+
+FileListCursor::~FileListCursor() = default;
+
+bool FileListCursor::read(size_t max_items, proto::FileList* file_list)
+{
+    DCHECK(file_list);
+
+    size_t page_bytes = 0;
+    size_t count = 0;
+
+    while (!levels_.empty())
+    {
+        Level& level = levels_.back();
+        FileEnumerator* enumerator = level.enumerator.get();
+
+        if (enumerator->isAtEnd())
+        {
+            error_code_ = enumerator->errorCode();
+            if (error_code_ != proto::FILE_ERROR_SUCCESS)
+            {
+                levels_.clear();
+                return false;
+            }
+
+            levels_.pop_back();
+            continue;
+        }
+
+        if (count >= max_items || page_bytes >= kMaxFileListPageBytes)
+            return true;
+
+        const FileEnumerator::FileInfo& file_info = enumerator->fileInfo();
+
+        std::string name = level.prefix + file_info.u8name();
+        page_bytes += name.size() + kFileListItemOverhead;
+        ++count;
+
+        proto::FileList::Item* item = file_list->add_item();
+        item->set_size(file_info.size());
+        item->set_modification_time(file_info.lastWriteTime());
+        item->set_is_directory(file_info.isDirectory());
+
+        // Links to directories are not followed: they can make a cycle.
+        const bool descend = recursive_ && file_info.isDirectory() && !file_info.isLink();
+        std::filesystem::path path;
+
+        if (descend)
+            path = root_path_ / std::filesystem::u8path(name);
+
+        item->set_name(name);
+        enumerator->advance();
+
+        if (descend)
+        {
+            name += '/';
+            pushLevel(path, std::move(name));
+        }
+    }
+
+    return false;
+}
+
+void FileListCursor::pushLevel(const std::filesystem::path& path, std::string&& prefix)
+{
+    Level level;
+    level.enumerator = std::make_unique<FileEnumerator>(path);
+    level.prefix = std::move(prefix);
+
+    levels_.emplace_back(std::move(level));
+}
+
+} // namespace common
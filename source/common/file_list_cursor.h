@@ -0,0 +1,78 @@
+//
+// Aspia Project
+// Copyright (C) 2020 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+
+#ifndef COMMON__FILE_LIST_CURSOR_H
+#define COMMON__FILE_LIST_CURSOR_H
+
+#include "base/macros_magic.h"
+#include "proto/file_transfer.pb.h"
+
+#include <filesystem>
+#include <memory>
+#include <vector>
+
+namespace common {
+
+class FileEnumerator;
+
+// The default and the largest number of items in one page of a file list.
+static const uint32_t kFileListPageSize = 4096;
+static const uint32_t kMaxFileListPageSize = 65536;
+
+// Lists a directory in pages. The directory stays open between the pages, so a large directory is
+// read only once. For a recursive list the subdirectories are listed after their directory
+// (depth-first), which keeps only one enumerator per level open.
+class FileListCursor
+{
+public:
+    FileListCursor(const std::filesystem::path& root_path, bool recursive);
+    ~FileListCursor();
+
+    // Adds up to |max_items| items to |file_list|. Returns true if the list has more items.
+    // A page is also finished earlier when its size approaches the limit of a network message.
+    bool read(size_t max_items, proto::FileList* file_list);
+
+    // The error of the last opened directory. The list ends with the error.
+    proto::FileError errorCode() const { return error_code_; }
+
+    bool isRecursive() const { return recursive_; }
+
+private:
+    struct Level
+    {
+        std::unique_ptr<FileEnumerator> enumerator;
+
+        // The path of the directory relative to the root with a trailing separator.
+        std::string prefix;
+    };
+
+    void pushLevel(const std::filesystem::path& path, std::string&& prefix);
+
+    const std::filesystem::path root_path_;
+    const bool recursive_;
+
+    std::vector<Level> levels_;
+    proto::FileError error_code_ = proto::FILE_ERROR_SUCCESS;
+
+    DISALLOW_COPY_AND_ASSIGN(FileListCursor);
+};
+
+} // namespace common
+
+#endif // COMMON__FILE_LIST_CURSOR_H
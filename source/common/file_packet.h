@@ -19,11 +19,48 @@
 #ifndef COMMON__FILE_PACKET_H
 #define COMMON__FILE_PACKET_H
 
+#include <cstddef>
+#include <cstdint>
+
 namespace common {
 
 // When transferring a file is divided into parts and each part is transmitted separately.
-// This parameter specifies the size of the part.
-static const size_t kMaxFilePacketSize = 16 * 1024; // 16 kB
+// This parameter specifies the size of the part for peers which do not negotiate it. It is also
+// the initial size of the part for peers which do.
+static const size_t kDefaultFilePacketSize = 16 * 1024; // 16 kB
+
+// The largest part. Together with the protocol overhead it must fit into one network message
+// (16 MB).
+static const size_t kMaxFilePacketSize = 4 * 1024 * 1024; // 4 MB
+
+// Files are read and written with buffers of this size, whatever the size of packets is.
+static const size_t kFileBufferSize = 1024 * 1024; // 1 MB
+
+// The alignment of the file buffers (the page size).
+static const size_t kFileBufferAlignment = 4096;
+
+// The maximum number of file packets which can be in flight at the same time (see
+// DownloadRequest::max_window_size and UploadRequest::max_window_size).
+static const uint32_t kMaxFilePacketWindow = 256;
+
+// Files up to this size and directories are transferred in batches: one request reads or writes
+// many of them (see BatchDownloadRequest and BatchUploadRequest).
+static const int64_t kMaxBatchFileSize = 64 * 1024; // 64 kB
+
+// The limits of one batch. A file which grew after the queue was built is still sent in the batch
+// if it does not exceed kMaxFilePacketSize. The source also checks the limits and cuts the reply
+// when they are reached, the rest of the batch is requested again.
+static const size_t kMaxFileBatchSize = 2 * 1024 * 1024; // 2 MB
+static const size_t kMaxFileBatchItems = 256;
+
+// The number of batches which are read or written at the same time.
+static const size_t kMaxFileBatchesInFlight = 4;
+
+// New files of these sizes are sent as content-defined chunks, and the chunks which the target
+// already has are not sent (see FileChunkList). Smaller files are not worth the extra requests and
+// the chunk list of a larger file would not fit into one message.
+static const uint64_t kMinChunkedFileSize = 1024 * 1024; // 1 MB
+static const uint64_t kMaxChunkedFileSize = 8ULL * 1024 * 1024 * 1024; // 8 GB
 
 } // namespace common
 
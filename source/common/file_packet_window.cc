@@ -0,0 +1,170 @@
+//
+// Aspia Project
+// Copyright (C) 2020 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "common/file_packet_window.h"
+
+#include "base/logging.h"
+#include "common/file_packet.h"
+
+#include <algorithm>
+
+namespace common {
+
+namespace {
+
+// Variations of the round trip time below this value are not considered queuing.
+constexpr std::chrono::milliseconds kRttTolerance(5);
+
+// The throughput is measured over this interval.
+constexpr std::chrono::milliseconds kRateInterval(200);
+
+// The duration of the transfer of one packet.
+constexpr std::chrono::milliseconds kPacketDuration(20);
+
+} // namespace
+
+FilePacketWindow::FilePacketWindow()
+    : max_packet_size_(kDefaultFilePacketSize),
+      packet_size_(kDefaultFilePacketSize)
+{
+    // Nothing
+}
+
+void FilePacketWindow::setLimits(uint32_t max_size, size_t max_packet_size)
+{
+    max_size_ = std::max(max_size, uint32_t(1));
+    max_packet_size_ = std::clamp(max_packet_size, kDefaultFilePacketSize, kMaxFilePacketSize);
+
+    // The first file starts with the initial window, the next ones continue with the window
+    // of the previous file.
+    if (!has_limits_)
+    {
+        size_ = kInitialSize;
+        has_limits_ = true;
+    }
+
+    size_ = std::min(size_, max_size_);
+    packet_size_ = std::min(packet_size_, max_packet_size_);
+}
+
+bool FilePacketWindow::canSend() const
+{
+    return in_flight_.size() < size_ && bytes_in_flight_ < kMaxBytesInFlight;
+}
+
+void FilePacketWindow::onPacketSent(size_t packet_size, TimePoint time)
+{
+    if (in_flight_.empty())
+    {
+        // The throughput is measured only while packets are in flight.
+        rate_start_time_ = time;
+        rate_bytes_ = 0;
+    }
+
+    in_flight_.push_back({ time, packet_size });
+    bytes_in_flight_ += packet_size;
+}
+
+void FilePacketWindow::onPacketConfirmed(TimePoint time)
+{
+    if (in_flight_.empty())
+    {
+        NOTREACHED();
+        return;
+    }
+
+    const size_t in_flight = in_flight_.size();
+
+    // Packets are confirmed in the order in which they were sent.
+    const Packet packet = in_flight_.front();
+    in_flight_.pop_front();
+
+    bytes_in_flight_ -= packet.size;
+
+    updateWindowSize(in_flight, time - packet.time);
+    updatePacketSize(packet.size, time);
+}
+
+void FilePacketWindow::clear()
+{
+    in_flight_.clear();
+    bytes_in_flight_ = 0;
+    hold_count_ = 0;
+}
+
+void FilePacketWindow::updateWindowSize(size_t in_flight, Clock::duration rtt)
+{
+    min_rtt_ = std::min(min_rtt_, rtt);
+
+    if (hold_count_)
+        --hold_count_;
+
+    if (rtt <= min_rtt_ + std::max(Clock::duration(min_rtt_ / 2), Clock::duration(kRttTolerance)))
+    {
+        // The window was fully used and packets are not queued. The link can take more.
+        if (in_flight >= size_)
+            size_ = std::min(size_ + 1, max_size_);
+        return;
+    }
+
+    if (hold_count_)
+        return;
+
+    // With N packets in flight the throughput is N / rtt. The same throughput is reached with
+    // N * min_rtt / rtt packets in flight without the queuing.
+    const uint32_t estimate = static_cast<uint32_t>(
+        (in_flight * min_rtt_.count() + rtt.count() - 1) / rtt.count());
+
+    size_ = std::clamp(estimate + 1, uint32_t(1), std::min(size_, max_size_));
+
+    // The packets sent with the previous window are still arriving.
+    hold_count_ = static_cast<uint32_t>(in_flight);
+}
+
+void FilePacketWindow::updatePacketSize(size_t packet_size, TimePoint time)
+{
+    rate_bytes_ += packet_size;
+
+    const Clock::duration elapsed = time - rate_start_time_;
+    if (elapsed < kRateInterval)
+        return;
+
+    const uint64_t bytes_per_packet = static_cast<uint64_t>(rate_bytes_) *
+        std::chrono::duration_cast<Clock::duration>(kPacketDuration).count() / elapsed.count();
+
+    // Round down to a power of two, so the size does not change with every measurement.
+    size_t new_packet_size = kDefaultFilePacketSize;
+    while (new_packet_size * 2 <= bytes_per_packet && new_packet_size * 2 <= max_packet_size_)
+        new_packet_size *= 2;
+
+    // Grow gradually, the throughput may have been limited by the small packets.
+    new_packet_size = std::min(new_packet_size, packet_size_ * 2);
+
+    if (new_packet_size != packet_size_)
+    {
+        packet_size_ = new_packet_size;
+
+        // Larger packets take longer to transfer, the old minimum no longer applies.
+        min_rtt_ = Clock::duration::max();
+    }
+
+    rate_start_time_ = time;
+    rate_bytes_ = 0;
+}
+
+} // namespace common
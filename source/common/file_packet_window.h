@@ -0,0 +1,108 @@
+//
+// Aspia Project
+// Copyright (C) 2020 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#ifndef COMMON__FILE_PACKET_WINDOW_H
+#define COMMON__FILE_PACKET_WINDOW_H
+
+#include "base/macros_magic.h"
+
+#include <chrono>
+#include <cstdint>
+#include <deque>
+
+namespace common {
+
+// Controls the number of file packets in flight. A packet is in flight from the moment it is
+// requested from the source until the target confirms that it is written.
+//
+// The window starts small and grows by one packet per confirmed packet (it doubles every round
+// trip) while the round trip time stays close to the minimum observed. When the round trip time
+// grows, packets are queued somewhere on the path: the window is larger than the bandwidth-delay
+// product and it is reduced to the estimate of the product.
+//
+// The size of packets follows the measured throughput: a packet carries about 20 ms of the
+// transfer, so fast links do not pay the per-packet overhead thousands of times per second. The
+// size starts at kDefaultFilePacketSize and at most doubles per measurement.
+class FilePacketWindow
+{
+public:
+    using Clock = std::chrono::steady_clock;
+    using TimePoint = Clock::time_point;
+
+    FilePacketWindow();
+    ~FilePacketWindow() = default;
+
+    // Sets the limits negotiated with the peers. The window size 1 means stop-and-wait.
+    void setLimits(uint32_t max_size, size_t max_packet_size);
+
+    // Returns true if one more packet can be requested.
+    bool canSend() const;
+
+    uint32_t size() const { return size_; }
+    size_t inFlight() const { return in_flight_.size(); }
+
+    // Returns the size of the data to request in the next packet.
+    size_t packetSize() const { return packet_size_; }
+
+    void onPacketSent(size_t packet_size, TimePoint time = Clock::now());
+    void onPacketConfirmed(TimePoint time = Clock::now());
+
+    // Forgets the packets in flight (after an error). The window size and the round trip time
+    // estimate are kept for the next file.
+    void clear();
+
+    static const uint32_t kInitialSize = 4;
+
+    // The limit of data in flight, whatever the window size is.
+    static const size_t kMaxBytesInFlight = 32 * 1024 * 1024;
+
+private:
+    void updateWindowSize(size_t in_flight, Clock::duration rtt);
+    void updatePacketSize(size_t packet_size, TimePoint time);
+
+    struct Packet
+    {
+        TimePoint time;
+        size_t size;
+    };
+
+    std::deque<Packet> in_flight_;
+    size_t bytes_in_flight_ = 0;
+
+    bool has_limits_ = false;
+    uint32_t max_size_ = 1;
+    uint32_t size_ = 1;
+
+    size_t max_packet_size_;
+    size_t packet_size_;
+
+    Clock::duration min_rtt_ = Clock::duration::max();
+
+    // Bytes confirmed since |rate_start_time_|.
+    TimePoint rate_start_time_;
+    size_t rate_bytes_ = 0;
+
+    // The number of packets to confirm before the window can be reduced again.
+    uint32_t hold_count_ = 0;
+
+    DISALLOW_COPY_AND_ASSIGN(FilePacketWindow);
+};
+
+} // namespace common
+
+#endif // COMMON__FILE_PACKET_WINDOW_H
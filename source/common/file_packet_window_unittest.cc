@@ -0,0 +1,178 @@
+//
+// Aspia Project
+// Copyright (C) 2020 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "common/file_packet_window.h"
+
+#include "common/file_packet.h"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <deque>
+
+namespace common {
+
+namespace {
+
+using Clock = FilePacketWindow::Clock;
+using TimePoint = FilePacketWindow::TimePoint;
+
+// A link with a constant round trip time: the packets are requested while the window allows and
+// every packet is confirmed |rtt| after it was sent.
+class Link
+{
+public:
+    explicit Link(FilePacketWindow* window)
+        : window_(window)
+    {
+        // Nothing
+    }
+
+    // Fills the window and confirms the oldest packet.
+    void step(Clock::duration rtt)
+    {
+        while (window_->canSend())
+        {
+            window_->onPacketSent(window_->packetSize(), now_);
+            sent_.push_back(now_);
+        }
+
+        now_ = std::max(now_, sent_.front() + rtt);
+        sent_.pop_front();
+
+        window_->onPacketConfirmed(now_);
+    }
+
+    TimePoint now() const { return now_; }
+
+private:
+    FilePacketWindow* window_;
+    TimePoint now_;
+    std::deque<TimePoint> sent_;
+};
+
+const uint32_t kInitialSize = FilePacketWindow::kInitialSize;
+const std::chrono::milliseconds kRtt(10);
+
+} // namespace
+
+TEST(FilePacketWindowTest, Limits)
+{
+    FilePacketWindow window;
+
+    // Without the negotiated limits the transfer is stop-and-wait.
+    EXPECT_EQ(window.size(), 1u);
+    EXPECT_EQ(window.packetSize(), kDefaultFilePacketSize);
+    EXPECT_TRUE(window.canSend());
+
+    window.onPacketSent(window.packetSize());
+    EXPECT_FALSE(window.canSend());
+
+    window.onPacketConfirmed();
+    EXPECT_TRUE(window.canSend());
+
+    window.setLimits(64, kMaxFilePacketSize);
+    EXPECT_EQ(window.size(), kInitialSize);
+
+    window.setLimits(2, kMaxFilePacketSize);
+    EXPECT_EQ(window.size(), 2u);
+
+    window.onPacketSent(window.packetSize());
+    window.onPacketSent(window.packetSize());
+    EXPECT_FALSE(window.canSend());
+    EXPECT_EQ(window.inFlight(), 2u);
+
+    window.clear();
+    EXPECT_EQ(window.inFlight(), 0u);
+    EXPECT_TRUE(window.canSend());
+}
+
+TEST(FilePacketWindowTest, GrowsWithoutQueuing)
+{
+    FilePacketWindow window;
+    window.setLimits(64, kMaxFilePacketSize);
+
+    Link link(&window);
+
+    // The window doubles every round trip.
+    for (uint32_t i = 0; i < kInitialSize; ++i)
+        link.step(kRtt);
+    EXPECT_EQ(window.size(), 2 * kInitialSize);
+
+    for (uint32_t i = 0; i < 2 * kInitialSize; ++i)
+        link.step(kRtt);
+    EXPECT_EQ(window.size(), 4 * kInitialSize);
+
+    // And stops at the limit.
+    for (int i = 0; i < 100; ++i)
+        link.step(kRtt);
+    EXPECT_EQ(window.size(), 64u);
+    EXPECT_EQ(window.inFlight(), 63u);
+}
+
+TEST(FilePacketWindowTest, ShrinksOnQueuing)
+{
+    FilePacketWindow window;
+    window.setLimits(64, kMaxFilePacketSize);
+
+    Link link(&window);
+
+    while (window.size() < 64)
+        link.step(kRtt);
+
+    // The round trip time grows four times: the data in flight is four times the bandwidth-delay
+    // product.
+    link.step(4 * kRtt);
+    EXPECT_EQ(window.size(), 64u / 4 + 1);
+    EXPECT_FALSE(window.canSend());
+
+    // The packets sent with the previous window do not reduce it again.
+    link.step(4 * kRtt);
+    EXPECT_EQ(window.size(), 64u / 4 + 1);
+
+    // Small variations of the round trip time are not queuing.
+    FilePacketWindow stable_window;
+    stable_window.setLimits(64, kMaxFilePacketSize);
+
+    Link stable_link(&stable_window);
+
+    for (int i = 0; i < 20; ++i)
+        stable_link.step(kRtt + std::chrono::milliseconds(i % 2 ? 4 : 0));
+    EXPECT_GT(stable_window.size(), 2 * kInitialSize);
+}
+
+TEST(FilePacketWindowTest, PacketSizeFollowsThroughput)
+{
+    FilePacketWindow window;
+    window.setLimits(4, 4 * kDefaultFilePacketSize);
+
+    Link link(&window);
+
+    // About 64 MB/s: a packet of 20 ms is much larger than the limit, but the size at most
+    // doubles per measurement.
+    const TimePoint start_time = link.now();
+    while (link.now() - start_time < std::chrono::milliseconds(250))
+        link.step(std::chrono::milliseconds(1));
+    EXPECT_EQ(window.packetSize(), 2 * kDefaultFilePacketSize);
+
+    while (link.now() - start_time < std::chrono::seconds(2))
+        link.step(std::chrono::milliseconds(1));
+    EXPECT_EQ(window.packetSize(), 4 * kDefaultFilePacketSize);
+}
+
+} // namespace common
@@ -19,8 +19,13 @@
 #include "common/file_packetizer.h"
 
 #include "base/logging.h"
+#include "common/file_chunker.h"
+#include "common/file_delta.h"
 #include "common/file_packet.h"
 
+#include <algorithm>
+#include <cstring>
+
 namespace common {
 
 namespace {
@@ -33,30 +38,35 @@ char* outputBuffer(proto::FilePacket* packet, size_t size)
 
 } // namespace
 
-FilePacketizer::FilePacketizer(std::ifstream&& file_stream)
-    : file_stream_(std::move(file_stream))
+FilePacketizer::FilePacketizer(base::File&& file, uint64_t file_size)
+    : file_(std::move(file)),
+      file_size_(file_size),
+      left_size_(file_size)
 {
-    file_stream_.seekg(0, file_stream_.end);
-    file_size_ = file_stream_.tellg();
-    file_stream_.seekg(0);
-    left_size_ = file_size_;
+    // Nothing
 }
 
+FilePacketizer::~FilePacketizer() = default;
+
+// static
 std::unique_ptr<FilePacketizer> FilePacketizer::create(const std::filesystem::path& file_path)
 {
-    std::ifstream file_stream;
+    base::File file(file_path,
+                    base::File::FLAG_OPEN | base::File::FLAG_READ | base::File::FLAG_SEQUENTIAL);
+    if (!file.isValid())
+        return nullptr;
 
-    file_stream.open(file_path, std::ifstream::binary);
-    if (!file_stream.is_open())
+    const int64_t file_size = file.length();
+    if (file_size < 0)
         return nullptr;
 
-    return std::unique_ptr<FilePacketizer>(new FilePacketizer(std::move(file_stream)));
+    return std::unique_ptr<FilePacketizer>(new FilePacketizer(std::move(file), file_size));
 }
 
 std::unique_ptr<proto::FilePacket> FilePacketizer::readNextPacket(
     const proto::FilePacketRequest& request)
 {
-    DCHECK(file_stream_.is_open());
+    DCHECK(file_.isValid());
 
     // Create a new file packet.
     std::unique_ptr<proto::FilePacket> packet = std::make_unique<proto::FilePacket>();
@@ -67,29 +77,65 @@ std::unique_ptr<proto::FilePacket> FilePacketizer::readNextPacket(
         return packet;
     }
 
-    size_t packet_buffer_size = kMaxFilePacketSize;
+    size_t packet_buffer_size = kDefaultFilePacketSize;
+
+    // The client can ask for a different size.
+    if (request.packet_size())
+    {
+        packet_buffer_size =
+            std::min(static_cast<size_t>(request.packet_size()), kMaxFilePacketSize);
+    }
 
-    if (left_size_ < kMaxFilePacketSize)
+    if (left_size_ < packet_buffer_size)
         packet_buffer_size = static_cast<size_t>(left_size_);
 
-    char* packet_buffer = outputBuffer(packet.get(), packet_buffer_size);
+    if (delta_encoder_)
+    {
+        if (!delta_encoder_->encode(packet_buffer_size, packet.get()))
+            return nullptr;
+    }
+    else if (!present_chunks_.empty())
+    {
+        if (!encodeChunks(packet_buffer_size, packet.get()))
+        {
+            LOG(LS_WARNING) << "Unable to read file";
+            return nullptr;
+        }
+    }
+    else
+    {
+        char* packet_buffer = outputBuffer(packet.get(), packet_buffer_size);
 
-    // Moving to a new position in file.
-    file_stream_.seekg(file_size_ - left_size_);
+        if (!read(packet_buffer, packet_buffer_size))
+        {
+            LOG(LS_WARNING) << "Unable to read file";
+            return nullptr;
+        }
+    }
 
-    file_stream_.read(packet_buffer, packet_buffer_size);
-    if (file_stream_.fail())
+    if (request.compression() == proto::FILE_COMPRESSION_ZSTD)
     {
-        LOG(LS_WARNING) << "Unable to read file";
-        return nullptr;
+        if (!compressor_)
+            compressor_ = std::make_unique<base::ChunkCompressor>();
+
+        // Incompressible data is sent as is.
+        if (compressor_->compress(packet->data(), &compressed_))
+        {
+            packet->set_compression(proto::FILE_COMPRESSION_ZSTD);
+            packet->set_uncompressed_size(static_cast<uint32_t>(packet->data().size()));
+            packet->mutable_data()->swap(compressed_);
+        }
     }
 
-    if (left_size_ == file_size_)
+    if (is_first_packet_)
     {
         packet->set_flags(packet->flags() | proto::FilePacket::FIRST_PACKET);
 
-        // Set file path and size in first packet.
+        // Set file size and the position of the data in first packet.
         packet->set_file_size(file_size_);
+        packet->set_offset(file_size_ - left_size_);
+
+        is_first_packet_ = false;
     }
 
     left_size_ -= packet_buffer_size;
@@ -97,7 +143,7 @@ std::unique_ptr<proto::FilePacket> FilePacketizer::readNextPacket(
     if (!left_size_)
     {
         file_size_ = 0;
-        file_stream_.close();
+        file_.close();
 
         packet->set_flags(packet->flags() | proto::FilePacket::LAST_PACKET);
     }
@@ -105,4 +151,181 @@ std::unique_ptr<proto::FilePacket> FilePacketizer::readNextPacket(
     return packet;
 }
 
+bool FilePacketizer::sync(const proto::FileSignature& signature, uint64_t* resume_offset)
+{
+    DCHECK(resume_offset);
+
+    *resume_offset = 0;
+
+    if (!is_first_packet_ || !isValidFileSignature(signature))
+    {
+        LOG(LS_WARNING) << "Unexpected file signature";
+        return false;
+    }
+
+    if (signature.type() == proto::FileSignature::TYPE_PARTIAL_FILE)
+    {
+        const int64_t offset = partialFileMatch(&file_, signature);
+        if (offset < 0)
+        {
+            LOG(LS_WARNING) << "Unable to read file";
+            return false;
+        }
+
+        *resume_offset = static_cast<uint64_t>(offset);
+
+        read_offset_ = *resume_offset;
+        left_size_ = file_size_ - *resume_offset;
+        return true;
+    }
+
+    delta_encoder_ = std::make_unique<FileDeltaEncoder>(&file_, file_size_, signature);
+    return true;
+}
+
+bool FilePacketizer::makeChunkList(proto::FileChunkList* chunk_list)
+{
+    DCHECK(chunk_list);
+
+    if (!is_first_packet_ || delta_encoder_ || left_size_ != file_size_)
+    {
+        LOG(LS_WARNING) << "Unexpected chunk list request";
+        return false;
+    }
+
+    if (!makeFileChunkList(&file_, file_size_, &chunk_list_))
+        return false;
+
+    chunk_list->CopyFrom(chunk_list_);
+    return true;
+}
+
+bool FilePacketizer::skipChunks(const std::string& present_chunks)
+{
+    if (!is_first_packet_ || chunk_list_.size_size() == 0 ||
+        present_chunks.size() != static_cast<size_t>(chunk_list_.size_size() + 7) / 8)
+    {
+        LOG(LS_WARNING) << "Unexpected present chunks";
+        return false;
+    }
+
+    present_chunks_ = present_chunks;
+    return true;
+}
+
+bool FilePacketizer::encodeChunks(size_t size, proto::FilePacket* packet)
+{
+    std::string* data = packet->mutable_data();
+    data->reserve(size);
+
+    // The literal data before the next reference.
+    uint32_t literal_size = 0;
+
+    while (size)
+    {
+        // The file has changed since the chunk list was made.
+        if (chunk_index_ >= chunk_list_.size_size())
+            return false;
+
+        const uint32_t chunk_size = chunk_list_.size(chunk_index_);
+        const uint32_t part_size =
+            static_cast<uint32_t>(std::min<size_t>(size, chunk_size - chunk_offset_));
+
+        if (isChunkPresent(present_chunks_, static_cast<size_t>(chunk_index_)))
+        {
+            proto::FilePacket::DeltaOp* op = packet->add_delta_op();
+            op->set_literal_size(literal_size);
+            op->set_copy_offset(chunk_offset_);
+            op->set_copy_size(part_size);
+            op->set_chunk_hash(std::string(fileChunkHashAt(chunk_list_, chunk_index_)));
+
+            literal_size = 0;
+            skip(part_size);
+        }
+        else
+        {
+            const size_t offset = data->size();
+            data->resize(offset + part_size);
+
+            if (!read(data->data() + offset, part_size))
+                return false;
+
+            literal_size += part_size;
+        }
+
+        size -= part_size;
+        chunk_offset_ += part_size;
+
+        if (chunk_offset_ == chunk_size)
+        {
+            ++chunk_index_;
+            chunk_offset_ = 0;
+        }
+    }
+
+    // The data after the last reference.
+    if (literal_size && packet->delta_op_size())
+        packet->add_delta_op()->set_literal_size(literal_size);
+
+    return true;
+}
+
+void FilePacketizer::skip(size_t size)
+{
+    // The skipped part is taken from the buffer first. The rest of it is not read.
+    const size_t buffered_size = std::min(size, buffer_size_ - buffer_pos_);
+
+    buffer_pos_ += buffered_size;
+    read_offset_ += size - buffered_size;
+}
+
+bool FilePacketizer::read(char* data, size_t size)
+{
+    while (size)
+    {
+        if (buffer_pos_ == buffer_size_)
+        {
+            if (size >= kFileBufferSize)
+            {
+                // Large packets are read directly.
+                if (file_.read(read_offset_, data, size) != static_cast<int64_t>(size))
+                    return false;
+
+                read_offset_ += size;
+
+                if (read_offset_ < file_size_)
+                    file_.prefetch(read_offset_, size);
+                return true;
+            }
+
+            if (!buffer_)
+            {
+                buffer_.reset(static_cast<char*>(
+                    base::alignedAlloc(kFileBufferSize, kFileBufferAlignment)));
+            }
+
+            const int64_t result = file_.read(read_offset_, buffer_.get(), kFileBufferSize);
+            if (result <= 0)
+                return false;
+
+            buffer_pos_ = 0;
+            buffer_size_ = static_cast<size_t>(result);
+            read_offset_ += buffer_size_;
+
+            // The next block is read by the system while the packets from the buffer are sent.
+            if (read_offset_ < file_size_)
+                file_.prefetch(read_offset_, kFileBufferSize);
+        }
+
+        const size_t copy_size = std::min(size, buffer_size_ - buffer_pos_);
+        memcpy(data, buffer_.get() + buffer_pos_, copy_size);
+
+        buffer_pos_ += copy_size;
+        data += copy_size;
+        size -= copy_size;
+    }
+
+    return true;
+}
+
 } // namespace common
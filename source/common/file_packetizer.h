@@ -19,19 +19,23 @@
 #ifndef COMMON__FILE_PACKETIZER_H
 #define COMMON__FILE_PACKETIZER_H
 
-#include "base/macros_magic.h"
+#include "base/codec/chunk_compressor.h"
+#include "base/files/file.h"
+#include "base/memory/aligned_memory.h"
 #include "proto/file_transfer.pb.h"
 
 #include <filesystem>
-#include <fstream>
 #include <memory>
+#include <string>
 
 namespace common {
 
+class FileDeltaEncoder;
+
 class FilePacketizer
 {
 public:
-    ~FilePacketizer() = default;
+    ~FilePacketizer();
 
     // Creates an instance of the class.
     // Parameter |file_path| contains the full path to the file.
@@ -41,13 +45,59 @@ public:
     // Creates a packet for transferring.
     std::unique_ptr<proto::FilePacket> readNextPacket(const proto::FilePacketRequest& request);
 
+    // Applies the signature of the file of the target. For a partial file, the packets continue
+    // after the part which the target already has and |resume_offset| is set to its size. For an
+    // existing file, the following packets are built as a difference to it.
+    bool sync(const proto::FileSignature& signature, uint64_t* resume_offset);
+
+    // Splits the file into content-defined chunks. The chunks which the target has in its chunk
+    // store (|present_chunks|, see FileSyncRequest) are then sent as references.
+    bool makeChunkList(proto::FileChunkList* chunk_list);
+    bool skipChunks(const std::string& present_chunks);
+
+    // Returns the size of the file.
+    uint64_t fileSize() const { return file_size_; }
+
 private:
-    explicit FilePacketizer(std::ifstream&& file_stream);
+    FilePacketizer(base::File&& file, uint64_t file_size);
+
+    // Copies |size| bytes from the current position of the file to |data|.
+    bool read(char* data, size_t size);
+
+    // Moves the current position of the file |size| bytes forward.
+    void skip(size_t size);
 
-    std::ifstream file_stream_;
+    // Fills |packet| with the next |size| bytes of the file as literal data and chunk references.
+    bool encodeChunks(size_t size, proto::FilePacket* packet);
+
+    base::File file_;
+
+    // Small packets are served from the buffer, which is filled with large reads. When the buffer
+    // is filled, the system is asked to read the next block in the background, so it is in the
+    // cache by the time the next packets are requested.
+    std::unique_ptr<char, base::AlignedFreeDeleter> buffer_;
+    size_t buffer_pos_ = 0;
+    size_t buffer_size_ = 0;
+
+    // The offset in the file of the data after the buffer.
+    uint64_t read_offset_ = 0;
 
     uint64_t file_size_ = 0;
     uint64_t left_size_ = 0;
+    bool is_first_packet_ = true;
+
+    // Created when the signature of the existing file is received.
+    std::unique_ptr<FileDeltaEncoder> delta_encoder_;
+
+    // The chunks of the file and the position of the next packet in them.
+    proto::FileChunkList chunk_list_;
+    std::string present_chunks_;
+    int chunk_index_ = 0;
+    uint32_t chunk_offset_ = 0;
+
+    // Created when the first compressed packet is requested.
+    std::unique_ptr<base::ChunkCompressor> compressor_;
+    std::string compressed_;
 
     DISALLOW_COPY_AND_ASSIGN(FilePacketizer);
 };
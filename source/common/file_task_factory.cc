@@ -21,12 +21,31 @@
 #include "base/logging.h"
 #include "proto/file_transfer.pb.h"
 
+#include <atomic>
+
 namespace common {
 
+namespace {
+
+uint32_t nextLane()
+{
+    static std::atomic_uint32_t last_lane = 0;
+
+    // Lane 0 is used by peers that do not support lanes.
+    uint32_t lane = ++last_lane;
+    while (!lane)
+        lane = ++last_lane;
+
+    return lane;
+}
+
+} // namespace
+
 FileTaskFactory::FileTaskFactory(
     std::shared_ptr<FileTaskProducerProxy> producer_proxy, FileTask::Target target)
     : producer_proxy_(std::move(producer_proxy)),
-      target_(target)
+      target_(target),
+      lane_(nextLane())
 {
     DCHECK(producer_proxy_);
     DCHECK(target_ == FileTask::Target::LOCAL || target_ == FileTask::Target::REMOTE);
@@ -41,10 +60,27 @@ std::shared_ptr<FileTask> FileTaskFactory::driveList()
     return makeTask(std::move(request));
 }
 
-std::shared_ptr<FileTask> FileTaskFactory::fileList(const std::string& path)
+std::shared_ptr<FileTask> FileTaskFactory::fileList(
+    const std::string& path, uint32_t page_size, bool recursive)
+{
+    auto request = std::make_unique<proto::FileRequest>();
+
+    proto::FileListRequest* file_list_request = request->mutable_file_list_request();
+    file_list_request->set_path(path);
+    file_list_request->set_page_size(page_size);
+    file_list_request->set_recursive(recursive);
+
+    return makeTask(std::move(request));
+}
+
+std::shared_ptr<FileTask> FileTaskFactory::fileListPage(uint32_t page_token, uint32_t page_size)
 {
     auto request = std::make_unique<proto::FileRequest>();
-    request->mutable_file_list_request()->set_path(path);
+
+    proto::FileListRequest* file_list_request = request->mutable_file_list_request();
+    file_list_request->set_page_token(page_token);
+    file_list_request->set_page_size(page_size);
+
     return makeTask(std::move(request));
 }
 
@@ -74,28 +110,74 @@ std::shared_ptr<FileTask> FileTaskFactory::remove(const std::string& path)
     return makeTask(std::move(request));
 }
 
-std::shared_ptr<FileTask> FileTaskFactory::download(const std::string& file_path)
+std::shared_ptr<FileTask> FileTaskFactory::download(
+    const std::string& file_path, uint32_t max_window_size)
 {
     auto request = std::make_unique<proto::FileRequest>();
-    request->mutable_download_request()->set_path(file_path);
+
+    proto::DownloadRequest* download_request = request->mutable_download_request();
+    download_request->set_path(file_path);
+    download_request->set_max_window_size(max_window_size);
+
     return makeTask(std::move(request));
 }
 
-std::shared_ptr<FileTask> FileTaskFactory::upload(const std::string& file_path, bool overwrite)
+std::shared_ptr<FileTask> FileTaskFactory::upload(const std::string& file_path,
+                                                  bool overwrite,
+                                                  uint32_t max_window_size,
+                                                  bool keep_partial,
+                                                  bool delta)
 {
     auto request = std::make_unique<proto::FileRequest>();
 
     proto::UploadRequest* upload_request = request->mutable_upload_request();
     upload_request->set_path(file_path);
     upload_request->set_overwrite(overwrite);
+    upload_request->set_max_window_size(max_window_size);
+    upload_request->set_keep_partial(keep_partial);
+    upload_request->set_delta(delta);
+
+    return makeTask(std::move(request));
+}
 
+std::shared_ptr<FileTask> FileTaskFactory::sync(const proto::FileSignature& signature)
+{
+    auto request = std::make_unique<proto::FileRequest>();
+    request->mutable_sync_request()->mutable_signature()->CopyFrom(signature);
     return makeTask(std::move(request));
 }
 
-std::shared_ptr<FileTask> FileTaskFactory::packetRequest(uint32_t flags)
+std::shared_ptr<FileTask> FileTaskFactory::syncChunks(const std::string& present_chunks)
 {
     auto request = std::make_unique<proto::FileRequest>();
-    request->mutable_packet_request()->set_flags(flags);
+    request->mutable_sync_request()->set_present_chunks(present_chunks);
+    return makeTask(std::move(request));
+}
+
+std::shared_ptr<FileTask> FileTaskFactory::chunkList()
+{
+    auto request = std::make_unique<proto::FileRequest>();
+    request->mutable_chunk_list_request()->set_dummy(1);
+    return makeTask(std::move(request));
+}
+
+std::shared_ptr<FileTask> FileTaskFactory::chunkQuery(const proto::FileChunkList& chunk_list)
+{
+    auto request = std::make_unique<proto::FileRequest>();
+    request->mutable_chunk_query()->mutable_chunk_list()->CopyFrom(chunk_list);
+    return makeTask(std::move(request));
+}
+
+std::shared_ptr<FileTask> FileTaskFactory::packetRequest(
+    uint32_t flags, uint32_t packet_size, proto::FileCompression compression)
+{
+    auto request = std::make_unique<proto::FileRequest>();
+
+    proto::FilePacketRequest* packet_request = request->mutable_packet_request();
+    packet_request->set_flags(flags);
+    packet_request->set_packet_size(packet_size);
+    packet_request->set_compression(compression);
+
     return makeTask(std::move(request));
 }
 
@@ -113,8 +195,34 @@ std::shared_ptr<FileTask> FileTaskFactory::packet(std::unique_ptr<proto::FilePac
     return makeTask(std::move(request));
 }
 
+std::shared_ptr<FileTask> FileTaskFactory::batchDownload(
+    const std::vector<std::string>& paths, proto::FileCompression compression)
+{
+    auto request = std::make_unique<proto::FileRequest>();
+
+    proto::BatchDownloadRequest* batch_request = request->mutable_batch_download_request();
+    for (const auto& path : paths)
+        batch_request->add_path(path);
+    batch_request->set_compression(compression);
+
+    return makeTask(std::move(request));
+}
+
+std::shared_ptr<FileTask> FileTaskFactory::batchUpload(
+    std::unique_ptr<proto::FileBatch> batch, bool overwrite)
+{
+    auto request = std::make_unique<proto::FileRequest>();
+
+    proto::BatchUploadRequest* batch_request = request->mutable_batch_upload_request();
+    batch_request->set_allocated_batch(batch.release());
+    batch_request->set_overwrite(overwrite);
+
+    return makeTask(std::move(request));
+}
+
 std::shared_ptr<FileTask> FileTaskFactory::makeTask(std::unique_ptr<proto::FileRequest> request)
 {
+    request->set_lane(lane_);
     return std::make_shared<FileTask>(producer_proxy_, std::move(request), target_);
 }
 
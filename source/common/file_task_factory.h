@@ -20,12 +20,10 @@
 #define CLIENT__FILE_TASK_FACTORY_H
 
 #include "common/file_task.h"
+#include "proto/file_transfer.pb.h"
 
 #include <string>
-
-namespace proto {
-class FilePacket;
-} // namespace proto
+#include <vector>
 
 namespace common {
 
@@ -37,22 +35,43 @@ public:
 
     FileTask::Target target() const { return target_; }
 
+    // All requests of the factory are executed in order in one lane (see FileRequest::lane). The
+    // requests of different factories can be executed in parallel.
+    uint32_t lane() const { return lane_; }
+
     std::shared_ptr<FileTask> driveList();
-    std::shared_ptr<FileTask> fileList(const std::string& path);
+    std::shared_ptr<FileTask> fileList(
+        const std::string& path, uint32_t page_size = 0, bool recursive = false);
+    std::shared_ptr<FileTask> fileListPage(uint32_t page_token, uint32_t page_size);
     std::shared_ptr<FileTask> createDirectory(const std::string& path);
     std::shared_ptr<FileTask> rename(const std::string& old_name, const std::string& new_name);
     std::shared_ptr<FileTask> remove(const std::string& path);
-    std::shared_ptr<FileTask> download(const std::string& file_path);
-    std::shared_ptr<FileTask> upload(const std::string& file_path, bool overwrite);
-    std::shared_ptr<FileTask> packetRequest(uint32_t flags);
+    std::shared_ptr<FileTask> download(const std::string& file_path, uint32_t max_window_size);
+    std::shared_ptr<FileTask> upload(const std::string& file_path,
+                                     bool overwrite,
+                                     uint32_t max_window_size,
+                                     bool keep_partial = false,
+                                     bool delta = false);
+    std::shared_ptr<FileTask> sync(const proto::FileSignature& signature);
+    std::shared_ptr<FileTask> syncChunks(const std::string& present_chunks);
+    std::shared_ptr<FileTask> chunkList();
+    std::shared_ptr<FileTask> chunkQuery(const proto::FileChunkList& chunk_list);
+    std::shared_ptr<FileTask> packetRequest(
+        uint32_t flags,
+        uint32_t packet_size = 0,
+        proto::FileCompression compression = proto::FILE_COMPRESSION_NONE);
     std::shared_ptr<FileTask> packet(const proto::FilePacket& packet);
     std::shared_ptr<FileTask> packet(std::unique_ptr<proto::FilePacket> packet);
+    std::shared_ptr<FileTask> batchDownload(
+        const std::vector<std::string>& paths, proto::FileCompression compression);
+    std::shared_ptr<FileTask> batchUpload(std::unique_ptr<proto::FileBatch> batch, bool overwrite);
 
 private:
     std::shared_ptr<FileTask> makeTask(std::unique_ptr<proto::FileRequest> request);
 
     std::shared_ptr<FileTaskProducerProxy> producer_proxy_;
     const FileTask::Target target_;
+    const uint32_t lane_;
 
     DISALLOW_COPY_AND_ASSIGN(FileTaskFactory);
 };
@@ -20,9 +20,15 @@
 
 #include "base/logging.h"
 #include "base/task_runner.h"
+#include "base/threading/thread.h"
+#include "base/codec/chunk_compressor.h"
+#include "base/files/file.h"
 #include "base/files/base_paths.h"
 #include "build/build_config.h"
+#include "common/file_chunk_store.h"
 #include "common/file_depacketizer.h"
+#include "common/file_list_cursor.h"
+#include "common/file_packet.h"
 #include "common/file_packetizer.h"
 #include "common/file_platform_util.h"
 #include "common/file_task.h"
@@ -32,8 +38,33 @@
 #include "common/win/file_enumerator.h"
 #endif // defined(OS_WIN)
 
+#include <algorithm>
+#include <atomic>
+#include <limits>
+#include <map>
+
 namespace common {
 
+namespace {
+
+// The number of file lists which can be continued at the same time. The oldest list is closed
+// when a new one is started.
+const size_t kMaxFileListCursors = 16;
+
+proto::FileError createDirectory(const std::filesystem::path& directory_path)
+{
+    std::error_code ignored_code;
+    if (std::filesystem::exists(directory_path, ignored_code))
+        return proto::FILE_ERROR_PATH_ALREADY_EXISTS;
+
+    if (!std::filesystem::create_directory(directory_path, ignored_code))
+        return proto::FILE_ERROR_ACCESS_DENIED;
+
+    return proto::FILE_ERROR_SUCCESS;
+}
+
+} // namespace
+
 class FileWorker::Impl : public std::enable_shared_from_this<Impl>
 {
 public:
@@ -41,24 +72,61 @@ public:
     ~Impl();
 
     void doTask(std::shared_ptr<FileTask> task);
+    std::unique_ptr<proto::FileReply> doRequest(const proto::FileRequest& request);
 
     std::shared_ptr<base::TaskRunner> taskRunner() { return task_runner_; }
 
+    // Returns true if a file is being downloaded or uploaded between the requests. It can be called
+    // on any thread.
+    bool hasTransfer() const { return has_transfer_.load(std::memory_order_acquire); }
+
 private:
-    std::unique_ptr<proto::FileReply> doRequest(const proto::FileRequest& request);
+    std::unique_ptr<proto::FileReply> executeRequest(const proto::FileRequest& request);
     std::unique_ptr<proto::FileReply> doDriveListRequest();
     std::unique_ptr<proto::FileReply> doFileListRequest(const proto::FileListRequest& request);
+    std::unique_ptr<proto::FileReply> readFileListPage(
+        std::unique_ptr<FileListCursor> cursor, size_t page_size);
     std::unique_ptr<proto::FileReply> doCreateDirectoryRequest(const proto::CreateDirectoryRequest& request);
     std::unique_ptr<proto::FileReply> doRenameRequest(const proto::RenameRequest& request);
     std::unique_ptr<proto::FileReply> doRemoveRequest(const proto::RemoveRequest& request);
     std::unique_ptr<proto::FileReply> doDownloadRequest(const proto::DownloadRequest& request);
     std::unique_ptr<proto::FileReply> doUploadRequest(const proto::UploadRequest& request);
+    std::unique_ptr<proto::FileReply> doSyncRequest(const proto::FileSyncRequest& request);
+    std::unique_ptr<proto::FileReply> doChunkListRequest();
+    std::unique_ptr<proto::FileReply> doChunkQuery(const proto::FileChunkQuery& query);
     std::unique_ptr<proto::FileReply> doPacketRequest(const proto::FilePacketRequest& request);
     std::unique_ptr<proto::FileReply> doPacket(const proto::FilePacket& packet);
+    std::unique_ptr<proto::FileReply> doBatchDownloadRequest(
+        const proto::BatchDownloadRequest& request);
+    std::unique_ptr<proto::FileReply> doBatchUploadRequest(
+        const proto::BatchUploadRequest& request);
+
+    proto::FileError readBatchFile(const std::filesystem::path& file_path,
+                                   proto::FileCompression compression,
+                                   proto::FileBatch::Item* item);
+    proto::FileError writeBatchFile(const std::filesystem::path& file_path,
+                                    bool overwrite,
+                                    const proto::FileBatch::Item& item);
+
+    // Opens the chunk store on first use. Returns nullptr if it is not available.
+    FileChunkStore* chunkStore();
 
     std::shared_ptr<base::TaskRunner> task_runner_;
     std::unique_ptr<FileDepacketizer> depacketizer_;
     std::unique_ptr<FilePacketizer> packetizer_;
+    std::atomic_bool has_transfer_ { false };
+
+    std::shared_ptr<FileChunkStore> chunk_store_;
+    bool is_chunk_store_opened_ = false;
+
+    // Created for the first compressed batch.
+    std::unique_ptr<base::ChunkCompressor> batch_compressor_;
+    std::unique_ptr<base::ChunkDecompressor> batch_decompressor_;
+    std::string batch_buffer_;
+
+    // The lists which are continued in the next pages.
+    std::map<uint32_t, std::unique_ptr<FileListCursor>> list_cursors_;
+    uint32_t last_page_token_ = 0;
 
     DISALLOW_COPY_AND_ASSIGN(Impl);
 };
@@ -76,11 +144,21 @@ void FileWorker::Impl::doTask(std::shared_ptr<FileTask> task)
     auto self = shared_from_this();
     task_runner_->postTask([self, task]()
     {
-        task->setReply(self->doRequest(task->request()));
+        std::unique_ptr<proto::FileReply> reply = self->doRequest(task->request());
+        reply->set_lane(task->request().lane());
+        task->setReply(std::move(reply));
     });
 }
 
 std::unique_ptr<proto::FileReply> FileWorker::Impl::doRequest(const proto::FileRequest& request)
+{
+    std::unique_ptr<proto::FileReply> reply = executeRequest(request);
+    has_transfer_.store(packetizer_ || depacketizer_, std::memory_order_release);
+    return reply;
+}
+
+std::unique_ptr<proto::FileReply> FileWorker::Impl::executeRequest(
+    const proto::FileRequest& request)
 {
 #if defined(OS_WIN)
     // We send a notification to the system that it is used to prevent the screen saver, going into
@@ -116,6 +194,18 @@ std::unique_ptr<proto::FileReply> FileWorker::Impl::doRequest(const proto::FileR
     {
         return doUploadRequest(request.upload_request());
     }
+    else if (request.has_sync_request())
+    {
+        return doSyncRequest(request.sync_request());
+    }
+    else if (request.has_chunk_list_request())
+    {
+        return doChunkListRequest();
+    }
+    else if (request.has_chunk_query())
+    {
+        return doChunkQuery(request.chunk_query());
+    }
     else if (request.has_packet_request())
     {
         return doPacketRequest(request.packet_request());
@@ -124,6 +214,14 @@ std::unique_ptr<proto::FileReply> FileWorker::Impl::doRequest(const proto::FileR
     {
         return doPacket(request.packet());
     }
+    else if (request.has_batch_download_request())
+    {
+        return doBatchDownloadRequest(request.batch_download_request());
+    }
+    else if (request.has_batch_upload_request())
+    {
+        return doBatchUploadRequest(request.batch_upload_request());
+    }
     else
     {
         std::unique_ptr<proto::FileReply> reply = std::make_unique<proto::FileReply>();
@@ -208,6 +306,27 @@ std::unique_ptr<proto::FileReply> FileWorker::Impl::doDriveListRequest()
 std::unique_ptr<proto::FileReply> FileWorker::Impl::doFileListRequest(
     const proto::FileListRequest& request)
 {
+    // Old peers do not set the page size and receive the whole list at once.
+    size_t page_size = std::numeric_limits<size_t>::max();
+    if (request.page_size())
+        page_size = std::min(request.page_size(), kMaxFileListPageSize);
+
+    if (request.page_token())
+    {
+        auto cursor = list_cursors_.find(request.page_token());
+        if (cursor == list_cursors_.end())
+        {
+            std::unique_ptr<proto::FileReply> reply = std::make_unique<proto::FileReply>();
+            reply->set_error_code(proto::FILE_ERROR_INVALID_REQUEST);
+            return reply;
+        }
+
+        std::unique_ptr<FileListCursor> list_cursor = std::move(cursor->second);
+        list_cursors_.erase(cursor);
+
+        return readFileListPage(std::move(list_cursor), page_size);
+    }
+
     std::unique_ptr<proto::FileReply> reply = std::make_unique<proto::FileReply>();
 
     std::filesystem::path path = std::filesystem::u8path(request.path());
@@ -227,23 +346,34 @@ std::unique_ptr<proto::FileReply> FileWorker::Impl::doFileListRequest(
         return reply;
     }
 
+    return readFileListPage(
+        std::make_unique<FileListCursor>(path, request.recursive()), page_size);
+}
+
+std::unique_ptr<proto::FileReply> FileWorker::Impl::readFileListPage(
+    std::unique_ptr<FileListCursor> cursor, size_t page_size)
+{
+    std::unique_ptr<proto::FileReply> reply = std::make_unique<proto::FileReply>();
     proto::FileList* file_list = reply->mutable_file_list();
-    FileEnumerator enumerator(path);
 
-    while (!enumerator.isAtEnd())
+    file_list->set_recursive(cursor->isRecursive());
+
+    const bool has_more = cursor->read(page_size, file_list);
+    reply->set_error_code(cursor->errorCode());
+
+    if (has_more)
     {
-        const FileEnumerator::FileInfo& file_info = enumerator.fileInfo();
+        if (list_cursors_.size() >= kMaxFileListCursors)
+            list_cursors_.erase(list_cursors_.begin());
 
-        proto::FileList::Item* item = file_list->add_item();
-        item->set_name(file_info.u8name());
-        item->set_size(file_info.size());
-        item->set_modification_time(file_info.lastWriteTime());
-        item->set_is_directory(file_info.isDirectory());
+        // 0 means the last page.
+        if (!++last_page_token_)
+            ++last_page_token_;
 
-        enumerator.advance();
+        file_list->set_next_page_token(last_page_token_);
+        list_cursors_.emplace(last_page_token_, std::move(cursor));
     }
 
-    reply->set_error_code(enumerator.errorCode());
     return reply;
 }
 
@@ -252,22 +382,7 @@ std::unique_ptr<proto::FileReply> FileWorker::Impl::doCreateDirectoryRequest(
 {
     std::unique_ptr<proto::FileReply> reply = std::make_unique<proto::FileReply>();
 
-    std::filesystem::path directory_path = std::filesystem::u8path(request.path());
-
-    std::error_code ignored_code;
-    if (std::filesystem::exists(directory_path, ignored_code))
-    {
-        reply->set_error_code(proto::FILE_ERROR_PATH_ALREADY_EXISTS);
-        return reply;
-    }
-
-    if (!std::filesystem::create_directory(directory_path, ignored_code))
-    {
-        reply->set_error_code(proto::FILE_ERROR_ACCESS_DENIED);
-        return reply;
-    }
-
-    reply->set_error_code(proto::FILE_ERROR_SUCCESS);
+    reply->set_error_code(createDirectory(std::filesystem::u8path(request.path())));
     return reply;
 }
 
@@ -348,9 +463,21 @@ std::unique_ptr<proto::FileReply> FileWorker::Impl::doDownloadRequest(
 
     packetizer_ = FilePacketizer::create(std::filesystem::u8path(request.path()));
     if (!packetizer_)
+    {
         reply->set_error_code(proto::FILE_ERROR_FILE_OPEN_ERROR);
+    }
     else
+    {
+        // Requests are processed in the order of arrival, so any number of packet requests can
+        // be queued. The client uses the file size to know how many packets to request.
+        reply->set_window_size(std::min(request.max_window_size(), kMaxFilePacketWindow));
+        reply->set_max_packet_size(kMaxFilePacketSize);
+        reply->set_compression(proto::FILE_COMPRESSION_ZSTD);
+        reply->set_sync_supported(true);
+        reply->set_chunks_supported(true);
+        reply->set_file_size(packetizer_->fileSize());
         reply->set_error_code(proto::FILE_ERROR_SUCCESS);
+    }
 
     return reply;
 }
@@ -374,13 +501,30 @@ std::unique_ptr<proto::FileReply> FileWorker::Impl::doUploadRequest(
             }
         }
 
-        depacketizer_ = FileDepacketizer::create(file_path, request.overwrite());
+        if (request.keep_partial() || request.delta())
+        {
+            depacketizer_ = FileDepacketizer::createPartial(
+                file_path, request.keep_partial(), request.delta(), reply->mutable_signature());
+        }
+        else
+        {
+            depacketizer_ = FileDepacketizer::create(file_path);
+        }
+
         if (!depacketizer_)
         {
             reply->set_error_code(proto::FILE_ERROR_FILE_CREATE_ERROR);
             break;
         }
 
+        // The chunks are used only for new files. A partial or an existing file is continued or
+        // updated with its signature.
+        if (reply->signature().weak_checksum_size() == 0 && chunkStore())
+            reply->set_chunks_supported(true);
+
+        reply->set_window_size(std::min(request.max_window_size(), kMaxFilePacketWindow));
+        reply->set_max_packet_size(kMaxFilePacketSize);
+        reply->set_compression(proto::FILE_COMPRESSION_ZSTD);
         reply->set_error_code(proto::FILE_ERROR_SUCCESS);
     }
     while (false);
@@ -388,6 +532,96 @@ std::unique_ptr<proto::FileReply> FileWorker::Impl::doUploadRequest(
     return reply;
 }
 
+std::unique_ptr<proto::FileReply> FileWorker::Impl::doSyncRequest(
+    const proto::FileSyncRequest& request)
+{
+    std::unique_ptr<proto::FileReply> reply = std::make_unique<proto::FileReply>();
+
+    if (!packetizer_)
+    {
+        // Set the unknown status of the request. The connection will be closed.
+        reply->set_error_code(proto::FILE_ERROR_UNKNOWN);
+        LOG(LS_WARNING) << "Unexpected file sync request";
+    }
+    else
+    {
+        uint64_t resume_offset = 0;
+        bool result;
+
+        if (!request.present_chunks().empty())
+            result = packetizer_->skipChunks(request.present_chunks());
+        else
+            result = packetizer_->sync(request.signature(), &resume_offset);
+
+        if (!result)
+        {
+            reply->set_error_code(proto::FILE_ERROR_FILE_READ_ERROR);
+            packetizer_.reset();
+        }
+        else
+        {
+            reply->set_resume_offset(resume_offset);
+            reply->set_error_code(proto::FILE_ERROR_SUCCESS);
+        }
+    }
+
+    return reply;
+}
+
+std::unique_ptr<proto::FileReply> FileWorker::Impl::doChunkListRequest()
+{
+    std::unique_ptr<proto::FileReply> reply = std::make_unique<proto::FileReply>();
+
+    if (!packetizer_)
+    {
+        // Set the unknown status of the request. The connection will be closed.
+        reply->set_error_code(proto::FILE_ERROR_UNKNOWN);
+        LOG(LS_WARNING) << "Unexpected chunk list request";
+    }
+    else
+    {
+        if (!packetizer_->makeChunkList(reply->mutable_chunk_list()))
+        {
+            reply->set_error_code(proto::FILE_ERROR_FILE_READ_ERROR);
+            packetizer_.reset();
+        }
+        else
+        {
+            reply->set_error_code(proto::FILE_ERROR_SUCCESS);
+        }
+    }
+
+    return reply;
+}
+
+std::unique_ptr<proto::FileReply> FileWorker::Impl::doChunkQuery(
+    const proto::FileChunkQuery& query)
+{
+    std::unique_ptr<proto::FileReply> reply = std::make_unique<proto::FileReply>();
+
+    if (!depacketizer_ || !chunk_store_)
+    {
+        // Set the unknown status of the request. The connection will be closed.
+        reply->set_error_code(proto::FILE_ERROR_UNKNOWN);
+        LOG(LS_WARNING) << "Unexpected chunk query";
+    }
+    else
+    {
+        if (!depacketizer_->setChunkList(
+                query.chunk_list(), chunk_store_, reply->mutable_present_chunks()))
+        {
+            reply->set_error_code(proto::FILE_ERROR_INVALID_REQUEST);
+            depacketizer_.reset();
+        }
+        else
+        {
+            reply->set_error_code(proto::FILE_ERROR_SUCCESS);
+        }
+    }
+
+    return reply;
+}
+
 std::unique_ptr<proto::FileReply> FileWorker::Impl::doPacketRequest(
     const proto::FilePacketRequest& request)
 {
@@ -449,21 +683,399 @@ std::unique_ptr<proto::FileReply> FileWorker::Impl::doPacket(const proto::FilePa
     return reply;
 }
 
+std::unique_ptr<proto::FileReply> FileWorker::Impl::doBatchDownloadRequest(
+    const proto::BatchDownloadRequest& request)
+{
+    std::unique_ptr<proto::FileReply> reply = std::make_unique<proto::FileReply>();
+    proto::FileBatch* batch = reply->mutable_batch();
+
+    size_t batch_size = 0;
+
+    // The files could grow after the client built the batch. The reply is cut when it reaches the
+    // limits and the client requests the rest. A file is at most kMaxFilePacketSize, so the reply
+    // fits into one message.
+    for (const auto& path : request.path())
+    {
+        if (batch->item_size() >= static_cast<int>(kMaxFileBatchItems) ||
+            batch_size >= kMaxFileBatchSize)
+        {
+            break;
+        }
+
+        proto::FileBatch::Item* item = batch->add_item();
+        item->set_error_code(
+            readBatchFile(std::filesystem::u8path(path), request.compression(), item));
+
+        batch_size += item->data().size();
+    }
+
+    reply->set_error_code(proto::FILE_ERROR_SUCCESS);
+    return reply;
+}
+
+std::unique_ptr<proto::FileReply> FileWorker::Impl::doBatchUploadRequest(
+    const proto::BatchUploadRequest& request)
+{
+    std::unique_ptr<proto::FileReply> reply = std::make_unique<proto::FileReply>();
+    proto::FileBatch* batch = reply->mutable_batch();
+
+    // The items are processed in order, so the directories are created before their files.
+    for (const auto& item : request.batch().item())
+    {
+        const std::filesystem::path path = std::filesystem::u8path(item.path());
+        proto::FileError error_code;
+
+        if (item.is_directory())
+            error_code = createDirectory(path);
+        else
+            error_code = writeBatchFile(path, request.overwrite(), item);
+
+        batch->add_item()->set_error_code(error_code);
+    }
+
+    reply->set_error_code(proto::FILE_ERROR_SUCCESS);
+    return reply;
+}
+
+proto::FileError FileWorker::Impl::readBatchFile(const std::filesystem::path& file_path,
+                                                 proto::FileCompression compression,
+                                                 proto::FileBatch::Item* item)
+{
+    base::File file(file_path, base::File::FLAG_OPEN | base::File::FLAG_READ);
+    if (!file.isValid())
+        return proto::FILE_ERROR_FILE_OPEN_ERROR;
+
+    const int64_t file_size = file.length();
+    if (file_size < 0 || file_size > static_cast<int64_t>(kMaxFilePacketSize))
+        return proto::FILE_ERROR_FILE_READ_ERROR;
+
+    std::string* data = item->mutable_data();
+    data->resize(static_cast<size_t>(file_size));
+
+    const int64_t read_size = file.read(0, data->data(), data->size());
+    if (read_size < 0)
+    {
+        data->clear();
+        return proto::FILE_ERROR_FILE_READ_ERROR;
+    }
+
+    // The file could become smaller after the size was taken.
+    data->resize(static_cast<size_t>(read_size));
+
+    if (compression == proto::FILE_COMPRESSION_ZSTD)
+    {
+        if (!batch_compressor_)
+            batch_compressor_ = std::make_unique<base::ChunkCompressor>();
+
+        // The files are unrelated, each one is checked for compressibility.
+        batch_compressor_->reset();
+
+        if (batch_compressor_->compress(*data, &batch_buffer_))
+        {
+            item->set_compression(proto::FILE_COMPRESSION_ZSTD);
+            item->set_uncompressed_size(static_cast<uint32_t>(data->size()));
+            data->swap(batch_buffer_);
+        }
+    }
+
+    return proto::FILE_ERROR_SUCCESS;
+}
+
+proto::FileError FileWorker::Impl::writeBatchFile(const std::filesystem::path& file_path,
+                                                  bool overwrite,
+                                                  const proto::FileBatch::Item& item)
+{
+    std::string_view data = item.data();
+
+    if (item.compression() == proto::FILE_COMPRESSION_ZSTD)
+    {
+        if (!batch_decompressor_)
+            batch_decompressor_ = std::make_unique<base::ChunkDecompressor>();
+
+        if (!batch_decompressor_->decompress(data, kMaxFilePacketSize, &batch_buffer_) ||
+            batch_buffer_.size() != item.uncompressed_size())
+        {
+            return proto::FILE_ERROR_INVALID_REQUEST;
+        }
+
+        data = batch_buffer_;
+    }
+    else if (item.compression() != proto::FILE_COMPRESSION_NONE)
+    {
+        return proto::FILE_ERROR_INVALID_REQUEST;
+    }
+
+    if (!overwrite)
+    {
+        std::error_code ignored_code;
+        if (std::filesystem::exists(file_path, ignored_code))
+            return proto::FILE_ERROR_PATH_ALREADY_EXISTS;
+    }
+
+    base::File file(file_path, base::File::FLAG_CREATE_ALWAYS | base::File::FLAG_WRITE);
+    if (!file.isValid())
+        return proto::FILE_ERROR_FILE_CREATE_ERROR;
+
+    if (!file.write(0, data.data(), data.size()))
+    {
+        file.close();
+
+        std::error_code ignored_code;
+        std::filesystem::remove(file_path, ignored_code);
+        return proto::FILE_ERROR_FILE_WRITE_ERROR;
+    }
+
+    return proto::FILE_ERROR_SUCCESS;
+}
+
+FileChunkStore* FileWorker::Impl::chunkStore()
+{
+    // The store is opened on the thread of the request, which impersonates the user on the host.
+    if (!is_chunk_store_opened_)
+    {
+        chunk_store_ = FileChunkStore::openForCurrentUser();
+        is_chunk_store_opened_ = true;
+    }
+
+    return chunk_store_.get();
+}
+
+// Executes the requests of each lane sequentially in its own Impl. A lane is bound to one thread
+// of the pool when it is started; the lanes are distributed evenly between the threads.
+class FileWorker::Pool : public std::enable_shared_from_this<Pool>
+{
+public:
+    Pool(std::shared_ptr<base::TaskRunner> task_runner,
+         size_t thread_count,
+         base::Thread::Delegate* thread_delegate);
+    ~Pool();
+
+    void stop();
+    void doTask(std::shared_ptr<FileTask> task);
+
+    std::shared_ptr<base::TaskRunner> taskRunner() { return task_runner_; }
+
+private:
+    struct Lane
+    {
+        std::shared_ptr<Impl> impl;
+        size_t thread_index = 0;
+
+        // The number of requests which are not replied yet.
+        size_t pending = 0;
+        uint64_t last_used = 0;
+    };
+
+    void dispatch(std::shared_ptr<FileTask> task);
+    void onReply(uint32_t lane_id,
+                 std::shared_ptr<FileTask> task,
+                 std::unique_ptr<proto::FileReply> reply);
+    void replyError(uint32_t lane_id, std::shared_ptr<FileTask> task, proto::FileError error_code);
+
+    // Returns the lane with |lane_id|. A new lane is started if there is a free one. Returns
+    // nullptr if all lanes are busy or the pool is stopped.
+    Lane* lane(uint32_t lane_id);
+
+    std::shared_ptr<base::TaskRunner> task_runner_;
+    std::vector<std::unique_ptr<base::Thread>> threads_;
+
+    // The number of lanes bound to each thread.
+    std::vector<size_t> thread_lanes_;
+
+    // The lanes are accessed only on |task_runner_|.
+    std::map<uint32_t, Lane> lanes_;
+    uint64_t use_counter_ = 0;
+
+    DISALLOW_COPY_AND_ASSIGN(Pool);
+};
+
+FileWorker::Pool::Pool(std::shared_ptr<base::TaskRunner> task_runner,
+                       size_t thread_count,
+                       base::Thread::Delegate* thread_delegate)
+    : task_runner_(std::move(task_runner)),
+      thread_lanes_(std::max(thread_count, size_t(1)))
+{
+    DCHECK(task_runner_);
+
+    for (size_t i = 0; i < thread_lanes_.size(); ++i)
+    {
+        std::unique_ptr<base::Thread> thread = std::make_unique<base::Thread>();
+        thread->start(base::MessageLoop::Type::DEFAULT, thread_delegate);
+
+        threads_.emplace_back(std::move(thread));
+    }
+}
+
+FileWorker::Pool::~Pool()
+{
+    stop();
+}
+
+void FileWorker::Pool::stop()
+{
+    for (auto& thread : threads_)
+        thread->stop();
+}
+
+void FileWorker::Pool::doTask(std::shared_ptr<FileTask> task)
+{
+    // The lanes are dispatched on one thread, so they need no locks.
+    auto self = shared_from_this();
+    task_runner_->postTask([self, task]() mutable
+    {
+        self->dispatch(std::move(task));
+    });
+}
+
+void FileWorker::Pool::dispatch(std::shared_ptr<FileTask> task)
+{
+    const uint32_t lane_id = task->request().lane();
+
+    Lane* current_lane = lane(lane_id);
+    if (!current_lane)
+    {
+        replyError(lane_id, std::move(task), proto::FILE_ERROR_UNKNOWN);
+        return;
+    }
+
+    std::shared_ptr<base::TaskRunner> thread_task_runner =
+        threads_[current_lane->thread_index]->taskRunner();
+    if (!thread_task_runner)
+    {
+        // The pool is stopped, the request will never be executed.
+        replyError(lane_id, std::move(task), proto::FILE_ERROR_UNKNOWN);
+        return;
+    }
+
+    ++current_lane->pending;
+    current_lane->last_used = ++use_counter_;
+
+    auto self = shared_from_this();
+    auto impl = current_lane->impl;
+
+    thread_task_runner->postTask([self, impl, lane_id, task]() mutable
+    {
+        std::unique_ptr<proto::FileReply> reply = impl->doRequest(task->request());
+        reply->set_lane(lane_id);
+
+        // The replies are sent from the thread of the owner.
+        self->task_runner_->postTask(
+            [self, lane_id, task = std::move(task), reply = std::move(reply)]() mutable
+        {
+            self->onReply(lane_id, std::move(task), std::move(reply));
+        });
+    });
+}
+
+void FileWorker::Pool::onReply(uint32_t lane_id,
+                               std::shared_ptr<FileTask> task,
+                               std::unique_ptr<proto::FileReply> reply)
+{
+    auto current_lane = lanes_.find(lane_id);
+    if (current_lane != lanes_.end())
+    {
+        DCHECK(current_lane->second.pending);
+        --current_lane->second.pending;
+    }
+
+    task->setReply(std::move(reply));
+}
+
+void FileWorker::Pool::replyError(uint32_t lane_id,
+                                  std::shared_ptr<FileTask> task,
+                                  proto::FileError error_code)
+{
+    std::unique_ptr<proto::FileReply> reply = std::make_unique<proto::FileReply>();
+    reply->set_error_code(error_code);
+    reply->set_lane(lane_id);
+
+    task->setReply(std::move(reply));
+}
+
+FileWorker::Pool::Lane* FileWorker::Pool::lane(uint32_t lane_id)
+{
+    auto current_lane = lanes_.find(lane_id);
+    if (current_lane != lanes_.end())
+        return &current_lane->second;
+
+    if (lanes_.size() >= kMaxFileWorkerLanes)
+    {
+        // The lanes of finished producers are never used again. A lane with requests in progress
+        // or with an open file is kept: closing it would abort the transfer between two packets
+        // and remove the partial file. A producer which does not complete a file cancels it (see
+        // FilePacketRequest::CANCEL), so that its lane can be closed.
+        auto oldest_lane = lanes_.end();
+
+        for (auto it = lanes_.begin(); it != lanes_.end(); ++it)
+        {
+            if (it->second.pending || it->second.impl->hasTransfer())
+                continue;
+
+            if (oldest_lane == lanes_.end() || it->second.last_used < oldest_lane->second.last_used)
+                oldest_lane = it;
+        }
+
+        // A peer could start any number of transfers. Their state is not dropped and new lanes
+        // are not started until one of them ends.
+        if (oldest_lane == lanes_.end())
+        {
+            LOG(LS_WARNING) << "Too many busy lanes, request rejected";
+            return nullptr;
+        }
+
+        --thread_lanes_[oldest_lane->second.thread_index];
+        lanes_.erase(oldest_lane);
+    }
+
+    const size_t thread_index = static_cast<size_t>(std::distance(
+        thread_lanes_.begin(), std::min_element(thread_lanes_.begin(), thread_lanes_.end())));
+
+    std::shared_ptr<base::TaskRunner> thread_task_runner = threads_[thread_index]->taskRunner();
+    if (!thread_task_runner)
+        return nullptr;
+
+    Lane& new_lane = lanes_[lane_id];
+    new_lane.impl = std::make_shared<Impl>(std::move(thread_task_runner));
+    new_lane.thread_index = thread_index;
+
+    ++thread_lanes_[thread_index];
+    return &new_lane;
+}
+
 FileWorker::FileWorker(std::shared_ptr<base::TaskRunner> task_runner)
     : impl_(std::make_shared<Impl>(std::move(task_runner)))
 {
     // Nothing
 }
 
-FileWorker::~FileWorker() = default;
+FileWorker::FileWorker(std::shared_ptr<base::TaskRunner> task_runner,
+                       size_t thread_count,
+                       base::Thread::Delegate* thread_delegate)
+    : pool_(std::make_shared<Pool>(std::move(task_runner), thread_count, thread_delegate))
+{
+    // Nothing
+}
+
+FileWorker::~FileWorker()
+{
+    // The requests in progress are completed. Their replies may still be posted to the owner.
+    if (pool_)
+        pool_->stop();
+}
 
 void FileWorker::doTask(std::shared_ptr<FileTask> task)
 {
-    impl_->doTask(std::move(task));
+    if (pool_)
+        pool_->doTask(std::move(task));
+    else
+        impl_->doTask(std::move(task));
 }
 
 std::shared_ptr<base::TaskRunner> FileWorker::taskRunner()
 {
+    if (pool_)
+        return pool_->taskRunner();
+
     return impl_->taskRunner();
 }
 
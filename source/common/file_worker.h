@@ -20,7 +20,9 @@
 #define COMMON__FILE_WORKER_H
 
 #include "base/macros_magic.h"
+#include "base/threading/thread.h"
 
+#include <cstddef>
 #include <memory>
 
 namespace base {
@@ -31,10 +33,24 @@ namespace common {
 
 class FileTask;
 
+// The number of lanes whose state is kept. The least recently used idle lane without a file
+// transfer in progress is closed when a new one is started. While all lanes are busy, the requests
+// of new lanes are rejected.
+static const size_t kMaxFileWorkerLanes = 32;
+
 class FileWorker
 {
 public:
+    // Executes all requests sequentially on |task_runner|.
     explicit FileWorker(std::shared_ptr<base::TaskRunner> task_runner);
+
+    // Executes the requests on a pool of |thread_count| threads. The requests of different lanes
+    // (see FileRequest::lane) run in parallel, the requests of one lane run sequentially and are
+    // replied in order. The replies are sent from |task_runner|. |thread_delegate| is called on
+    // each thread of the pool (for example, to impersonate a user).
+    FileWorker(std::shared_ptr<base::TaskRunner> task_runner,
+               size_t thread_count,
+               base::Thread::Delegate* thread_delegate = nullptr);
     ~FileWorker();
 
     void doTask(std::shared_ptr<FileTask> task);
@@ -43,7 +59,10 @@ public:
 
 private:
     class Impl;
+    class Pool;
+
     std::shared_ptr<Impl> impl_;
+    std::shared_ptr<Pool> pool_;
 
     DISALLOW_COPY_AND_ASSIGN(FileWorker);
 };
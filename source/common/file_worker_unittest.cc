@@ -0,0 +1,292 @@
+//
+// Aspia Project
+// Copyright (C) 2020 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "common/file_worker.h"
+
+#include "base/files/file_util.h"
+#include "base/message_loop/message_loop.h"
+#include "base/task_runner.h"
+#include "common/file_task_factory.h"
+#include "common/file_task_producer_proxy.h"
+
+#include <gtest/gtest.h>
+
+#include <map>
+
+namespace common {
+
+namespace {
+
+const std::chrono::seconds kTimeout(10);
+const size_t kThreadCount = 2;
+
+class FileWorkerTest
+    : public testing::Test,
+      public FileTaskProducer
+{
+protected:
+    FileWorkerTest()
+        : message_loop_(base::MessageLoop::Type::DEFAULT),
+          task_runner_(message_loop_.taskRunner()),
+          producer_proxy_(std::make_shared<FileTaskProducerProxy>(this)),
+          directory_(std::filesystem::temp_directory_path() / "aspia_file_worker_unittest")
+    {
+        std::error_code ignored_code;
+        std::filesystem::remove_all(directory_, ignored_code);
+        std::filesystem::create_directories(directory_, ignored_code);
+    }
+
+    ~FileWorkerTest() override
+    {
+        producer_proxy_->dettach();
+
+        std::error_code ignored_code;
+        std::filesystem::remove_all(directory_, ignored_code);
+    }
+
+    std::unique_ptr<FileTaskFactory> createFactory()
+    {
+        return std::make_unique<FileTaskFactory>(producer_proxy_, FileTask::Target::LOCAL);
+    }
+
+    std::string path(const char* name) const
+    {
+        return (directory_ / name).u8string();
+    }
+
+    // Runs the message loop until |count| replies are received. Returns false on timeout.
+    bool waitReplies(size_t count)
+    {
+        if (replies_.size() >= count)
+            return true;
+
+        expected_replies_ = count;
+        timed_out_ = false;
+
+        const int generation = ++generation_;
+
+        task_runner_->postDelayedTask([this, generation]()
+        {
+            if (generation != generation_)
+                return;
+
+            timed_out_ = true;
+            task_runner_->postQuit();
+        }, kTimeout);
+
+        message_loop_.run();
+        ++generation_;
+
+        return !timed_out_;
+    }
+
+    // FileTaskProducer implementation.
+    void onTaskDone(std::shared_ptr<FileTask> task) override
+    {
+        replies_.emplace_back(std::move(task));
+
+        if (replies_.size() == expected_replies_)
+            task_runner_->postQuit();
+    }
+
+    base::MessageLoop message_loop_;
+    std::shared_ptr<base::TaskRunner> task_runner_;
+    std::shared_ptr<FileTaskProducerProxy> producer_proxy_;
+
+    const std::filesystem::path directory_;
+    std::vector<std::shared_ptr<FileTask>> replies_;
+
+private:
+    size_t expected_replies_ = 0;
+    bool timed_out_ = false;
+    int generation_ = 0;
+};
+
+} // namespace
+
+TEST_F(FileWorkerTest, LaneOrder)
+{
+    FileWorker worker(task_runner_, kThreadCount);
+
+    std::vector<std::unique_ptr<FileTaskFactory>> factories;
+    std::map<uint32_t, std::vector<std::shared_ptr<FileTask>>> sent;
+
+    for (int i = 0; i < 4; ++i)
+        factories.emplace_back(createFactory());
+
+    // The second request of each lane depends on the first one.
+    for (int i = 0; i < 8; ++i)
+    {
+        for (size_t j = 0; j < factories.size(); ++j)
+        {
+            const std::string name = std::to_string(j);
+
+            std::shared_ptr<FileTask> task = (i % 2) ?
+                factories[j]->remove(path(name.c_str())) :
+                factories[j]->createDirectory(path(name.c_str()));
+
+            sent[factories[j]->lane()].push_back(task);
+            worker.doTask(std::move(task));
+        }
+    }
+
+    ASSERT_TRUE(waitReplies(32));
+
+    std::map<uint32_t, std::vector<std::shared_ptr<FileTask>>> received;
+    for (const auto& task : replies_)
+    {
+        EXPECT_EQ(task->reply().lane(), task->request().lane());
+        EXPECT_EQ(task->reply().error_code(), proto::FILE_ERROR_SUCCESS);
+
+        received[task->request().lane()].push_back(task);
+    }
+
+    EXPECT_EQ(received, sent);
+}
+
+TEST_F(FileWorkerTest, IdleLanesAreClosed)
+{
+    FileWorker worker(task_runner_, kThreadCount);
+
+    // The lanes of finished factories make room for the new ones.
+    for (size_t i = 0; i < 2 * kMaxFileWorkerLanes; ++i)
+    {
+        std::unique_ptr<FileTaskFactory> factory = createFactory();
+        worker.doTask(factory->createDirectory(path(std::to_string(i).c_str())));
+
+        ASSERT_TRUE(waitReplies(i + 1));
+        EXPECT_EQ(replies_.back()->reply().error_code(), proto::FILE_ERROR_SUCCESS);
+    }
+}
+
+TEST_F(FileWorkerTest, BusyLanesLimit)
+{
+    ASSERT_TRUE(base::writeFile(directory_ / "file", std::string(1000, 'x')));
+
+    FileWorker worker(task_runner_, kThreadCount);
+
+    // Each lane has an open file.
+    std::vector<std::unique_ptr<FileTaskFactory>> factories;
+    for (size_t i = 0; i < kMaxFileWorkerLanes; ++i)
+    {
+        factories.emplace_back(createFactory());
+        worker.doTask(factories.back()->download(path("file"), 1));
+    }
+
+    ASSERT_TRUE(waitReplies(kMaxFileWorkerLanes));
+    for (const auto& task : replies_)
+        EXPECT_EQ(task->reply().error_code(), proto::FILE_ERROR_SUCCESS);
+
+    // The request of a new lane is rejected and not executed.
+    std::unique_ptr<FileTaskFactory> factory = createFactory();
+    worker.doTask(factory->createDirectory(path("rejected")));
+
+    ASSERT_TRUE(waitReplies(kMaxFileWorkerLanes + 1));
+    EXPECT_EQ(replies_.back()->reply().error_code(), proto::FILE_ERROR_UNKNOWN);
+    EXPECT_EQ(replies_.back()->reply().lane(), factory->lane());
+
+    std::error_code ignored_code;
+    EXPECT_FALSE(std::filesystem::exists(directory_ / "rejected", ignored_code));
+
+    // The busy lanes continue.
+    worker.doTask(factories[0]->packetRequest(proto::FilePacketRequest::NO_FLAGS));
+
+    ASSERT_TRUE(waitReplies(kMaxFileWorkerLanes + 2));
+    EXPECT_EQ(replies_.back()->reply().error_code(), proto::FILE_ERROR_SUCCESS);
+    EXPECT_TRUE(replies_.back()->reply().packet().flags() & proto::FilePacket::LAST_PACKET);
+
+    // The file of the first lane is completed, its lane is closed for the new one.
+    worker.doTask(factory->createDirectory(path("accepted")));
+
+    ASSERT_TRUE(waitReplies(kMaxFileWorkerLanes + 3));
+    EXPECT_EQ(replies_.back()->reply().error_code(), proto::FILE_ERROR_SUCCESS);
+}
+
+TEST_F(FileWorkerTest, CanceledFilesCloseLanes)
+{
+    ASSERT_TRUE(base::writeFile(directory_ / "file", std::string(100000, 'x')));
+
+    FileWorker worker(task_runner_, kThreadCount);
+
+    // Each transfer is aborted in the middle of the file, as FileTransfer does it.
+    for (size_t i = 0; i <= kMaxFileWorkerLanes; ++i)
+    {
+        const std::string name = std::to_string(i);
+
+        std::unique_ptr<FileTaskFactory> source = createFactory();
+        std::unique_ptr<FileTaskFactory> target = createFactory();
+
+        worker.doTask(source->download(path("file"), 1));
+        worker.doTask(source->packetRequest(proto::FilePacketRequest::NO_FLAGS));
+        worker.doTask(target->upload(path(name.c_str()), false, 1));
+
+        ASSERT_TRUE(waitReplies(replies_.size() + 3));
+
+        // The replies of the two lanes can come in any order.
+        std::shared_ptr<FileTask> packet_reply;
+        for (auto it = replies_.end() - 3; it != replies_.end(); ++it)
+        {
+            ASSERT_EQ((*it)->reply().error_code(), proto::FILE_ERROR_SUCCESS) << i;
+
+            if ((*it)->request().has_packet_request())
+                packet_reply = *it;
+        }
+
+        ASSERT_TRUE(packet_reply);
+
+        const proto::FilePacket& packet = packet_reply->reply().packet();
+        ASSERT_FALSE(packet.flags() & proto::FilePacket::LAST_PACKET);
+        worker.doTask(target->packet(packet));
+
+        // The source replies with an empty last packet and the target deletes the file.
+        proto::FilePacket cancel_packet;
+        cancel_packet.set_flags(proto::FilePacket::LAST_PACKET);
+
+        worker.doTask(source->packetRequest(proto::FilePacketRequest::CANCEL));
+        worker.doTask(target->packet(cancel_packet));
+
+        ASSERT_TRUE(waitReplies(replies_.size() + 3));
+        for (auto it = replies_.end() - 3; it != replies_.end(); ++it)
+            EXPECT_EQ((*it)->reply().error_code(), proto::FILE_ERROR_SUCCESS) << i;
+
+        std::error_code ignored_code;
+        EXPECT_FALSE(std::filesystem::exists(directory_ / name, ignored_code)) << i;
+    }
+
+    // The lanes of the canceled files are closed for the new ones.
+    std::unique_ptr<FileTaskFactory> factory = createFactory();
+    worker.doTask(factory->createDirectory(path("accepted")));
+
+    ASSERT_TRUE(waitReplies(replies_.size() + 1));
+    EXPECT_EQ(replies_.back()->reply().error_code(), proto::FILE_ERROR_SUCCESS);
+}
+
+TEST_F(FileWorkerTest, StoppedPool)
+{
+    std::unique_ptr<FileWorker> worker = std::make_unique<FileWorker>(task_runner_, kThreadCount);
+    std::unique_ptr<FileTaskFactory> factory = createFactory();
+
+    // The request is dispatched after the threads are stopped. It is replied with an error.
+    worker->doTask(factory->createDirectory(path("stopped")));
+    worker.reset();
+
+    ASSERT_TRUE(waitReplies(1));
+    EXPECT_EQ(replies_.back()->reply().error_code(), proto::FILE_ERROR_UNKNOWN);
+}
+
+} // namespace common
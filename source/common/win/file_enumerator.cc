@@ -54,6 +54,12 @@ bool FileEnumerator::FileInfo::isDirectory() const
     return (find_data_.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) != 0;
 }
 
+bool FileEnumerator::FileInfo::isLink() const
+{
+    // Symbolic links and junctions.
+    return (find_data_.dwFileAttributes & FILE_ATTRIBUTE_REPARSE_POINT) != 0;
+}
+
 std::filesystem::path FileEnumerator::FileInfo::name() const
 {
     return std::filesystem::path(find_data_.cFileName);
@@ -38,6 +38,7 @@ public:
         ~FileInfo() = default;
 
         bool isDirectory() const;
+        bool isLink() const;
         std::filesystem::path name() const;
         std::string u8name() const;
         int64_t size() const;
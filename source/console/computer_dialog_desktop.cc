@@ -55,6 +55,7 @@ void ComputerDialogDesktop::restoreSettings(
     combo_codec->addItem(QLatin1String("VP9"), proto::VIDEO_ENCODING_VP9);
     combo_codec->addItem(QLatin1String("VP8"), proto::VIDEO_ENCODING_VP8);
     combo_codec->addItem(QLatin1String("ZSTD"), proto::VIDEO_ENCODING_ZSTD);
+    combo_codec->addItem(QLatin1String("ZSTD + VP9"), proto::VIDEO_ENCODING_HYBRID);
 
     QComboBox* combo_color_depth = ui.combo_color_depth;
     combo_color_depth->addItem(tr("True color (32 bit)"), COLOR_DEPTH_ARGB);
@@ -123,6 +124,12 @@ void ComputerDialogDesktop::restoreSettings(
 
     if (config.flags() & proto::DISABLE_FONT_SMOOTHING)
         ui.checkbox_font_smoothing->setChecked(true);
+
+    if (config.flags() & proto::ENABLE_COLOR_444)
+        ui.checkbox_color_444->setChecked(true);
+
+    if (config.flags() & proto::ENABLE_PROGRESSIVE)
+        ui.checkbox_progressive->setChecked(true);
 }
 
 void ComputerDialogDesktop::saveSettings(proto::DesktopConfig* config)
@@ -132,7 +139,8 @@ void ComputerDialogDesktop::saveSettings(proto::DesktopConfig* config)
 
     config->set_video_encoding(video_encoding);
 
-    if (video_encoding == proto::VIDEO_ENCODING_ZSTD)
+    if (video_encoding == proto::VIDEO_ENCODING_ZSTD ||
+        video_encoding == proto::VIDEO_ENCODING_HYBRID)
     {
         base::PixelFormat pixel_format;
 
@@ -191,13 +199,22 @@ void ComputerDialogDesktop::saveSettings(proto::DesktopConfig* config)
     if (ui.checkbox_lock_at_disconnect->isChecked())
         flags |= proto::LOCK_AT_DISCONNECT;
 
+    if (ui.checkbox_color_444->isChecked() && ui.checkbox_color_444->isEnabled())
+        flags |= proto::ENABLE_COLOR_444;
+
+    if (ui.checkbox_progressive->isChecked() && ui.checkbox_progressive->isEnabled())
+        flags |= proto::ENABLE_PROGRESSIVE;
+
     config->set_flags(flags);
 }
 
 void ComputerDialogDesktop::onCodecChanged(int item_index)
 {
-    bool has_pixel_format =
-        (ui.combo_codec->itemData(item_index).toInt() == proto::VIDEO_ENCODING_ZSTD);
+    const int video_encoding = ui.combo_codec->itemData(item_index).toInt();
+
+    // The hybrid encoding sends the text with Zstd.
+    bool has_pixel_format = (video_encoding == proto::VIDEO_ENCODING_ZSTD ||
+                             video_encoding == proto::VIDEO_ENCODING_HYBRID);
 
     ui.label_color_depth->setEnabled(has_pixel_format);
     ui.combo_color_depth->setEnabled(has_pixel_format);
@@ -205,6 +222,12 @@ void ComputerDialogDesktop::onCodecChanged(int item_index)
     ui.slider_compression_ratio->setEnabled(has_pixel_format);
     ui.label_fast->setEnabled(has_pixel_format);
     ui.label_best->setEnabled(has_pixel_format);
+
+    // Only VP9 supports images without chroma subsampling.
+    ui.checkbox_color_444->setEnabled(video_encoding == proto::VIDEO_ENCODING_VP9);
+
+    // The progressive mode improves the reduced pixel formats of Zstd.
+    ui.checkbox_progressive->setEnabled(video_encoding == proto::VIDEO_ENCODING_ZSTD);
 }
 
 void ComputerDialogDesktop::onCompressionRatioChanged(int value)
@@ -38,7 +38,9 @@ ClientSession::ClientSession(
 
 // static
 std::unique_ptr<ClientSession> ClientSession::create(
-    proto::SessionType session_type, std::unique_ptr<base::NetworkChannel> channel)
+    proto::SessionType session_type,
+    std::unique_ptr<base::NetworkChannel> channel,
+    std::shared_ptr<base::TaskRunner> task_runner)
 {
     if (!channel)
         return nullptr;
@@ -47,8 +49,8 @@ std::unique_ptr<ClientSession> ClientSession::create(
     {
         case proto::SESSION_TYPE_DESKTOP_MANAGE:
         case proto::SESSION_TYPE_DESKTOP_VIEW:
-            return std::unique_ptr<ClientSessionDesktop>(
-                new ClientSessionDesktop(session_type, std::move(channel)));
+            return std::unique_ptr<ClientSessionDesktop>(new ClientSessionDesktop(
+                session_type, std::move(channel), std::move(task_runner)));
 
         case proto::SESSION_TYPE_FILE_TRANSFER:
             return std::unique_ptr<ClientSessionFileTransfer>(
@@ -108,6 +110,16 @@ void ClientSession::sendMessage(base::ByteArray&& buffer)
     channel_->send(std::move(buffer));
 }
 
+size_t ClientSession::sendMessage(const google::protobuf::MessageLite& message)
+{
+    base::ByteArray buffer = channel_->takeFreeBuffer();
+    base::serialize(message, &buffer);
+
+    const size_t size = buffer.size();
+    channel_->send(std::move(buffer));
+    return size;
+}
+
 void ClientSession::onConnected()
 {
     NOTREACHED();
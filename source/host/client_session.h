@@ -26,6 +26,7 @@
 
 namespace base {
 class NetworkChannelProxy;
+class TaskRunner;
 } // namespace base
 
 namespace host {
@@ -54,7 +55,9 @@ public:
     };
 
     static std::unique_ptr<ClientSession> create(
-        proto::SessionType session_type, std::unique_ptr<base::NetworkChannel> channel);
+        proto::SessionType session_type,
+        std::unique_ptr<base::NetworkChannel> channel,
+        std::shared_ptr<base::TaskRunner> task_runner);
 
     void start(Delegate* delegate);
     void stop();
@@ -81,6 +84,10 @@ protected:
     std::shared_ptr<base::NetworkChannelProxy> channelProxy();
     void sendMessage(base::ByteArray&& buffer);
 
+    // Serializes the message into a reused buffer of the channel and sends it. Returns the size of
+    // the serialized message.
+    size_t sendMessage(const google::protobuf::MessageLite& message);
+
     // base::NetworkChannel::Listener implementation.
     void onConnected() override;
     void onDisconnected(base::NetworkChannel::ErrorCode error_code) override;
@@ -22,6 +22,7 @@
 #include "base/power_controller.h"
 #include "base/codec/cursor_encoder.h"
 #include "base/codec/scale_reducer.h"
+#include "base/codec/video_encoder_hybrid.h"
 #include "base/codec/video_encoder_vpx.h"
 #include "base/codec/video_encoder_zstd.h"
 #include "base/codec/video_util.h"
@@ -34,9 +35,36 @@
 
 namespace host {
 
-ClientSessionDesktop::ClientSessionDesktop(
-    proto::SessionType session_type, std::unique_ptr<base::NetworkChannel> channel)
-    : ClientSession(session_type, std::move(channel))
+namespace {
+
+// New frames are skipped while the client has this number of frames which are not acknowledged.
+const uint64_t kMaxFramesInFlight = 4;
+
+// If no frame comes during this time after the client has caught up, the skipped region is sent
+// with a new capture of the screen.
+constexpr std::chrono::milliseconds kSkippedFrameDelay(100);
+
+const int kFrameLatencyWindow = 10;
+
+// If the screen does not change during this time, the encoder improves the areas which it sent
+// with a lower quality.
+constexpr std::chrono::milliseconds kRefinementDelay(1000);
+
+int64_t currentTimeUs()
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+} // namespace
+
+ClientSessionDesktop::ClientSessionDesktop(proto::SessionType session_type,
+                                           std::unique_ptr<base::NetworkChannel> channel,
+                                           std::shared_ptr<base::TaskRunner> task_runner)
+    : ClientSession(session_type, std::move(channel)),
+      frame_latency_(kFrameLatencyWindow),
+      skipped_frame_timer_(task_runner),
+      refinement_timer_(std::move(task_runner))
 {
     // Nothing
 }
@@ -100,6 +128,10 @@ void ClientSessionDesktop::onMessageReceived(const base::ByteArray& buffer)
     {
         readConfig(incoming_message_.config());
     }
+    else if (incoming_message_.has_video_ack())
+    {
+        readVideoAck(incoming_message_.video_ack());
+    }
     else
     {
         LOG(LS_WARNING) << "Unhandled message from client";
@@ -109,7 +141,7 @@ void ClientSessionDesktop::onMessageReceived(const base::ByteArray& buffer)
 
 void ClientSessionDesktop::onMessageWritten(size_t /* pending */)
 {
-    // Nothing
+    bandwidth_estimator_.onMessageWritten();
 }
 
 void ClientSessionDesktop::onStarted()
@@ -135,15 +167,35 @@ void ClientSessionDesktop::onStarted()
     request->set_video_encodings(common::kSupportedVideoEncodings);
 
     // Send the request.
-    sendMessage(base::serialize(outgoing_message_));
+    sendOutgoingMessage();
 }
 
 void ClientSessionDesktop::encode(const base::Frame* frame, const base::MouseCursor* cursor)
 {
     outgoing_message_.Clear();
 
+    if (frame && video_encoder_ && scale_reducer_ && isClientBusy())
+    {
+        skipped_region_.addRegion(frame->constUpdatedRegion());
+        frame = nullptr;
+    }
+
     if (frame && video_encoder_ && scale_reducer_)
     {
+        // The frame is shared by all clients, so the skipped areas are added to a copy of its
+        // updated region.
+        base::Region updated_region = frame->constUpdatedRegion();
+
+        if (!skipped_region_.isEmpty())
+        {
+            skipped_region_.intersectWith(base::Rect::makeSize(frame->size()));
+            updated_region.addRegion(skipped_region_);
+
+            skipped_region_.clear();
+            skipped_frame_timer_.stop();
+        }
+
+        const int64_t capture_time = currentTimeUs();
         const base::Size& source_size = frame->size();
 
         if (preferred_size_.width() > source_size.width() ||
@@ -155,14 +207,20 @@ void ClientSessionDesktop::encode(const base::Frame* frame, const base::MouseCur
         if (preferred_size_.isEmpty())
             preferred_size_ = source_size;
 
-        const base::Frame* scaled_frame = scale_reducer_->scaleFrame(frame, preferred_size_);
+        const base::Frame* scaled_frame =
+            scale_reducer_->scaleFrame(frame, updated_region, preferred_size_);
         if (!scaled_frame)
             return;
 
-        proto::VideoPacket* packet = outgoing_message_.mutable_video_packet();
+        // Without scaling the source frame is returned and its region is not extended.
+        if (scaled_frame != frame)
+            updated_region = scaled_frame->constUpdatedRegion();
+
+        proto::VideoPacket* packet = mutableVideoPacket();
 
         // Encode the frame into a video packet.
-        video_encoder_->encode(scaled_frame, packet);
+        video_encoder_->setBandwidthEstimateKbps(bandwidth_estimator_.bandwidthKbps());
+        video_encoder_->encode(scaled_frame, updated_region, packet);
 
         if (packet->has_format())
         {
@@ -170,6 +228,9 @@ void ClientSessionDesktop::encode(const base::Frame* frame, const base::MouseCur
             screen_size->set_width(frame->size().width());
             screen_size->set_height(frame->size().height());
         }
+
+        numberVideoPacket(packet, capture_time);
+        startRefinementTimer();
     }
 
     if (cursor && cursor_encoder_)
@@ -179,7 +240,7 @@ void ClientSessionDesktop::encode(const base::Frame* frame, const base::MouseCur
     }
 
     if (outgoing_message_.has_video_packet() || outgoing_message_.has_cursor_shape())
-        sendMessage(base::serialize(outgoing_message_));
+        sendOutgoingMessage();
 }
 
 void ClientSessionDesktop::setScreenList(const proto::ScreenList& list)
@@ -190,7 +251,7 @@ void ClientSessionDesktop::setScreenList(const proto::ScreenList& list)
     extension->set_name(common::kSelectScreenExtension);
     extension->set_data(list.SerializeAsString());
 
-    sendMessage(base::serialize(outgoing_message_));
+    sendOutgoingMessage();
 }
 
 void ClientSessionDesktop::injectClipboardEvent(const proto::ClipboardEvent& event)
@@ -200,7 +261,7 @@ void ClientSessionDesktop::injectClipboardEvent(const proto::ClipboardEvent& eve
         outgoing_message_.Clear();
 
         outgoing_message_.mutable_clipboard_event()->CopyFrom(event);
-        sendMessage(base::serialize(outgoing_message_));
+        sendOutgoingMessage();
     }
 }
 
@@ -284,7 +345,7 @@ void ClientSessionDesktop::readExtension(const proto::DesktopExtension& extensio
         desktop_extension->set_name(common::kSystemInfoExtension);
         desktop_extension->set_data(system_info.SerializeAsString());
 
-        sendMessage(base::serialize(outgoing_message_));
+        sendOutgoingMessage();
     }
     else
     {
@@ -301,11 +362,33 @@ void ClientSessionDesktop::readConfig(const proto::DesktopConfig& config)
             break;
 
         case proto::VIDEO_ENCODING_VP9:
-            video_encoder_ = base::VideoEncoderVPX::createVP9();
-            break;
+        {
+            if (config.flags() & proto::ENABLE_COLOR_444)
+                video_encoder_ = base::VideoEncoderVPX::createVP9I444();
+            else
+                video_encoder_ = base::VideoEncoderVPX::createVP9();
+        }
+        break;
 
         case proto::VIDEO_ENCODING_ZSTD:
-            video_encoder_ = base::VideoEncoderZstd::create(
+        {
+            const base::PixelFormat pixel_format = base::parsePixelFormat(config.pixel_format());
+
+            if (config.flags() & proto::ENABLE_PROGRESSIVE)
+            {
+                video_encoder_ = base::VideoEncoderZstd::createProgressive(
+                    pixel_format, config.compress_ratio());
+            }
+            else
+            {
+                video_encoder_ = base::VideoEncoderZstd::create(
+                    pixel_format, config.compress_ratio());
+            }
+        }
+        break;
+
+        case proto::VIDEO_ENCODING_HYBRID:
+            video_encoder_ = base::VideoEncoderHybrid::create(
                 base::parsePixelFormat(config.pixel_format()), config.compress_ratio());
             break;
 
@@ -323,6 +406,8 @@ void ClientSessionDesktop::readConfig(const proto::DesktopConfig& config)
         return;
     }
 
+    video_encoder_->setTileCacheSize(config.tile_cache_size());
+
     cursor_encoder_.reset();
     if (config.flags() & proto::ENABLE_CURSOR_SHAPE)
         cursor_encoder_ = std::make_unique<base::CursorEncoder>();
@@ -342,6 +427,9 @@ void ClientSessionDesktop::readConfig(const proto::DesktopConfig& config)
 
     LOG(LS_INFO) << "NEW CLIENT CONFIGURATION";
     LOG(LS_INFO) << "Video encoding: " << config.video_encoding();
+    LOG(LS_INFO) << "Color 4:4:4: " << ((config.flags() & proto::ENABLE_COLOR_444) != 0);
+    LOG(LS_INFO) << "Progressive: " << ((config.flags() & proto::ENABLE_PROGRESSIVE) != 0);
+    LOG(LS_INFO) << "Tile cache size: " << config.tile_cache_size();
     LOG(LS_INFO) << "Enable cursor shape: " << (cursor_encoder_ != nullptr);
     LOG(LS_INFO) << "Disable font smoothing: " << desktop_session_config_.disable_font_smoothing;
     LOG(LS_INFO) << "Disable desktop effects: " << desktop_session_config_.disable_effects;
@@ -352,4 +440,113 @@ void ClientSessionDesktop::readConfig(const proto::DesktopConfig& config)
     delegate_->onClientSessionConfigured();
 }
 
+void ClientSessionDesktop::readVideoAck(const proto::VideoAck& ack)
+{
+    const int64_t current_time = currentTimeUs();
+
+    if (ack.sequence_number() <= last_acked_sequence_number_ ||
+        ack.sequence_number() > last_sequence_number_ ||
+        ack.capture_time() > current_time)
+    {
+        LOG(LS_WARNING) << "Invalid video acknowledgement: " << ack.sequence_number();
+        return;
+    }
+
+    frame_acks_supported_ = true;
+    last_acked_sequence_number_ = ack.sequence_number();
+
+    const std::chrono::milliseconds latency = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::microseconds(current_time - ack.capture_time()));
+
+    frame_latency_.record(latency.count());
+    bandwidth_estimator_.onMessageAcknowledged(latency);
+
+    if (skipped_region_.isEmpty() || isClientBusy())
+        return;
+
+    // If the screen does not change any more, there is no next frame for the skipped region.
+    skipped_frame_timer_.start(kSkippedFrameDelay, [this]()
+    {
+        if (!skipped_region_.isEmpty())
+            desktop_session_proxy_->captureScreen();
+    });
+}
+
+void ClientSessionDesktop::encodeRefinement()
+{
+    if (!video_encoder_ || !video_encoder_->hasPendingRefinement())
+        return;
+
+    // If the client has not yet received the previous frames, try again later.
+    if (!isClientBusy())
+    {
+        outgoing_message_.Clear();
+
+        proto::VideoPacket* packet = mutableVideoPacket();
+        video_encoder_->encodeRefinement(packet);
+
+        if (packet->dirty_rect_size())
+        {
+            numberVideoPacket(packet, currentTimeUs());
+            sendOutgoingMessage();
+        }
+    }
+
+    // The areas that still change and the next steps of the encoder are improved later.
+    startRefinementTimer();
+}
+
+void ClientSessionDesktop::startRefinementTimer()
+{
+    if (refinement_scheduled_ || !video_encoder_->hasPendingRefinement())
+        return;
+
+    refinement_scheduled_ = true;
+    refinement_timer_.start(kRefinementDelay, [this]()
+    {
+        refinement_scheduled_ = false;
+        encodeRefinement();
+    });
+}
+
+void ClientSessionDesktop::numberVideoPacket(proto::VideoPacket* packet, int64_t capture_time)
+{
+    packet->set_sequence_number(++last_sequence_number_);
+    packet->set_capture_time(capture_time);
+
+    if (frame_acks_supported_)
+    {
+        packet->set_frame_latency(static_cast<uint32_t>(frame_latency_.average()));
+        packet->set_frames_in_flight(
+            static_cast<uint32_t>(last_sequence_number_ - last_acked_sequence_number_ - 1));
+    }
+}
+
+bool ClientSessionDesktop::isClientBusy() const
+{
+    return frame_acks_supported_ &&
+           last_sequence_number_ - last_acked_sequence_number_ >= kMaxFramesInFlight;
+}
+
+proto::VideoPacket* ClientSessionDesktop::mutableVideoPacket()
+{
+    // The packet of the previous frame is reused together with the memory of its data.
+    if (video_packet_)
+        outgoing_message_.set_allocated_video_packet(video_packet_.release());
+
+    return outgoing_message_.mutable_video_packet();
+}
+
+void ClientSessionDesktop::sendOutgoingMessage()
+{
+    bandwidth_estimator_.onMessageSent(sendMessage(outgoing_message_));
+
+    // HostToClient::Clear() deletes the video packet, so it is taken out of the message before.
+    if (outgoing_message_.has_video_packet())
+    {
+        video_packet_.reset(outgoing_message_.release_video_packet());
+        video_packet_->Clear();
+    }
+}
+
 } // namespace host
@@ -20,7 +20,11 @@
 #define HOST__CLIENT_SESSION_DESKTOP_H
 
 #include "base/macros_magic.h"
+#include "base/waitable_timer.h"
+#include "base/codec/running_samples.h"
 #include "base/desktop/geometry.h"
+#include "base/desktop/region.h"
+#include "base/net/bandwidth_estimator.h"
 #include "host/client_session.h"
 #include "host/desktop_session.h"
 
@@ -40,7 +44,8 @@ class ClientSessionDesktop : public ClientSession
 {
 public:
     ClientSessionDesktop(proto::SessionType session_type,
-                         std::unique_ptr<base::NetworkChannel> channel);
+                         std::unique_ptr<base::NetworkChannel> channel,
+                         std::shared_ptr<base::TaskRunner> task_runner);
     ~ClientSessionDesktop();
 
     void setDesktopSessionProxy(std::shared_ptr<DesktopSessionProxy> desktop_session_proxy);
@@ -62,6 +67,13 @@ protected:
 private:
     void readExtension(const proto::DesktopExtension& extension);
     void readConfig(const proto::DesktopConfig& config);
+    void readVideoAck(const proto::VideoAck& ack);
+    void encodeRefinement();
+    void startRefinementTimer();
+    void numberVideoPacket(proto::VideoPacket* packet, int64_t capture_time);
+    bool isClientBusy() const;
+    proto::VideoPacket* mutableVideoPacket();
+    void sendOutgoingMessage();
 
     std::shared_ptr<DesktopSessionProxy> desktop_session_proxy_;
     std::unique_ptr<base::ScaleReducer> scale_reducer_;
@@ -70,9 +82,31 @@ private:
     DesktopSession::Config desktop_session_config_;
     base::Size preferred_size_;
 
+    // Estimates the bandwidth to the client for the video encoder.
+    base::BandwidthEstimator bandwidth_estimator_;
+
+    // The frames are numbered and the client acknowledges them (old clients do not). While the
+    // client has too many frames which are not acknowledged, new frames are skipped and their
+    // updated region is sent with the next frame.
+    bool frame_acks_supported_ = false;
+    uint64_t last_sequence_number_ = 0;
+    uint64_t last_acked_sequence_number_ = 0;
+    base::RunningSamples frame_latency_;
+    base::Region skipped_region_;
+    base::WaitableTimer skipped_frame_timer_;
+
+    // Some encoders send the changes with a lower quality first and improve them when they stop
+    // changing. The timer is not restarted by new frames, otherwise a blinking caret would delay
+    // the refinement of the rest of the screen forever.
+    base::WaitableTimer refinement_timer_;
+    bool refinement_scheduled_ = false;
+
     proto::ClientToHost incoming_message_;
     proto::HostToClient outgoing_message_;
 
+    // The video packet of the last sent message. Its buffers are reused for the next frame.
+    std::unique_ptr<proto::VideoPacket> video_packet_;
+
     DISALLOW_COPY_AND_ASSIGN(ClientSessionDesktop);
 };
 
@@ -31,6 +31,8 @@
 
 #include <wtsapi32.h>
 
+#include <atomic>
+
 namespace host {
 
 namespace {
@@ -90,6 +92,60 @@ bool createLoggedOnUserToken(DWORD session_id, base::win::ScopedHandle* token_ou
     return true;
 }
 
+// Requests of different lanes (for example, a listing of a slow network share and a transfer) are
+// executed in parallel on these threads.
+const size_t kWorkerThreads = 4;
+
+// The impersonation of the current thread of the file worker.
+thread_local std::unique_ptr<base::win::ScopedImpersonator> thread_impersonator;
+
+// Impersonates the logged on user on each thread of the file worker.
+class ImpersonatedThreadDelegate : public base::Thread::Delegate
+{
+public:
+    explicit ImpersonatedThreadDelegate(HANDLE user_token)
+        : user_token_(user_token)
+    {
+        // Nothing
+    }
+
+    // Returns true if a thread could not be impersonated. The threads are impersonated before
+    // base::Thread::start() returns.
+    bool hasFailed() const { return failed_; }
+
+    void onBeforeThreadRunning() override
+    {
+        thread_impersonator = std::make_unique<base::win::ScopedImpersonator>();
+        if (!thread_impersonator->loggedOnUser(user_token_))
+        {
+            LOG(LS_ERROR) << "Unable to impersonate the file worker thread";
+            thread_impersonator.reset();
+            failed_ = true;
+        }
+    }
+
+    void onThreadRunning(base::MessageLoop* message_loop) override
+    {
+        // The requests must never be executed with the rights of the service. The worker does not
+        // use the threads if one of them failed.
+        if (!thread_impersonator)
+            return;
+
+        base::Thread::Delegate::onThreadRunning(message_loop);
+    }
+
+    void onAfterThreadRunning() override
+    {
+        thread_impersonator.reset();
+    }
+
+private:
+    HANDLE user_token_;
+    std::atomic_bool failed_ { false };
+
+    DISALLOW_COPY_AND_ASSIGN(ImpersonatedThreadDelegate);
+};
+
 } // namespace
 
 class ClientSessionFileTransfer::Worker
@@ -114,7 +170,9 @@ protected:
 private:
     base::Thread thread_;
     const base::SessionId session_id_;
+    base::win::ScopedHandle user_token_;
     std::unique_ptr<base::win::ScopedImpersonator> impersonator_;
+    std::unique_ptr<ImpersonatedThreadDelegate> thread_delegate_;
     std::shared_ptr<base::NetworkChannelProxy> channel_proxy_;
     std::shared_ptr<common::FileTaskProducerProxy> producer_proxy_;
     std::unique_ptr<common::FileWorker> impl_;
@@ -153,22 +211,36 @@ void ClientSessionFileTransfer::Worker::postRequest(std::unique_ptr<proto::FileR
     {
         proto::FileReply reply;
         reply.set_error_code(proto::FILE_ERROR_NO_LOGGED_ON_USER);
+        reply.set_lane(request->lane());
         channel_proxy_->send(base::serialize(reply));
     }
 }
 
 void ClientSessionFileTransfer::Worker::onBeforeThreadRunning()
 {
-    base::win::ScopedHandle user_token;
-    if (!createLoggedOnUserToken(session_id_, &user_token))
+    if (!createLoggedOnUserToken(session_id_, &user_token_))
         return;
 
     impersonator_ = std::make_unique<base::win::ScopedImpersonator>();
-    if (!impersonator_->loggedOnUser(user_token))
+    if (!impersonator_->loggedOnUser(user_token_))
         return;
 
+    // The requests are executed on the threads of the worker and the replies are sent from this
+    // thread.
+    thread_delegate_ = std::make_unique<ImpersonatedThreadDelegate>(user_token_);
     producer_proxy_ = std::make_shared<common::FileTaskProducerProxy>(this);
-    impl_ = std::make_unique<common::FileWorker>(thread_.taskRunner());
+    impl_ = std::make_unique<common::FileWorker>(
+        thread_.taskRunner(), kWorkerThreads, thread_delegate_.get());
+
+    if (thread_delegate_->hasFailed())
+    {
+        // The tasks posted to a thread which is not running would never be replied. The requests
+        // are executed sequentially on this thread instead, it is impersonated too.
+        LOG(LS_WARNING) << "Unable to start the threads of the file worker";
+
+        impl_ = std::make_unique<common::FileWorker>(thread_.taskRunner());
+        thread_delegate_.reset();
+    }
 }
 
 void ClientSessionFileTransfer::Worker::onAfterThreadRunning()
@@ -180,7 +252,9 @@ void ClientSessionFileTransfer::Worker::onAfterThreadRunning()
     }
 
     impl_.reset();
+    thread_delegate_.reset();
     impersonator_.reset();
+    user_token_.reset();
 }
 
 void ClientSessionFileTransfer::Worker::onTaskDone(std::shared_ptr<common::FileTask> task)
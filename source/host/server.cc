@@ -131,7 +131,9 @@ void Server::onClientConnected(std::unique_ptr<base::NetworkChannel> channel)
 void Server::onNewSession(base::ServerAuthenticatorManager::SessionInfo&& session_info)
 {
     std::unique_ptr<ClientSession> session = ClientSession::create(
-        static_cast<proto::SessionType>(session_info.session_type), std::move(session_info.channel));
+        static_cast<proto::SessionType>(session_info.session_type),
+        std::move(session_info.channel),
+        task_runner_);
 
     if (session)
     {
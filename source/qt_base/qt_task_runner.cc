@@ -104,23 +104,27 @@ bool QtTaskRunner::belongsToCurrentThread() const
     return impl_->belongsToCurrentThread();
 }
 
-void QtTaskRunner::postTask(Callback callback)
+void QtTaskRunner::postTaskImpl(Callback callback, const base::Location& /* from_here */)
 {
     impl_->postTask(std::move(callback), Qt::NormalEventPriority);
 }
 
-void QtTaskRunner::postDelayedTask(Callback /* callback */, const Milliseconds& /* delay */)
+void QtTaskRunner::postDelayedTaskImpl(Callback /* callback */,
+                                       const Milliseconds& /* delay */,
+                                       const base::Location& /* from_here */)
 {
     NOTIMPLEMENTED();
 }
 
-void QtTaskRunner::postNonNestableTask(Callback callback)
+void QtTaskRunner::postNonNestableTaskImpl(Callback callback,
+                                           const base::Location& /* from_here */)
 {
     impl_->postTask(std::move(callback), Qt::LowEventPriority);
 }
 
-void QtTaskRunner::postNonNestableDelayedTask(
-    Callback /* callback */, const Milliseconds& /* delay */)
+void QtTaskRunner::postNonNestableDelayedTaskImpl(Callback /* callback */,
+                                                  const Milliseconds& /* delay */,
+                                                  const base::Location& /* from_here */)
 {
     NOTIMPLEMENTED();
 }
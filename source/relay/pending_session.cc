@@ -21,8 +21,11 @@
 #include "base/endian_util.h"
 #include "base/location.h"
 #include "base/logging.h"
+#include "base/message_loop/message_loop.h"
+#include "base/message_loop/message_pump_asio.h"
 #include "base/strings/unicode.h"
 
+#include <asio/bind_executor.hpp>
 #include <asio/read.hpp>
 
 namespace relay {
@@ -38,6 +41,7 @@ PendingSession::PendingSession(std::shared_ptr<base::TaskRunner> task_runner,
                                asio::ip::tcp::socket&& socket,
                                Delegate* delegate)
     : delegate_(delegate),
+      io_context_(base::MessageLoop::current()->pumpAsio()->ioContext()),
       timer_(std::move(task_runner)),
       socket_(std::move(socket))
 {
@@ -98,6 +102,7 @@ void PendingSession::doReadMessage(PendingSession* session)
 {
     asio::async_read(session->socket_,
                      asio::buffer(&session->buffer_size_, sizeof(uint32_t)),
+                     asio::bind_executor(session->io_context_,
                      [session](const std::error_code& error_code, size_t bytes_transferred)
     {
         if (error_code)
@@ -118,6 +123,7 @@ void PendingSession::doReadMessage(PendingSession* session)
 
         asio::async_read(session->socket_,
                          asio::buffer(session->buffer_.data(), session->buffer_.size()),
+                         asio::bind_executor(session->io_context_,
                          [session](const std::error_code& error_code, size_t bytes_transferred)
         {
             if (error_code)
@@ -128,8 +134,8 @@ void PendingSession::doReadMessage(PendingSession* session)
             }
 
             session->onMessage();
-        });
-    });
+        }));
+    }));
 }
 
 void PendingSession::onErrorOccurred(
@@ -78,6 +78,10 @@ private:
 
     Delegate* delegate_;
 
+    // The socket can belong to the thread pool. Handlers are executed in this context (on the
+    // thread of the message loop).
+    asio::io_context& io_context_;
+
     base::WaitableTimer timer_;
     asio::ip::tcp::socket socket_;
 
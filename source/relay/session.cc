@@ -20,22 +20,169 @@
 
 #include "base/location.h"
 #include "base/logging.h"
+#include "base/task_runner.h"
 #include "base/strings/unicode.h"
 
+#include <asio/bind_executor.hpp>
+#include <asio/post.hpp>
+#include <asio/strand.hpp>
 #include <asio/write.hpp>
 
+#include <atomic>
+
 namespace relay {
 
-Session::Session(std::pair<asio::ip::tcp::socket, asio::ip::tcp::socket>&& sockets)
-    : socket_{ std::move(sockets.first), std::move(sockets.second) }
+// The part of the session that is used by the handlers of the sockets. It lives while there are
+// handlers and all its methods except start(), stop() and bytesTransferred() are called in
+// |strand_|.
+class Session::Core : public std::enable_shared_from_this<Core>
+{
+public:
+    Core(std::pair<asio::ip::tcp::socket, asio::ip::tcp::socket>&& sockets,
+         std::shared_ptr<base::TaskRunner> task_runner,
+         Session* session);
+
+    void start();
+    void stop();
+
+    // Called by the session on the thread of |task_runner_|.
+    void detach() { session_ = nullptr; }
+
+    int64_t bytesTransferred() const { return bytes_transferred_.load(std::memory_order_relaxed); }
+
+private:
+    void doReadSome(int source);
+    void onErrorOccurred(const base::Location& location, const std::error_code& error_code);
+    void closeSockets();
+
+    static const int kNumberOfSides = 2;
+    static const int kBufferSize = 8192;
+
+    asio::ip::tcp::socket socket_[kNumberOfSides];
+    asio::strand<asio::ip::tcp::socket::executor_type> strand_;
+    std::array<uint8_t, kBufferSize> buffer_[kNumberOfSides];
+
+    std::atomic_int64_t bytes_transferred_ { 0 };
+    bool closed_ = false;
+
+    std::shared_ptr<base::TaskRunner> task_runner_;
+
+    // Accessed only on the thread of |task_runner_|.
+    Session* session_;
+
+    DISALLOW_COPY_AND_ASSIGN(Core);
+};
+
+Session::Core::Core(std::pair<asio::ip::tcp::socket, asio::ip::tcp::socket>&& sockets,
+                    std::shared_ptr<base::TaskRunner> task_runner,
+                    Session* session)
+    : socket_{ std::move(sockets.first), std::move(sockets.second) },
+      strand_(asio::make_strand(socket_[0].get_executor())),
+      task_runner_(std::move(task_runner)),
+      session_(session)
 {
+    DCHECK(task_runner_);
+
     for (size_t i = 0; i < kNumberOfSides; ++i)
         std::fill(buffer_[i].begin(), buffer_[i].end(), 0);
 }
 
+void Session::Core::start()
+{
+    asio::post(strand_, [self = shared_from_this()]()
+    {
+        for (int i = 0; i < kNumberOfSides; ++i)
+            self->doReadSome(i);
+    });
+}
+
+void Session::Core::stop()
+{
+    asio::post(strand_, [self = shared_from_this()]()
+    {
+        self->closeSockets();
+    });
+}
+
+void Session::Core::doReadSome(int source)
+{
+    socket_[source].async_read_some(
+        asio::buffer(buffer_[source].data(), buffer_[source].size()),
+        asio::bind_executor(strand_, [self = shared_from_this(), source](
+            const std::error_code& error_code, size_t bytes_transferred)
+    {
+        if (error_code)
+        {
+            if (error_code != asio::error::operation_aborted)
+                self->onErrorOccurred(FROM_HERE, error_code);
+            return;
+        }
+
+        self->bytes_transferred_.fetch_add(bytes_transferred, std::memory_order_relaxed);
+
+        asio::async_write(
+            self->socket_[(source + kNumberOfSides - 1) % kNumberOfSides],
+            asio::const_buffer(self->buffer_[source].data(), bytes_transferred),
+            asio::bind_executor(self->strand_, [self, source](
+                const std::error_code& error_code, size_t /* bytes_transferred */)
+        {
+            if (error_code)
+            {
+                if (error_code != asio::error::operation_aborted)
+                    self->onErrorOccurred(FROM_HERE, error_code);
+                return;
+            }
+
+            self->doReadSome(source);
+        }));
+    }));
+}
+
+void Session::Core::onErrorOccurred(
+    const base::Location& location, const std::error_code& error_code)
+{
+    if (closed_)
+        return;
+
+    LOG(LS_ERROR) << "Connection finished: " << base::utf16FromLocal8Bit(error_code.message())
+                  << " (" << location.toString() << ")";
+
+    closeSockets();
+
+    // The session is notified on its own thread.
+    task_runner_->postTask([self = shared_from_this()]()
+    {
+        if (self->session_)
+            self->session_->onFinished();
+    });
+}
+
+void Session::Core::closeSockets()
+{
+    if (closed_)
+        return;
+
+    closed_ = true;
+
+    std::error_code ignored_code;
+    for (int i = 0; i < kNumberOfSides; ++i)
+    {
+        socket_[i].cancel(ignored_code);
+        socket_[i].close(ignored_code);
+    }
+}
+
+Session::Session(std::pair<asio::ip::tcp::socket, asio::ip::tcp::socket>&& sockets,
+                 std::shared_ptr<base::TaskRunner> task_runner)
+    : core_(std::make_shared<Core>(std::move(sockets), std::move(task_runner), this))
+{
+    // Nothing
+}
+
 Session::~Session()
 {
     stop();
+    core_->detach();
 }
 
 void Session::start(Delegate* delegate)
@@ -45,8 +192,7 @@ void Session::start(Delegate* delegate)
     start_time_ = std::chrono::high_resolution_clock::now();
     delegate_ = delegate;
 
-    for (int i = 0; i < kNumberOfSides; ++i)
-        Session::doReadSome(this, i);
+    core_->start();
 }
 
 void Session::stop()
@@ -55,13 +201,7 @@ void Session::stop()
         return;
 
     delegate_ = nullptr;
-
-    std::error_code ignored_code;
-    for (int i = 0; i < kNumberOfSides; ++i)
-    {
-        socket_[i].cancel(ignored_code);
-        socket_[i].close(ignored_code);
-    }
+    core_->stop();
 
     LOG(LS_INFO) << "Session stopped (duration: " << duration().count()
                  << " seconds, bytes transferred: " << bytesTransferred() << ")";
@@ -77,48 +217,11 @@ std::chrono::seconds Session::duration() const
 
 int64_t Session::bytesTransferred() const
 {
-    return bytes_transferred_;
+    return core_->bytesTransferred();
 }
 
-// static
-void Session::doReadSome(Session* session, int source)
+void Session::onFinished()
 {
-    session->socket_[source].async_read_some(
-        asio::buffer(session->buffer_[source].data(), session->buffer_[source].size()),
-        [session, source](const std::error_code& error_code, size_t bytes_transferred)
-    {
-        if (error_code)
-        {
-            if (error_code != asio::error::operation_aborted)
-                session->onErrorOccurred(FROM_HERE, error_code);
-        }
-        else
-        {
-            session->bytes_transferred_ += bytes_transferred;
-
-            asio::async_write(
-                session->socket_[(source + kNumberOfSides - 1) % kNumberOfSides],
-                asio::const_buffer(session->buffer_[source].data(), bytes_transferred),
-                [session, source](const std::error_code& error_code, size_t bytes_transferred)
-            {
-                if (error_code)
-                {
-                    if (error_code != asio::error::operation_aborted)
-                        session->onErrorOccurred(FROM_HERE, error_code);
-                }
-                else
-                {
-                    doReadSome(session, source);
-                }
-            });
-        }
-    });
-}
-
-void Session::onErrorOccurred(const base::Location& location, const std::error_code& error_code)
-{
-    LOG(LS_ERROR) << "Connection finished: " << base::utf16FromLocal8Bit(error_code.message())
-                  << " (" << location.toString() << ")";
     if (delegate_)
         delegate_->onSessionFinished(this);
 
@@ -23,16 +23,22 @@
 
 #include <asio/ip/tcp.hpp>
 
+#include <memory>
+
 namespace base {
-class Location;
+class TaskRunner;
 } // namespace base
 
 namespace relay {
 
+// Transfers data between two peers. The transfer is done in a strand on the threads of the sockets'
+// io_context (a thread pool for Type::ASIO_POOL loops), and only notifications of the delegate are
+// delivered to the thread of |task_runner|. All public methods must be called on that thread.
 class Session
 {
 public:
-    explicit Session(std::pair<asio::ip::tcp::socket, asio::ip::tcp::socket>&& sockets);
+    Session(std::pair<asio::ip::tcp::socket, asio::ip::tcp::socket>&& sockets,
+            std::shared_ptr<base::TaskRunner> task_runner);
     ~Session();
 
     class Delegate
@@ -50,18 +56,13 @@ public:
     int64_t bytesTransferred() const;
 
 private:
-    static void doReadSome(Session* session, int source);
-    void onErrorOccurred(const base::Location& location, const std::error_code& error_code);
-
-    std::chrono::time_point<std::chrono::high_resolution_clock> start_time_;
-    int64_t bytes_transferred_ = 0;
+    class Core;
 
-    static const int kNumberOfSides = 2;
-    static const int kBufferSize = 8192;
+    void onFinished();
 
-    asio::ip::tcp::socket socket_[kNumberOfSides];
-    std::array<uint8_t, kBufferSize> buffer_[kNumberOfSides];
+    std::chrono::time_point<std::chrono::high_resolution_clock> start_time_;
 
+    std::shared_ptr<Core> core_;
     Delegate* delegate_ = nullptr;
 
     DISALLOW_COPY_AND_ASSIGN(Session);
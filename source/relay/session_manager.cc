@@ -97,7 +97,8 @@ std::unique_ptr<T> removeSessionT(std::vector<std::unique_ptr<T>>* session_list,
 SessionManager::SessionManager(std::shared_ptr<base::TaskRunner> task_runner, uint16_t port)
     : task_runner_(std::move(task_runner)),
       acceptor_(base::MessageLoop::current()->pumpAsio()->ioContext(),
-                asio::ip::tcp::endpoint(asio::ip::tcp::v4(), port))
+                asio::ip::tcp::endpoint(asio::ip::tcp::v4(), port)),
+      session_context_(base::MessageLoop::current()->pumpAsio()->poolContext())
 {
     DCHECK(task_runner_);
 
@@ -151,7 +152,8 @@ void SessionManager::onPendingSessionReady(
 
                     // Now the opposite peer is found, start the data transfer between them.
                     active_sessions_.emplace_back(std::make_unique<Session>(
-                        std::make_pair(session->takeSocket(), other_session->takeSocket())));
+                        std::make_pair(session->takeSocket(), other_session->takeSocket()),
+                        task_runner_));
                     active_sessions_.back()->start(this);
 
                     // Pending sessions are no longer needed, remove them.
@@ -191,7 +193,9 @@ void SessionManager::onSessionFinished(Session* session)
 // static
 void SessionManager::doAccept(SessionManager* session_manager)
 {
-    session_manager->acceptor_.async_accept(
+    // Accepted sockets belong to the thread pool of the loop (if it has one), so the data transfer
+    // of active sessions is spread over its threads. The handler itself runs on the loop thread.
+    session_manager->acceptor_.async_accept(session_manager->session_context_,
         [session_manager](const std::error_code& error_code, asio::ip::tcp::socket socket)
     {
         if (!error_code)
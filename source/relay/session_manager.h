@@ -65,6 +65,7 @@ private:
     std::shared_ptr<base::TaskRunner> task_runner_;
 
     asio::ip::tcp::acceptor acceptor_;
+    asio::io_context& session_context_;
     std::vector<std::unique_ptr<PendingSession>> pending_sessions_;
     std::vector<std::unique_ptr<Session>> active_sessions_;
 
@@ -25,7 +25,7 @@
 namespace relay {
 
 Service::Service()
-    : base::win::Service(kServiceName, base::MessageLoop::Type::ASIO)
+    : base::win::Service(kServiceName, base::MessageLoop::Type::ASIO_POOL)
 {
     // Nothing
 }